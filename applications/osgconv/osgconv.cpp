@@ -14,6 +14,7 @@
 
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
+#include <osgDB/AsyncReader>
 #include <osgDB/WriteFile>
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReaderWriter>
@@ -113,9 +114,10 @@ class CompressTexturesVisitor : public osg::NodeVisitor
 {
 public:
 
-    CompressTexturesVisitor(osg::Texture::InternalFormatMode internalFormatMode):
+    CompressTexturesVisitor(osg::Texture::InternalFormatMode internalFormatMode, osgDB::ImageProcessor* imageProcessor=0):
         osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
-        _internalFormatMode(internalFormatMode) {}
+        _internalFormatMode(internalFormatMode),
+        _imageProcessor(imageProcessor) {}
 
     virtual void apply(osg::Node& node)
     {
@@ -151,6 +153,12 @@ public:
 
     void compress()
     {
+        if (_imageProcessor.valid())
+        {
+            compressWithImageProcessor();
+            return;
+        }
+
         MyGraphicsContext context;
         if (!context.valid())
         {
@@ -194,6 +202,29 @@ public:
         }
     }
 
+    // compress the images on the CPU, without needing a graphics context.
+    void compressWithImageProcessor()
+    {
+        for(TextureSet::iterator itr=_textureSet.begin();
+            itr!=_textureSet.end();
+            ++itr)
+        {
+            osg::Texture* texture = const_cast<osg::Texture*>(itr->get());
+
+            osg::Texture2D* texture2D = dynamic_cast<osg::Texture2D*>(texture);
+            osg::Texture3D* texture3D = dynamic_cast<osg::Texture3D*>(texture);
+
+            osg::ref_ptr<osg::Image> image = texture2D ? texture2D->getImage() : (texture3D ? texture3D->getImage() : 0);
+            if (image.valid() &&
+                (image->getPixelFormat()==GL_RGB || image->getPixelFormat()==GL_RGBA) &&
+                (image->s()>=32 && image->t()>=32))
+            {
+                _imageProcessor->compress(*image, _internalFormatMode, true, false, osgDB::ImageProcessor::USE_CPU, osgDB::ImageProcessor::PRODUCTION);
+                image->dirty();
+            }
+        }
+    }
+
     void write(const std::string &dir)
     {
         for(TextureSet::iterator itr=_textureSet.begin();
@@ -219,8 +250,9 @@ public:
     }
 
     typedef std::set< osg::ref_ptr<osg::Texture> > TextureSet;
-    TextureSet                          _textureSet;
-    osg::Texture::InternalFormatMode    _internalFormatMode;
+    TextureSet                              _textureSet;
+    osg::Texture::InternalFormatMode        _internalFormatMode;
+    osg::ref_ptr<osgDB::ImageProcessor>     _imageProcessor;
 
 };
 
@@ -442,6 +474,11 @@ static void usage( const char *prog, const char *msg )
     osg::notify(osg::NOTICE)<<"    --compressed-dxt1  - Enable the usage of S3TC DXT1 compressed textures"<< std::endl;
     osg::notify(osg::NOTICE)<<"    --compressed-dxt3  - Enable the usage of S3TC DXT3 compressed textures"<< std::endl;
     osg::notify(osg::NOTICE)<<"    --compressed-dxt5  - Enable the usage of S3TC DXT5 compressed textures"<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --compressed-rgtc1 - Enable the usage of RGTC1 compressed textures"<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --compressed-rgtc2 - Enable the usage of RGTC2 compressed textures"<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --software-compression - Compress textures on the CPU using the registered"<< std::endl;
+    osg::notify(osg::NOTICE)<<"                         ImageProcessor rather than the OpenGL driver, so no"<< std::endl;
+    osg::notify(osg::NOTICE)<<"                         graphics context is required. Generates mipmaps."<< std::endl;
     osg::notify(osg::NOTICE)<< std::endl;
     osg::notify(osg::NOTICE)<<"    --fix-transparency - fix statesets which are currently"<< std::endl;
     osg::notify(osg::NOTICE)<<"                         declared as transparent, but should be opaque."<< std::endl;
@@ -517,6 +554,8 @@ static void usage( const char *prog, const char *msg )
                               "                         (--addMissingColours also accepted)."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --overallNormal    - Replace normals with a single overall normal."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --enable-object-cache - Enable caching of objects, images, etc."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --threads n        - Read the input files concurrently using n threads. By default"<< std::endl
+                            <<"                         they are read one at a time."<< std::endl;
 
     osg::notify( osg::NOTICE ) << std::endl;
     osg::notify( osg::NOTICE ) <<
@@ -734,6 +773,11 @@ int main( int argc, char **argv )
     while(arguments.read("--compressed-dxt1")) { internalFormatMode = osg::Texture::USE_S3TC_DXT1_COMPRESSION; }
     while(arguments.read("--compressed-dxt3")) { internalFormatMode = osg::Texture::USE_S3TC_DXT3_COMPRESSION; }
     while(arguments.read("--compressed-dxt5")) { internalFormatMode = osg::Texture::USE_S3TC_DXT5_COMPRESSION; }
+    while(arguments.read("--compressed-rgtc1")) { internalFormatMode = osg::Texture::USE_RGTC1_COMPRESSION; }
+    while(arguments.read("--compressed-rgtc2")) { internalFormatMode = osg::Texture::USE_RGTC2_COMPRESSION; }
+
+    bool softwareCompression = false;
+    while(arguments.read("--software-compression")) { softwareCompression = true; }
 
     bool smooth = false;
     while(arguments.read("--smooth")) { smooth = true; }
@@ -747,6 +791,10 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    unsigned int numThreads = 0;
+    bool readConcurrently = false;
+    while(arguments.read("--threads",numThreads)) { osgDB::AsyncReader::instance()->setNumThreads(numThreads); readConcurrently = numThreads>1; }
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -780,7 +828,7 @@ int main( int argc, char **argv )
 
     osg::Timer_t startTick = osg::Timer::instance()->tick();
 
-    osg::ref_ptr<osg::Node> root = osgDB::readRefNodeFiles(fileNames);
+    osg::ref_ptr<osg::Node> root = osgDB::readRefNodeFiles(fileNames, osgDB::Registry::instance()->getOptions(), readConcurrently);
 
     if (root.valid())
     {
@@ -826,7 +874,14 @@ int main( int argc, char **argv )
         if (internalFormatMode != osg::Texture::USE_IMAGE_DATA_FORMAT)
         {
             ext = osgDB::getFileExtension(fileNameOut);
-            CompressTexturesVisitor ctv(internalFormatMode);
+            osgDB::ImageProcessor* imageProcessor = 0;
+            if (softwareCompression)
+            {
+                imageProcessor = osgDB::Registry::instance()->getImageProcessor();
+                if (!imageProcessor) osg::notify(osg::NOTICE)<<"Warning: no ImageProcessor available for software compression, falling back to the OpenGL driver."<<std::endl;
+            }
+
+            CompressTexturesVisitor ctv(internalFormatMode, imageProcessor);
             root->accept(ctv);
             ctv.compress();
 
@@ -49,6 +49,7 @@ int main(int argc, char** argv)
     arguments.getApplicationUsage()->addCommandLineOption("--speed <factor>","Speed factor for animation playing (1 == normal speed).");
     arguments.getApplicationUsage()->addCommandLineOption("--device <device-name>","add named device to the viewer");
     arguments.getApplicationUsage()->addCommandLineOption("--stats","print out load and compile timing stats");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Read the files given on the command line concurrently using <num> threads.");
 
     osgViewer::Viewer viewer(arguments);
 
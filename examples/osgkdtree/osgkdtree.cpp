@@ -42,6 +42,139 @@
 #include <osg/KdTree>
 
 #include <iostream>
+#include <cstdlib>
+#include <sstream>
+
+class CollectGeometriesVisitor : public osg::NodeVisitor
+{
+public:
+    CollectGeometriesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    void apply(osg::Geometry& geometry)
+    {
+        _geometries.push_back(&geometry);
+    }
+
+    typedef std::vector< osg::ref_ptr<osg::Geometry> > Geometries;
+    Geometries _geometries;
+};
+
+struct BenchmarkResult
+{
+    BenchmarkResult():
+        buildTime(0.0),
+        queryTime(0.0),
+        numNodes(0),
+        numHits(0) {}
+
+    double          buildTime;
+    double          queryTime;
+    unsigned int    numNodes;
+    unsigned int    numHits;
+};
+
+// build KdTrees for all the geometries with the specified options, then time a set of line segment intersections against them.
+BenchmarkResult runBenchmark(osg::Node* scene, CollectGeometriesVisitor::Geometries& geometries, osg::KdTree::BuildOptions buildOptions, const std::vector<osg::Vec3d>& segments)
+{
+    BenchmarkResult result;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(CollectGeometriesVisitor::Geometries::iterator itr = geometries.begin();
+        itr != geometries.end();
+        ++itr)
+    {
+        osg::ref_ptr<osg::KdTree> kdTree = new osg::KdTree;
+        if (kdTree->build(buildOptions, itr->get()))
+        {
+            (*itr)->setShape(kdTree.get());
+            result.numNodes += static_cast<unsigned int>(kdTree->getNodes().size());
+        }
+        else
+        {
+            (*itr)->setShape(0);
+        }
+    }
+    result.buildTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+    startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i+1<segments.size(); i+=2)
+    {
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(segments[i], segments[i+1]);
+        osgUtil::IntersectionVisitor intersectionVisitor(intersector.get());
+        scene->accept(intersectionVisitor);
+        result.numHits += static_cast<unsigned int>(intersector->getIntersections().size());
+    }
+    result.queryTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+    return result;
+}
+
+void reportBenchmark(const std::string& name, const BenchmarkResult& result, unsigned int numQueries)
+{
+    std::cout<<name<<": build time "<<result.buildTime*1000.0<<"ms, "<<result.numNodes<<" nodes, "
+             <<numQueries<<" queries in "<<result.queryTime*1000.0<<"ms, "<<result.numHits<<" hits"<<std::endl;
+}
+
+int benchmark(osg::ArgumentParser& arguments, const osg::KdTree::BuildOptions& buildOptions)
+{
+    unsigned int numThreads = 0;
+    while (arguments.read("--threads", numThreads)) {}
+
+    unsigned int numQueries = 10000;
+    while (arguments.read("--queries", numQueries)) {}
+
+    osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
+    if (!scene)
+    {
+        std::cout<<"No model loaded, please specify a valid model on the command line."<<std::endl;
+        return 1;
+    }
+
+    CollectGeometriesVisitor collectGeometries;
+    scene->accept(collectGeometries);
+
+    // random line segments passing through the bounding sphere of the scene, the same set is used for each build method.
+    const osg::BoundingSphere& bs = scene->getBound();
+    std::vector<osg::Vec3d> segments;
+    srand(1);
+    for(unsigned int i=0; i<numQueries; ++i)
+    {
+        osg::Vec3d direction(double(rand())/RAND_MAX-0.5, double(rand())/RAND_MAX-0.5, double(rand())/RAND_MAX-0.5);
+        direction.normalize();
+        osg::Vec3d offset(double(rand())/RAND_MAX-0.5, double(rand())/RAND_MAX-0.5, double(rand())/RAND_MAX-0.5);
+        osg::Vec3d center = bs.center() + offset*bs.radius();
+        segments.push_back(center - direction*(bs.radius()*2.0));
+        segments.push_back(center + direction*(bs.radius()*2.0));
+    }
+
+    std::cout<<collectGeometries._geometries.size()<<" geometries"<<std::endl;
+
+    osg::KdTree::BuildOptions midpointOptions = buildOptions;
+    midpointOptions._splitMethod = osg::KdTree::MIDPOINT_SPLIT;
+    BenchmarkResult midpointResult = runBenchmark(scene.get(), collectGeometries._geometries, midpointOptions, segments);
+    reportBenchmark("Midpoint split", midpointResult, numQueries);
+
+    osg::KdTree::BuildOptions sahOptions = buildOptions;
+    sahOptions._splitMethod = osg::KdTree::SAH_SPLIT;
+    sahOptions._numThreads = 1;
+    BenchmarkResult sahResult = runBenchmark(scene.get(), collectGeometries._geometries, sahOptions, segments);
+    reportBenchmark("SAH split", sahResult, numQueries);
+
+    sahOptions._numThreads = numThreads;
+    BenchmarkResult threadedResult = runBenchmark(scene.get(), collectGeometries._geometries, sahOptions, segments);
+    std::ostringstream name;
+    name<<"SAH split, "<<(numThreads>0 ? numThreads : OpenThreads::GetNumberOfProcessors())<<" threads";
+    reportBenchmark(name.str(), threadedResult, numQueries);
+
+    if (sahResult.numHits!=midpointResult.numHits || threadedResult.numHits!=midpointResult.numHits)
+    {
+        std::cout<<"Warning: number of hits differs between build methods."<<std::endl;
+        return 1;
+    }
+
+    return 0;
+}
 
 int main(int argc, char **argv)
 {
@@ -54,6 +187,22 @@ int main(int argc, char **argv)
     while (arguments.read("--max", maxNumLevels)) {}
     while (arguments.read("--leaf", targetNumIndicesPerLeaf)) {}
 
+    osg::KdTreeBuilder* kdTreeBuilder = osgDB::Registry::instance()->getKdTreeBuilder();
+    if (kdTreeBuilder)
+    {
+        kdTreeBuilder->_buildOptions._maxNumLevels = maxNumLevels;
+        kdTreeBuilder->_buildOptions._targetNumTrianglesPerLeaf = targetNumIndicesPerLeaf;
+        if (arguments.read("--sah")) kdTreeBuilder->_buildOptions._splitMethod = osg::KdTree::SAH_SPLIT;
+    }
+
+    if (arguments.read("--benchmark"))
+    {
+        osg::KdTree::BuildOptions buildOptions;
+        buildOptions._maxNumLevels = maxNumLevels;
+        buildOptions._targetNumTrianglesPerLeaf = targetNumIndicesPerLeaf;
+        return benchmark(arguments, buildOptions);
+    }
+
     osgDB::Registry::instance()->setBuildKdTreesHint(osgDB::ReaderWriter::Options::BUILD_KDTREES);
 
     osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
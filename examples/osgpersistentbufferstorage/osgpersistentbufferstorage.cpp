@@ -63,6 +63,47 @@ private:
 };
 
 
+class SineUpdate: public osg::Callback
+{
+public:
+    SineUpdate(osg::Vec4Array* dyn) : _dyn(dyn), _rate(0), _frame(0) {}
+
+    virtual bool run(osg::Object* object, osg::Object* data)
+    {
+        _rate+=0.01;
+        float value =  sinf( _rate );
+        for(int i=0; i<4; i++) {
+            (*_dyn)[i].x() = 4.0f + float(i/2) + float(i)*0.25*value;
+        }
+        _dyn->dirty();
+
+        // every few seconds change the number of ring buffer frames, switching over to plain buffer uploads and back,
+        // so the buffer storage is reallocated under a new buffer object and the colours and indices in it are dispatched again.
+        if ((++_frame)%300==0)
+        {
+            static const unsigned int numFrames[] = { 3, 0, 2 };
+            unsigned int numRingBufferFrames = numFrames[(_frame/300)%3];
+
+            _dyn->getBufferObject()->setNumRingBufferFrames(numRingBufferFrames);
+
+            osg::Geometry* geom = object->asDrawable() ? object->asDrawable()->asGeometry() : 0;
+            if (geom && geom->getNumPrimitiveSets()>0 && geom->getPrimitiveSet(0)->getBufferObject())
+            {
+                geom->getPrimitiveSet(0)->getBufferObject()->setNumRingBufferFrames(numRingBufferFrames);
+            }
+
+            OSG_NOTICE<<"Ring buffer frames set to "<<numRingBufferFrames<<std::endl;
+        }
+
+        return traverse(object, data);
+    }
+
+private:
+    osg::ref_ptr<osg::Vec4Array> _dyn;
+    float _rate;
+    unsigned int _frame;
+};
+
 ///////////////////////////////////////////////////////////////////////////
 
 int main( int, char** )
@@ -112,6 +153,44 @@ int main( int, char** )
 
     }
 
+    //third geometry is modified in an update callback like any dynamic array, and written into a ring of 3 persistently mapped regions,
+    //the colours share its buffer object and the indices have their own ring buffer
+    {
+        osg::ref_ptr<osg::Vec4Array> vAry = new osg::Vec4Array;
+        vAry->setDataVariance(osg::Object::DYNAMIC);
+        vAry->push_back( osg::Vec4(4,0,0,1) );
+        vAry->push_back( osg::Vec4(4,0,1,1) );
+        vAry->push_back( osg::Vec4(5,0,0,1) );
+        vAry->push_back( osg::Vec4(5,0,1,1) );
+        osg::ref_ptr<osg::VertexBufferObject> vbo = new osg::VertexBufferObject;
+        vbo->setNumRingBufferFrames(3);
+        vAry->setBufferObject(vbo);
+
+        osg::ref_ptr<osg::Vec4Array> cAry = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX);
+        cAry->push_back( osg::Vec4(1,0,0,1) );
+        cAry->push_back( osg::Vec4(0,1,0,1) );
+        cAry->push_back( osg::Vec4(0,0,1,1) );
+        cAry->push_back( osg::Vec4(1,1,1,1) );
+        cAry->setBufferObject(vbo);
+
+        osg::ref_ptr<osg::DrawElementsUShort> indices = new osg::DrawElementsUShort(GL_TRIANGLES);
+        indices->push_back(0); indices->push_back(2); indices->push_back(1);
+        indices->push_back(1); indices->push_back(2); indices->push_back(3);
+        osg::ref_ptr<osg::ElementBufferObject> ebo = new osg::ElementBufferObject;
+        ebo->setNumRingBufferFrames(3);
+        indices->setElementBufferObject(ebo);
+
+        osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+        geom->setDataVariance(osg::Object::DYNAMIC);
+        geom->setUseDisplayList(false);
+        geom->setUseVertexBufferObjects(true);
+        geom->setVertexArray( vAry );
+        geom->setColorArray( cAry );
+        geom->addPrimitiveSet( indices );
+        geom->addUpdateCallback(new SineUpdate(vAry));
+        root->addChild(geom);
+    }
+
     osgViewer::Viewer viewer;
     viewer.setSceneData( root );
     return viewer.run();
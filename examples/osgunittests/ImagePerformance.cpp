@@ -0,0 +1,118 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "ImagePerformance.h"
+
+#include <osg/ImageUtils>
+#include <osg/TaskScheduler>
+#include <osg/Timer>
+
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+
+static osg::Image* createTestImage(int size, GLenum pixelFormat, GLenum dataType)
+{
+    osg::Image* image = new osg::Image;
+    image->allocateImage(size, size, 1, pixelFormat, dataType);
+
+    unsigned int numValues = size*size*osg::Image::computeNumComponents(pixelFormat);
+    switch(dataType)
+    {
+        case(GL_UNSIGNED_BYTE):
+        {
+            unsigned char* ptr = image->data();
+            for(unsigned int i=0; i<numValues; ++i) *ptr++ = static_cast<unsigned char>(rand());
+            break;
+        }
+        case(GL_UNSIGNED_SHORT):
+        {
+            unsigned short* ptr = reinterpret_cast<unsigned short*>(image->data());
+            for(unsigned int i=0; i<numValues; ++i) *ptr++ = static_cast<unsigned short>(rand());
+            break;
+        }
+        case(GL_FLOAT):
+        {
+            float* ptr = reinterpret_cast<float*>(image->data());
+            for(unsigned int i=0; i<numValues; ++i) *ptr++ = static_cast<float>(rand())/static_cast<float>(RAND_MAX);
+            break;
+        }
+    }
+    return image;
+}
+
+static void reportImagePerformance(const char* name, unsigned int numThreads, double numPixels, osg::Timer_t startTick, osg::Timer_t endTick)
+{
+    double seconds = osg::Timer::instance()->delta_s(startTick, endTick);
+    std::cout<<"    "<<std::setw(40)<<std::left<<name<<std::right
+             <<" threads "<<std::setw(2)<<numThreads
+             <<std::setw(10)<<std::fixed<<std::setprecision(1)<<(seconds>0.0 ? numPixels/(seconds*1.0e6) : 0.0)<<" MPixel/s"<<std::endl;
+}
+
+static void runImagePerformanceTests(int size, GLenum dataType, unsigned int numThreads, unsigned int numIterations)
+{
+    osg::ref_ptr<osg::Image> image = createTestImage(size, GL_RGBA, dataType);
+    osg::ref_ptr<osg::Image> rgbImage = new osg::Image;
+    rgbImage->allocateImage(size, size, 1, GL_RGB, dataType);
+    osg::ref_ptr<osg::Image> copiedImage = new osg::Image;
+    copiedImage->allocateImage(size, size, 1, GL_RGBA, dataType);
+
+    double numPixels = double(size)*double(size)*double(numIterations);
+    osg::Vec4 minValue, maxValue;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i) osg::computeMinMax(image.get(), minValue, maxValue, numThreads);
+    reportImagePerformance("computeMinMax", numThreads, numPixels, startTick, osg::Timer::instance()->tick());
+
+    startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i) osg::offsetAndScaleImage(image.get(), osg::Vec4(0.0f,0.0f,0.0f,0.0f), osg::Vec4(1.0f,1.0f,1.0f,1.0f), numThreads);
+    reportImagePerformance("offsetAndScaleImage", numThreads, numPixels, startTick, osg::Timer::instance()->tick());
+
+    startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i) osg::copyImage(image.get(), 0, 0, 0, size, size, 1, copiedImage.get(), 0, 0, 0, false, numThreads);
+    reportImagePerformance("copyImage RGBA to RGBA", numThreads, numPixels, startTick, osg::Timer::instance()->tick());
+
+    startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i) osg::copyImage(image.get(), 0, 0, 0, size, size, 1, rgbImage.get(), 0, 0, 0, false, numThreads);
+    reportImagePerformance("copyImage RGBA to RGB", numThreads, numPixels, startTick, osg::Timer::instance()->tick());
+
+    startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i) osg::colorSpaceConversion(osg::MODULATE_ALPHA_BY_LUMINANCE, copiedImage.get(), osg::Vec4(1.0f,1.0f,1.0f,1.0f), numThreads);
+    reportImagePerformance("colorSpaceConversion MODULATE_ALPHA", numThreads, numPixels, startTick, osg::Timer::instance()->tick());
+}
+
+void runImagePerformanceTests(osg::ArgumentParser& arguments)
+{
+    int size = 4096;
+    while (arguments.read("image-size", size)) {}
+
+    unsigned int numIterations = 4;
+    while (arguments.read("image-iterations", numIterations)) {}
+
+    unsigned int maxNumThreads = osg::TaskScheduler::instance()->getNumThreads()+1;
+
+    GLenum dataTypes[] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT };
+    const char* dataTypeNames[] = { "GL_UNSIGNED_BYTE", "GL_UNSIGNED_SHORT", "GL_FLOAT" };
+    for(unsigned int i=0; i<3; ++i)
+    {
+        std::cout<<size<<"x"<<size<<" GL_RGBA "<<dataTypeNames[i]<<" image"<<std::endl;
+
+        runImagePerformanceTests(size, dataTypes[i], 1, numIterations);
+        if (maxNumThreads>1) runImagePerformanceTests(size, dataTypes[i], maxNumThreads, numIterations);
+    }
+}
@@ -0,0 +1,238 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE ABOVE COPYRIGHT NOTICE AND THIS PERMISSION NOTICE SHALL BE INCLUDED IN
+*  ALL COPIES OR SUBSTANTIAL PORTIONS OF THE SOFTWARE.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "UnitTestFramework.h"
+
+#include <osg/Endian>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/PagedLOD>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #include <direct.h>
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace las
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Octree Tests
+//
+class OctreeTestFixture
+{
+public:
+
+    OctreeTestFixture()
+    {
+        const char* tmp = getenv("TMPDIR");
+        if (!tmp) tmp = getenv("TEMP");
+        if (!tmp) tmp = getenv("TMP");
+    #if defined(_WIN32) && !defined(__CYGWIN__)
+        if (!tmp) tmp = ".";
+    #else
+        if (!tmp) tmp = "/tmp";
+    #endif
+
+        std::ostringstream name;
+        name << "osgunittests_las_" << getpid();
+        _directory = osgDB::concatPaths(tmp, name.str());
+    }
+
+    ~OctreeTestFixture()
+    {
+        // remove the las file and the tiles written out, then the directory itself.
+        osgDB::DirectoryContents contents = osgDB::getDirectoryContents(_directory);
+        for(osgDB::DirectoryContents::iterator itr = contents.begin();
+            itr != contents.end();
+            ++itr)
+        {
+            if (*itr!="." && *itr!="..") remove(osgDB::concatPaths(_directory, *itr).c_str());
+        }
+        rmdir(_directory.c_str());
+    }
+
+    void testBuild(const osgUtx::TestContext& ctx);
+
+private:
+
+    template<typename T>
+    static void write(std::ostream& out, T value)
+    {
+        if (osg::getCpuByteOrder()==osg::BigEndian) osg::swapBytes(value);
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static osg::Vec3d position(unsigned int i)
+    {
+        return osg::Vec3d(double(i%200)*0.5, double((i/200)%250)*0.2, double(i%7));
+    }
+
+    // write a LAS 1.2 file of point data format 2 with numPoints points spread over a 100x50x6 box at offset.
+    static bool writeLAS(const std::string& fileName, unsigned int numPoints, const osg::Vec3d& offset, double scale)
+    {
+        std::ofstream out(fileName.c_str(), std::ios::out | std::ios::binary);
+        if (!out) return false;
+
+        // signature, file source id, global encoding, guid, version, system identifier, generating software and date
+        char header[94];
+        memset(header, 0, sizeof(header));
+        memcpy(header, "LASF", 4);
+        header[24] = 1;   // version major
+        header[25] = 2;   // version minor
+        out.write(header, 94);
+        write<unsigned short>(out, 227);            // header size
+        write<unsigned int>(out, 227);              // offset to point data
+        write<unsigned int>(out, 0);                // number of variable length records
+        write<unsigned char>(out, 2);               // point data format
+        write<unsigned short>(out, 26);             // point data record length
+        write<unsigned int>(out, numPoints);
+        write<unsigned int>(out, numPoints);        // points by return
+        for(unsigned int r=1; r<5; ++r) write<unsigned int>(out, 0);
+        for(unsigned int c=0; c<3; ++c) write<double>(out, scale);
+        for(unsigned int c=0; c<3; ++c) write<double>(out, offset[c]);
+
+        osg::BoundingBoxd bounds;
+        for(unsigned int i=0; i<numPoints; ++i) bounds.expandBy(position(i));
+        for(unsigned int c=0; c<3; ++c)
+        {
+            write<double>(out, offset[c] + bounds._max[c]);
+            write<double>(out, offset[c] + bounds._min[c]);
+        }
+
+        for(unsigned int i=0; i<numPoints; ++i)
+        {
+            osg::Vec3d p = position(i);
+            for(unsigned int c=0; c<3; ++c) write<int>(out, static_cast<int>(osg::round(p[c]/scale)));
+            write<unsigned short>(out, 0);          // intensity
+            write<unsigned char>(out, 1 | (1<<3));  // first of one return
+            write<unsigned char>(out, 0);           // classification
+            write<signed char>(out, 0);             // scan angle rank
+            write<unsigned char>(out, 0);           // user data
+            write<unsigned short>(out, 0);          // point source id
+            write<unsigned short>(out, 65535);      // red
+            write<unsigned short>(out, 32768);      // green
+            write<unsigned short>(out, 0);          // blue
+        }
+
+        return out.good();
+    }
+
+    // count the points in the leaf tiles below node, loading the children of the PagedLOD from directory.
+    static unsigned int countLeafPoints(osg::Node* node, const std::string& directory)
+    {
+        osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(node);
+        if (plod)
+        {
+            osg::ref_ptr<osg::Node> children = osgDB::readRefNodeFile(osgDB::concatPaths(directory, plod->getFileName(1)));
+            return children.valid() ? countLeafPoints(children.get(), directory) : 0;
+        }
+
+        osg::Geode* geode = node->asGeode();
+        if (geode)
+        {
+            osg::Geometry* geometry = geode->getDrawable(0)->asGeometry();
+            return geometry && geometry->getVertexArray() ? geometry->getVertexArray()->getNumElements() : 0;
+        }
+
+        osg::Group* group = node->asGroup();
+        unsigned int numPoints = 0;
+        for(unsigned int i=0; group && i<group->getNumChildren(); ++i)
+        {
+            numPoints += countLeafPoints(group->getChild(i), directory);
+        }
+        return numPoints;
+    }
+
+    std::string _directory;
+};
+
+void OctreeTestFixture::testBuild(const osgUtx::TestContext&)
+{
+    // the las plugin is only built where liblas is available.
+    if (!osgDB::Registry::instance()->getReaderWriterForExtension("las"))
+    {
+        OSG_NOTICE<<"las plugin not available, skipping octree test"<<std::endl;
+        return;
+    }
+
+    OSGUTX_TEST_F( osgDB::makeDirectory(_directory) )
+
+    // enough points to overflow a 1MB budget, so that they are spilled to the temporary files, split across several levels.
+    const unsigned int numPoints = 100000;
+    const osg::Vec3d offset(1000.0, 2000.0, 50.0);
+    std::string fileName = osgDB::concatPaths(_directory, "points.las");
+    OSGUTX_TEST_F( writeLAS(fileName, numPoints, offset, 0.01) )
+
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options("octree="+_directory+" octreeTilePoints=256 octreeMemory=1");
+    osg::ref_ptr<osg::Node> root = osgDB::readRefNodeFile(fileName, options.get());
+    OSGUTX_TEST_F( root.valid() )
+
+    // the points are recentred, with the offset and mid point moved into the transform above the octree.
+    osg::MatrixTransform* mt = dynamic_cast<osg::MatrixTransform*>(root.get());
+    OSGUTX_TEST_F( mt!=0 )
+    osg::Vec3d translation = mt->getMatrix().getTrans();
+    OSGUTX_TEST_F( (translation - (offset + osg::Vec3d(49.75, 24.9, 3.0))).length() < 1e-6 )
+
+    // every point ends up in exactly one leaf tile.
+    OSGUTX_TEST_F( countLeafPoints(root.get(), _directory)==numPoints )
+
+    // the root written out reloads in place of the one returned, transform included.
+    osg::ref_ptr<osg::Node> reloaded = osgDB::readRefNodeFile(osgDB::concatPaths(_directory, "points.osgb"));
+    osg::MatrixTransform* reloadedMT = dynamic_cast<osg::MatrixTransform*>(reloaded.get());
+    OSGUTX_TEST_F( reloadedMT!=0 && reloadedMT->getMatrix()==mt->getMatrix() )
+    OSGUTX_TEST_F( reloaded.valid() && countLeafPoints(reloaded.get(), _directory)==numPoints )
+
+    // the temporary files are removed once built.
+    bool temporaryFilesRemoved = true;
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(_directory);
+    for(osgDB::DirectoryContents::iterator itr = contents.begin();
+        itr != contents.end();
+        ++itr)
+    {
+        if (osgDB::getFileExtension(*itr)=="tmp") temporaryFilesRemoved = false;
+    }
+    OSGUTX_TEST_F( temporaryFilesRemoved )
+}
+
+OSGUTX_BEGIN_TESTSUITE(Octree)
+    OSGUTX_ADD_TESTCASE(OctreeTestFixture, testBuild)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(Octree, root.las)
+
+
+}
@@ -0,0 +1,285 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE ABOVE COPYRIGHT NOTICE AND THIS PERMISSION NOTICE SHALL BE INCLUDED IN
+*  ALL COPIES OR SUBSTANTIAL PORTIONS OF THE SOFTWARE.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "UnitTestFramework.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #include <direct.h>
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace obj
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Parallel Parse Tests
+//
+class ParseTestFixture
+{
+public:
+
+    typedef std::vector<osg::Vec3> Vertices;
+    typedef std::map<std::string, Vertices> VerticesMap;
+
+    ParseTestFixture()
+    {
+        const char* tmp = getenv("TMPDIR");
+        if (!tmp) tmp = getenv("TEMP");
+        if (!tmp) tmp = getenv("TMP");
+    #if defined(_WIN32) && !defined(__CYGWIN__)
+        if (!tmp) tmp = ".";
+    #else
+        if (!tmp) tmp = "/tmp";
+    #endif
+
+        std::ostringstream name;
+        name << "osgunittests_obj_" << getpid();
+        _directory = osgDB::concatPaths(tmp, name.str());
+    }
+
+    ~ParseTestFixture()
+    {
+        osgDB::DirectoryContents contents = osgDB::getDirectoryContents(_directory);
+        for(osgDB::DirectoryContents::iterator itr = contents.begin();
+            itr != contents.end();
+            ++itr)
+        {
+            if (*itr!="." && *itr!="..") remove(osgDB::concatPaths(_directory, *itr).c_str());
+        }
+        rmdir(_directory.c_str());
+    }
+
+    void testParallelParseMatchesSerial(const osgUtx::TestContext& ctx);
+
+private:
+
+    // the size of the blocks the loader reads the file in, the boundaries between them are placed mid-line below.
+    static const std::streamoff CHUNK_SIZE = 4*1024*1024;
+
+    // write the coordinate in one of the forms an exporter might, returning the value strtod reads back from it.
+    static float writeCoordinate(std::ostream& out, unsigned int i, unsigned int c)
+    {
+        double value = (double((i*7 + c*13)%2000) - 1000.0) * 0.0123 + double(c);
+        char text[64];
+        switch((i+c)%6)
+        {
+            case 0: sprintf(text, "%.6f", value); break;
+            case 1: sprintf(text, "%g", value); break;
+            case 2: sprintf(text, "%e", value); break;
+            case 3: sprintf(text, "%+.3E", value); break;
+            case 4: sprintf(text, ".%04u", (i*31)%10000); break;
+            default: sprintf(text, "%d", int(value)); break;
+        }
+        out << text;
+        return static_cast<float>(strtod(text, 0));
+    }
+
+    // write an OBJ file of several blocks of vertices and polygons spread over a few groups, filling in the
+    // vertices expected in each group's geometry. Each of the first two blocks ends in a continued line, the second
+    // with its windows line ending split across the boundary.
+    static bool writeOBJ(const std::string& fileName, VerticesMap& expected)
+    {
+        std::ostringstream out;
+
+        const char* groupNames[] = { "alpha", "beta", "gamma" };
+        const std::streamoff boundaries[] = { CHUNK_SIZE, 2*CHUNK_SIZE };
+        const char* lineEnds[] = { "\n", "\r\n" };
+        unsigned int boundary = 0;
+
+        Vertices vertices;
+        std::string groupName;
+        for(unsigned int i=0; out.tellp()<std::streamoff(2*CHUNK_SIZE + 1024*1024); ++i)
+        {
+            // switch group every so often, revisiting the earlier ones
+            if (i%900==0)
+            {
+                groupName = groupNames[(i/900)%3];
+                out << "g " << groupName << "\n";
+            }
+
+            osg::Vec3 v;
+            out << (i%5==0 ? "v\t" : "v ");
+            for(unsigned int c=0; c<3; ++c)
+            {
+                if (c>0) out << (i%4==0 ? " \t" : " ");
+                v[c] = writeCoordinate(out, i, c);
+            }
+            out << (i%3==0 ? "\r\n" : "\n");
+            vertices.push_back(v);
+
+            if (vertices.size()%12!=0) continue;
+
+            // make a polygon of the last dozen vertices, by absolute and relative indices in turn, leaving the last
+            // index to follow on a continuation line
+            std::ostringstream face;
+            std::ostringstream last;
+            int n = vertices.size();
+            face << "f ";
+            for(int j=n-11; j<n; ++j)
+            {
+                if (i%24==11) face << j << " ";
+                else face << j-n-1 << " ";
+            }
+            if (i%24==11) last << n; else last << "-1";
+
+            Vertices& groupVertices = expected[groupName];
+            groupVertices.insert(groupVertices.end(), vertices.end()-12, vertices.end());
+
+            if (boundary<2)
+            {
+                // pad with a comment so that the backslash and the following character end the block
+                std::streamoff gap = boundaries[boundary] - out.tellp() - std::streamoff(face.str().size() + 2);
+                if (gap>=2 && gap<2048)
+                {
+                    out << "#" << std::string(gap-2, '-') << "\n";
+                    out << face.str() << "\\" << lineEnds[boundary] << "   " << last.str() << "\n";
+                    ++boundary;
+                    continue;
+                }
+            }
+
+            if (i%5==0) out << face.str() << "\\\n\t" << last.str() << "\n";
+            else out << face.str() << last.str() << "\n";
+        }
+
+        if (boundary!=2) return false;
+
+        std::ofstream fout(fileName.c_str(), std::ios::out | std::ios::binary);
+        if (!fout) return false;
+        std::string text = out.str();
+        fout.write(text.c_str(), text.size());
+        return fout.good();
+    }
+
+    class CollectVerticesVisitor : public osg::NodeVisitor
+    {
+    public:
+        CollectVerticesVisitor(VerticesMap& verticesMap):
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _verticesMap(verticesMap) {}
+
+        virtual void apply(osg::Geode& geode)
+        {
+            for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+            {
+                osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+                osg::Vec3Array* vertices = geometry ? dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray()) : 0;
+                if (vertices)
+                {
+                    Vertices& collected = _verticesMap[geode.getName()];
+                    collected.insert(collected.end(), vertices->begin(), vertices->end());
+                }
+            }
+        }
+
+    protected:
+        VerticesMap& _verticesMap;
+    };
+
+    static bool read(const std::string& fileName, const std::string& optionString, VerticesMap& verticesMap)
+    {
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionString);
+        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(fileName, options.get());
+        if (!node) return false;
+
+        CollectVerticesVisitor cvv(verticesMap);
+        node->accept(cvv);
+        return true;
+    }
+
+    static bool equivalent(const VerticesMap& lhs, const VerticesMap& rhs)
+    {
+        if (lhs.size()!=rhs.size()) return false;
+        for(VerticesMap::const_iterator litr = lhs.begin(), ritr = rhs.begin();
+            litr != lhs.end();
+            ++litr, ++ritr)
+        {
+            if (litr->first!=ritr->first || litr->second.size()!=ritr->second.size()) return false;
+            for(unsigned int i=0; i<litr->second.size(); ++i)
+            {
+                for(unsigned int c=0; c<3; ++c)
+                {
+                    float l = litr->second[i][c], r = ritr->second[i][c];
+                    if (fabs(l-r) > 1e-6f*osg::maximum(1.0f, fabsf(r))) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::string _directory;
+};
+
+void ParseTestFixture::testParallelParseMatchesSerial(const osgUtx::TestContext&)
+{
+    if (!osgDB::Registry::instance()->getReaderWriterForExtension("obj"))
+    {
+        OSG_NOTICE<<"obj plugin not available, skipping parse test"<<std::endl;
+        return;
+    }
+
+    OSGUTX_TEST_F( osgDB::makeDirectory(_directory) )
+
+    std::string fileName = osgDB::concatPaths(_directory, "chunks.obj");
+    VerticesMap expected;
+    OSGUTX_TEST_F( writeOBJ(fileName, expected) )
+    OSGUTX_TEST_F( expected.size()==3 )
+
+    // keep the faces as written, so the vertices come out in file order
+    const std::string options = "noRotation noReverseFaces noTesselateLargePolygons noTriStripPolygons generateFacetNormals";
+
+    VerticesMap serial;
+    OSGUTX_TEST_F( read(fileName, options+" numThreads=1", serial) )
+    OSGUTX_TEST_F( equivalent(serial, expected) )
+
+    VerticesMap parallel;
+    OSGUTX_TEST_F( read(fileName, options+" numThreads=3", parallel) )
+    OSGUTX_TEST_F( equivalent(parallel, serial) )
+}
+
+OSGUTX_BEGIN_TESTSUITE(Parse)
+    OSGUTX_ADD_TESTCASE(ParseTestFixture, testParallelParseMatchesSerial)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(Parse, root.obj)
+
+
+}
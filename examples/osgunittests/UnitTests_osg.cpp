@@ -22,7 +22,21 @@
 #include <osg/Matrixf>
 #include <osg/Vec3d>
 #include <osg/Vec3>
+#include <osg/TaskScheduler>
+#include <osg/ImageUtils>
+#include <osg/Texture>
+#include <osg/Vec4ub>
+#include <osg/Texture>
+#include <osg/Vec4ub>
+#include <osg/BufferObject>
+#include <osg/Version>
+#include <osgDB/Registry>
 #include <sstream>
+#include <vector>
+#include <float.h>
+#include <stdlib.h>
+#include <stdlib.h>
+#include <string.h>
 
 namespace osg
 {
@@ -102,6 +116,7 @@ public:
     void testPostMultScale(const osgUtx::TestContext& ctx);
     void testPreMultRotate(const osgUtx::TestContext& ctx);
     void testPostMultRotate(const osgUtx::TestContext& ctx);
+    void testMultMatchesScalar(const osgUtx::TestContext& ctx);
 
 private:
 
@@ -369,6 +384,57 @@ void MatrixTestFixture::testPostMultRotate(const osgUtx::TestContext&)
     OSGUTX_TEST_F( tfo == tfn )
 }
 
+// Reference multiply using the same order of operations as the scalar Matrix_implementation code,
+// used to check that the SIMD kernels give bit for bit identical results.
+template<class M>
+M scalarMult(const M& lhs, const M& rhs)
+{
+    M result;
+    for(int r=0; r<4; ++r)
+    {
+        for(int c=0; c<4; ++c)
+        {
+            result(r,c) = (lhs(r,0) * rhs(0,c)) + (lhs(r,1) * rhs(1,c)) + (lhs(r,2) * rhs(2,c)) + (lhs(r,3) * rhs(3,c));
+        }
+    }
+    return result;
+}
+
+template<class M>
+bool testMultAgainstScalar(const M& lhs, const M& rhs)
+{
+    M expected = scalarMult(lhs, rhs);
+
+    M mult;
+    mult.mult(lhs, rhs);
+
+    M preMult(rhs);
+    preMult.preMult(lhs);
+
+    M postMult(lhs);
+    postMult.postMult(rhs);
+
+    return mult==expected && preMult==expected && postMult==expected;
+}
+
+void MatrixTestFixture::testMultMatchesScalar(const osgUtx::TestContext&)
+{
+    osg::Matrixd rd = osg::Matrixd::rotate(0.3, osg::Vec3d(0.2, 0.5, 0.8)) * osg::Matrixd::translate(1.5, -2.25, 3.125);
+    osg::Matrixd pd = osg::Matrixd::perspective(33.0, 1.6, 0.1, 10000.0);
+    osg::Matrixf rf(rd);
+    osg::Matrixf pf(pd);
+
+    OSGUTX_TEST_F( testMultAgainstScalar(_md, _md) )
+    OSGUTX_TEST_F( testMultAgainstScalar(_md, rd) )
+    OSGUTX_TEST_F( testMultAgainstScalar(rd, pd) )
+    OSGUTX_TEST_F( testMultAgainstScalar(pd, rd) )
+
+    OSGUTX_TEST_F( testMultAgainstScalar(_mf, _mf) )
+    OSGUTX_TEST_F( testMultAgainstScalar(_mf, rf) )
+    OSGUTX_TEST_F( testMultAgainstScalar(rf, pf) )
+    OSGUTX_TEST_F( testMultAgainstScalar(pf, rf) )
+}
+
 OSGUTX_BEGIN_TESTSUITE(Matrix)
     OSGUTX_ADD_TESTCASE(MatrixTestFixture, testPreMultTranslate)
     OSGUTX_ADD_TESTCASE(MatrixTestFixture, testPostMultTranslate)
@@ -376,9 +442,703 @@ OSGUTX_BEGIN_TESTSUITE(Matrix)
     OSGUTX_ADD_TESTCASE(MatrixTestFixture, testPostMultScale)
     OSGUTX_ADD_TESTCASE(MatrixTestFixture, testPreMultRotate)
     OSGUTX_ADD_TESTCASE(MatrixTestFixture, testPostMultRotate)
+    OSGUTX_ADD_TESTCASE(MatrixTestFixture, testMultMatchesScalar)
 OSGUTX_END_TESTSUITE
 
 OSGUTX_AUTOREGISTER_TESTSUITE_AT(Matrix, root.osg)
 
 
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  TaskScheduler Tests
+//
+class CountOperation : public Operation
+{
+public:
+    CountOperation(OpenThreads::Atomic& count):
+        Operation("Count", false),
+        _count(count) {}
+
+    virtual void operator () (Object*) { ++_count; }
+
+    OpenThreads::Atomic& _count;
+};
+
+class GateOperation : public Operation
+{
+public:
+    GateOperation(OpenThreads::Atomic& open):
+        Operation("Gate", false),
+        _open(open) {}
+
+    virtual void operator () (Object*) { while(_open==0) OpenThreads::Thread::microSleep(1000); }
+
+    OpenThreads::Atomic& _open;
+};
+
+class WaitOperation : public Operation
+{
+public:
+    WaitOperation(TaskScheduler* scheduler, TaskGroup* group):
+        Operation("Wait", false),
+        _scheduler(scheduler),
+        _group(group) {}
+
+    virtual void operator () (Object*) { _scheduler->wait(_group.get()); }
+
+    TaskScheduler*      _scheduler;
+    ref_ptr<TaskGroup>  _group;
+};
+
+class AddTasksThread : public OpenThreads::Thread
+{
+public:
+    AddTasksThread(TaskScheduler* scheduler, TaskGroup* group, OpenThreads::Atomic& count, unsigned int numTasks):
+        _scheduler(scheduler),
+        _group(group),
+        _count(count),
+        _numTasks(numTasks) {}
+
+    virtual void run()
+    {
+        for(unsigned int i=0; i<_numTasks; ++i) _scheduler->add(new CountOperation(_count), _group.get());
+    }
+
+    ref_ptr<TaskScheduler>  _scheduler;
+    ref_ptr<TaskGroup>      _group;
+    OpenThreads::Atomic&    _count;
+    unsigned int            _numTasks;
+};
+
+class MarkItemsFunctor : public TaskScheduler::ParallelForFunctor
+{
+public:
+    MarkItemsFunctor(unsigned int numItems, unsigned int grainSize):
+        _marks(numItems, 0),
+        _grainSize(grainSize) {}
+
+    virtual void operator() (unsigned int begin, unsigned int end)
+    {
+        if (begin%_grainSize!=0 || end<=begin || end-begin>_grainSize) ++_numInvalidRanges;
+        for(unsigned int i=begin; i<end; ++i) ++_marks[i];
+    }
+
+    std::vector<unsigned int>   _marks;
+    unsigned int                _grainSize;
+    OpenThreads::Atomic         _numInvalidRanges;
+};
+
+class TaskSchedulerTestFixture
+{
+public:
+
+    TaskSchedulerTestFixture():
+        _scheduler(new TaskScheduler(3)) {}
+
+    void testWait(const osgUtx::TestContext& ctx);
+    void testContinuation(const osgUtx::TestContext& ctx);
+    void testWaitForPinnedTask(const osgUtx::TestContext& ctx);
+    void testWaitOnlyRunsGroupTasks(const osgUtx::TestContext& ctx);
+    void testCancelWhileAdding(const osgUtx::TestContext& ctx);
+    void testParallelFor(const osgUtx::TestContext& ctx);
+
+private:
+
+    ref_ptr<TaskScheduler> _scheduler;
+};
+
+void TaskSchedulerTestFixture::testWait(const osgUtx::TestContext&)
+{
+    OpenThreads::Atomic count;
+    ref_ptr<TaskGroup> group = new TaskGroup;
+    for(unsigned int i=0; i<100; ++i)
+    {
+        _scheduler->add(new CountOperation(count), group.get());
+    }
+    for(unsigned int i=0; i<_scheduler->getNumThreads(); ++i)
+    {
+        _scheduler->addToThread(new CountOperation(count), i, group.get());
+    }
+    _scheduler->wait(group.get());
+
+    OSGUTX_TEST_F( group->done() )
+    OSGUTX_TEST_F( static_cast<unsigned int>(count)==100+_scheduler->getNumThreads() )
+}
+
+void TaskSchedulerTestFixture::testContinuation(const osgUtx::TestContext&)
+{
+    OpenThreads::Atomic count;
+    OpenThreads::Atomic continued;
+    ref_ptr<TaskGroup> group = new TaskGroup;
+    for(unsigned int i=0; i<10; ++i)
+    {
+        _scheduler->add(new CountOperation(count), group.get());
+    }
+
+    group->addContinuation(new CountOperation(continued), _scheduler.get());
+    _scheduler->wait(group.get());
+
+    OSGUTX_TEST_F( static_cast<unsigned int>(count)==10 )
+
+    // the continuation may still be queued once wait() returns, cancel() runs anything outstanding.
+    _scheduler->cancel();
+    OSGUTX_TEST_F( static_cast<unsigned int>(continued)==1 )
+
+    group->addContinuation(new CountOperation(continued), _scheduler.get());
+    OSGUTX_TEST_F( static_cast<unsigned int>(continued)==2 )
+}
+
+void TaskSchedulerTestFixture::testWaitForPinnedTask(const osgUtx::TestContext&)
+{
+    // worker 0 waits on a group held open by worker 1, then has a task for that group pinned to it.
+    OpenThreads::Atomic open;
+    OpenThreads::Atomic count;
+    ref_ptr<TaskGroup> innerGroup = new TaskGroup;
+    ref_ptr<TaskGroup> outerGroup = new TaskGroup;
+    _scheduler->addToThread(new GateOperation(open), 1, innerGroup.get());
+    _scheduler->addToThread(new WaitOperation(_scheduler.get(), innerGroup.get()), 0, outerGroup.get());
+
+    OpenThreads::Thread::microSleep(100000);
+    _scheduler->addToThread(new CountOperation(count), 0, innerGroup.get());
+    open.exchange(1);
+
+    _scheduler->wait(outerGroup.get());
+
+    OSGUTX_TEST_F( innerGroup->done() )
+    OSGUTX_TEST_F( static_cast<unsigned int>(count)==1 )
+}
+
+void TaskSchedulerTestFixture::testWaitOnlyRunsGroupTasks(const osgUtx::TestContext&)
+{
+    // the only worker is held up, so the task of another group can only be run by the thread waiting on group.
+    ref_ptr<TaskScheduler> scheduler = new TaskScheduler(1);
+    OpenThreads::Atomic open;
+    OpenThreads::Atomic unrelated;
+    OpenThreads::Atomic count;
+    ref_ptr<TaskGroup> otherGroup = new TaskGroup;
+    ref_ptr<TaskGroup> group = new TaskGroup;
+    scheduler->addToThread(new GateOperation(open), 0, otherGroup.get());
+    scheduler->add(new CountOperation(unrelated), otherGroup.get());
+    for(unsigned int i=0; i<10; ++i)
+    {
+        scheduler->add(new CountOperation(count), group.get());
+    }
+
+    scheduler->wait(group.get());
+
+    OSGUTX_TEST_F( static_cast<unsigned int>(count)==10 )
+    OSGUTX_TEST_F( static_cast<unsigned int>(unrelated)==0 )
+
+    open.exchange(1);
+    scheduler->wait(otherGroup.get());
+
+    OSGUTX_TEST_F( static_cast<unsigned int>(unrelated)==1 )
+}
+
+void TaskSchedulerTestFixture::testCancelWhileAdding(const osgUtx::TestContext&)
+{
+    // every task added while the scheduler is cancelled is run, either by the workers, by cancel() or by add() itself.
+    const unsigned int numTasks = 2000;
+    for(unsigned int attempt=0; attempt<20; ++attempt)
+    {
+        ref_ptr<TaskScheduler> scheduler = new TaskScheduler(2);
+        ref_ptr<TaskGroup> group = new TaskGroup;
+        OpenThreads::Atomic count;
+
+        AddTasksThread thread(scheduler.get(), group.get(), count, numTasks);
+        thread.startThread();
+        OpenThreads::Thread::microSleep(attempt*50);
+        scheduler->cancel();
+        thread.join();
+
+        // poll rather than block, so that a task left on a queue fails the test rather than hanging it.
+        for(unsigned int i=0; i<5000 && !group->done(); ++i) OpenThreads::Thread::microSleep(1000);
+
+        OSGUTX_TEST_F( group->done() )
+        OSGUTX_TEST_F( static_cast<unsigned int>(count)==numTasks )
+    }
+}
+
+void TaskSchedulerTestFixture::testParallelFor(const osgUtx::TestContext&)
+{
+    unsigned int grainSizes[] = { 1, 7, 1000 };
+    for(unsigned int g=0; g<3; ++g)
+    {
+        MarkItemsFunctor functor(10001, grainSizes[g]);
+        _scheduler->parallelFor(10001, functor, 0, grainSizes[g]);
+
+        bool eachOnce = true;
+        for(unsigned int i=0; i<functor._marks.size(); ++i) eachOnce = eachOnce && functor._marks[i]==1;
+
+        OSGUTX_TEST_F( eachOnce )
+        OSGUTX_TEST_F( functor._numInvalidRanges==0 )
+    }
+
+    OSGUTX_TEST_F( _scheduler->computeNumThreads(100, 1000, 0)==1 )
+    OSGUTX_TEST_F( _scheduler->computeNumThreads(3000, 1000, 2)==2 )
+    OSGUTX_TEST_F( _scheduler->computeNumThreads(100000, 1000, 0)==_scheduler->getNumThreads()+1 )
+}
+
+OSGUTX_BEGIN_TESTSUITE(TaskScheduler)
+    OSGUTX_ADD_TESTCASE(TaskSchedulerTestFixture, testWait)
+    OSGUTX_ADD_TESTCASE(TaskSchedulerTestFixture, testContinuation)
+    OSGUTX_ADD_TESTCASE(TaskSchedulerTestFixture, testWaitForPinnedTask)
+    OSGUTX_ADD_TESTCASE(TaskSchedulerTestFixture, testWaitOnlyRunsGroupTasks)
+    OSGUTX_ADD_TESTCASE(TaskSchedulerTestFixture, testCancelWhileAdding)
+    OSGUTX_ADD_TESTCASE(TaskSchedulerTestFixture, testParallelFor)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(TaskScheduler, root.osg)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  ImageUtils Tests
+//
+struct ImageRangeOperator : public CastAndScaleToFloatOperation
+{
+    ImageRangeOperator(): _min(FLT_MAX,FLT_MAX,FLT_MAX,FLT_MAX), _max(-FLT_MAX,-FLT_MAX,-FLT_MAX,-FLT_MAX) {}
+
+    inline void luminance(float l) { rgba(l,l,l,l); }
+    inline void alpha(float a) { rgba(1.0f,1.0f,1.0f,a); }
+    inline void luminance_alpha(float l,float a) { rgba(l,l,l,a); }
+    inline void rgb(float r,float g,float b) { rgba(r,g,b,1.0f); }
+    inline void rgba(float r,float g,float b,float a)
+    {
+        Vec4 v(r,g,b,a);
+        for(unsigned int i=0; i<4; ++i)
+        {
+            _min[i] = minimum(v[i], _min[i]);
+            _max[i] = maximum(v[i], _max[i]);
+        }
+    }
+
+    Vec4 _min;
+    Vec4 _max;
+};
+
+struct ImageOffsetAndScaleOperator
+{
+    ImageOffsetAndScaleOperator(const Vec4& offset, const Vec4& scale): _offset(offset), _scale(scale) {}
+
+    inline void luminance(float& l) const { l = _offset.r() + l*_scale.r(); }
+    inline void alpha(float& a) const { a = _offset.a() + a*_scale.a(); }
+    inline void luminance_alpha(float& l,float& a) const { luminance(l); alpha(a); }
+    inline void rgb(float& r,float& g,float& b) const { r = _offset.r() + r*_scale.r(); g = _offset.g() + g*_scale.g(); b = _offset.b() + b*_scale.b(); }
+    inline void rgba(float& r,float& g,float& b,float& a) const { rgb(r,g,b); alpha(a); }
+
+    Vec4 _offset;
+    Vec4 _scale;
+};
+
+class ImageUtilsTestFixture
+{
+public:
+
+    void testComputeMinMax(const osgUtx::TestContext& ctx);
+    void testOffsetAndScaleImage(const osgUtx::TestContext& ctx);
+    void testCopyImage(const osgUtx::TestContext& ctx);
+
+private:
+
+    // large enough for the rows to be spread across threads.
+    static Image* createImage(GLenum pixelFormat, GLenum dataType)
+    {
+        Image* image = new Image;
+        image->allocateImage(509, 517, 1, pixelFormat, dataType);
+        unsigned char* data = image->data();
+        for(unsigned int i=0; i<image->getTotalSizeInBytes(); ++i) data[i] = static_cast<unsigned char>((i*7919)>>3);
+        if (dataType==GL_FLOAT)
+        {
+            float* values = reinterpret_cast<float*>(data);
+            for(unsigned int i=0; i<image->getTotalSizeInBytes()/sizeof(float); ++i) values[i] = float(i%1013)/1013.0f;
+        }
+        return image;
+    }
+};
+
+void ImageUtilsTestFixture::testComputeMinMax(const osgUtx::TestContext&)
+{
+    GLenum pixelFormats[] = { GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_BGRA };
+    GLenum dataTypes[] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT, GL_SHORT };
+    for(unsigned int f=0; f<4; ++f)
+    {
+        for(unsigned int d=0; d<4; ++d)
+        {
+            ref_ptr<Image> image = createImage(pixelFormats[f], dataTypes[d]);
+
+            ImageRangeOperator rangeOp;
+            readImage(image.get(), rangeOp);
+
+            Vec4 minValue, maxValue;
+            OSGUTX_TEST_F( computeMinMax(image.get(), minValue, maxValue, 4) )
+            OSGUTX_TEST_F( minValue==rangeOp._min && maxValue==rangeOp._max )
+        }
+    }
+}
+
+void ImageUtilsTestFixture::testOffsetAndScaleImage(const osgUtx::TestContext&)
+{
+    GLenum dataTypes[] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT };
+    for(unsigned int d=0; d<3; ++d)
+    {
+        // values stay in range so the result matches modifyImage() with an equivalent operator.
+        ref_ptr<Image> image = createImage(GL_BGR, dataTypes[d]);
+        ref_ptr<Image> expected = new Image(*image, CopyOp::DEEP_COPY_ALL);
+
+        Vec4 offset(0.1f, 0.05f, 0.2f, 0.0f);
+        Vec4 scale(0.5f, 0.9f, 0.75f, 1.0f);
+        offsetAndScaleImage(image.get(), offset, scale, 4);
+        modifyImage(expected.get(), ImageOffsetAndScaleOperator(offset, scale));
+
+        OSGUTX_TEST_F( memcmp(image->data(), expected->data(), image->getTotalSizeInBytes())==0 )
+    }
+
+    // unsigned bytes are clamped rather than wrapping round.
+    ref_ptr<Image> image = new Image;
+    image->allocateImage(2, 1, 1, GL_LUMINANCE, GL_UNSIGNED_BYTE);
+    image->data()[0] = 10;
+    image->data()[1] = 250;
+    offsetAndScaleImage(image.get(), Vec4(-0.1f, 0.0f, 0.0f, 0.0f), Vec4(1.2f, 1.0f, 1.0f, 1.0f));
+    OSGUTX_TEST_F( image->data()[0]==0 && image->data()[1]==255 )
+}
+
+void ImageUtilsTestFixture::testCopyImage(const osgUtx::TestContext&)
+{
+    ref_ptr<Image> image = createImage(GL_BGR, GL_UNSIGNED_SHORT);
+    ref_ptr<Image> rgba = new Image;
+    rgba->allocateImage(image->s(), image->t(), 1, GL_RGBA, GL_UNSIGNED_SHORT);
+    OSGUTX_TEST_F( copyImage(image.get(), 0, 0, 0, image->s(), image->t(), 1, rgba.get(), 0, 0, 0, false, 4) )
+
+    bool matches = true;
+    for(int t=0; t<image->t(); ++t)
+    {
+        for(int s=0; s<image->s(); ++s)
+        {
+            const unsigned short* bgr = reinterpret_cast<const unsigned short*>(image->data(s, t));
+            const unsigned short* pixel = reinterpret_cast<const unsigned short*>(rgba->data(s, t));
+            matches = matches && pixel[0]==bgr[2] && pixel[1]==bgr[1] && pixel[2]==bgr[0] && pixel[3]==65535;
+        }
+    }
+    OSGUTX_TEST_F( matches )
+
+    // and back again, via the luminance channel.
+    ref_ptr<Image> luminance = new Image;
+    luminance->allocateImage(image->s(), image->t(), 1, GL_LUMINANCE, GL_UNSIGNED_SHORT);
+    OSGUTX_TEST_F( copyImage(rgba.get(), 0, 0, 0, image->s(), image->t(), 1, luminance.get(), 0, 0, 0, false, 4) )
+    OSGUTX_TEST_F( *reinterpret_cast<const unsigned short*>(luminance->data(7, 11))==reinterpret_cast<const unsigned short*>(image->data(7, 11))[2] )
+}
+
+OSGUTX_BEGIN_TESTSUITE(ImageUtils)
+    OSGUTX_ADD_TESTCASE(ImageUtilsTestFixture, testComputeMinMax)
+    OSGUTX_ADD_TESTCASE(ImageUtilsTestFixture, testOffsetAndScaleImage)
+    OSGUTX_ADD_TESTCASE(ImageUtilsTestFixture, testCopyImage)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(ImageUtils, root.osg)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Image compression Tests
+//
+class ImageCompressionTestFixture
+{
+public:
+
+    void testDXTRoundTrip(const osgUtx::TestContext& ctx);
+    void testRGTCRoundTrip(const osgUtx::TestContext& ctx);
+    void testUniformBlocks(const osgUtx::TestContext& ctx);
+
+private:
+
+    // smooth gradients crossed by a few hard edges, sized so the last row and column of blocks are partial.
+    static Image* createImage()
+    {
+        Image* image = new Image;
+        image->allocateImage(37, 29, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for(int t=0; t<image->t(); ++t)
+        {
+            for(int s=0; s<image->s(); ++s)
+            {
+                unsigned char* pixel = image->data(s, t);
+                pixel[0] = static_cast<unsigned char>(s*6 + t);
+                pixel[1] = static_cast<unsigned char>(t*8);
+                pixel[2] = static_cast<unsigned char>(((s/9+t/7)%2==0) ? 40 + s : 220 - t);
+                pixel[3] = static_cast<unsigned char>(((s+t)%13<6) ? 255 - 3*s : 4*t);
+            }
+        }
+        return image;
+    }
+
+    // the size of the whole compressed image, getTotalSizeInBytes() misses the partial blocks at the end of each row.
+    static unsigned int computeSizeInBytes(const Image* image)
+    {
+        return Image::computeImageSizeInBytes(image->s(), image->t(), image->r(), image->getPixelFormat(), image->getDataType(), image->getPacking());
+    }
+
+    // the largest per channel difference between the decoded image and the original, over the channels given.
+    static int computeMaxError(const Image* original, const std::vector<Vec4ub>& decoded, unsigned int firstChannel, unsigned int numChannels)
+    {
+        int maxError = 0;
+        for(int t=0; t<original->t(); ++t)
+        {
+            for(int s=0; s<original->s(); ++s)
+            {
+                const unsigned char* pixel = original->data(s, t);
+                for(unsigned int c=firstChannel; c<firstChannel+numChannels; ++c)
+                {
+                    maxError = maximum(maxError, abs(static_cast<int>(pixel[c]) - static_cast<int>(decoded[t*original->s()+s][c])));
+                }
+            }
+        }
+        return maxError;
+    }
+
+    static std::vector<Vec4ub> decodeDXT(const Image* image)
+    {
+        std::vector<Vec4ub> decoded;
+        for(int t=0; t<image->t(); ++t)
+        {
+            for(int s=0; s<image->s(); ++s)
+            {
+                Vec4 color = image->getColor(s, t);
+                decoded.push_back(Vec4ub(static_cast<unsigned char>(color.r()*255.0f+0.5f), static_cast<unsigned char>(color.g()*255.0f+0.5f),
+                                         static_cast<unsigned char>(color.b()*255.0f+0.5f), static_cast<unsigned char>(color.a()*255.0f+0.5f)));
+            }
+        }
+        return decoded;
+    }
+
+    // decode an RGTC channel block, which shares its layout with the DXT5 alpha block.
+    static unsigned char decodeChannel(const unsigned char* block, unsigned int texel)
+    {
+        unsigned int bit = 3*texel;
+        unsigned int bits = block[2 + bit/8] | ((bit/8<5) ? block[3 + bit/8]<<8 : 0);
+        unsigned int index = (bits >> (bit%8)) & 0x7;
+
+        int value_0 = block[0], value_1 = block[1];
+        if (index==0) return static_cast<unsigned char>(value_0);
+        if (index==1) return static_cast<unsigned char>(value_1);
+        if (value_0>value_1) return static_cast<unsigned char>((value_0*(8-index) + value_1*(index-1) + 3)/7);
+        if (index==6) return 0;
+        if (index==7) return 255;
+        return static_cast<unsigned char>((value_0*(6-index) + value_1*(index-1) + 2)/5);
+    }
+
+    static std::vector<Vec4ub> decodeRGTC(const Image* image)
+    {
+        unsigned int blockSize = Image::computeBlockSize(image->getPixelFormat(), 0);
+        unsigned int numBlocksWide = (image->s()+3)/4;
+
+        std::vector<Vec4ub> decoded;
+        for(int t=0; t<image->t(); ++t)
+        {
+            for(int s=0; s<image->s(); ++s)
+            {
+                const unsigned char* block = image->data() + ((t/4)*numBlocksWide + s/4)*blockSize;
+                unsigned int texel = (t%4)*4 + s%4;
+                Vec4ub color(decodeChannel(block, texel), 0, 0, 255);
+                if (blockSize==16) color.g() = decodeChannel(block+8, texel);
+                decoded.push_back(color);
+            }
+        }
+        return decoded;
+    }
+};
+
+void ImageCompressionTestFixture::testDXTRoundTrip(const osgUtx::TestContext&)
+{
+    ref_ptr<Image> original = createImage();
+
+    GLenum formats[] = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+    for(unsigned int f=0; f<3; ++f)
+    {
+        int previousError = 0;
+        for(unsigned int q=0; q<2; ++q)
+        {
+            bool highQuality = (q==1);
+            ref_ptr<Image> image = new Image(*original, CopyOp::DEEP_COPY_ALL);
+            OSGUTX_TEST_F( compressImage(image.get(), formats[f], highQuality) )
+            OSGUTX_TEST_F( image->isCompressed() && image->getPixelFormat()==formats[f] )
+
+            std::vector<Vec4ub> decoded = decodeDXT(image.get());
+            int colorError = computeMaxError(original.get(), decoded, 0, 3);
+
+            // the end points are 5:6:5 with only two colours between them, refining them shouldn't lose anything
+            OSGUTX_TEST_F( colorError<=32 )
+            OSGUTX_TEST_F( !highQuality || colorError<=previousError )
+            previousError = colorError;
+
+            // DXT3 rounds alpha to four bits, DXT5 interpolates between two end points for each block
+            int alphaError = computeMaxError(original.get(), decoded, 3, 1);
+            OSGUTX_TEST_F( f!=1 || alphaError<=8 )
+            OSGUTX_TEST_F( f!=2 || alphaError<=16 )
+        }
+    }
+
+    // the blocks are independent, so the result doesn't depend on how they are spread across threads
+    ref_ptr<Image> serial = new Image(*original, CopyOp::DEEP_COPY_ALL);
+    ref_ptr<Image> threaded = new Image(*original, CopyOp::DEEP_COPY_ALL);
+    OSGUTX_TEST_F( compressImage(serial.get(), GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, true, 1) )
+    OSGUTX_TEST_F( compressImage(threaded.get(), GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, true, 0) )
+    OSGUTX_TEST_F( computeSizeInBytes(serial.get())==computeSizeInBytes(threaded.get()) &&
+                   memcmp(serial->data(), threaded->data(), computeSizeInBytes(serial.get()))==0 )
+}
+
+void ImageCompressionTestFixture::testRGTCRoundTrip(const osgUtx::TestContext&)
+{
+    ref_ptr<Image> original = createImage();
+
+    GLenum formats[] = { GL_COMPRESSED_RED_RGTC1_EXT, GL_COMPRESSED_RED_GREEN_RGTC2_EXT };
+    for(unsigned int f=0; f<2; ++f)
+    {
+        for(unsigned int q=0; q<2; ++q)
+        {
+            ref_ptr<Image> image = new Image(*original, CopyOp::DEEP_COPY_ALL);
+            OSGUTX_TEST_F( compressImage(image.get(), formats[f], q==1) )
+            OSGUTX_TEST_F( computeSizeInBytes(image.get())==10*8*Image::computeBlockSize(formats[f], 0) )
+
+            // eight levels between the end points of each block keep a smooth channel within a few steps
+            std::vector<Vec4ub> decoded = decodeRGTC(image.get());
+            OSGUTX_TEST_F( computeMaxError(original.get(), decoded, 0, f+1)<=4 )
+        }
+    }
+}
+
+void ImageCompressionTestFixture::testUniformBlocks(const osgUtx::TestContext&)
+{
+    // a colour representable in 5:6:5 and any single alpha or channel value come back exactly
+    ref_ptr<Image> original = new Image;
+    original->allocateImage(8, 8, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    for(int t=0; t<8; ++t)
+    {
+        for(int s=0; s<8; ++s)
+        {
+            unsigned char* pixel = original->data(s, t);
+            bool left = s<4;
+            pixel[0] = left ? 255 : 0;
+            pixel[1] = left ? 255 : 0;
+            pixel[2] = left ? 0 : 255;
+            pixel[3] = static_cast<unsigned char>(left ? 177 : 201);
+        }
+    }
+
+    ref_ptr<Image> dxt5 = new Image(*original, CopyOp::DEEP_COPY_ALL);
+    OSGUTX_TEST_F( compressImage(dxt5.get(), GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) )
+    OSGUTX_TEST_F( computeMaxError(original.get(), decodeDXT(dxt5.get()), 0, 4)==0 )
+
+    ref_ptr<Image> rgtc2 = new Image(*original, CopyOp::DEEP_COPY_ALL);
+    OSGUTX_TEST_F( compressImage(rgtc2.get(), GL_COMPRESSED_RED_GREEN_RGTC2_EXT) )
+    OSGUTX_TEST_F( computeMaxError(original.get(), decodeRGTC(rgtc2.get()), 0, 2)==0 )
+
+    // punch-through alpha makes the transparent texels of a DXT1 block black and the rest opaque
+    for(int t=0; t<8; ++t) original->data(t, t)[3] = 0;
+    ref_ptr<Image> dxt1 = new Image(*original, CopyOp::DEEP_COPY_ALL);
+    OSGUTX_TEST_F( compressImage(dxt1.get(), GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) )
+    std::vector<Vec4ub> decoded = decodeDXT(dxt1.get());
+    bool matches = true;
+    for(int t=0; t<8; ++t)
+    {
+        for(int s=0; s<8; ++s)
+        {
+            const Vec4ub& color = decoded[t*8+s];
+            if (s==t) matches = matches && color==Vec4ub(0, 0, 0, 0);
+            else matches = matches && color.a()==255 && color.r()==original->data(s, t)[0] && color.b()==original->data(s, t)[2];
+        }
+    }
+    OSGUTX_TEST_F( matches )
+}
+
+OSGUTX_BEGIN_TESTSUITE(ImageCompression)
+    OSGUTX_ADD_TESTCASE(ImageCompressionTestFixture, testDXTRoundTrip)
+    OSGUTX_ADD_TESTCASE(ImageCompressionTestFixture, testRGTCRoundTrip)
+    OSGUTX_ADD_TESTCASE(ImageCompressionTestFixture, testUniformBlocks)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(ImageCompression, root.osg)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  BufferObject serializer Tests
+//
+class BufferObjectSerializerTestFixture
+{
+public:
+
+    void testRoundTrip(const osgUtx::TestContext& ctx);
+    void testReadVersion202(const osgUtx::TestContext& ctx);
+
+private:
+
+    static std::string write(const BufferObject* bufferObject, const std::string& targetFileVersion)
+    {
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("osgt");
+        if (!rw) return std::string();
+
+        // writing to a stream rather than a .osgt file, so ask for ascii explicitly
+        ref_ptr<osgDB::Options> options = new osgDB::Options;
+        options->setPluginStringData("fileType", "Ascii");
+        if (!targetFileVersion.empty()) options->setPluginStringData("TargetFileVersion", targetFileVersion);
+
+        std::ostringstream out;
+        if (!rw->writeObject(*bufferObject, out, options.get()).success()) return std::string();
+        return out.str();
+    }
+
+    static ref_ptr<BufferObject> read(const std::string& str)
+    {
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("osgt");
+        if (!rw) return 0;
+
+        std::istringstream in(str);
+        osgDB::ReaderWriter::ReadResult rr = rw->readObject(in);
+        return dynamic_cast<BufferObject*>(rr.getObject());
+    }
+};
+
+void BufferObjectSerializerTestFixture::testRoundTrip(const osgUtx::TestContext&)
+{
+    ref_ptr<VertexBufferObject> vbo = new VertexBufferObject;
+    vbo->setUsage(GL_DYNAMIC_DRAW_ARB);
+    vbo->setNumRingBufferFrames(3);
+
+    std::string str = write(vbo.get(), std::string());
+    OSGUTX_TEST_F( str.find("NumRingBufferFrames 3")!=std::string::npos )
+
+    ref_ptr<BufferObject> result = read(str);
+    OSGUTX_TEST_F( result.valid() && result->getNumRingBufferFrames()==3 )
+}
+
+void BufferObjectSerializerTestFixture::testReadVersion202(const osgUtx::TestContext&)
+{
+    ref_ptr<VertexBufferObject> vbo = new VertexBufferObject;
+    vbo->setUsage(GL_DYNAMIC_DRAW_ARB);
+    vbo->setNumRingBufferFrames(3);
+
+    // the header always records the current version, so mark the file as written by version 202,
+    // which predates NumRingBufferFrames.
+    std::string str = write(vbo.get(), "202");
+    OSGUTX_TEST_F( str.find("NumRingBufferFrames")==std::string::npos )
+
+    std::ostringstream currentVersion;
+    currentVersion<<"#Version "<<OPENSCENEGRAPH_SOVERSION;
+    std::string::size_type pos = str.find(currentVersion.str());
+    OSGUTX_TEST_F( pos!=std::string::npos )
+    if (pos!=std::string::npos) str.replace(pos, currentVersion.str().size(), "#Version 202");
+
+    ref_ptr<BufferObject> result = read(str);
+    OSGUTX_TEST_F( result.valid() && result->getUsage()==GL_DYNAMIC_DRAW_ARB && result->getNumRingBufferFrames()==0 )
+}
+
+OSGUTX_BEGIN_TESTSUITE(BufferObjectSerializer)
+    OSGUTX_ADD_TESTCASE(BufferObjectSerializerTestFixture, testRoundTrip)
+    OSGUTX_ADD_TESTCASE(BufferObjectSerializerTestFixture, testReadVersion202)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(BufferObjectSerializer, root.osg)
+
+
 }
@@ -0,0 +1,233 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE ABOVE COPYRIGHT NOTICE AND THIS PERMISSION NOTICE SHALL BE INCLUDED IN
+*  ALL COPIES OR SUBSTANTIAL PORTIONS OF THE SOFTWARE.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "UnitTestFramework.h"
+
+#include <osg/TaskScheduler>
+#include <osgAnimation/Bone>
+#include <osgAnimation/RigGeometry>
+#include <osgAnimation/RigTransformSoftware>
+#include <osgAnimation/Skeleton>
+
+#include <sstream>
+#include <vector>
+#include <math.h>
+
+namespace osgAnimation
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  RigTransformSoftware Tests
+//
+class RigTransformSoftwareTestFixture
+{
+public:
+
+    RigTransformSoftwareTestFixture()
+    {
+        // a root bone left at its bind pose, and a tip bone bound one unit up the y axis then turned a quarter turn about z around its base.
+        _skeleton = new Skeleton;
+        osg::ref_ptr<Bone> root = new Bone("root");
+        osg::ref_ptr<Bone> tip = new Bone("tip");
+        _skeleton->addChild(root.get());
+        root->addChild(tip.get());
+
+        tip->setInvBindMatrixInSkeletonSpace(osg::Matrix::translate(0.0, -1.0, 0.0));
+        tip->setMatrixInSkeletonSpace(osg::Matrix::rotate(osg::PI_2, osg::Z_AXIS) * osg::Matrix::translate(0.0, 1.0, 0.0));
+    }
+
+    void testSkinningMethods(const osgUtx::TestContext& ctx);
+    void testDualQuaternionHemisphere(const osgUtx::TestContext& ctx);
+    void testThreadedSkinningMatchesSerial(const osgUtx::TestContext& ctx);
+
+private:
+
+    class TestRigTransformSoftware : public RigTransformSoftware
+    {
+    public:
+
+        // skin the vertices again with the dual quaternion of a bone negated, which represents the same transform.
+        void skinWithNegatedBone(unsigned int boneIndex, const osg::Vec3Array& source, osg::Vec3Array& destination)
+        {
+            for(unsigned int i=0; i<8; ++i) _boneDualQuaternions[boneIndex].q[i] = -_boneDualQuaternions[boneIndex].q[i];
+
+            for(VertexGroupList::const_iterator itr = _uniqVertexGroupList.begin();
+                itr != _uniqVertexGroupList.end();
+                ++itr)
+            {
+                skinVertexGroup(*itr, &source.front(), &destination.front(), 0, 0);
+            }
+        }
+    };
+
+    // a rig whose vertices are moved by the tip bone with the given weights, and by the root bone with the rest.
+    osg::ref_ptr<RigGeometry> createRig(osg::Vec3Array* vertices, osg::Vec3Array* normals, const std::vector<float>& tipWeights, RigTransformSoftware* rts)
+    {
+        osg::ref_ptr<osg::Geometry> source = new osg::Geometry;
+        source->setVertexArray(vertices);
+        source->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+
+        osg::ref_ptr<VertexInfluenceMap> influenceMap = new VertexInfluenceMap;
+        VertexInfluence& rootInfluence = (*influenceMap)["root"];
+        VertexInfluence& tipInfluence = (*influenceMap)["tip"];
+        for(unsigned int i=0; i<tipWeights.size(); ++i)
+        {
+            if (tipWeights[i]<1.0f) rootInfluence.push_back(VertexIndexWeight(i, 1.0f-tipWeights[i]));
+            if (tipWeights[i]>0.0f) tipInfluence.push_back(VertexIndexWeight(i, tipWeights[i]));
+        }
+
+        osg::ref_ptr<RigGeometry> rig = new RigGeometry;
+        rig->setSourceGeometry(source.get());
+        rig->setInfluenceMap(influenceMap.get());
+        rig->setSkeleton(_skeleton.get());
+        rig->setRigTransformImplementation(rts);
+
+        // the first call prepares the rig's arrays, the second binds the bones and skins.
+        (*rts)(*rig);
+        (*rts)(*rig);
+        return rig;
+    }
+
+    osg::ref_ptr<RigGeometry> createThreeVertexRig(RigTransformSoftware* rts)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+        std::vector<float> tipWeights;
+        vertices->push_back(osg::Vec3(0.0f, 0.0f, 0.0f)); normals->push_back(osg::Vec3(1.0f, 0.0f, 0.0f)); tipWeights.push_back(0.0f);
+        vertices->push_back(osg::Vec3(0.0f, 2.0f, 0.0f)); normals->push_back(osg::Vec3(1.0f, 0.0f, 0.0f)); tipWeights.push_back(1.0f);
+        vertices->push_back(osg::Vec3(1.0f, 1.0f, 0.0f)); normals->push_back(osg::Vec3(1.0f, 0.0f, 0.0f)); tipWeights.push_back(0.5f);
+        return createRig(vertices.get(), normals.get(), tipWeights, rts);
+    }
+
+    static const osg::Vec3& vertex(RigGeometry* rig, unsigned int i) { return (*static_cast<osg::Vec3Array*>(rig->getVertexArray()))[i]; }
+    static const osg::Vec3& normal(RigGeometry* rig, unsigned int i) { return (*static_cast<osg::Vec3Array*>(rig->getNormalArray()))[i]; }
+
+    static bool equivalent(const osg::Vec3& lhs, const osg::Vec3& rhs) { return (lhs-rhs).length()<1e-5f; }
+
+    osg::ref_ptr<Skeleton> _skeleton;
+};
+
+void RigTransformSoftwareTestFixture::testSkinningMethods(const osgUtx::TestContext&)
+{
+    const float halfRoot2 = sqrtf(0.5f);
+
+    osg::ref_ptr<RigTransformSoftware> linear = new RigTransformSoftware;
+    osg::ref_ptr<RigGeometry> linearRig = createThreeVertexRig(linear.get());
+
+    osg::ref_ptr<RigTransformSoftware> dualQuaternion = new RigTransformSoftware;
+    dualQuaternion->setSkinningMethod(RigTransformSoftware::DUAL_QUATERNION);
+    osg::ref_ptr<RigGeometry> dualQuaternionRig = createThreeVertexRig(dualQuaternion.get());
+
+    // vertices bound to a single bone follow it whichever way the bones are blended.
+    RigGeometry* rigs[] = { linearRig.get(), dualQuaternionRig.get() };
+    for(unsigned int i=0; i<2; ++i)
+    {
+        OSGUTX_TEST_F( equivalent(vertex(rigs[i], 0), osg::Vec3(0.0f, 0.0f, 0.0f)) )
+        OSGUTX_TEST_F( equivalent(normal(rigs[i], 0), osg::Vec3(1.0f, 0.0f, 0.0f)) )
+        OSGUTX_TEST_F( equivalent(vertex(rigs[i], 1), osg::Vec3(-1.0f, 1.0f, 0.0f)) )
+        OSGUTX_TEST_F( equivalent(normal(rigs[i], 1), osg::Vec3(0.0f, 1.0f, 0.0f)) )
+    }
+
+    // half way between the bones the matrices average to a point inside the joint, pulling the vertex in ...
+    OSGUTX_TEST_F( equivalent(vertex(linearRig.get(), 2), osg::Vec3(0.5f, 1.5f, 0.0f)) )
+    OSGUTX_TEST_F( equivalent(normal(linearRig.get(), 2), osg::Vec3(0.5f, 0.5f, 0.0f)) )
+
+    // ... while the dual quaternions turn it an eighth of a turn about the joint, keeping its distance from it.
+    OSGUTX_TEST_F( equivalent(vertex(dualQuaternionRig.get(), 2), osg::Vec3(halfRoot2, 1.0f+halfRoot2, 0.0f)) )
+    OSGUTX_TEST_F( equivalent(normal(dualQuaternionRig.get(), 2), osg::Vec3(halfRoot2, halfRoot2, 0.0f)) )
+}
+
+void RigTransformSoftwareTestFixture::testDualQuaternionHemisphere(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<TestRigTransformSoftware> rts = new TestRigTransformSoftware;
+    rts->setSkinningMethod(RigTransformSoftware::DUAL_QUATERNION);
+    osg::ref_ptr<RigGeometry> rig = createThreeVertexRig(rts.get());
+
+    // the negated dual quaternion of the tip bone is in the other hemisphere to the root's, and is flipped back before blending.
+    osg::Vec3Array* source = static_cast<osg::Vec3Array*>(rig->getSourceGeometry()->getVertexArray());
+    osg::ref_ptr<osg::Vec3Array> flipped = new osg::Vec3Array(source->size());
+    rts->skinWithNegatedBone(1, *source, *flipped);
+
+    for(unsigned int i=0; i<source->size(); ++i)
+    {
+        OSGUTX_TEST_F( equivalent((*flipped)[i], vertex(rig.get(), i)) )
+    }
+}
+
+void RigTransformSoftwareTestFixture::testThreadedSkinningMatchesSerial(const osgUtx::TestContext&)
+{
+    // a scheduler with workers to spread the vertex groups across, whatever the number of processors.
+    osg::ref_ptr<osg::TaskScheduler> previousScheduler = osg::TaskScheduler::instance();
+    osg::TaskScheduler::instance() = new osg::TaskScheduler(3);
+
+    // enough vertices for four threads, their weights spread over many vertex groups.
+    const unsigned int numVertices = 40000;
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    std::vector<float> tipWeights;
+    for(unsigned int i=0; i<numVertices; ++i)
+    {
+        float y = float(i%200)*0.01f;
+        vertices->push_back(osg::Vec3(float(i/200)*0.01f - 1.0f, y, float(i%7)*0.1f));
+        normals->push_back(osg::Vec3(float(i%3), 1.0f, float(i%5))*(1.0f/float(1+i%3+i%5)));
+        tipWeights.push_back(float((i*37)%65)/64.0f);
+    }
+
+    RigTransformSoftware::SkinningMethod methods[] = { RigTransformSoftware::LINEAR_BLEND, RigTransformSoftware::DUAL_QUATERNION };
+    for(unsigned int m=0; m<2; ++m)
+    {
+        osg::ref_ptr<RigTransformSoftware> serial = new RigTransformSoftware;
+        serial->setSkinningMethod(methods[m]);
+        osg::ref_ptr<RigGeometry> serialRig = createRig(vertices.get(), normals.get(), tipWeights, serial.get());
+
+        osg::ref_ptr<RigTransformSoftware> threaded = new RigTransformSoftware;
+        threaded->setSkinningMethod(methods[m]);
+        threaded->setNumThreads(4);
+        osg::ref_ptr<RigGeometry> threadedRig = createRig(vertices.get(), normals.get(), tipWeights, threaded.get());
+
+        bool same = true;
+        for(unsigned int i=0; i<numVertices; ++i)
+        {
+            if (vertex(serialRig.get(), i)!=vertex(threadedRig.get(), i) ||
+                normal(serialRig.get(), i)!=normal(threadedRig.get(), i)) same = false;
+        }
+        OSGUTX_TEST_F( same )
+
+        // and the skinning moved the vertices rather than leaving them as they were.
+        OSGUTX_TEST_F( vertex(threadedRig.get(), 199)!=(*vertices)[199] )
+    }
+
+    osg::TaskScheduler::instance()->cancel();
+    osg::TaskScheduler::instance() = previousScheduler;
+}
+
+OSGUTX_BEGIN_TESTSUITE(RigTransformSoftware)
+    OSGUTX_ADD_TESTCASE(RigTransformSoftwareTestFixture, testSkinningMethods)
+    OSGUTX_ADD_TESTCASE(RigTransformSoftwareTestFixture, testDualQuaternionHemisphere)
+    OSGUTX_ADD_TESTCASE(RigTransformSoftwareTestFixture, testThreadedSkinningMatchesSerial)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(RigTransformSoftware, root.osgAnimation)
+
+
+}
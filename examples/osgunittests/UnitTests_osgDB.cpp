@@ -0,0 +1,1093 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE ABOVE COPYRIGHT NOTICE AND THIS PERMISSION NOTICE SHALL BE INCLUDED IN
+*  ALL COPIES OR SUBSTANTIAL PORTIONS OF THE SOFTWARE.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "UnitTestFramework.h"
+
+#include <osg/FrameStamp>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/Image>
+#include <osg/ImageSequence>
+#include <osg/NodeVisitor>
+#include <osg/Texture2D>
+#include <osgDB/AsyncReader>
+#include <osgDB/Callbacks>
+#include <osgDB/DatabasePager>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ImageDestination>
+#include <osgDB/ImagePager>
+#include <osgDB/ObjectCache>
+#include <osgDB/Options>
+#include <osgDB/Registry>
+#include <osgDB/WriteFile>
+
+#include <OpenThreads/Block>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #include <direct.h>
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace osgDB
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  ObjectCache Tests
+//
+class ObjectCacheTestFixture
+{
+public:
+
+    void testShardDistribution(const osgUtx::TestContext& ctx);
+    void testLeastRecentlyUsedOrder(const osgUtx::TestContext& ctx);
+    void testBudgetEviction(const osgUtx::TestContext& ctx);
+    void testStatistics(const osgUtx::TestContext& ctx);
+
+private:
+
+    // gives every object the same size so that the budgets don't depend on the size estimate, and exposes the shards.
+    class TestObjectCache : public ObjectCache
+    {
+    public:
+
+        virtual std::size_t computeObjectSizeInBytes(const osg::Object*) const { return 100; }
+
+        unsigned int getShardIndex(const std::string& fileName) { return static_cast<unsigned int>(&getShard(fileName) - _shards); }
+
+        static unsigned int getNumShards() { return NUM_SHARDS; }
+
+    protected:
+
+        virtual ~TestObjectCache() {}
+    };
+
+    static std::string createFileName(unsigned int i)
+    {
+        std::ostringstream str;
+        str<<"tile_"<<i<<".osgb";
+        return str.str();
+    }
+
+    static bool contains(ObjectCache* cache, const std::string& fileName)
+    {
+        return cache->getRefFromObjectCache(fileName).valid();
+    }
+};
+
+void ObjectCacheTestFixture::testShardDistribution(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<TestObjectCache> cache = new TestObjectCache;
+
+    const unsigned int numFiles = 1600;
+    std::vector<unsigned int> numPerShard(TestObjectCache::getNumShards(), 0);
+    for(unsigned int i=0; i<numFiles; ++i)
+    {
+        std::string fileName = createFileName(i);
+        unsigned int shardIndex = cache->getShardIndex(fileName);
+        OSGUTX_TEST_F( shardIndex<TestObjectCache::getNumShards() )
+        OSGUTX_TEST_F( cache->getShardIndex(fileName)==shardIndex )
+
+        ++numPerShard[shardIndex];
+        cache->addEntryToObjectCache(fileName, new osg::Group);
+    }
+
+    // the file names are spread across all the shards without any of them taking a disproportionate share.
+    unsigned int average = numFiles/TestObjectCache::getNumShards();
+    for(unsigned int i=0; i<numPerShard.size(); ++i)
+    {
+        OSGUTX_TEST_F( numPerShard[i]>average/2 && numPerShard[i]<average*2 )
+    }
+    OSGUTX_TEST_F( cache->getNumObjects()==numFiles )
+
+    // the same file read with different options is held as a separate entry.
+    osg::ref_ptr<Options> options = new Options("noTextures");
+    cache->addEntryToObjectCache(createFileName(0), new osg::Group, 0.0, options.get());
+    OSGUTX_TEST_F( cache->getNumObjects()==numFiles+1 )
+    OSGUTX_TEST_F( cache->getRefFromObjectCache(createFileName(0), options.get())!=cache->getRefFromObjectCache(createFileName(0)) )
+}
+
+void ObjectCacheTestFixture::testLeastRecentlyUsedOrder(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<TestObjectCache> cache = new TestObjectCache;
+    cache->addEntryToObjectCache("a", new osg::Group);
+    cache->addEntryToObjectCache("b", new osg::Group);
+    cache->addEntryToObjectCache("c", new osg::Group);
+
+    // using "a" makes "b" the least recently used.
+    OSGUTX_TEST_F( contains(cache.get(), "a") )
+
+    // 300 bytes against a budget of 250 evicts down to 225 bytes, so only "b" goes.
+    cache->setMaxNumBytes(250);
+    OSGUTX_TEST_F( cache->getNumEvictions()==1 )
+    OSGUTX_TEST_F( cache->getNumBytes()==200 )
+    OSGUTX_TEST_F( !contains(cache.get(), "b") )
+    OSGUTX_TEST_F( contains(cache.get(), "a") )
+    OSGUTX_TEST_F( contains(cache.get(), "c") )
+
+    // "a" was used before "c" above, so it's next to go.
+    cache->addEntryToObjectCache("d", new osg::Group);
+    OSGUTX_TEST_F( cache->getNumEvictions()==2 )
+    OSGUTX_TEST_F( !contains(cache.get(), "a") )
+    OSGUTX_TEST_F( contains(cache.get(), "c") )
+    OSGUTX_TEST_F( contains(cache.get(), "d") )
+}
+
+void ObjectCacheTestFixture::testBudgetEviction(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<TestObjectCache> cache = new TestObjectCache;
+    cache->setMaxNumBytes(1000);
+
+    // an object referenced from outside the cache isn't evicted, as doing so wouldn't free any memory.
+    osg::ref_ptr<osg::Group> referenced = new osg::Group;
+    cache->addEntryToObjectCache(createFileName(0), referenced.get());
+
+    bool withinBudget = true;
+    for(unsigned int i=1; i<50; ++i)
+    {
+        cache->addEntryToObjectCache(createFileName(i), new osg::Group);
+        if (cache->getNumBytes()>cache->getMaxNumBytes()) withinBudget = false;
+    }
+    OSGUTX_TEST_F( withinBudget )
+    OSGUTX_TEST_F( cache->getNumEvictions()>0 )
+    OSGUTX_TEST_F( cache->getNumObjects()*100==cache->getNumBytes() )
+    OSGUTX_TEST_F( contains(cache.get(), createFileName(0)) )
+    OSGUTX_TEST_F( contains(cache.get(), createFileName(49)) )
+    OSGUTX_TEST_F( !contains(cache.get(), createFileName(1)) )
+
+    // with everything left referenced the cache stays over budget, and is brought back within it once they're released.
+    std::vector< osg::ref_ptr<osg::Object> > objects;
+    for(unsigned int i=0; i<50; ++i)
+    {
+        osg::ref_ptr<osg::Object> object = cache->getRefFromObjectCache(createFileName(i));
+        if (object.valid()) objects.push_back(object);
+    }
+    cache->setMaxNumBytes(100);
+    OSGUTX_TEST_F( cache->getNumObjects()==objects.size() )
+
+    objects.clear();
+    referenced = 0;
+    cache->addEntryToObjectCache(createFileName(50), new osg::Group);
+    OSGUTX_TEST_F( cache->getNumBytes()<=cache->getMaxNumBytes() )
+}
+
+void ObjectCacheTestFixture::testStatistics(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<TestObjectCache> cache = new TestObjectCache;
+
+    OSGUTX_TEST_F( !contains(cache.get(), "x") )
+    cache->addEntryToObjectCache("x", new osg::Group);
+    OSGUTX_TEST_F( contains(cache.get(), "x") )
+
+    osg::ref_ptr<Options> options = new Options("noTextures");
+    OSGUTX_TEST_F( !cache->getRefFromObjectCache("x", options.get()) )
+
+    OSGUTX_TEST_F( cache->getNumHits()==1 )
+    OSGUTX_TEST_F( cache->getNumMisses()==2 )
+    OSGUTX_TEST_F( cache->getNumEvictions()==0 )
+
+    cache->setMaxNumBytes(50);
+    OSGUTX_TEST_F( cache->getNumEvictions()==1 )
+    OSGUTX_TEST_F( cache->getNumObjects()==0 )
+    OSGUTX_TEST_F( cache->getNumBytes()==0 )
+
+    cache->resetStatistics();
+    OSGUTX_TEST_F( cache->getNumHits()==0 )
+    OSGUTX_TEST_F( cache->getNumMisses()==0 )
+    OSGUTX_TEST_F( cache->getNumEvictions()==0 )
+}
+
+OSGUTX_BEGIN_TESTSUITE(ObjectCache)
+    OSGUTX_ADD_TESTCASE(ObjectCacheTestFixture, testShardDistribution)
+    OSGUTX_ADD_TESTCASE(ObjectCacheTestFixture, testLeastRecentlyUsedOrder)
+    OSGUTX_ADD_TESTCASE(ObjectCacheTestFixture, testBudgetEviction)
+    OSGUTX_ADD_TESTCASE(ObjectCacheTestFixture, testStatistics)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(ObjectCache, root.osgDB)
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  AsyncReader Tests
+//
+class AsyncReaderTestFixture
+{
+public:
+
+    void testReadFutureStates(const osgUtx::TestContext& ctx);
+    void testPriorityOrder(const osgUtx::TestContext& ctx);
+    void testCancel(const osgUtx::TestContext& ctx);
+    void testChangeThreadsFromCallback(const osgUtx::TestContext& ctx);
+
+private:
+
+    // returns a Group named after each file, holding up the read of "gate" until the gate is released.
+    class GatedReadFileCallback : public ReadFileCallback
+    {
+    public:
+
+        virtual ReaderWriter::ReadResult readNode(const std::string& fileName, const Options*)
+        {
+            if (fileName=="gate") _gate.block();
+
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+                _fileNames.push_back(fileName);
+            }
+
+            osg::ref_ptr<osg::Group> group = new osg::Group;
+            group->setName(fileName);
+            return group.get();
+        }
+
+        std::vector<std::string> getFileNames()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            return _fileNames;
+        }
+
+        OpenThreads::Block          _gate;
+
+    protected:
+
+        virtual ~GatedReadFileCallback() {}
+
+        OpenThreads::Mutex          _mutex;
+        std::vector<std::string>    _fileNames;
+    };
+
+    // counts the completed reads, optionally changing the number of threads of, or cancelling, the reader.
+    class CountingCallback : public ReadFuture::Callback
+    {
+    public:
+
+        CountingCallback(AsyncReader* reader=0, unsigned int numThreads=0, bool cancel=false):
+            _reader(reader), _numThreads(numThreads), _cancel(cancel), _numCompleted(0) {}
+
+        virtual void readCompleted(ReadFuture*)
+        {
+            if (_reader && _numThreads>0) _reader->setNumThreads(_numThreads);
+            if (_reader && _cancel) _reader->cancel();
+            ++_numCompleted;
+        }
+
+        AsyncReader*        _reader;
+        unsigned int        _numThreads;
+        bool                _cancel;
+        OpenThreads::Atomic _numCompleted;
+
+    protected:
+
+        virtual ~CountingCallback() {}
+    };
+
+    static bool waitForStatus(ReadFuture* future, ReadFuture::Status status)
+    {
+        for(unsigned int i=0; i<5000 && future->getStatus()!=status; ++i)
+        {
+            OpenThreads::Thread::microSleep(1000);
+        }
+        return future->getStatus()==status;
+    }
+
+    static bool waitForCallback(CountingCallback* callback)
+    {
+        for(unsigned int i=0; i<5000 && callback->_numCompleted==0; ++i)
+        {
+            OpenThreads::Thread::microSleep(1000);
+        }
+        return callback->_numCompleted!=0;
+    }
+};
+
+void AsyncReaderTestFixture::testReadFutureStates(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<AsyncReader> reader = new AsyncReader(1);
+    osg::ref_ptr<GatedReadFileCallback> readCallback = new GatedReadFileCallback;
+    osg::ref_ptr<Options> options = new Options;
+    options->setReadFileCallback(readCallback.get());
+
+    osg::ref_ptr<ReadFuture> running = reader->read(ReadFuture::READ_NODE, "gate", options.get());
+    OSGUTX_TEST_F( waitForStatus(running.get(), ReadFuture::RUNNING) )
+    OSGUTX_TEST_F( !running->done() )
+
+    osg::ref_ptr<ReadFuture> pending = reader->read(ReadFuture::READ_NODE, "pending", options.get());
+    osg::ref_ptr<ReadFuture> cancelled = reader->read(ReadFuture::READ_NODE, "cancelled", options.get());
+    OSGUTX_TEST_F( pending->getStatus()==ReadFuture::PENDING )
+    OSGUTX_TEST_F( reader->getNumPendingReads()==2 )
+
+    // a cancelled read is done straight away, without blocking on the reads ahead of it.
+    OSGUTX_TEST_F( cancelled->cancel() )
+    OSGUTX_TEST_F( cancelled->getStatus()==ReadFuture::CANCELLED )
+    OSGUTX_TEST_F( cancelled->done() )
+    OSGUTX_TEST_F( !cancelled->getNode() )
+    OSGUTX_TEST_F( reader->getNumPendingReads()==1 )
+
+    readCallback->_gate.release();
+
+    osg::ref_ptr<osg::Node> node = running->getNode();
+    OSGUTX_TEST_F( node.valid() && node->getName()=="gate" )
+    OSGUTX_TEST_F( running->getStatus()==ReadFuture::COMPLETED )
+    OSGUTX_TEST_F( running->done() )
+    OSGUTX_TEST_F( !running->cancel() )
+
+    node = pending->getNode();
+    OSGUTX_TEST_F( node.valid() && node->getName()=="pending" )
+    OSGUTX_TEST_F( reader->getNumPendingReads()==0 )
+
+    std::vector<std::string> fileNames = readCallback->getFileNames();
+    OSGUTX_TEST_F( fileNames.size()==2 && fileNames[0]=="gate" && fileNames[1]=="pending" )
+}
+
+void AsyncReaderTestFixture::testPriorityOrder(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<AsyncReader> reader = new AsyncReader(1);
+    osg::ref_ptr<GatedReadFileCallback> readCallback = new GatedReadFileCallback;
+    osg::ref_ptr<Options> options = new Options;
+    options->setReadFileCallback(readCallback.get());
+
+    // hold up the only thread so that the rest of the reads are queued before any are started.
+    osg::ref_ptr<ReadFuture> gate = reader->read(ReadFuture::READ_NODE, "gate", options.get());
+    OSGUTX_TEST_F( waitForStatus(gate.get(), ReadFuture::RUNNING) )
+
+    std::vector< osg::ref_ptr<ReadFuture> > futures;
+    futures.push_back(reader->read(ReadFuture::READ_NODE, "low", options.get(), 0.0f));
+    futures.push_back(reader->read(ReadFuture::READ_NODE, "mid", options.get(), 5.0f));
+    futures.push_back(reader->read(ReadFuture::READ_NODE, "high", options.get(), 10.0f));
+    futures.push_back(reader->read(ReadFuture::READ_NODE, "mid2", options.get(), 5.0f));
+    futures.push_back(reader->read(ReadFuture::READ_NODE, "raised", options.get(), 0.0f));
+    futures.back()->setPriority(20.0f);
+
+    readCallback->_gate.release();
+    for(unsigned int i=0; i<futures.size(); ++i)
+    {
+        futures[i]->wait();
+    }
+
+    // highest priority first, and in order of submission for equal priorities.
+    const char* expected[] = { "gate", "raised", "high", "mid", "mid2", "low" };
+    std::vector<std::string> fileNames = readCallback->getFileNames();
+    OSGUTX_TEST_F( fileNames.size()==6 )
+    for(unsigned int i=0; i<fileNames.size() && i<6; ++i)
+    {
+        OSGUTX_TEST_F( fileNames[i]==expected[i] )
+    }
+}
+
+void AsyncReaderTestFixture::testCancel(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<AsyncReader> reader = new AsyncReader(1);
+    osg::ref_ptr<GatedReadFileCallback> readCallback = new GatedReadFileCallback;
+    osg::ref_ptr<Options> options = new Options;
+    options->setReadFileCallback(readCallback.get());
+    osg::ref_ptr<CountingCallback> completedCallback = new CountingCallback;
+
+    // a running read that is cancelled finishes, but its result is discarded and the callback isn't invoked.
+    osg::ref_ptr<ReadFuture> running = reader->read(ReadFuture::READ_NODE, "gate", options.get(), 0.0f, completedCallback.get());
+    OSGUTX_TEST_F( waitForStatus(running.get(), ReadFuture::RUNNING) )
+
+    std::vector< osg::ref_ptr<ReadFuture> > pending;
+    for(unsigned int i=0; i<4; ++i)
+    {
+        pending.push_back(reader->read(ReadFuture::READ_NODE, "pending", options.get(), 0.0f, completedCallback.get()));
+    }
+
+    OSGUTX_TEST_F( running->cancel() )
+    reader->cancelPendingReads();
+    OSGUTX_TEST_F( reader->getNumPendingReads()==0 )
+    for(unsigned int i=0; i<pending.size(); ++i)
+    {
+        OSGUTX_TEST_F( pending[i]->getStatus()==ReadFuture::CANCELLED )
+    }
+
+    readCallback->_gate.release();
+
+    // the reader carries on with reads added after the cancellation.
+    osg::ref_ptr<ReadFuture> after = reader->read(ReadFuture::READ_NODE, "after", options.get(), 0.0f, completedCallback.get());
+    OSGUTX_TEST_F( after->getNode().valid() )
+    OSGUTX_TEST_F( waitForStatus(running.get(), ReadFuture::CANCELLED) )
+    OSGUTX_TEST_F( !running->getNode() )
+
+    reader->cancel();
+    OSGUTX_TEST_F( completedCallback->_numCompleted==1 )
+
+    std::vector<std::string> fileNames = readCallback->getFileNames();
+    OSGUTX_TEST_F( fileNames.size()==2 && fileNames[0]=="gate" && fileNames[1]=="after" )
+}
+
+void AsyncReaderTestFixture::testChangeThreadsFromCallback(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<AsyncReader> reader = new AsyncReader(2);
+    osg::ref_ptr<GatedReadFileCallback> readCallback = new GatedReadFileCallback;
+    readCallback->_gate.release();
+    osg::ref_ptr<Options> options = new Options;
+    options->setReadFileCallback(readCallback.get());
+
+    // changing the number of threads, or cancelling, from a loader thread mustn't have it wait to join itself.
+    osg::ref_ptr<CountingCallback> setNumThreadsCallback = new CountingCallback(reader.get(), 3);
+    osg::ref_ptr<ReadFuture> future = reader->read(ReadFuture::READ_NODE, "a", options.get(), 0.0f, setNumThreadsCallback.get());
+    OSGUTX_TEST_F( future->getNode().valid() )
+
+    // the callback is invoked after the future is marked as completed, so wait for it to return.
+    OSGUTX_TEST_F( waitForCallback(setNumThreadsCallback.get()) )
+    OSGUTX_TEST_F( reader->getNumThreads()==3 )
+
+    future = reader->read(ReadFuture::READ_NODE, "b", options.get());
+    OSGUTX_TEST_F( future->getNode().valid() )
+
+    osg::ref_ptr<CountingCallback> cancelCallback = new CountingCallback(reader.get(), 0, true);
+    future = reader->read(ReadFuture::READ_NODE, "c", options.get(), 0.0f, cancelCallback.get());
+    OSGUTX_TEST_F( future->getNode().valid() )
+    OSGUTX_TEST_F( waitForCallback(cancelCallback.get()) )
+
+    // the threads are started again for the next read.
+    future = reader->read(ReadFuture::READ_NODE, "d", options.get());
+    OSGUTX_TEST_F( future->getNode().valid() )
+
+    // deleting the reader joins the threads that were stopped from within their callbacks.
+    future = 0;
+    reader = 0;
+    OSGUTX_TEST_F( setNumThreadsCallback->_numCompleted==1 && cancelCallback->_numCompleted==1 )
+}
+
+OSGUTX_BEGIN_TESTSUITE(AsyncReader)
+    OSGUTX_ADD_TESTCASE(AsyncReaderTestFixture, testReadFutureStates)
+    OSGUTX_ADD_TESTCASE(AsyncReaderTestFixture, testPriorityOrder)
+    OSGUTX_ADD_TESTCASE(AsyncReaderTestFixture, testCancel)
+    OSGUTX_ADD_TESTCASE(AsyncReaderTestFixture, testChangeThreadsFromCallback)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(AsyncReader, root.osgDB)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  DatabasePager Tests
+//
+class DatabasePagerTestFixture
+{
+public:
+
+    DatabasePagerTestFixture():
+        _pager(new TestDatabasePager),
+        _group(new osg::Group),
+        _frameStamp(new osg::FrameStamp) {}
+
+    void testTakeOrderAfterRenewal(const osgUtx::TestContext& ctx);
+
+private:
+
+    // a pager whose threads are never started, so that the test takes the requests off the file queue itself.
+    class TestDatabasePager : public DatabasePager
+    {
+    public:
+
+        TestDatabasePager() { _startThreadCalled = true; }
+
+        std::string takeFirst()
+        {
+            osg::ref_ptr<DatabaseRequest> databaseRequest;
+            _fileRequestQueue->takeFirst(databaseRequest);
+            return databaseRequest.valid() ? databaseRequest->_fileName : std::string();
+        }
+
+    protected:
+
+        virtual ~TestDatabasePager() {}
+    };
+
+    void frame(unsigned int frameNumber)
+    {
+        _frameStamp->setFrameNumber(frameNumber);
+        _frameStamp->setReferenceTime(double(frameNumber));
+        _pager->signalBeginFrame(_frameStamp.get());
+    }
+
+    void request(const std::string& fileName, float priority)
+    {
+        osg::NodePath nodePath;
+        nodePath.push_back(_group.get());
+        _pager->requestNodeFile(fileName, nodePath, priority, _frameStamp.get(), _requests[fileName], 0);
+    }
+
+    osg::ref_ptr<TestDatabasePager> _pager;
+    osg::ref_ptr<osg::Group> _group;
+    osg::ref_ptr<osg::FrameStamp> _frameStamp;
+    std::map< std::string, osg::ref_ptr<osg::Referenced> > _requests;
+};
+
+void DatabasePagerTestFixture::testTakeOrderAfterRenewal(const osgUtx::TestContext&)
+{
+    frame(1);
+    request("a", 1.0f);
+    request("b", 2.0f);
+    request("c", 3.0f);
+    request("d", 4.0f);
+    request("e", 5.0f);
+    request("f", 6.0f);
+
+    // the first take of the frame re-keys the queue, the renewals that follow are all made after it.
+    frame(2);
+    OSGUTX_TEST_F( _pager->takeFirst()=="f" )
+
+    // a request buried at the bottom moves up as soon as it is renewed, c is renewed with a lower priority but a
+    // newer time stamp, b with a higher and then a lower priority in the same frame.
+    request("a", 1.0f);
+    request("c", 0.5f);
+    request("b", 3.0f);
+    request("b", 0.25f);
+
+    // the same order as SortFileRequestFunctor: the most recently requested first, then the highest priority.
+    OSGUTX_TEST_F( _pager->takeFirst()=="a" )
+    OSGUTX_TEST_F( _pager->takeFirst()=="c" )
+
+    request("d", 2.0f);
+    OSGUTX_TEST_F( _pager->takeFirst()=="d" )
+    OSGUTX_TEST_F( _pager->takeFirst()=="b" )
+
+    // e wasn't renewed in frame 2, so it's pruned rather than taken two frames after it was last requested.
+    frame(3);
+    OSGUTX_TEST_F( _pager->takeFirst().empty() )
+}
+
+OSGUTX_BEGIN_TESTSUITE(DatabasePager)
+    OSGUTX_ADD_TESTCASE(DatabasePagerTestFixture, testTakeOrderAfterRenewal)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(DatabasePager, root.osgDB)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  ImageDestination Tests
+//
+class ImageDestinationTestFixture
+{
+public:
+
+    void testReuseUnreferencedImages(const osgUtx::TestContext& ctx);
+    void testPreferImagesOfTheSameSize(const osgUtx::TestContext& ctx);
+    void testRecycledImagesAreReset(const osgUtx::TestContext& ctx);
+    void testDecodeIntoDestination(const osgUtx::TestContext& ctx);
+    void testHoldReleasedImagesForAFrame(const osgUtx::TestContext& ctx);
+
+private:
+
+    static osg::ref_ptr<osg::Image> allocate(ImageDestination* destination, int s, int t)
+    {
+        return destination->allocateImage(s, t, 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE);
+    }
+};
+
+void ImageDestinationTestFixture::testReuseUnreferencedImages(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<ImageDestination> destination = new ImageDestination(2);
+
+    osg::ref_ptr<osg::Image> first = allocate(destination.get(), 64, 64);
+    OSGUTX_TEST_F( first.valid() && first->s()==64 && first->t()==64 && first->data()!=0 )
+    OSGUTX_TEST_F( destination->getNumPooledImages()==1 )
+
+    // a pooled image isn't handed out again while it's still referenced.
+    osg::ref_ptr<osg::Image> second = allocate(destination.get(), 64, 64);
+    OSGUTX_TEST_F( second.valid() && second!=first )
+    OSGUTX_TEST_F( destination->getNumPooledImages()==2 )
+
+    // beyond the maximum the images allocated aren't pooled.
+    osg::ref_ptr<osg::Image> third = allocate(destination.get(), 64, 64);
+    OSGUTX_TEST_F( third.valid() && third!=first && third!=second )
+    OSGUTX_TEST_F( destination->getNumPooledImages()==2 )
+
+    // once only the pool references it, the image and its storage are reused.
+    osg::Image* firstImage = first.get();
+    unsigned char* firstData = first->data();
+    first = 0;
+    osg::ref_ptr<osg::Image> reused = allocate(destination.get(), 64, 64);
+    OSGUTX_TEST_F( reused.get()==firstImage )
+    OSGUTX_TEST_F( reused->data()==firstData )
+
+    // images added to the pool are reused as well.
+    osg::ref_ptr<osg::Image> added = new osg::Image;
+    added->allocateImage(16, 16, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    destination->addImage(added.get());
+    OSGUTX_TEST_F( destination->getNumPooledImages()==3 )
+    osg::Image* addedImage = added.get();
+    added = 0;
+    OSGUTX_TEST_F( allocate(destination.get(), 16, 16).get()==addedImage )
+
+    destination->clear();
+    OSGUTX_TEST_F( destination->getNumPooledImages()==0 )
+}
+
+void ImageDestinationTestFixture::testPreferImagesOfTheSameSize(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<ImageDestination> destination = new ImageDestination(2);
+
+    osg::ref_ptr<osg::Image> large = allocate(destination.get(), 64, 64);
+    osg::ref_ptr<osg::Image> small = allocate(destination.get(), 32, 32);
+    osg::Image* largeImage = large.get();
+    osg::Image* smallImage = small.get();
+    unsigned char* smallData = small->data();
+    large = 0;
+    small = 0;
+
+    // the second pooled image already has the storage needed, so it's preferred over the first.
+    osg::ref_ptr<osg::Image> image = allocate(destination.get(), 32, 32);
+    OSGUTX_TEST_F( image.get()==smallImage && image->data()==smallData )
+
+    // with no image of the right size free, the first unreferenced one is reallocated.
+    osg::ref_ptr<osg::Image> resized = allocate(destination.get(), 48, 48);
+    OSGUTX_TEST_F( resized.get()==largeImage && resized->s()==48 && resized->t()==48 )
+}
+
+void ImageDestinationTestFixture::testRecycledImagesAreReset(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<ImageDestination> destination = new ImageDestination(1);
+
+    osg::ref_ptr<osg::Image> image = allocate(destination.get(), 8, 8);
+    image->setFileName("previous.png");
+    image->setName("previous");
+    image->setUserData(new osg::Group);
+    image->setOrigin(osg::Image::TOP_LEFT);
+    image->setPixelAspectRatio(2.0f);
+    image->setPixelBufferObject(new osg::PixelBufferObject(image.get()));
+    osg::Image* previous = image.get();
+    image = 0;
+
+    image = allocate(destination.get(), 8, 8);
+    OSGUTX_TEST_F( image.get()==previous )
+    OSGUTX_TEST_F( image->getFileName().empty() && image->getName().empty() )
+    OSGUTX_TEST_F( image->getUserData()==0 )
+    OSGUTX_TEST_F( image->getOrigin()==osg::Image::BOTTOM_LEFT )
+    OSGUTX_TEST_F( image->getPixelAspectRatio()==1.0f )
+    OSGUTX_TEST_F( image->getPixelBufferObject()==0 )
+}
+
+void ImageDestinationTestFixture::testDecodeIntoDestination(const osgUtx::TestContext&)
+{
+    ReaderWriter* rw = Registry::instance()->getReaderWriterForExtension("png");
+    if (!rw)
+    {
+        OSG_NOTICE<<"png plugin not available, skipping decode test"<<std::endl;
+        return;
+    }
+
+    osg::ref_ptr<osg::Image> source = new osg::Image;
+    source->allocateImage(16, 8, 1, GL_RGB, GL_UNSIGNED_BYTE);
+    for(unsigned int i=0; i<source->getTotalSizeInBytes(); ++i) source->data()[i] = static_cast<unsigned char>(i*7);
+
+    std::stringstream png;
+    OSGUTX_TEST_F( rw->writeImage(*source, png).success() )
+    const std::string encoded = png.str();
+
+    osg::ref_ptr<ImageDestination> destination = new ImageDestination(1);
+    osg::ref_ptr<Options> options = new Options;
+    options->setImageDestination(destination.get());
+
+    std::istringstream first(encoded);
+    osg::ref_ptr<osg::Image> image = rw->readImage(first, options.get()).getImage();
+    OSGUTX_TEST_F( image.valid() && destination->getNumPooledImages()==1 )
+    OSGUTX_TEST_F( image->s()==16 && image->t()==8 )
+    OSGUTX_TEST_F( memcmp(image->data(), source->data(), source->getTotalSizeInBytes())==0 )
+
+    // the second read decodes into the image of the first, once that's been let go.
+    osg::Image* previous = image.get();
+    image = 0;
+    std::istringstream second(encoded);
+    image = rw->readImage(second, options.get()).getImage();
+    OSGUTX_TEST_F( image.get()==previous )
+    OSGUTX_TEST_F( memcmp(image->data(), source->data(), source->getTotalSizeInBytes())==0 )
+}
+
+void ImageDestinationTestFixture::testHoldReleasedImagesForAFrame(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<ImageDestination> destination = new ImageDestination(1);
+    OSGUTX_TEST_F( destination->getNumFramesBeforeReuse()==1 )
+
+    destination->setFrameNumber(1);
+    osg::ref_ptr<osg::Image> image = allocate(destination.get(), 8, 8);
+    osg::Image* previous = image.get();
+    image = 0;
+
+    // let go of in frame 1, the draw of that frame may still be reading it.
+    OSGUTX_TEST_F( allocate(destination.get(), 8, 8).get()!=previous )
+
+    // frame 2 notes it as released, it then has to stay unreferenced for a whole frame.
+    destination->setFrameNumber(2);
+    OSGUTX_TEST_F( allocate(destination.get(), 8, 8).get()!=previous )
+
+    destination->setFrameNumber(3);
+    image = allocate(destination.get(), 8, 8);
+    OSGUTX_TEST_F( image.get()==previous )
+
+    // without the latency an image is reused from the frame it's noted as released in.
+    destination->setNumFramesBeforeReuse(0);
+    image = 0;
+    OSGUTX_TEST_F( allocate(destination.get(), 8, 8).get()!=previous )
+    destination->setFrameNumber(4);
+    OSGUTX_TEST_F( allocate(destination.get(), 8, 8).get()==previous )
+}
+
+OSGUTX_BEGIN_TESTSUITE(ImageDestination)
+    OSGUTX_ADD_TESTCASE(ImageDestinationTestFixture, testReuseUnreferencedImages)
+    OSGUTX_ADD_TESTCASE(ImageDestinationTestFixture, testPreferImagesOfTheSameSize)
+    OSGUTX_ADD_TESTCASE(ImageDestinationTestFixture, testRecycledImagesAreReset)
+    OSGUTX_ADD_TESTCASE(ImageDestinationTestFixture, testDecodeIntoDestination)
+    OSGUTX_ADD_TESTCASE(ImageDestinationTestFixture, testHoldReleasedImagesForAFrame)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(ImageDestination, root.osgDB)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  ImagePager Tests
+//
+class ImagePagerTestFixture
+{
+public:
+
+    ImagePagerTestFixture():
+        _pager(new TestImagePager),
+        _frameStamp(new osg::FrameStamp) {}
+
+    void testRequestCurrent(const osgUtx::TestContext& ctx);
+    void testDiscardStaleRequests(const osgUtx::TestContext& ctx);
+    void testPreLoadNumImages(const osgUtx::TestContext& ctx);
+    void testPassFramesToImageDestination(const osgUtx::TestContext& ctx);
+
+private:
+
+    // a pager whose threads are never started, so that the test takes the requests off the read queue itself.
+    class TestImagePager : public ImagePager
+    {
+    public:
+
+        TestImagePager() { _startThreadCalled = true; }
+
+        static bool isRequestCurrent(unsigned int frameNumberLastRequest, int frameNumber)
+        {
+            osg::ref_ptr<ImageRequest> imageRequest = new ImageRequest;
+            imageRequest->_frameNumberLastRequest = frameNumberLastRequest;
+            return imageRequest->isRequestCurrent(frameNumber);
+        }
+
+        std::string takeFirst(int frameNumber)
+        {
+            osg::ref_ptr<ImageRequest> imageRequest;
+            _readQueue->takeFirst(imageRequest, frameNumber);
+            return imageRequest.valid() ? imageRequest->_fileName : std::string();
+        }
+
+        unsigned int getNumRequests() const { return _readQueue->size(); }
+
+    protected:
+
+        virtual ~TestImagePager() {}
+    };
+
+    void frame(unsigned int frameNumber)
+    {
+        _frameStamp->setFrameNumber(frameNumber);
+        _frameStamp->setReferenceTime(double(frameNumber));
+        _pager->signalBeginFrame(_frameStamp.get());
+    }
+
+    void request(const std::string& fileName, double timeToMergeBy)
+    {
+        _pager->requestImageFile(fileName, 0, 0, timeToMergeBy, _frameStamp.get(), _requests[fileName], 0);
+    }
+
+    osg::ref_ptr<TestImagePager> _pager;
+    osg::ref_ptr<osg::FrameStamp> _frameStamp;
+    std::map< std::string, osg::ref_ptr<osg::Referenced> > _requests;
+};
+
+void ImagePagerTestFixture::testRequestCurrent(const osgUtx::TestContext&)
+{
+    OSGUTX_TEST_F( TestImagePager::isRequestCurrent(5, 4) )
+    OSGUTX_TEST_F( TestImagePager::isRequestCurrent(5, 5) )
+    OSGUTX_TEST_F( TestImagePager::isRequestCurrent(5, 6) )
+    OSGUTX_TEST_F( !TestImagePager::isRequestCurrent(5, 7) )
+    OSGUTX_TEST_F( !TestImagePager::isRequestCurrent(0, 100) )
+}
+
+void ImagePagerTestFixture::testDiscardStaleRequests(const osgUtx::TestContext&)
+{
+    frame(1);
+    request("a", 3.0);
+    request("b", 1.0);
+    request("c", 2.0);
+    OSGUTX_TEST_F( _pager->getNumRequests()==3 )
+
+    // renewing a request keeps it current and moves it to the time it's now needed by.
+    frame(2);
+    request("b", 1.0);
+    request("c", 0.5);
+    OSGUTX_TEST_F( _pager->getNumRequests()==3 )
+
+    // a was last requested two frames ago, so it's discarded rather than read.
+    frame(3);
+    OSGUTX_TEST_F( _pager->takeFirst(3)=="c" )
+    OSGUTX_TEST_F( _pager->getNumRequests()==1 )
+    OSGUTX_TEST_F( _pager->takeFirst(3)=="b" )
+    OSGUTX_TEST_F( _pager->takeFirst(3).empty() )
+}
+
+void ImagePagerTestFixture::testPreLoadNumImages(const osgUtx::TestContext&)
+{
+    _pager->setPreLoadTime(0.5);
+    OSGUTX_TEST_F( _pager->getPreLoadNumImages()==0 )
+
+    osg::ref_ptr<osg::ImageSequence> imageSequence = new osg::ImageSequence;
+    imageSequence->setMode(osg::ImageSequence::PAGE_AND_DISCARD_USED_IMAGES);
+    for(unsigned int i=0; i<10; ++i)
+    {
+        std::ostringstream fileName;
+        fileName << "frame_" << i << ".png";
+        imageSequence->addImageFile(fileName.str());
+    }
+    imageSequence->setLength(10.0);
+    imageSequence->play();
+
+    osg::NodeVisitor nv(osg::NodeVisitor::UPDATE_VISITOR);
+    nv.setFrameStamp(_frameStamp.get());
+    nv.setImageRequestHandler(_pager.get());
+
+    // half a second ahead only reaches the first image of a second each.
+    frame(1);
+    imageSequence->update(&nv);
+    OSGUTX_TEST_F( _pager->getNumRequests()==1 )
+
+    // asking for a number of images ahead widens the window beyond the preload time.
+    _pager->setPreLoadNumImages(4);
+    OSGUTX_TEST_F( _pager->getPreLoadNumImages()==4 )
+    frame(2);
+    imageSequence->update(&nv);
+    OSGUTX_TEST_F( _pager->getNumRequests()==5 )
+
+    OSGUTX_TEST_F( _pager->takeFirst(2)=="frame_0.png" )
+    OSGUTX_TEST_F( _pager->takeFirst(2)=="frame_1.png" )
+}
+
+void ImagePagerTestFixture::testPassFramesToImageDestination(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<ImageDestination> destination = new ImageDestination(1);
+    _pager->setImageDestination(destination.get());
+
+    frame(1);
+    osg::ref_ptr<osg::Image> image = destination->allocateImage(8, 8, 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE);
+    osg::Image* discarded = image.get();
+    image = 0;
+
+    // the image discarded in frame 1 is held back until the draw of that frame is done with it.
+    frame(2);
+    image = destination->allocateImage(8, 8, 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE);
+    OSGUTX_TEST_F( image.get()!=discarded )
+
+    frame(3);
+    image = destination->allocateImage(8, 8, 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE);
+    OSGUTX_TEST_F( image.get()==discarded )
+}
+
+OSGUTX_BEGIN_TESTSUITE(ImagePager)
+    OSGUTX_ADD_TESTCASE(ImagePagerTestFixture, testRequestCurrent)
+    OSGUTX_ADD_TESTCASE(ImagePagerTestFixture, testDiscardStaleRequests)
+    OSGUTX_ADD_TESTCASE(ImagePagerTestFixture, testPreLoadNumImages)
+    OSGUTX_ADD_TESTCASE(ImagePagerTestFixture, testPassFramesToImageDestination)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(ImagePager, root.osgDB)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  MemoryMappedStream Tests
+//
+class MemoryMappedStreamTestFixture
+{
+public:
+
+    MemoryMappedStreamTestFixture()
+    {
+        const char* tmp = getenv("TMPDIR");
+        if (!tmp) tmp = getenv("TEMP");
+        if (!tmp) tmp = getenv("TMP");
+    #if defined(_WIN32) && !defined(__CYGWIN__)
+        if (!tmp) tmp = ".";
+    #else
+        if (!tmp) tmp = "/tmp";
+    #endif
+
+        std::ostringstream name;
+        name << "osgunittests_osgDB_" << getpid();
+        _directory = osgDB::concatPaths(tmp, name.str());
+    }
+
+    ~MemoryMappedStreamTestFixture()
+    {
+        osgDB::DirectoryContents contents = osgDB::getDirectoryContents(_directory);
+        for(osgDB::DirectoryContents::iterator itr = contents.begin();
+            itr != contents.end();
+            ++itr)
+        {
+            if (*itr!="." && *itr!="..") remove(osgDB::concatPaths(_directory, *itr).c_str());
+        }
+        rmdir(_directory.c_str());
+    }
+
+    void testReadMatchesFileStream(const osgUtx::TestContext& ctx);
+
+private:
+
+    // a geometry with arrays large enough to span several reads, textured with the image given.
+    static osg::Node* createScene(osg::Image* image)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+        osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;
+        osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+        for(unsigned int i=0; i<30000; ++i)
+        {
+            vertices->push_back(osg::Vec3(float(i%173)*0.5f, float(i/173)*0.25f, float((i*7919)%1000)*0.001f));
+            colors->push_back(osg::Vec4(float(i%256)/255.0f, float((i*3)%256)/255.0f, 0.5f, 1.0f));
+            texcoords->push_back(osg::Vec2(float(i%173)/172.0f, float(i/173)/173.0f));
+            if (i>=2) { triangles->push_back(i-2); triangles->push_back(i-1); triangles->push_back(i); }
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setColorArray(colors.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->setTexCoordArray(0, texcoords.get());
+        geometry->addPrimitiveSet(triangles.get());
+
+        osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D(image);
+        geometry->getOrCreateStateSet()->setTextureAttributeAndModes(0, texture.get());
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(geometry.get());
+        return geode.release();
+    }
+
+    // the scene written as ascii with its image data, so two reads can be compared in full.
+    static std::string toText(ReaderWriter* rw, const osg::Node* node)
+    {
+        osg::ref_ptr<Options> options = new Options("Ascii WriteImageHint=IncludeData");
+        std::ostringstream out;
+        if (!node || !rw->writeNode(*node, out, options.get()).success()) return std::string();
+        return out.str();
+    }
+
+    std::string _directory;
+};
+
+void MemoryMappedStreamTestFixture::testReadMatchesFileStream(const osgUtx::TestContext&)
+{
+    ReaderWriter* rw = Registry::instance()->getReaderWriterForExtension("osgb");
+    if (!rw || !Registry::instance()->getReaderWriterForExtension("rgb"))
+    {
+        OSG_NOTICE<<"osg or rgb plugin not available, skipping memory mapped read test"<<std::endl;
+        return;
+    }
+
+    OSGUTX_TEST_F( osgDB::makeDirectory(_directory) )
+
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(64, 32, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    for(unsigned int i=0; i<image->getTotalSizeInBytes(); ++i) image->data()[i] = static_cast<unsigned char>((i*7919)>>3);
+    std::string imageFileName = osgDB::concatPaths(_directory, "texture.rgb");
+    OSGUTX_TEST_F( osgDB::writeImageFile(*image, imageFileName) )
+    image->setFileName(imageFileName);
+
+    osg::ref_ptr<osg::Node> scene = createScene(image.get());
+
+    // the arrays and image data are read in place from the mapping, the embedded image file is handed to its plugin
+    const char* imageHints[] = { "IncludeData", "IncludeFile" };
+    for(unsigned int h=0; h<2; ++h)
+    {
+        std::string fileName = osgDB::concatPaths(_directory, std::string("scene_")+imageHints[h]+".osgb");
+        osg::ref_ptr<Options> writeOptions = new Options(std::string("WriteImageHint=")+imageHints[h]);
+        OSGUTX_TEST_F( rw->writeNode(*scene, fileName, writeOptions.get()).success() )
+
+        osg::ref_ptr<Options> mappedOptions = new Options("MemoryMapped");
+        osg::ref_ptr<osg::Node> mapped = rw->readNode(fileName, mappedOptions.get()).getNode();
+
+        std::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+        osg::ref_ptr<osg::Node> streamed = rw->readNode(fin, 0).getNode();
+
+        OSGUTX_TEST_F( mapped.valid() && streamed.valid() )
+
+        std::string mappedText = toText(rw, mapped.get());
+        OSGUTX_TEST_F( !mappedText.empty() && mappedText==toText(rw, streamed.get()) )
+
+        osg::Geode* geode = mapped->asGeode();
+        osg::Geometry* geometry = (geode && geode->getNumDrawables()==1) ? geode->getDrawable(0)->asGeometry() : 0;
+        osg::Vec3Array* vertices = geometry ? dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray()) : 0;
+        const osg::Vec3Array* original = static_cast<const osg::Vec3Array*>(scene->asGeode()->getDrawable(0)->asGeometry()->getVertexArray());
+        OSGUTX_TEST_F( vertices && vertices->size()==original->size() &&
+                       memcmp(&vertices->front(), &original->front(), original->size()*sizeof(osg::Vec3))==0 )
+
+        osg::Texture* texture = geometry ? dynamic_cast<osg::Texture*>(geometry->getStateSet()->getTextureAttribute(0, osg::StateAttribute::TEXTURE)) : 0;
+        osg::Image* mappedImage = texture ? texture->getImage(0) : 0;
+        OSGUTX_TEST_F( mappedImage && mappedImage->getTotalSizeInBytes()==image->getTotalSizeInBytes() &&
+                       memcmp(mappedImage->data(), image->data(), image->getTotalSizeInBytes())==0 )
+    }
+
+    // a truncated file fails to read rather than reading past the end of the mapping
+    std::string fileName = osgDB::concatPaths(_directory, "scene_IncludeData.osgb");
+    std::string truncatedFileName = osgDB::concatPaths(_directory, "truncated.osgb");
+    {
+        std::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+        std::ostringstream contents;
+        contents << fin.rdbuf();
+        std::string data = contents.str();
+        std::ofstream fout(truncatedFileName.c_str(), std::ios::out | std::ios::binary);
+        fout.write(data.c_str(), data.size()/2);
+    }
+
+    osg::ref_ptr<Options> mappedOptions = new Options("MemoryMapped");
+    OSGUTX_TEST_F( !rw->readNode(truncatedFileName, mappedOptions.get()).getNode() )
+}
+
+OSGUTX_BEGIN_TESTSUITE(MemoryMappedStream)
+    OSGUTX_ADD_TESTCASE(MemoryMappedStreamTestFixture, testReadMatchesFileStream)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(MemoryMappedStream, root.osgDB)
+
+
+}
@@ -0,0 +1,603 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE ABOVE COPYRIGHT NOTICE AND THIS PERMISSION NOTICE SHALL BE INCLUDED IN
+*  ALL COPIES OR SUBSTANTIAL PORTIONS OF THE SOFTWARE.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "UnitTestFramework.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Program>
+#include <osg/Texture2D>
+#include <osg/Viewport>
+#include <osg/io_utils>
+#include <osgUtil/CullVisitor>
+#include <osgUtil/Optimizer>
+#include <osgUtil/RenderBin>
+#include <osgUtil/RenderStage>
+#include <osgUtil/StateGraph>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace osgUtil
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  CullVisitor Tests
+//
+class CullVisitorTestFixture
+{
+public:
+
+    void testParallelCullMatchesSerial(const osgUtx::TestContext& ctx);
+
+private:
+
+    // a wide Group of triangles spread over the view, some below transforms, with a mix of shared, transparent and nested bin StateSets.
+    static osg::Node* createScene(unsigned int numChildren)
+    {
+        osg::ref_ptr<osg::StateSet> sharedStateSet = new osg::StateSet;
+        sharedStateSet->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+
+        osg::ref_ptr<osg::StateSet> transparentStateSet = new osg::StateSet;
+        transparentStateSet->setMode(GL_BLEND, osg::StateAttribute::ON);
+        transparentStateSet->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+
+        osg::Group* group = new osg::Group;
+        for(unsigned int i=0; i<numChildren; ++i)
+        {
+            osg::Vec3 position(float(i%8)*2.0f-8.0f, float(i/8)*2.0f-5.0f, -20.0f-float(i%5));
+
+            osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+            vertices->push_back(position);
+            vertices->push_back(position+osg::Vec3(1.0f, 0.0f, 0.0f));
+            vertices->push_back(position+osg::Vec3(0.0f, 1.0f, 0.0f));
+
+            osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+            geometry->setVertexArray(vertices.get());
+            geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, 3));
+
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->addDrawable(geometry.get());
+
+            switch(i%4)
+            {
+                case(1): geometry->setStateSet(sharedStateSet.get()); break;
+                case(2): geode->setStateSet(transparentStateSet.get()); break;
+                case(3): geode->getOrCreateStateSet()->setRenderBinDetails(5, "RenderBin"); break;
+                default: break;
+            }
+
+            if (i%3==0)
+            {
+                osg::MatrixTransform* transform = new osg::MatrixTransform(osg::Matrix::translate(0.0f, 0.0f, -float(i%7)));
+                transform->addChild(geode.get());
+                group->addChild(transform);
+            }
+            else
+            {
+                group->addChild(geode.get());
+            }
+        }
+        return group;
+    }
+
+    static void describeRenderBin(std::ostream& out, RenderBin* bin, const std::string& indent)
+    {
+        out<<indent<<"bin "<<bin->getBinNum()<<" "<<bin->className()<<" "<<bin->getSortMode()<<std::endl;
+
+        RenderBin::StateGraphList& stateGraphs = bin->getStateGraphList();
+        for(RenderBin::StateGraphList::iterator itr = stateGraphs.begin();
+            itr != stateGraphs.end();
+            ++itr)
+        {
+            // the StateGraphs themselves differ between the serial and parallel culls, the StateSets leading to them don't.
+            out<<indent<<"  stategraph";
+            for(StateGraph* sg = *itr; sg; sg = sg->_parent) out<<" "<<sg->getStateSet();
+            out<<std::endl;
+
+            for(StateGraph::LeafList::iterator litr = (*itr)->_leaves.begin();
+                litr != (*itr)->_leaves.end();
+                ++litr)
+            {
+                RenderLeaf* leaf = litr->get();
+                out<<indent<<"    leaf "<<leaf->_drawable.get()<<" "<<leaf->_traversalOrderNumber<<" "<<leaf->_depth<<" "<<leaf->_modelview->getTrans()<<std::endl;
+            }
+        }
+
+        for(RenderBin::RenderBinList::iterator itr = bin->getRenderBinList().begin();
+            itr != bin->getRenderBinList().end();
+            ++itr)
+        {
+            describeRenderBin(out, itr->second.get(), indent+"  ");
+        }
+    }
+
+    static std::string cull(osg::Node* scene, unsigned int numCullThreads, double& znear, double& zfar)
+    {
+        osg::ref_ptr<CullVisitor> cv = new CullVisitor;
+        cv->setNumCullThreads(numCullThreads);
+        cv->setMinimumNumChildrenToCullInParallel(2);
+
+        osg::ref_ptr<StateGraph> stateGraph = new StateGraph;
+        osg::ref_ptr<RenderStage> renderStage = new RenderStage;
+        osg::ref_ptr<osg::Viewport> viewport = new osg::Viewport(0, 0, 800, 600);
+        osg::ref_ptr<osg::RefMatrix> projection = new osg::RefMatrix(osg::Matrix::perspective(60.0, 800.0/600.0, 1.0, 1000.0));
+        osg::ref_ptr<osg::RefMatrix> modelview = new osg::RefMatrix();
+
+        cv->reset();
+        cv->setStateGraph(stateGraph.get());
+        cv->setRenderStage(renderStage.get());
+        renderStage->setViewport(viewport.get());
+
+        cv->pushViewport(viewport.get());
+        cv->pushProjectionMatrix(projection.get());
+        cv->pushModelViewMatrix(modelview.get(), osg::Transform::ABSOLUTE_RF);
+        scene->accept(*cv);
+        cv->popModelViewMatrix();
+        cv->popProjectionMatrix();
+        cv->popViewport();
+
+        znear = cv->getCalculatedNearPlane();
+        zfar = cv->getCalculatedFarPlane();
+
+        std::ostringstream out;
+        describeRenderBin(out, renderStage.get(), "");
+        return out.str();
+    }
+};
+
+void CullVisitorTestFixture::testParallelCullMatchesSerial(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<osg::Node> scene = createScene(48);
+
+    double serialNear, serialFar;
+    std::string serial = cull(scene.get(), 1, serialNear, serialFar);
+
+    // the triangles all end up in the bins, so a match isn't down to both culls being empty.
+    OSGUTX_TEST_F( serial.find("leaf")!=std::string::npos )
+    OSGUTX_TEST_F( serial.find("bin 10 ")!=std::string::npos )
+
+    unsigned int numThreads[] = { 2, 3, 5 };
+    for(unsigned int i=0; i<3; ++i)
+    {
+        double parallelNear, parallelFar;
+        std::string parallel = cull(scene.get(), numThreads[i], parallelNear, parallelFar);
+
+        OSGUTX_TEST_F( parallel==serial )
+        OSGUTX_TEST_F( parallelNear==serialNear && parallelFar==serialFar )
+    }
+}
+
+OSGUTX_BEGIN_TESTSUITE(CullVisitor)
+    OSGUTX_ADD_TESTCASE(CullVisitorTestFixture, testParallelCullMatchesSerial)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(CullVisitor, root.osgUtil)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  RenderBin Tests
+//
+class RenderBinTestFixture
+{
+public:
+
+    void testRetainedBinReuse(const osgUtx::TestContext& ctx);
+    void testCoherentOrderMatchesDepthSort(const osgUtx::TestContext& ctx);
+    void testDrawKeyOrderMatchesStateRanks(const osgUtx::TestContext& ctx);
+
+private:
+
+    typedef std::vector<StateGraph*> StateGraphs;
+    typedef std::vector<RenderLeaf*> Leaves;
+    typedef std::map<const osg::StateAttribute*, unsigned int> RankMap;
+
+    static unsigned int nextRandom(unsigned int& random)
+    {
+        random = random*1664525u + 1013904223u;
+        return random>>8;
+    }
+
+    // a tree of StateGraphs, some inheriting their program or texture from their parent, each with a few leaves
+    // at distinct whole number depths so that the quantized depths of the draw key keep their order.
+    void createStateGraphs(StateGraph* root, StateGraphs& stateGraphs)
+    {
+        std::vector< osg::ref_ptr<osg::Program> > programs;
+        std::vector< osg::ref_ptr<osg::Texture2D> > textures;
+        for(unsigned int i=0; i<5; ++i) programs.push_back(new osg::Program);
+        for(unsigned int i=0; i<4; ++i) textures.push_back(new osg::Texture2D);
+
+        unsigned int random = 7;
+        std::vector<float> depths;
+        for(unsigned int i=0; i<120; ++i) depths.push_back(float(i));
+        for(unsigned int i=depths.size()-1; i>0; --i) std::swap(depths[i], depths[nextRandom(random)%(i+1)]);
+
+        osg::ref_ptr<osg::Geometry> drawable = new osg::Geometry;
+        osg::ref_ptr<osg::RefMatrix> matrix = new osg::RefMatrix;
+        unsigned int numLeaves = 0;
+        for(unsigned int i=0; i<40; ++i)
+        {
+            osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+            unsigned int choice = nextRandom(random);
+            if (choice%6!=0) stateset->setAttribute(programs[choice%programs.size()].get());
+            if ((choice/7)%5!=0) stateset->setTextureAttribute(0, textures[(choice/7)%textures.size()].get());
+
+            StateGraph* parent = (i%4==3) ? stateGraphs[i-1] : root;
+            StateGraph* sg = parent->find_or_insert(stateset.get());
+            _statesets.push_back(stateset);
+            stateGraphs.push_back(sg);
+
+            for(unsigned int j=0; j<=i%5; ++j)
+            {
+                sg->addLeaf(new RenderLeaf(drawable.get(), matrix.get(), matrix.get(), depths[numLeaves++]));
+            }
+        }
+    }
+
+    static const osg::StateAttribute* getInheritedAttribute(StateGraph* sg, osg::StateAttribute::Type type)
+    {
+        for(; sg; sg = sg->_parent)
+        {
+            const osg::StateSet* stateset = sg->getStateSet();
+            const osg::StateAttribute* attribute = !stateset ? 0 :
+                type==osg::StateAttribute::TEXTURE ? stateset->getTextureAttribute(0, type) : stateset->getAttribute(type);
+            if (attribute) return attribute;
+        }
+        return 0;
+    }
+
+    static unsigned int rank(const osg::StateAttribute* attribute, RankMap& ranks)
+    {
+        if (!attribute) return 0;
+        RankMap::iterator itr = ranks.find(attribute);
+        if (itr!=ranks.end()) return itr->second;
+        unsigned int rank = ranks.size()+1;
+        ranks[attribute] = rank;
+        return rank;
+    }
+
+    // the order the draw key describes: by program then texture ranked in order of first appearance, StateGraph then depth.
+    struct ExpectedLeaf
+    {
+        ExpectedLeaf(unsigned int program, unsigned int texture, unsigned int stateGraph, RenderLeaf* leaf):
+            _program(program), _texture(texture), _stateGraph(stateGraph), _leaf(leaf) {}
+
+        bool operator < (const ExpectedLeaf& rhs) const
+        {
+            if (_program!=rhs._program) return _program<rhs._program;
+            if (_texture!=rhs._texture) return _texture<rhs._texture;
+            if (_stateGraph!=rhs._stateGraph) return _stateGraph<rhs._stateGraph;
+            return _leaf->_depth<rhs._leaf->_depth;
+        }
+
+        unsigned int _program;
+        unsigned int _texture;
+        unsigned int _stateGraph;
+        RenderLeaf* _leaf;
+    };
+
+    static Leaves expectedDrawKeyOrder(const StateGraphs& stateGraphs)
+    {
+        RankMap programRanks, textureRanks;
+        std::vector<ExpectedLeaf> expected;
+        for(unsigned int i=0; i<stateGraphs.size(); ++i)
+        {
+            unsigned int program = rank(getInheritedAttribute(stateGraphs[i], osg::StateAttribute::PROGRAM), programRanks);
+            unsigned int texture = rank(getInheritedAttribute(stateGraphs[i], osg::StateAttribute::TEXTURE), textureRanks);
+            for(unsigned int j=0; j<stateGraphs[i]->_leaves.size(); ++j)
+            {
+                expected.push_back(ExpectedLeaf(program, texture, i, stateGraphs[i]->_leaves[j].get()));
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+
+        Leaves leaves;
+        for(unsigned int i=0; i<expected.size(); ++i) leaves.push_back(expected[i]._leaf);
+        return leaves;
+    }
+
+    static bool lessDepth(const RenderLeaf* lhs, const RenderLeaf* rhs) { return lhs->_depth<rhs->_depth; }
+
+    std::vector< osg::ref_ptr<osg::StateSet> > _statesets;
+
+    class CoherentTestBin : public RenderBin
+    {
+    public:
+
+        CoherentTestBin():
+            RenderBin(SORT_BACK_TO_FRONT_COHERENT) {}
+
+        CoherentTestBin(const CoherentTestBin& rhs, const osg::CopyOp& copyop=osg::CopyOp::SHALLOW_COPY):
+            RenderBin(rhs, copyop) {}
+
+        META_Object(osgUtil, CoherentTestBin)
+    };
+};
+
+void RenderBinTestFixture::testRetainedBinReuse(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<RenderBin> root = new RenderBin;
+
+    // a coherently sorted bin is handed back the next frame, along with the order it sorted its leaves into.
+    osg::ref_ptr<RenderBin> coherent = root->find_or_insert(5, "CoherentDepthSortedBin");
+    OSGUTX_TEST_F( coherent.valid() && coherent->getSortMode()==RenderBin::SORT_BACK_TO_FRONT_COHERENT )
+    root->reset();
+    OSGUTX_TEST_F( root->find_or_insert(5, "CoherentDepthSortedBin")==coherent.get() )
+
+    // switching the bin number to another kind of bin with the same class but a different sort mode gives a new bin.
+    root->reset();
+    osg::ref_ptr<RenderBin> depthSorted = root->find_or_insert(5, "DepthSortedBin");
+    OSGUTX_TEST_F( depthSorted!=coherent )
+    OSGUTX_TEST_F( depthSorted->getSortMode()==RenderBin::SORT_BACK_TO_FRONT )
+
+    // and the retained bin isn't handed back on switching back.
+    root->reset();
+    osg::ref_ptr<RenderBin> coherentAgain = root->find_or_insert(5, "CoherentDepthSortedBin");
+    OSGUTX_TEST_F( coherentAgain!=coherent && coherentAgain!=depthSorted )
+
+    // the same goes for a prototype of a different class with the same sort mode.
+    root->reset();
+    osg::ref_ptr<CoherentTestBin> prototype = new CoherentTestBin;
+    osg::ref_ptr<RenderBin> custom = root->find_or_insert(5, prototype.get());
+    OSGUTX_TEST_F( custom!=coherentAgain && dynamic_cast<CoherentTestBin*>(custom.get())!=0 )
+
+    root->reset();
+    OSGUTX_TEST_F( root->find_or_insert(5, prototype.get())==custom )
+}
+
+void RenderBinTestFixture::testCoherentOrderMatchesDepthSort(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<StateGraph> root = new StateGraph;
+    StateGraphs stateGraphs;
+    createStateGraphs(root.get(), stateGraphs);
+
+    osg::ref_ptr<RenderBin> coherent = new RenderBin(RenderBin::SORT_FRONT_TO_BACK_COHERENT);
+    osg::ref_ptr<RenderBin> sorted = new RenderBin(RenderBin::SORT_FRONT_TO_BACK);
+
+    Leaves byDepth;
+    for(unsigned int i=0; i<stateGraphs.size(); ++i)
+    {
+        for(unsigned int j=0; j<stateGraphs[i]->_leaves.size(); ++j) byDepth.push_back(stateGraphs[i]->_leaves[j].get());
+    }
+    std::sort(byDepth.begin(), byDepth.end(), lessDepth);
+
+    // a few neighbours swap depths from frame to frame, so later frames repair the previous order rather than sorting afresh.
+    unsigned int random = 3;
+    for(unsigned int frame=0; frame<4; ++frame)
+    {
+        for(unsigned int i=0; frame>0 && i<20; ++i)
+        {
+            unsigned int k = nextRandom(random)%(byDepth.size()-1);
+            std::swap(byDepth[k]->_depth, byDepth[k+1]->_depth);
+            std::swap(byDepth[k], byDepth[k+1]);
+        }
+
+        coherent->reset();
+        sorted->reset();
+        for(unsigned int i=0; i<stateGraphs.size(); ++i)
+        {
+            coherent->addStateGraph(stateGraphs[i]);
+            sorted->addStateGraph(stateGraphs[i]);
+        }
+
+        coherent->sort();
+        sorted->sort();
+
+        OSGUTX_TEST_F( coherent->getRenderLeafList().size()==120 )
+        OSGUTX_TEST_F( coherent->getRenderLeafList()==sorted->getRenderLeafList() )
+        OSGUTX_TEST_F( coherent->getRenderLeafList()==byDepth )
+        if (frame>0) OSGUTX_TEST_F( coherent->getNumCoherentlySortedLeaves()==120 )
+    }
+}
+
+void RenderBinTestFixture::testDrawKeyOrderMatchesStateRanks(const osgUtx::TestContext&)
+{
+    osg::ref_ptr<StateGraph> root = new StateGraph;
+    StateGraphs stateGraphs;
+    createStateGraphs(root.get(), stateGraphs);
+
+    osg::ref_ptr<RenderBin> bin = new RenderBin(RenderBin::SORT_BY_DRAW_KEY);
+
+    // sorting the same bin again with the StateGraphs in another order reranks their programs and textures.
+    for(unsigned int frame=0; frame<2; ++frame)
+    {
+        bin->reset();
+        for(unsigned int i=0; i<stateGraphs.size(); ++i) bin->addStateGraph(stateGraphs[i]);
+        bin->sort();
+
+        Leaves expected = expectedDrawKeyOrder(stateGraphs);
+        OSGUTX_TEST_F( expected.size()==120 )
+        OSGUTX_TEST_F( bin->getRenderLeafList()==expected )
+
+        std::reverse(stateGraphs.begin(), stateGraphs.end());
+    }
+}
+
+OSGUTX_BEGIN_TESTSUITE(RenderBin)
+    OSGUTX_ADD_TESTCASE(RenderBinTestFixture, testRetainedBinReuse)
+    OSGUTX_ADD_TESTCASE(RenderBinTestFixture, testCoherentOrderMatchesDepthSort)
+    OSGUTX_ADD_TESTCASE(RenderBinTestFixture, testDrawKeyOrderMatchesStateRanks)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(RenderBin, root.osgUtil)
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Optimizer Tests
+//
+class OptimizerTestFixture
+{
+public:
+
+    void testParallelPassesMatchSerial(const osgUtx::TestContext& ctx);
+
+private:
+
+    // a grid of triangles with its vertices and triangles shuffled, so that the cache and access order passes have work to do.
+    static osg::Geometry* createGrid(unsigned int seed)
+    {
+        const unsigned int size = 12;
+        unsigned int random = seed*2654435761u + 1;
+
+        std::vector<unsigned int> order(size*size);
+        for(unsigned int i=0; i<order.size(); ++i) order[i] = i;
+        for(unsigned int i=order.size()-1; i>0; --i)
+        {
+            random = random*1664525u + 1013904223u;
+            std::swap(order[i], order[(random>>8)%(i+1)]);
+        }
+
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(size*size);
+        osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array(size*size);
+        for(unsigned int i=0; i<order.size(); ++i)
+        {
+            unsigned int x = order[i]%size, y = order[i]/size;
+            (*vertices)[i].set(float(x), float(y), float((x*y+seed)%5));
+            (*normals)[i].set(0.0f, 0.0f, 1.0f);
+        }
+
+        std::vector<unsigned int> positionToIndex(size*size);
+        for(unsigned int i=0; i<order.size(); ++i) positionToIndex[order[i]] = i;
+
+        std::vector<unsigned int> quads;
+        for(unsigned int y=0; y<size-1; ++y)
+        {
+            for(unsigned int x=0; x<size-1; ++x) quads.push_back(x+y*size);
+        }
+        for(unsigned int i=quads.size()-1; i>0; --i)
+        {
+            random = random*1664525u + 1013904223u;
+            std::swap(quads[i], quads[(random>>8)%(i+1)]);
+        }
+
+        osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+        for(unsigned int i=0; i<quads.size(); ++i)
+        {
+            unsigned int p = quads[i];
+            triangles->push_back(positionToIndex[p]);
+            triangles->push_back(positionToIndex[p+1]);
+            triangles->push_back(positionToIndex[p+size+1]);
+            triangles->push_back(positionToIndex[p]);
+            triangles->push_back(positionToIndex[p+size+1]);
+            triangles->push_back(positionToIndex[p+size]);
+        }
+
+        osg::Geometry* geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(triangles.get());
+        return geometry;
+    }
+
+    // a mix of independent geometries, ones that share a vertex array and ones that share buffer objects.
+    static osg::Node* createScene()
+    {
+        osg::Geode* geode = new osg::Geode;
+        for(unsigned int i=0; i<48; ++i)
+        {
+            osg::Geometry* geometry = createGrid(i);
+            geometry->setUseVertexBufferObjects(true);
+
+            osg::Geometry* previous = (i>0) ? geode->getDrawable(i-1)->asGeometry() : 0;
+            if (previous && i%6==1)
+            {
+                geometry->setVertexArray(previous->getVertexArray());
+            }
+            else if (previous && i%6==3)
+            {
+                geometry->getVertexArray()->setBufferObject(previous->getVertexArray()->getBufferObject());
+                geometry->getNormalArray()->setBufferObject(previous->getVertexArray()->getBufferObject());
+                geometry->getPrimitiveSet(0)->setBufferObject(previous->getPrimitiveSet(0)->getBufferObject());
+            }
+
+            geode->addDrawable(geometry);
+        }
+        return geode;
+    }
+
+    static std::string describe(osg::Node* node)
+    {
+        std::ostringstream out;
+        osg::Geode* geode = node->asGeode();
+        for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+        {
+            osg::Geometry* geometry = geode->getDrawable(i)->asGeometry();
+            out<<"geometry "<<i<<std::endl;
+
+            osg::Vec3Array* vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+            osg::Vec3Array* normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
+            for(unsigned int v=0; vertices && v<vertices->size(); ++v)
+            {
+                out<<"  "<<(*vertices)[v];
+                if (normals && v<normals->size()) out<<" "<<(*normals)[v];
+                out<<std::endl;
+            }
+
+            for(unsigned int p=0; p<geometry->getNumPrimitiveSets(); ++p)
+            {
+                osg::PrimitiveSet* primitiveSet = geometry->getPrimitiveSet(p);
+                out<<"  primitives "<<primitiveSet->getMode()<<" ";
+                for(unsigned int j=0; j<primitiveSet->getNumIndices(); ++j) out<<primitiveSet->index(j)<<" ";
+                out<<std::endl;
+            }
+        }
+        return out.str();
+    }
+
+    static std::string optimize(unsigned int numThreads)
+    {
+        osg::ref_ptr<osg::Node> scene = createScene();
+
+        Optimizer optimizer;
+        optimizer.setNumThreads(numThreads);
+        optimizer.optimize(scene.get(), Optimizer::INDEX_MESH | Optimizer::VERTEX_POSTTRANSFORM | Optimizer::VERTEX_PRETRANSFORM);
+
+        return describe(scene.get());
+    }
+};
+
+void OptimizerTestFixture::testParallelPassesMatchSerial(const osgUtx::TestContext&)
+{
+    std::string original = describe(osg::ref_ptr<osg::Node>(createScene()).get());
+    std::string serial = optimize(1);
+    OSGUTX_TEST_F( serial!=original )
+
+    for(unsigned int numThreads=2; numThreads<=4; ++numThreads)
+    {
+        OSGUTX_TEST_F( optimize(numThreads)==serial )
+    }
+}
+
+OSGUTX_BEGIN_TESTSUITE(Optimizer)
+    OSGUTX_ADD_TESTCASE(OptimizerTestFixture, testParallelPassesMatchSerial)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(Optimizer, root.osgUtil)
+
+
+}
@@ -0,0 +1,228 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE ABOVE COPYRIGHT NOTICE AND THIS PERMISSION NOTICE SHALL BE INCLUDED IN
+*  ALL COPIES OR SUBSTANTIAL PORTIONS OF THE SOFTWARE.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "UnitTestFramework.h"
+
+#include <osg/Group>
+#include <osgDB/Archive>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #include <direct.h>
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace osga
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Archive Tests
+//
+class ArchiveTestFixture
+{
+public:
+
+    ArchiveTestFixture()
+    {
+        const char* tmp = getenv("TMPDIR");
+        if (!tmp) tmp = getenv("TEMP");
+        if (!tmp) tmp = getenv("TMP");
+    #if defined(_WIN32) && !defined(__CYGWIN__)
+        if (!tmp) tmp = ".";
+    #else
+        if (!tmp) tmp = "/tmp";
+    #endif
+
+        std::ostringstream name;
+        name << "osgunittests_osga_" << getpid();
+        _directory = osgDB::concatPaths(tmp, name.str());
+    }
+
+    ~ArchiveTestFixture()
+    {
+        osgDB::DirectoryContents contents = osgDB::getDirectoryContents(_directory);
+        for(osgDB::DirectoryContents::iterator itr = contents.begin();
+            itr != contents.end();
+            ++itr)
+        {
+            if (*itr!="." && *itr!="..") remove(osgDB::concatPaths(_directory, *itr).c_str());
+        }
+        rmdir(_directory.c_str());
+    }
+
+    void testConcurrentReadsAndReopenForWrite(const osgUtx::TestContext& ctx);
+
+private:
+
+    static std::string entryName(unsigned int i)
+    {
+        std::ostringstream name;
+        name << "node_" << i << ".osgt";
+        return name.str();
+    }
+
+    static osg::ref_ptr<osgDB::Archive> openArchive(const std::string& fileName, osgDB::ReaderWriter::ArchiveStatus status)
+    {
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("osga");
+        return rw ? rw->openArchive(fileName, status).getArchive() : 0;
+    }
+
+    static bool writeEntries(osgDB::Archive* archive, unsigned int begin, unsigned int end)
+    {
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            osg::ref_ptr<osg::Group> group = new osg::Group;
+            group->setName(entryName(i));
+            for(unsigned int j=0; j<=i%4; ++j) group->addChild(new osg::Group);
+            if (!archive->writeNode(*group, entryName(i)).success()) return false;
+        }
+        return true;
+    }
+
+    static bool readEntry(osgDB::Archive* archive, unsigned int i)
+    {
+        osg::ref_ptr<osg::Node> node = archive->readNode(entryName(i)).getNode();
+        osg::Group* group = node.valid() ? node->asGroup() : 0;
+        return group && group->getName()==entryName(i) && group->getNumChildren()==i%4+1;
+    }
+
+    // reads every entry of the archive over and over, at the same time as the other threads.
+    class ReadThread : public osg::Referenced, public OpenThreads::Thread
+    {
+    public:
+
+        ReadThread(osgDB::Archive* archive, unsigned int numEntries, unsigned int offset):
+            _archive(archive),
+            _numEntries(numEntries),
+            _offset(offset),
+            _numReads(0),
+            _numFailures(0) {}
+
+        virtual void run()
+        {
+            for(unsigned int pass=0; pass<20; ++pass)
+            {
+                for(unsigned int i=0; i<_numEntries; ++i)
+                {
+                    if (readEntry(_archive.get(), (i+_offset)%_numEntries)) ++_numReads;
+                    else ++_numFailures;
+                }
+            }
+        }
+
+        osg::ref_ptr<osgDB::Archive> _archive;
+        unsigned int _numEntries;
+        unsigned int _offset;
+        unsigned int _numReads;
+        unsigned int _numFailures;
+    };
+
+    std::string _directory;
+};
+
+void ArchiveTestFixture::testConcurrentReadsAndReopenForWrite(const osgUtx::TestContext&)
+{
+    if (!osgDB::Registry::instance()->getReaderWriterForExtension("osga") ||
+        !osgDB::Registry::instance()->getReaderWriterForExtension("osgt"))
+    {
+        OSG_NOTICE<<"osga or osg plugin not available, skipping archive test"<<std::endl;
+        return;
+    }
+
+    OSGUTX_TEST_F( osgDB::makeDirectory(_directory) )
+    std::string fileName = osgDB::concatPaths(_directory, "entries.osga");
+
+    const unsigned int numEntries = 8;
+    osg::ref_ptr<osgDB::Archive> archive = openArchive(fileName, osgDB::ReaderWriter::CREATE);
+    OSGUTX_TEST_F( archive.valid() )
+    OSGUTX_TEST_F( writeEntries(archive.get(), 0, numEntries) )
+    archive->close();
+
+    archive = openArchive(fileName, osgDB::ReaderWriter::READ);
+    OSGUTX_TEST_F( archive.valid() )
+
+    osgDB::Archive::FileNameList fileNames;
+    OSGUTX_TEST_F( archive->getFileNames(fileNames) && fileNames.size()==numEntries )
+
+    // an entry that isn't in the archive is reported missing without disturbing the reads of the others.
+    OSGUTX_TEST_F( !archive->fileExists("missing.osgt") )
+    OSGUTX_TEST_F( archive->getFileType("missing.osgt")==osgDB::FILE_NOT_FOUND )
+    OSGUTX_TEST_F( !archive->readNode("missing.osgt").success() )
+
+    std::vector< osg::ref_ptr<ReadThread> > threads;
+    for(unsigned int i=0; i<4; ++i)
+    {
+        threads.push_back(new ReadThread(archive.get(), numEntries, i*3));
+        threads.back()->startThread();
+    }
+
+    bool allRead = true;
+    for(unsigned int i=0; i<threads.size(); ++i)
+    {
+        threads[i]->join();
+        if (threads[i]->_numFailures!=0 || threads[i]->_numReads!=20*numEntries) allRead = false;
+    }
+    OSGUTX_TEST_F( allRead )
+    OSGUTX_TEST_F( readEntry(archive.get(), 0) )
+    archive->close();
+    threads.clear();
+
+    // reopening for WRITE reads the existing index before appending to it, the mapping made along the way is released.
+    archive = openArchive(fileName, osgDB::ReaderWriter::WRITE);
+    OSGUTX_TEST_F( archive.valid() )
+    OSGUTX_TEST_F( archive->fileExists(entryName(numEntries-1)) )
+    OSGUTX_TEST_F( writeEntries(archive.get(), numEntries, numEntries+2) )
+    archive->close();
+
+    archive = openArchive(fileName, osgDB::ReaderWriter::READ);
+    OSGUTX_TEST_F( archive.valid() )
+    OSGUTX_TEST_F( archive->getFileNames(fileNames) && fileNames.size()==numEntries+2 )
+    bool allEntries = true;
+    for(unsigned int i=0; i<numEntries+2; ++i)
+    {
+        if (!readEntry(archive.get(), i)) allEntries = false;
+    }
+    OSGUTX_TEST_F( allEntries )
+    archive->close();
+}
+
+OSGUTX_BEGIN_TESTSUITE(Archive)
+    OSGUTX_ADD_TESTCASE(ArchiveTestFixture, testConcurrentReadsAndReopenForWrite)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(Archive, root.osga)
+
+
+}
@@ -0,0 +1,251 @@
+/* OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE ABOVE COPYRIGHT NOTICE AND THIS PERMISSION NOTICE SHALL BE INCLUDED IN
+*  ALL COPIES OR SUBSTANTIAL PORTIONS OF THE SOFTWARE.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include "UnitTestFramework.h"
+
+#include <osg/Endian>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #include <direct.h>
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace ply
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Binary Read Tests
+//
+class BinaryTestFixture
+{
+public:
+
+    struct Mesh
+    {
+        std::vector<osg::Vec3> vertices;
+        std::vector<osg::Vec3> normals;
+        std::vector<osg::Vec4> colors;
+        std::vector<unsigned int> triangles;
+        std::vector<unsigned int> quads;
+
+        bool operator == (const Mesh& rhs) const
+        {
+            return vertices==rhs.vertices && normals==rhs.normals && colors==rhs.colors &&
+                   triangles==rhs.triangles && quads==rhs.quads;
+        }
+    };
+
+    BinaryTestFixture()
+    {
+        const char* tmp = getenv("TMPDIR");
+        if (!tmp) tmp = getenv("TEMP");
+        if (!tmp) tmp = getenv("TMP");
+    #if defined(_WIN32) && !defined(__CYGWIN__)
+        if (!tmp) tmp = ".";
+    #else
+        if (!tmp) tmp = "/tmp";
+    #endif
+
+        std::ostringstream name;
+        name << "osgunittests_ply_" << getpid();
+        _directory = osgDB::concatPaths(tmp, name.str());
+    }
+
+    ~BinaryTestFixture()
+    {
+        osgDB::DirectoryContents contents = osgDB::getDirectoryContents(_directory);
+        for(osgDB::DirectoryContents::iterator itr = contents.begin();
+            itr != contents.end();
+            ++itr)
+        {
+            if (*itr!="." && *itr!="..") remove(osgDB::concatPaths(_directory, *itr).c_str());
+        }
+        rmdir(_directory.c_str());
+    }
+
+    void testByteOrdersAndPathsAgree(const osgUtx::TestContext& ctx);
+
+private:
+
+    // enough vertices for the indices to need more than their low byte
+    static const unsigned int NUM_VERTICES = 300;
+
+    static void writeValue(std::ostream& out, const void* value, bool bigEndian)
+    {
+        char bytes[4];
+        memcpy(bytes, value, 4);
+        if (bigEndian != (osg::getCpuByteOrder()==osg::BigEndian)) osg::swapBytes4(bytes);
+        out.write(bytes, 4);
+    }
+
+    static void writeFloat(std::ostream& out, float value, bool bigEndian) { writeValue(out, &value, bigEndian); }
+    static void writeInt(std::ostream& out, int value, bool bigEndian) { writeValue(out, &value, bigEndian); }
+
+    // write a binary PLY file of colored, lit vertices and a mix of faces, filling in the mesh expected from it.
+    // The generic variant carries an extra property on both elements, which the loader's fast paths don't handle.
+    static bool writePLY(const std::string& fileName, bool bigEndian, bool generic, Mesh& expected)
+    {
+        std::ostringstream body;
+        for(unsigned int i=0; i<NUM_VERTICES; ++i)
+        {
+            osg::Vec3 v(float(i)*0.25f - 37.5f, float(i)*1.5f + 0.125f, -float(i)*0.0625f);
+            osg::Vec3 n(float(i%3), float((i+1)%3), -1.0f);
+            unsigned char c[3] = { static_cast<unsigned char>(i%256), static_cast<unsigned char>((i*7)%256), static_cast<unsigned char>(255-i%256) };
+
+            for(unsigned int k=0; k<3; ++k) writeFloat(body, v[k], bigEndian);
+            for(unsigned int k=0; k<3; ++k) writeFloat(body, n[k], bigEndian);
+            body.write(reinterpret_cast<const char*>(c), 3);
+            if (generic)
+            {
+                body.put(1);
+                writeInt(body, int(i), bigEndian);
+            }
+
+            expected.vertices.push_back(v);
+            expected.normals.push_back(n);
+            expected.colors.push_back(osg::Vec4((unsigned int) c[0] / 255.0, (unsigned int) c[1] / 255.0, (unsigned int) c[2] / 255.0, 1.0));
+        }
+
+        // triangles and quads reaching across the whole range of indices, along with a pentagon and a face of the
+        // largest size the count can hold, both of which are skipped
+        unsigned int numFaces = 0;
+        for(unsigned int i=0; i+3<NUM_VERTICES; i+=3)
+        {
+            unsigned int size = (i%9==0) ? 4 : 3;
+            if (i==150) size = 5;
+            if (i==210) size = 255;
+
+            body.put(static_cast<char>(size));
+            for(unsigned int j=0; j<size; ++j)
+            {
+                unsigned int index = (j%2==0) ? (i+j)%NUM_VERTICES : (2*NUM_VERTICES-1-i-j/2)%NUM_VERTICES;
+                writeInt(body, int(index), bigEndian);
+                if (size==3) expected.triangles.push_back(index);
+                else if (size==4) expected.quads.push_back(index);
+            }
+            if (generic) body.put(static_cast<char>(i%2));
+            ++numFaces;
+        }
+
+        std::ofstream fout(fileName.c_str(), std::ios::out | std::ios::binary);
+        if (!fout) return false;
+
+        fout << "ply\n"
+             << "format " << (bigEndian ? "binary_big_endian" : "binary_little_endian") << " 1.0\n"
+             << "element vertex " << NUM_VERTICES << "\n"
+             << "property float x\nproperty float y\nproperty float z\n"
+             << "property float nx\nproperty float ny\nproperty float nz\n"
+             << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        if (generic) fout << "property list uchar int extra\n";
+        fout << "element face " << numFaces << "\n"
+             << "property list uchar int vertex_indices\n";
+        if (generic) fout << "property uchar flags\n";
+        fout << "end_header\n";
+
+        std::string data = body.str();
+        fout.write(data.c_str(), data.size());
+        return fout.good();
+    }
+
+    static bool read(const std::string& fileName, Mesh& mesh)
+    {
+        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(fileName);
+        osg::Geode* geode = node.valid() ? node->asGeode() : 0;
+        osg::Geometry* geometry = (geode && geode->getNumDrawables()==1) ? geode->getDrawable(0)->asGeometry() : 0;
+        if (!geometry) return false;
+
+        osg::Vec3Array* vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+        osg::Vec3Array* normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
+        osg::Vec4Array* colors = dynamic_cast<osg::Vec4Array*>(geometry->getColorArray());
+        if (!vertices || !normals || !colors) return false;
+
+        mesh.vertices.assign(vertices->begin(), vertices->end());
+        mesh.normals.assign(normals->begin(), normals->end());
+        mesh.colors.assign(colors->begin(), colors->end());
+
+        for(unsigned int i=0; i<geometry->getNumPrimitiveSets(); ++i)
+        {
+            osg::DrawElementsUInt* elements = dynamic_cast<osg::DrawElementsUInt*>(geometry->getPrimitiveSet(i));
+            if (!elements) return false;
+
+            std::vector<unsigned int>& indices = (elements->getMode()==GL_QUADS) ? mesh.quads : mesh.triangles;
+            indices.insert(indices.end(), elements->begin(), elements->end());
+        }
+        return true;
+    }
+
+    std::string _directory;
+};
+
+void BinaryTestFixture::testByteOrdersAndPathsAgree(const osgUtx::TestContext&)
+{
+    if (!osgDB::Registry::instance()->getReaderWriterForExtension("ply"))
+    {
+        OSG_NOTICE<<"ply plugin not available, skipping binary read test"<<std::endl;
+        return;
+    }
+
+    OSGUTX_TEST_F( osgDB::makeDirectory(_directory) )
+
+    const char* names[] = { "fast_le.ply", "fast_be.ply", "generic_le.ply", "generic_be.ply" };
+    Mesh results[4];
+    for(unsigned int f=0; f<4; ++f)
+    {
+        std::string fileName = osgDB::concatPaths(_directory, names[f]);
+
+        Mesh expected;
+        OSGUTX_TEST_F( writePLY(fileName, f%2==1, f>=2, expected) )
+        OSGUTX_TEST_F( expected.triangles.size()>0 && expected.quads.size()>0 )
+
+        OSGUTX_TEST_F( read(fileName, results[f]) )
+        OSGUTX_TEST_F( results[f]==expected )
+    }
+
+    OSGUTX_TEST_F( results[0]==results[1] )
+    OSGUTX_TEST_F( results[0]==results[2] )
+    OSGUTX_TEST_F( results[1]==results[3] )
+}
+
+OSGUTX_BEGIN_TESTSUITE(Binary)
+    OSGUTX_ADD_TESTCASE(BinaryTestFixture, testByteOrdersAndPathsAgree)
+OSGUTX_END_TESTSUITE
+
+OSGUTX_AUTOREGISTER_TESTSUITE_AT(Binary, root.ply)
+
+
+}
@@ -30,6 +30,7 @@
 #include "UnitTestFramework.h"
 #include "performance.h"
 #include "MultiThreadRead.h"
+#include "ImagePerformance.h"
 
 #include <iostream>
 
@@ -572,6 +573,9 @@ int main( int argc, char** argv )
     arguments.getApplicationUsage()->addCommandLineOption("matrix","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("performance","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("read-threads <numthreads>","Run multi-thread reading test.");
+    arguments.getApplicationUsage()->addCommandLineOption("image-performance","Report the MPixel/s of the osg::ImageUtils pixel operations.");
+    arguments.getApplicationUsage()->addCommandLineOption("image-size <size>","Set the width and height of the images used by image-performance, the default is 4096.");
+    arguments.getApplicationUsage()->addCommandLineOption("image-iterations <num>","Set the number of times each image-performance operation is run, the default is 4.");
 
 
     if (arguments.argc()<=1)
@@ -610,6 +614,9 @@ int main( int argc, char** argv )
     bool performanceTest = false;
     while (arguments.read("p") || arguments.read("performance")) performanceTest = true;
 
+    bool imagePerformanceTest = false;
+    while (arguments.read("image-performance")) imagePerformanceTest = true;
+
     // if user request help write it out to cout.
     if (arguments.read("-h") || arguments.read("--help"))
     {
@@ -680,6 +687,13 @@ int main( int argc, char** argv )
         runPerformanceTests();
     }
 
+    if (imagePerformanceTest)
+    {
+        std::cout<<"**** image performance tests  ******"<<std::endl;
+
+        runImagePerformanceTests(arguments);
+    }
+
     if (numReadThreads>0)
     {
         runMultiThreadReadTests(numReadThreads, arguments);
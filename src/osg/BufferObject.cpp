@@ -58,6 +58,9 @@ GLBufferObject::GLBufferObject(unsigned int contextID, BufferObject* bufferObjec
     _allocatedSize(0),
     _dirty(true),
     _bufferObject(0),
+    _numRingBufferFrames(0),
+    _retiredGLObjectID(0),
+    _ringBufferMapFailed(false),
     _set(0),
     _previous(0),
     _next(0),
@@ -96,6 +99,9 @@ void GLBufferObject::assign(BufferObject* bufferObject)
 {
     _bufferObject = bufferObject;
 
+    // give ring buffering another go, whether this is a new BufferObject or an orphan being reused.
+    _ringBufferMapFailed = false;
+
     if (_bufferObject)
     {
         _profile = bufferObject->getProfile();
@@ -121,6 +127,21 @@ void GLBufferObject::clear()
 
 void GLBufferObject::compileBuffer()
 {
+    deleteRetiredGLObject();
+
+    if (_bufferObject->getNumRingBufferFrames()>1 && !_ringBufferMapFailed && _extensions->glBufferStorage && _extensions->glMapBufferRange && _extensions->glFenceSync)
+    {
+        compileRingBuffer();
+        return;
+    }
+
+    // switching back from ring buffering, or reused for another BufferObject, so need a buffer object that isn't immutable.
+    if (_numRingBufferFrames>0)
+    {
+        releaseRingBuffer();
+        _bufferEntries.clear();
+    }
+
     _dirty = false;
 
     _bufferEntries.reserve(_bufferObject->getNumBufferData());
@@ -288,6 +309,191 @@ void GLBufferObject::compileBuffer()
     }
 }
 
+void GLBufferObject::compileRingBuffer()
+{
+    _dirty = false;
+
+    unsigned int numFrames = _bufferObject->getNumRingBufferFrames();
+    unsigned int bufferAlignment = 4;
+
+    // each BufferData has numFrames consecutive regions, so the layout only needs rebuilding when the BufferData or their sizes change.
+    bool layoutChanged = (numFrames!=_numRingBufferFrames) || (_bufferEntries.size()!=_bufferObject->getNumBufferData());
+    for(unsigned int i=0; i<_bufferEntries.size() && !layoutChanged; ++i)
+    {
+        const BufferData* bd = _bufferObject->getBufferData(i);
+        if (_bufferEntries[i].dataSource!=bd || _bufferEntries[i].dataSize!=(bd ? bd->getTotalDataSize() : 0)) layoutChanged = true;
+    }
+
+    if (layoutChanged)
+    {
+        _bufferEntries.clear();
+        _bufferEntries.reserve(_bufferObject->getNumBufferData());
+
+        unsigned int newTotalSize = 0;
+        for(unsigned int i=0; i<_bufferObject->getNumBufferData(); ++i)
+        {
+            BufferData* bd = _bufferObject->getBufferData(i);
+
+            BufferEntry entry;
+            entry.offset = newTotalSize;
+            entry.modifiedCount = 0xffffff;
+            entry.dataSize = bd ? bd->getTotalDataSize() : 0;
+            entry.dataSource = bd;
+            entry.ringFrame = 0;
+
+            newTotalSize += numFrames * computeBufferAlignment(entry.dataSize, bufferAlignment);
+
+            _bufferEntries.push_back(entry);
+        }
+
+        if (newTotalSize > _profile._size)
+        {
+            OSG_INFO<<"newTotalSize="<<newTotalSize<<", _profile._size="<<_profile._size<<std::endl;
+
+            unsigned int sizeDifference = newTotalSize - _profile._size;
+            _profile._size = newTotalSize;
+
+            if (_set)
+            {
+                _set->moveToSet(this, _set->getParent()->getGLBufferObjectSet(_profile));
+                _set->getParent()->getCurrGLBufferObjectPoolSize() += sizeDifference;
+            }
+        }
+    }
+
+    // a new layout may overlap regions the GPU is still reading from, so it's given new storage too.
+    bool reallocate = layoutChanged || _allocatedSize != _profile._size || !_persistentDMA;
+    if (reallocate)
+    {
+        if (_numRingBufferFrames>0 || _allocatedSize>0) releaseRingBuffer();
+
+        _extensions->glBindBuffer(_profile._target, _glObjectID);
+        _extensions->debugObjectLabel(GL_BUFFER, _glObjectID, _bufferObject->getName());
+
+        OSG_INFO<<"    Allocating new ring buffer storage, size="<<_profile._size<<", numFrames="<<numFrames<<std::endl;
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        _extensions->glBufferStorage(_profile._target, _profile._size, NULL, flags);
+        _persistentDMA = _extensions->glMapBufferRange(_profile._target, 0, _profile._size, flags);
+        _allocatedSize = _profile._size;
+
+        _numRingBufferFrames = numFrames;
+        _ringBufferFences.assign(_bufferEntries.size()*numFrames, GLsync(0));
+
+        if (!_persistentDMA)
+        {
+            // rather than allocating new storage and trying again every frame, upload this buffer object the usual way from now on.
+            OSG_WARN<<"Warning: GLBufferObject::compileRingBuffer() unable to map buffer storage, falling back to glBufferSubData()."<<std::endl;
+            _ringBufferMapFailed = true;
+            compileBuffer();
+            return;
+        }
+    }
+    else
+    {
+        _extensions->glBindBuffer(_profile._target, _glObjectID);
+    }
+
+    for(unsigned int i=0; i<_bufferEntries.size(); ++i)
+    {
+        BufferEntry& entry = _bufferEntries[i];
+        if (!entry.dataSource || (!reallocate && entry.modifiedCount == entry.dataSource->getModifiedCount())) continue;
+
+        if (!reallocate)
+        {
+            // fence the region drawn from so far, then move on to the next region, waiting for the GPU to finish
+            // with it if it was last written numFrames updates ago and is still in use.
+            unsigned int regionSize = computeBufferAlignment(entry.dataSize, bufferAlignment);
+            unsigned int baseOffset = entry.offset - entry.ringFrame*regionSize;
+
+            GLsync& previousFence = _ringBufferFences[i*numFrames + entry.ringFrame];
+            if (previousFence) _extensions->glDeleteSync(previousFence);
+            previousFence = _extensions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+            entry.ringFrame = (entry.ringFrame+1)%numFrames;
+            entry.offset = baseOffset + entry.ringFrame*regionSize;
+
+            GLsync& nextFence = _ringBufferFences[i*numFrames + entry.ringFrame];
+            if (nextFence)
+            {
+                GLuint64 timeout = (GLuint64)1000 * 1000 * 1000;
+                GLenum result = _extensions->glClientWaitSync(nextFence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+                if (result!=GL_ALREADY_SIGNALED && result!=GL_CONDITION_SATISFIED)
+                {
+                    // the GPU may still be reading the region, so rather than overwrite it move all the entries
+                    // to new storage, as glBufferData() would orphan the old, and upload them there.
+                    OSG_NOTICE<<"Warning: GLBufferObject::compileRingBuffer() timed out waiting for the GPU to release a ring buffer region, reallocating."<<std::endl;
+                    releaseRingBuffer();
+                    compileRingBuffer();
+                    return;
+                }
+                _extensions->glDeleteSync(nextFence);
+                nextFence = 0;
+            }
+        }
+
+        entry.numRead = 0;
+        entry.modifiedCount = entry.dataSource->getModifiedCount();
+
+        unsigned char* dst = static_cast<unsigned char*>(_persistentDMA) + entry.offset;
+        const osg::Image* image = entry.dataSource->asImage();
+        if (image && !(image->isDataContiguous()))
+        {
+            for(osg::Image::DataIterator img_itr(image); img_itr.valid(); ++img_itr)
+            {
+                memcpy(dst, img_itr.data(), img_itr.size());
+                dst += img_itr.size();
+            }
+        }
+        else
+        {
+            memcpy(dst, entry.dataSource->getDataPointer(), entry.dataSize);
+        }
+    }
+}
+
+void GLBufferObject::releaseRingBuffer()
+{
+    deleteRingBufferFences();
+
+    if (_glObjectID!=0)
+    {
+        if (_persistentDMA)
+        {
+            _extensions->glBindBuffer(_profile._target, _glObjectID);
+            _extensions->glUnmapBuffer(_profile._target);
+            _persistentDMA = 0;
+        }
+
+        deleteRetiredGLObject();
+        _retiredGLObjectID = _glObjectID;
+        _extensions->glGenBuffers(1, &_glObjectID);
+    }
+
+    _allocatedSize = 0;
+    _numRingBufferFrames = 0;
+}
+
+void GLBufferObject::deleteRetiredGLObject()
+{
+    if (_retiredGLObjectID!=0)
+    {
+        _extensions->glDeleteBuffers(1, &_retiredGLObjectID);
+        _retiredGLObjectID = 0;
+    }
+}
+
+void GLBufferObject::deleteRingBufferFences()
+{
+    for(Fences::iterator itr = _ringBufferFences.begin();
+        itr != _ringBufferFences.end();
+        ++itr)
+    {
+        if (*itr) _extensions->glDeleteSync(*itr);
+    }
+    _ringBufferFences.clear();
+}
+
 void GLBufferObject::commitDMA(unsigned int entryidx)
 {
     if( !(_profile._mappingbitfield & GL_MAP_PERSISTENT_BIT) ) return;
@@ -310,8 +516,13 @@ void GLBufferObject::downloadBuffer(unsigned int entryidx)
 void GLBufferObject::deleteGLObject()
 {
     OSG_DEBUG<<"GLBufferObject::deleteGLObject() "<<_glObjectID<<std::endl;
+    deleteRetiredGLObject();
+
     if (_glObjectID!=0)
     {
+        deleteRingBufferFences();
+        _numRingBufferFrames = 0;
+
         if(_persistentDMA)
         {
             _extensions->glBindBuffer(_profile._target, _glObjectID);
@@ -1127,16 +1338,36 @@ void GLBufferObjectManager::recomputeStats(std::ostream& out) const
 // BufferObject
 //
 BufferObject::BufferObject():
-    _copyDataAndReleaseGLBufferObject(false)
+    _copyDataAndReleaseGLBufferObject(false),
+    _numRingBufferFrames(0)
 {
 }
 
 BufferObject::BufferObject(const BufferObject& bo,const CopyOp& copyop):
     Object(bo,copyop),
-    _copyDataAndReleaseGLBufferObject(bo._copyDataAndReleaseGLBufferObject)
+    _copyDataAndReleaseGLBufferObject(bo._copyDataAndReleaseGLBufferObject),
+    _numRingBufferFrames(bo._numRingBufferFrames)
 {
 }
 
+void BufferObject::setNumRingBufferFrames(unsigned int numFrames)
+{
+    if (_numRingBufferFrames==numFrames) return;
+
+    _numRingBufferFrames = numFrames;
+
+    // dirty the BufferData rather than just the GLBufferObjects so that the arrays are dispatched again, compiling
+    // the new buffer layout before any of them are drawn from.
+    for(BufferDataList::iterator itr = _bufferDataList.begin();
+        itr != _bufferDataList.end();
+        ++itr)
+    {
+        if (*itr) (*itr)->dirty();
+    }
+
+    dirty();
+}
+
 BufferObject::~BufferObject()
 {
     releaseGLObjects(0);
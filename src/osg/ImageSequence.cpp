@@ -391,7 +391,7 @@ void ImageSequence::update(osg::NodeVisitor* nv)
     }
     else
     {
-        double preLoadTime = time + osg::minimum(irh->getPreLoadTime()*_timeMultiplier, _length);
+        double preLoadTime = time + osg::minimum(osg::maximum(irh->getPreLoadTime()*_timeMultiplier, double(irh->getPreLoadNumImages())*_timePerImage), _length);
 
         int startLoadIndex = int(time/_timePerImage);
         if (startLoadIndex>=int(_imageDataList.size())) startLoadIndex = int(_imageDataList.size())-1;
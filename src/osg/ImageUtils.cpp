@@ -17,11 +17,375 @@
 #include <osg/Math>
 #include <osg/ImageUtils>
 #include <osg/Texture>
+#include <osg/TaskScheduler>
 
 #include <osg/Notify>
 #include <osg/io_utils>
 #include "dxtctool.h"
 
+namespace
+{
+
+// Task that repeatedly takes the next unprocessed row and processes it, so that it can be run by several threads at once.
+class ProcessRowsTask : public osg::Referenced, public osg::TaskScheduler::ParallelForFunctor
+{
+public:
+    ProcessRowsTask(unsigned int numRows):
+        _numRows(numRows) {}
+
+    virtual void operator() (unsigned int begin, unsigned int end)
+    {
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            processRow(i);
+        }
+    }
+
+    virtual void processRow(unsigned int row) = 0;
+
+    unsigned int getNumRows() const { return _numRows; }
+
+protected:
+    unsigned int            _numRows;
+};
+
+// Run the task on numThreads threads of the shared TaskScheduler, 0 for all of them, including the calling thread.
+void processRows(ProcessRowsTask* task, unsigned int numThreads)
+{
+    osg::TaskScheduler::instance()->parallelFor(task->getNumRows(), *task, numThreads);
+}
+
+// Smallest number of pixels worth handing to another thread by the per pixel operations, smaller images are processed on the calling thread.
+const unsigned int MIN_NUM_PIXELS_PER_THREAD = 65536;
+
+unsigned int computeNumPixelThreads(unsigned int numPixels, unsigned int numThreads)
+{
+    return osg::TaskScheduler::instance()->computeNumThreads(numPixels, MIN_NUM_PIXELS_PER_THREAD, numThreads);
+}
+
+// computeRowMinMax() works through rows in blocks of NUM_BLOCK_VALUES values, a multiple of the 1 to 4 components
+// of a pixel, so that each position within a block always holds the same component. The fixed size inner loops over
+// a block have no dependencies between positions and are compiled to SSE2/AVX/NEON code by the compiler's vectorizer.
+const unsigned int NUM_BLOCK_VALUES = 48;
+
+// Rows of all the slices of an image, numbered slice by slice.
+struct ImageRows
+{
+    ImageRows(const osg::Image* image, int s=0, int t=0, int r=0, int height=-1):
+        _image(const_cast<osg::Image*>(image)),
+        _s(s), _t(t), _r(r),
+        _height(height<0 ? image->t() : height) {}
+
+    unsigned char* data(unsigned int row) const { return _image->data(_s, _t + row%_height, _r + row/_height); }
+
+    osg::Image* _image;
+    int _s, _t, _r;
+    unsigned int _height;
+};
+
+template<typename T>
+void computeRowMinMax(const T* data, unsigned int numComponents, unsigned int numValues, T* minValues, T* maxValues)
+{
+    T blockMin[NUM_BLOCK_VALUES];
+    T blockMax[NUM_BLOCK_VALUES];
+    for(unsigned int k=0; k<NUM_BLOCK_VALUES; ++k)
+    {
+        blockMin[k] = blockMax[k] = data[k%numComponents];
+    }
+
+    unsigned int i=0;
+    for(; i+NUM_BLOCK_VALUES<=numValues; i+=NUM_BLOCK_VALUES)
+    {
+        const T* block = data+i;
+        for(unsigned int k=0; k<NUM_BLOCK_VALUES; ++k)
+        {
+            blockMin[k] = block[k]<blockMin[k] ? block[k] : blockMin[k];
+            blockMax[k] = block[k]>blockMax[k] ? block[k] : blockMax[k];
+        }
+    }
+    for(unsigned int k=0; i<numValues; ++i, ++k)
+    {
+        blockMin[k] = data[i]<blockMin[k] ? data[i] : blockMin[k];
+        blockMax[k] = data[i]>blockMax[k] ? data[i] : blockMax[k];
+    }
+
+    for(unsigned int k=0; k<NUM_BLOCK_VALUES; ++k)
+    {
+        T& minValue = minValues[k%numComponents];
+        T& maxValue = maxValues[k%numComponents];
+        minValue = blockMin[k]<minValue ? blockMin[k] : minValue;
+        maxValue = blockMax[k]>maxValue ? blockMax[k] : maxValue;
+    }
+}
+
+// Finds the range of each component of each row, kept separately for each row so that the result doesn't depend on the order rows are processed in.
+template<typename T>
+class ComputeMinMaxRowsTask : public ProcessRowsTask
+{
+public:
+    ComputeMinMaxRowsTask(const osg::Image* image):
+        ProcessRowsTask(image->t()*image->r()),
+        _rows(image),
+        _numComponents(osg::Image::computeNumComponents(image->getPixelFormat())),
+        _numValues(image->s()*_numComponents),
+        _minValues(_numRows*_numComponents),
+        _maxValues(_numRows*_numComponents) {}
+
+    virtual void processRow(unsigned int row)
+    {
+        const T* data = reinterpret_cast<const T*>(_rows.data(row));
+        T* minValues = &_minValues[row*_numComponents];
+        T* maxValues = &_maxValues[row*_numComponents];
+        for(unsigned int c=0; c<_numComponents; ++c)
+        {
+            minValues[c] = maxValues[c] = data[c];
+        }
+        computeRowMinMax(data, _numComponents, _numValues, minValues, maxValues);
+    }
+
+    template<class O>
+    void readRange(GLenum pixelFormat, O& operation) const
+    {
+        // each channel of the image maps to at most one component of the operation, so passing the pixels made from the smallest
+        // and largest values of each channel is enough for the operation to find the range of all the pixels.
+        std::vector<T> minValues(_minValues.begin(), _minValues.begin()+_numComponents);
+        std::vector<T> maxValues(_maxValues.begin(), _maxValues.begin()+_numComponents);
+        for(unsigned int row=1; row<_numRows; ++row)
+        {
+            for(unsigned int c=0; c<_numComponents; ++c)
+            {
+                minValues[c] = osg::minimum(_minValues[row*_numComponents+c], minValues[c]);
+                maxValues[c] = osg::maximum(_maxValues[row*_numComponents+c], maxValues[c]);
+            }
+        }
+        osg::_readRow(1, pixelFormat, &minValues.front(), operation);
+        osg::_readRow(1, pixelFormat, &maxValues.front(), operation);
+    }
+
+protected:
+    ImageRows           _rows;
+    unsigned int        _numComponents;
+    unsigned int        _numValues;
+    std::vector<T>      _minValues;
+    std::vector<T>      _maxValues;
+};
+
+template<typename T, class O>
+void readImageRange(const osg::Image* image, O& operation, unsigned int numThreads)
+{
+    osg::ref_ptr< ComputeMinMaxRowsTask<T> > task = new ComputeMinMaxRowsTask<T>(image);
+    processRows(task.get(), numThreads);
+    task->readRange(image->getPixelFormat(), operation);
+}
+
+// Offset and scale a row of numValues values in blocks of B values, a multiple of the number of components of a pixel,
+// the blocks of four or twelve values mapping onto whole SSE/NEON registers of float.
+template<typename T, unsigned int B>
+void offsetAndScaleRow(T* data, unsigned int numValues, const float* offsets, const float* scales, float typeScale)
+{
+    // applied in the same order as modifyRow() and OffsetAndScaleOperator so that values within range match,
+    // with local copies of the coefficients so the compiler knows writing the pixels can't change them.
+    const float inv_typeScale = 1.0f/typeScale;
+    float blockOffsets[B];
+    float blockScales[B];
+    for(unsigned int k=0; k<B; ++k)
+    {
+        blockOffsets[k] = offsets[k];
+        blockScales[k] = scales[k];
+    }
+
+    unsigned int i=0;
+    for(; i+B<=numValues; i+=B)
+    {
+        T* block = data+i;
+        for(unsigned int k=0; k<B; ++k)
+        {
+            block[k] = T((blockOffsets[k] + (float(block[k])*typeScale)*blockScales[k])*inv_typeScale);
+        }
+    }
+    for(unsigned int k=0; i<numValues; ++i, ++k)
+    {
+        data[i] = T((blockOffsets[k] + (float(data[i])*typeScale)*blockScales[k])*inv_typeScale);
+    }
+}
+
+template<unsigned int N>
+void lookUpRow(unsigned char* data, unsigned int num, const unsigned char* tables)
+{
+    for(unsigned int i=0; i<num; ++i, data+=N)
+    {
+        for(unsigned int c=0; c<N; ++c)
+        {
+            data[c] = tables[c*256+data[c]];
+        }
+    }
+}
+
+// Index of the component of a Vec4 colour that each channel of a pixel is written from, returns the number of channels or 0 for unsupported formats.
+unsigned int getWriteComponents(GLenum pixelFormat, int components[4])
+{
+    switch(pixelFormat)
+    {
+        case(GL_LUMINANCE):         components[0] = 0; return 1;
+        case(GL_ALPHA):             components[0] = 3; return 1;
+        case(GL_LUMINANCE_ALPHA):   components[0] = 0; components[1] = 3; return 2;
+        case(GL_RGB):               components[0] = 0; components[1] = 1; components[2] = 2; return 3;
+        case(GL_BGR):               components[0] = 2; components[1] = 1; components[2] = 0; return 3;
+        case(GL_RGBA):              components[0] = 0; components[1] = 1; components[2] = 2; components[3] = 3; return 4;
+        case(GL_BGRA):              components[0] = 2; components[1] = 1; components[2] = 0; components[3] = 3; return 4;
+        default:                    return 0;
+    }
+}
+
+// Channel of a pixel that each component of a Vec4 colour is read from, -1 for components that are 1.0, returns false for unsupported formats.
+bool getReadChannels(GLenum pixelFormat, int channels[4])
+{
+    switch(pixelFormat)
+    {
+        case(GL_LUMINANCE):         channels[0] = 0; channels[1] = 0; channels[2] = 0; channels[3] = -1; return true;
+        case(GL_ALPHA):             channels[0] = -1; channels[1] = -1; channels[2] = -1; channels[3] = 0; return true;
+        case(GL_LUMINANCE_ALPHA):   channels[0] = 0; channels[1] = 0; channels[2] = 0; channels[3] = 1; return true;
+        case(GL_RGB):               channels[0] = 0; channels[1] = 1; channels[2] = 2; channels[3] = -1; return true;
+        case(GL_BGR):               channels[0] = 2; channels[1] = 1; channels[2] = 0; channels[3] = -1; return true;
+        case(GL_RGBA):              channels[0] = 0; channels[1] = 1; channels[2] = 2; channels[3] = 3; return true;
+        case(GL_BGRA):              channels[0] = 2; channels[1] = 1; channels[2] = 0; channels[3] = 3; return true;
+        default:                    return false;
+    }
+}
+
+template<class M>
+class ModifyRowsTask : public ProcessRowsTask
+{
+public:
+    ModifyRowsTask(osg::Image* image, const M& operation):
+        ProcessRowsTask(image->t()*image->r()),
+        _rows(image),
+        _operation(operation) {}
+
+    virtual void processRow(unsigned int row)
+    {
+        osg::modifyRow(_rows._image->s(), _rows._image->getPixelFormat(), _rows._image->getDataType(), _rows.data(row), _operation);
+    }
+
+protected:
+    ImageRows   _rows;
+    M           _operation;
+};
+
+// Row parallel version of osg::modifyImage().
+template<class M>
+void modifyImageRows(osg::Image* image, const M& operation, unsigned int numThreads)
+{
+    osg::ref_ptr< ModifyRowsTask<M> > task = new ModifyRowsTask<M>(image, operation);
+    processRows(task.get(), computeNumPixelThreads(image->s()*image->t()*image->r(), numThreads));
+}
+
+template<typename T>
+class OffsetAndScaleRowsTask : public ProcessRowsTask
+{
+public:
+    OffsetAndScaleRowsTask(osg::Image* image, const int* components, unsigned int numComponents, const osg::Vec4& offset, const osg::Vec4& scale, float typeScale):
+        ProcessRowsTask(image->t()*image->r()),
+        _rows(image),
+        _numComponents(numComponents),
+        _typeScale(typeScale)
+    {
+        for(unsigned int k=0; k<12; ++k)
+        {
+            _offsets[k] = offset[components[k%numComponents]];
+            _scales[k] = scale[components[k%numComponents]];
+        }
+    }
+
+    virtual void processRow(unsigned int row)
+    {
+        T* data = reinterpret_cast<T*>(_rows.data(row));
+        unsigned int numValues = _rows._image->s()*_numComponents;
+        if (_numComponents==3) offsetAndScaleRow<T, 12>(data, numValues, _offsets, _scales, _typeScale);
+        else offsetAndScaleRow<T, 4>(data, numValues, _offsets, _scales, _typeScale);
+    }
+
+protected:
+    ImageRows       _rows;
+    unsigned int    _numComponents;
+    float           _typeScale;
+    float           _offsets[12];
+    float           _scales[12];
+};
+
+// Unsigned bytes only have 256 values, so rather than computing each channel of each pixel the results are looked up in a table for each channel.
+class LookUpRowsTask : public ProcessRowsTask
+{
+public:
+    LookUpRowsTask(osg::Image* image, unsigned int numComponents):
+        ProcessRowsTask(image->t()*image->r()),
+        _rows(image),
+        _numComponents(numComponents) {}
+
+    unsigned char* getTable(unsigned int channel) { return &_tables[channel*256]; }
+
+    virtual void processRow(unsigned int row)
+    {
+        unsigned char* data = _rows.data(row);
+        unsigned int num = _rows._image->s();
+        switch(_numComponents)
+        {
+            case(1): lookUpRow<1>(data, num, _tables); break;
+            case(2): lookUpRow<2>(data, num, _tables); break;
+            case(3): lookUpRow<3>(data, num, _tables); break;
+            case(4): lookUpRow<4>(data, num, _tables); break;
+        }
+    }
+
+protected:
+    ImageRows       _rows;
+    unsigned int    _numComponents;
+    unsigned char   _tables[4*256];
+};
+
+// Copy a row of pixels between two pixel formats of the same data type, each destination channel taken from the source
+// channel at sourceChannels[c], with the extra channel at index SRC_N holding one.
+template<typename T, unsigned int SRC_N, unsigned int DST_N>
+void reformatRow(const T* src, T* dest, unsigned int num, const unsigned int* sourceChannels, T one)
+{
+    T pixel[SRC_N+1];
+    pixel[SRC_N] = one;
+    for(unsigned int i=0; i<num; ++i)
+    {
+        for(unsigned int c=0; c<SRC_N; ++c) pixel[c] = src[c];
+        for(unsigned int c=0; c<DST_N; ++c) dest[c] = pixel[sourceChannels[c]];
+        src += SRC_N;
+        dest += DST_N;
+    }
+}
+
+template<typename T, unsigned int SRC_N>
+void reformatRow(const T* src, T* dest, unsigned int destNumComponents, unsigned int num, const unsigned int* sourceChannels, T one)
+{
+    switch(destNumComponents)
+    {
+        case(1): reformatRow<T, SRC_N, 1>(src, dest, num, sourceChannels, one); break;
+        case(2): reformatRow<T, SRC_N, 2>(src, dest, num, sourceChannels, one); break;
+        case(3): reformatRow<T, SRC_N, 3>(src, dest, num, sourceChannels, one); break;
+        case(4): reformatRow<T, SRC_N, 4>(src, dest, num, sourceChannels, one); break;
+    }
+}
+
+template<typename T>
+void reformatRow(const T* src, unsigned int srcNumComponents, T* dest, unsigned int destNumComponents, unsigned int num, const unsigned int* sourceChannels, T one)
+{
+    switch(srcNumComponents)
+    {
+        case(1): reformatRow<T, 1>(src, dest, destNumComponents, num, sourceChannels, one); break;
+        case(2): reformatRow<T, 2>(src, dest, destNumComponents, num, sourceChannels, one); break;
+        case(3): reformatRow<T, 3>(src, dest, destNumComponents, num, sourceChannels, one); break;
+        case(4): reformatRow<T, 4>(src, dest, destNumComponents, num, sourceChannels, one); break;
+    }
+}
+
+}
+
+
 namespace osg
 {
 
@@ -91,11 +455,30 @@ struct OffsetAndScaleOperator
 };
 
 bool computeMinMax(const osg::Image* image, osg::Vec4& minValue, osg::Vec4& maxValue)
+{
+    return computeMinMax(image, minValue, maxValue, 0);
+}
+
+bool computeMinMax(const osg::Image* image, osg::Vec4& minValue, osg::Vec4& maxValue, unsigned int numThreads)
 {
     if (!image) return false;
 
     osg::FindRangeOperator rangeOp;
-    readImage(image, rangeOp);
+    if (image->s()>0 && image->t()>0 && image->r()>0)
+    {
+        numThreads = computeNumPixelThreads(image->s()*image->t()*image->r(), numThreads);
+        switch(image->getDataType())
+        {
+            case(GL_BYTE):              readImageRange<char>(image, rangeOp, numThreads); break;
+            case(GL_UNSIGNED_BYTE):     readImageRange<unsigned char>(image, rangeOp, numThreads); break;
+            case(GL_SHORT):             readImageRange<short>(image, rangeOp, numThreads); break;
+            case(GL_UNSIGNED_SHORT):    readImageRange<unsigned short>(image, rangeOp, numThreads); break;
+            case(GL_INT):               readImageRange<int>(image, rangeOp, numThreads); break;
+            case(GL_UNSIGNED_INT):      readImageRange<unsigned int>(image, rangeOp, numThreads); break;
+            case(GL_FLOAT):             readImageRange<float>(image, rangeOp, numThreads); break;
+            case(GL_DOUBLE):            readImageRange<double>(image, rangeOp, numThreads); break;
+        }
+    }
     minValue.r() = rangeOp._rmin;
     minValue.g() = rangeOp._gmin;
     minValue.b() = rangeOp._bmin;
@@ -113,10 +496,47 @@ bool computeMinMax(const osg::Image* image, osg::Vec4& minValue, osg::Vec4& maxV
 }
 
 bool offsetAndScaleImage(osg::Image* image, const osg::Vec4& offset, const osg::Vec4& scale)
+{
+    return offsetAndScaleImage(image, offset, scale, 0);
+}
+
+bool offsetAndScaleImage(osg::Image* image, const osg::Vec4& offset, const osg::Vec4& scale, unsigned int numThreads)
 {
     if (!image) return false;
 
-    modifyImage(image,OffsetAndScaleOperator(offset, scale));
+    int components[4];
+    unsigned int numComponents = getWriteComponents(image->getPixelFormat(), components);
+    numThreads = computeNumPixelThreads(image->s()*image->t()*image->r(), numThreads);
+
+    osg::ref_ptr<ProcessRowsTask> task;
+    if (numComponents>0)
+    {
+        switch(image->getDataType())
+        {
+            case(GL_UNSIGNED_BYTE):
+            {
+                LookUpRowsTask* lookUpTask = new LookUpRowsTask(image, numComponents);
+                const float typeScale = 1.0f/255.0f;
+                const float inv_typeScale = 1.0f/typeScale;
+                for(unsigned int c=0; c<numComponents; ++c)
+                {
+                    unsigned char* table = lookUpTask->getTable(c);
+                    for(unsigned int i=0; i<256; ++i)
+                    {
+                        float v = (offset[components[c]] + (float(i)*typeScale)*scale[components[c]])*inv_typeScale;
+                        table[i] = static_cast<unsigned char>(v<0.0f ? 0.0f : (v>255.0f ? 255.0f : v));
+                    }
+                }
+                task = lookUpTask;
+                break;
+            }
+            case(GL_UNSIGNED_SHORT):    task = new OffsetAndScaleRowsTask<unsigned short>(image, components, numComponents, offset, scale, 1.0f/65535.0f); break;
+            case(GL_FLOAT):             task = new OffsetAndScaleRowsTask<float>(image, components, numComponents, offset, scale, 1.0f); break;
+        }
+    }
+
+    if (task.valid()) processRows(task.get(), numThreads);
+    else modifyImageRows(image, OffsetAndScaleOperator(offset, scale), numThreads);
 
     return true;
 }
@@ -196,12 +616,104 @@ struct WriteRowOperator
     inline void luminance(float& l) const { l = _colours[_pos++].r(); }
     inline void alpha(float& a) const { a = _colours[_pos++].a(); }
     inline void luminance_alpha(float& l,float& a) const { l = _colours[_pos].r(); a = _colours[_pos++].a(); }
-    inline void rgb(float& r,float& g,float& b) const { r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos].b(); }
+    inline void rgb(float& r,float& g,float& b) const { r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos++].b(); }
     inline void rgba(float& r,float& g,float& b,float& a) const {  r = _colours[_pos].r(); g = _colours[_pos].g(); b = _colours[_pos].b(); a = _colours[_pos++].a(); }
 };
 
+// Copies the rows of a region of one image to another, one of the ways copyImage() converts between pixel formats and data types.
+struct CopyRowsTask : public ProcessRowsTask
+{
+    enum Mode
+    {
+        COPY_ROWS,
+        COPY_AND_SCALE_ROWS,
+        REFORMAT_ROWS,
+        READ_AND_WRITE_ROWS
+    };
+
+    CopyRowsTask(Mode mode, const osg::Image* srcImage, int src_s, int src_t, int src_r, int width, int height, int depth,
+                 osg::Image* destImage, int dest_s, int dest_t, int dest_r, float scale):
+        ProcessRowsTask(height*depth),
+        _mode(mode),
+        _srcRows(srcImage, src_s, src_t, src_r, height),
+        _destRows(destImage, dest_s, dest_t, dest_r, height),
+        _width(width),
+        _scale(scale),
+        _srcNumComponents(osg::Image::computeNumComponents(srcImage->getPixelFormat())),
+        _destNumComponents(osg::Image::computeNumComponents(destImage->getPixelFormat()))
+    {
+        if (_mode==REFORMAT_ROWS)
+        {
+            int components[4];
+            int channels[4];
+            getWriteComponents(destImage->getPixelFormat(), components);
+            getReadChannels(srcImage->getPixelFormat(), channels);
+            for(unsigned int c=0; c<_destNumComponents; ++c)
+            {
+                int channel = channels[components[c]];
+                _sourceChannels[c] = channel<0 ? _srcNumComponents : static_cast<unsigned int>(channel);
+            }
+        }
+    }
+
+    virtual void processRow(unsigned int row)
+    {
+        const osg::Image* srcImage = _srcRows._image;
+        osg::Image* destImage = _destRows._image;
+        const unsigned char* srcData = _srcRows.data(row);
+        unsigned char* destData = _destRows.data(row);
+
+        switch(_mode)
+        {
+            case(COPY_ROWS):
+                memcpy(destData, srcData, (_width*destImage->getPixelSizeInBits())/8);
+                break;
+            case(COPY_AND_SCALE_ROWS):
+                _copyRowAndScale(srcData, srcImage->getDataType(), destData, destImage->getDataType(), (_width*_destNumComponents), _scale);
+                break;
+            case(REFORMAT_ROWS):
+                switch(srcImage->getDataType())
+                {
+                    case(GL_UNSIGNED_BYTE):     reformatRow((const unsigned char*)srcData, _srcNumComponents, (unsigned char*)destData, _destNumComponents, _width, _sourceChannels, (unsigned char)255); break;
+                    case(GL_UNSIGNED_SHORT):    reformatRow((const unsigned short*)srcData, _srcNumComponents, (unsigned short*)destData, _destNumComponents, _width, _sourceChannels, (unsigned short)65535); break;
+                    case(GL_FLOAT):             reformatRow((const float*)srcData, _srcNumComponents, (float*)destData, _destNumComponents, _width, _sourceChannels, 1.0f); break;
+                }
+                break;
+            case(READ_AND_WRITE_ROWS):
+            {
+                RecordRowOperator readOp(_width);
+                WriteRowOperator writeOp;
+
+                // read the pixels into readOp's _colour array
+                readRow(_width, srcImage->getPixelFormat(), srcImage->getDataType(), srcData, readOp);
+
+                // pass readOp's _colour array contents over to writeOp (note this is just a pointer swap).
+                writeOp._colours.swap(readOp._colours);
+
+                modifyRow(_width, destImage->getPixelFormat(), destImage->getDataType(), destData, writeOp);
+                break;
+            }
+        }
+    }
+
+    Mode            _mode;
+    ImageRows       _srcRows;
+    ImageRows       _destRows;
+    unsigned int    _width;
+    float           _scale;
+    unsigned int    _srcNumComponents;
+    unsigned int    _destNumComponents;
+    unsigned int    _sourceChannels[4];
+};
+
 bool copyImage(const osg::Image* srcImage, int src_s, int src_t, int src_r, int width, int height, int depth,
                osg::Image* destImage, int dest_s, int dest_t, int dest_r, bool doRescale)
+{
+    return copyImage(srcImage, src_s, src_t, src_r, width, height, depth, destImage, dest_s, dest_t, dest_r, doRescale, 0);
+}
+
+bool copyImage(const osg::Image* srcImage, int src_s, int src_t, int src_r, int width, int height, int depth,
+               osg::Image* destImage, int dest_s, int dest_t, int dest_r, bool doRescale, unsigned int numThreads)
 {
     if ((dest_s+width) > (destImage->s()))
     {
@@ -252,76 +764,31 @@ bool copyImage(const osg::Image* srcImage, int src_s, int src_t, int src_r, int
         }
     }
 
+    CopyRowsTask::Mode mode = CopyRowsTask::READ_AND_WRITE_ROWS;
     if (srcImage->getPixelFormat() == destImage->getPixelFormat())
     {
-        //OSG_NOTICE<<"copyImage("<<srcImage<<", "<<src_s<<", "<< src_t<<", "<<src_r<<", "<<width<<", "<<height<<", "<<depth<<std::endl;
-        //OSG_NOTICE<<"          "<<destImage<<", "<<dest_s<<", "<< dest_t<<", "<<dest_r<<", "<<doRescale<<")"<<std::endl;
-
-        if (srcImage->getDataType() == destImage->getDataType() && !doRescale)
-        {
-            //OSG_NOTICE<<"   Compatible pixelFormat and dataType."<<std::endl;
-            for(int slice = 0; slice<depth; ++slice)
-            {
-                for(int row = 0; row<height; ++row)
-                {
-                    const unsigned char* srcData = srcImage->data(src_s, src_t+row, src_r+slice);
-                    unsigned char* destData = destImage->data(dest_s, dest_t+row, dest_r+slice);
-                    memcpy(destData, srcData, (width*destImage->getPixelSizeInBits())/8);
-                }
-            }
-            return true;
-        }
-        else
-        {
-            //OSG_NOTICE<<"   Compatible pixelFormat and incompatible dataType."<<std::endl;
-            for(int slice = 0; slice<depth; ++slice)
-            {
-                for(int row = 0; row<height; ++row)
-                {
-                    const unsigned char* srcData = srcImage->data(src_s, src_t+row, src_r+slice);
-                    unsigned char* destData = destImage->data(dest_s, dest_t+row, dest_r+slice);
-                    unsigned int numComponents = osg::Image::computeNumComponents(destImage->getPixelFormat());
-
-                    _copyRowAndScale(srcData, srcImage->getDataType(), destData, destImage->getDataType(), (width*numComponents), scale);
-                }
-            }
-
-            return true;
-        }
+        if (srcImage->getDataType() == destImage->getDataType() && !doRescale) mode = CopyRowsTask::COPY_ROWS;
+        else mode = CopyRowsTask::COPY_AND_SCALE_ROWS;
     }
-    else
+    else if (srcImage->getDataType() == destImage->getDataType())
     {
-        //OSG_NOTICE<<"copyImage("<<srcImage<<", "<<src_s<<", "<< src_t<<", "<<src_r<<", "<<width<<", "<<height<<", "<<depth<<std::endl;
-        //OSG_NOTICE<<"          "<<destImage<<", "<<dest_s<<", "<< dest_t<<", "<<dest_r<<", "<<doRescale<<")"<<std::endl;
-
-        RecordRowOperator readOp(width);
-        WriteRowOperator writeOp;
-
-        for(int slice = 0; slice<depth; ++slice)
+        // pixels of the same data type can have their channels rearranged directly rather than via a Vec4 per pixel.
+        int components[4];
+        int channels[4];
+        GLenum dataType = srcImage->getDataType();
+        if ((dataType==GL_UNSIGNED_BYTE || dataType==GL_UNSIGNED_SHORT || dataType==GL_FLOAT) &&
+            getWriteComponents(destImage->getPixelFormat(), components)>0 &&
+            getReadChannels(srcImage->getPixelFormat(), channels))
         {
-            for(int row = 0; row<height; ++row)
-            {
-
-                // reset the indices to beginning
-                readOp._pos = 0;
-                writeOp._pos = 0;
-
-                // read the pixels into readOp's _colour array
-                readRow(width, srcImage->getPixelFormat(), srcImage->getDataType(), srcImage->data(src_s,src_t+row,src_r+slice), readOp);
-
-                // pass readOp's _colour array contents over to writeOp (note this is just a pointer swap).
-                writeOp._colours.swap(readOp._colours);
-
-                modifyRow(width, destImage->getPixelFormat(), destImage->getDataType(), destImage->data(dest_s, dest_t+row,dest_r+slice), writeOp);
-
-                // return readOp's _colour array contents back to its rightful owner.
-                writeOp._colours.swap(readOp._colours);
-            }
+            mode = CopyRowsTask::REFORMAT_ROWS;
         }
-
-        return true;
     }
 
+    osg::ref_ptr<CopyRowsTask> task = new CopyRowsTask(mode, srcImage, src_s, src_t, src_r, width, height, depth,
+                                                       destImage, dest_s, dest_t, dest_r, scale);
+    processRows(task.get(), computeNumPixelThreads(width*height*depth, numThreads));
+
+    return true;
 }
 
 
@@ -645,6 +1112,11 @@ struct ReplaceAlphaWithLuminanceOperator
 };
 
 osg::Image* colorSpaceConversion(ColorSpaceOperation op, osg::Image* image, const osg::Vec4& colour)
+{
+    return colorSpaceConversion(op, image, colour, 0);
+}
+
+osg::Image* colorSpaceConversion(ColorSpaceOperation op, osg::Image* image, const osg::Vec4& colour, unsigned int numThreads)
 {
     GLenum requiredPixelFormat = image->getPixelFormat();
     switch(op)
@@ -666,7 +1138,7 @@ osg::Image* colorSpaceConversion(ColorSpaceOperation op, osg::Image* image, cons
         osg::Image* newImage = new osg::Image;
         newImage->allocateImage(image->s(), image->t(), image->r(), requiredPixelFormat, image->getDataType());
         osg::copyImage(image, 0, 0, 0, image->s(), image->t(), image->r(),
-                    newImage, 0, 0, 0, false);
+                    newImage, 0, 0, 0, false, numThreads);
 
         image = newImage;
     }
@@ -676,19 +1148,19 @@ osg::Image* colorSpaceConversion(ColorSpaceOperation op, osg::Image* image, cons
         case (MODULATE_ALPHA_BY_LUMINANCE):
         {
             OSG_NOTICE<<"doing conversion MODULATE_ALPHA_BY_LUMINANCE"<<std::endl;
-            osg::modifyImage(image, ModulateAlphaByLuminanceOperator());
+            modifyImageRows(image, ModulateAlphaByLuminanceOperator(), numThreads);
             return image;
         }
         case (MODULATE_ALPHA_BY_COLOR):
         {
             OSG_NOTICE<<"doing conversion MODULATE_ALPHA_BY_COLOUR"<<std::endl;
-            osg::modifyImage(image, ModulateAlphaByColorOperator(colour));
+            modifyImageRows(image, ModulateAlphaByColorOperator(colour), numThreads);
             return image;
         }
         case (REPLACE_ALPHA_WITH_LUMINANCE):
         {
             OSG_NOTICE<<"doing conversion REPLACE_ALPHA_WITH_LUMINANCE"<<std::endl;
-            osg::modifyImage(image, ReplaceAlphaWithLuminanceOperator());
+            modifyImageRows(image, ReplaceAlphaWithLuminanceOperator(), numThreads);
             return image;
         }
         case (REPLACE_RGB_WITH_LUMINANCE):
@@ -797,5 +1269,650 @@ OSG_EXPORT osg::Image* createImageWithOrientationConversion(const osg::Image* sr
     return dstImage.release();
 }
 
+
+namespace
+{
+
+// Expand a pixel of an unsigned byte image to RGBA.
+inline void readTexel(const unsigned char* pixel, GLenum pixelFormat, unsigned char* texel)
+{
+    switch(pixelFormat)
+    {
+        case(GL_RGBA): texel[0] = pixel[0]; texel[1] = pixel[1]; texel[2] = pixel[2]; texel[3] = pixel[3]; break;
+        case(GL_BGRA): texel[0] = pixel[2]; texel[1] = pixel[1]; texel[2] = pixel[0]; texel[3] = pixel[3]; break;
+        case(GL_RGB): texel[0] = pixel[0]; texel[1] = pixel[1]; texel[2] = pixel[2]; texel[3] = 255; break;
+        case(GL_BGR): texel[0] = pixel[2]; texel[1] = pixel[1]; texel[2] = pixel[0]; texel[3] = 255; break;
+        case(GL_LUMINANCE): texel[0] = texel[1] = texel[2] = pixel[0]; texel[3] = 255; break;
+        case(GL_LUMINANCE_ALPHA): texel[0] = texel[1] = texel[2] = pixel[0]; texel[3] = pixel[1]; break;
+        case(GL_ALPHA): texel[0] = texel[1] = texel[2] = 255; texel[3] = pixel[0]; break;
+        case(GL_RED): texel[0] = pixel[0]; texel[1] = 0; texel[2] = 0; texel[3] = 255; break;
+        case(GL_RG): texel[0] = pixel[0]; texel[1] = pixel[1]; texel[2] = 0; texel[3] = 255; break;
+        default: texel[0] = texel[1] = texel[2] = texel[3] = 0; break;
+    }
+}
+
+bool isCompressibleSourceFormat(GLenum pixelFormat)
+{
+    switch(pixelFormat)
+    {
+        case(GL_RGBA):
+        case(GL_BGRA):
+        case(GL_RGB):
+        case(GL_BGR):
+        case(GL_LUMINANCE):
+        case(GL_LUMINANCE_ALPHA):
+        case(GL_ALPHA):
+        case(GL_RED):
+        case(GL_RG):
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isSupportedCompressedFormat(GLenum pixelFormat)
+{
+    switch(pixelFormat)
+    {
+        case(GL_COMPRESSED_RGB_S3TC_DXT1_EXT):
+        case(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT):
+        case(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT):
+        case(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT):
+        case(GL_COMPRESSED_RED_RGTC1_EXT):
+        case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT):
+            return true;
+        default:
+            return false;
+    }
+}
+
+struct CompressionLevel
+{
+    const unsigned char*    source;
+    unsigned int            rowStep;
+    int                     width;
+    int                     height;
+    unsigned char*          destination;
+};
+
+typedef std::vector<CompressionLevel> CompressionLevels;
+typedef std::vector< std::pair<unsigned int, int> > BlockRows;
+
+// Task that compresses the image a row of blocks at a time.
+class CompressBlockRowsTask : public ProcessRowsTask
+{
+public:
+    CompressBlockRowsTask(GLenum pixelFormat, GLenum compressedPixelFormat, bool highQuality, const CompressionLevels& levels, const BlockRows& blockRows):
+        ProcessRowsTask(static_cast<unsigned int>(blockRows.size())),
+        _pixelFormat(pixelFormat),
+        _compressedPixelFormat(compressedPixelFormat),
+        _highQuality(highQuality),
+        _pixelSize(osg::Image::computeNumComponents(pixelFormat)),
+        _blockSize(osg::Image::computeBlockSize(compressedPixelFormat, 0)),
+        _levels(levels),
+        _blockRows(blockRows) {}
+
+    virtual void processRow(unsigned int row)
+    {
+        compressBlockRow(_levels[_blockRows[row].first], _blockRows[row].second);
+    }
+
+    void compressBlockRow(const CompressionLevel& level, int blockRow)
+    {
+        int numBlocksWide = (level.width+3)/4;
+        unsigned char* block = level.destination + blockRow*numBlocksWide*_blockSize;
+
+        unsigned char texels[64];
+        for(int blockColumn=0; blockColumn<numBlocksWide; ++blockColumn, block += _blockSize)
+        {
+            // edge blocks repeat the last row and column of the image.
+            for(int y=0; y<4; ++y)
+            {
+                const unsigned char* row = level.source + osg::minimum(blockRow*4+y, level.height-1)*level.rowStep;
+                for(int x=0; x<4; ++x)
+                {
+                    readTexel(row + osg::minimum(blockColumn*4+x, level.width-1)*_pixelSize, _pixelFormat, texels+(y*4+x)*4);
+                }
+            }
+
+            switch(_compressedPixelFormat)
+            {
+                case(GL_COMPRESSED_RGB_S3TC_DXT1_EXT): dxtc_tool::compressBlockDXT1(texels, false, _highQuality, block); break;
+                case(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT): dxtc_tool::compressBlockDXT1(texels, true, _highQuality, block); break;
+                case(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT): dxtc_tool::compressBlockDXT3(texels, _highQuality, block); break;
+                case(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT): dxtc_tool::compressBlockDXT5(texels, _highQuality, block); break;
+                case(GL_COMPRESSED_RED_RGTC1_EXT): dxtc_tool::compressBlockRGTC1(texels, _highQuality, block); break;
+                case(GL_COMPRESSED_RED_GREEN_RGTC2_EXT): dxtc_tool::compressBlockRGTC2(texels, _highQuality, block); break;
+                default: break;
+            }
+        }
+    }
+
+protected:
+    GLenum                      _pixelFormat;
+    GLenum                      _compressedPixelFormat;
+    bool                        _highQuality;
+    unsigned int                _pixelSize;
+    unsigned int                _blockSize;
+    const CompressionLevels&    _levels;
+    const BlockRows&            _blockRows;
+};
+
+}
+
+bool compressImage(osg::Image* image, GLenum compressedPixelFormat, bool highQuality, unsigned int numThreads)
+{
+    if (!image || !image->data()) return false;
+
+    if (!isSupportedCompressedFormat(compressedPixelFormat))
+    {
+        OSG_NOTICE<<"Warning: compressImage() does not support compressed pixel format 0x"<<std::hex<<compressedPixelFormat<<std::dec<<std::endl;
+        return false;
+    }
+
+    if (image->isCompressed() || image->getDataType()!=GL_UNSIGNED_BYTE || !isCompressibleSourceFormat(image->getPixelFormat()) || image->r()!=1)
+    {
+        OSG_NOTICE<<"Warning: compressImage() only supports uncompressed 2D GL_UNSIGNED_BYTE images, cannot compress "<<image->getFileName()<<std::endl;
+        return false;
+    }
+
+    unsigned int blockSize = osg::Image::computeBlockSize(compressedPixelFormat, 0);
+
+    CompressionLevels levels;
+    BlockRows blockRows;
+    osg::Image::MipmapDataType mipmapOffsets;
+    unsigned int totalSize = 0;
+    for(unsigned int i=0; i<image->getNumMipmapLevels(); ++i)
+    {
+        CompressionLevel level;
+        level.width = osg::maximum(image->s()>>i, 1);
+        level.height = osg::maximum(image->t()>>i, 1);
+        level.source = image->getMipmapData(i);
+        level.rowStep = (i==0) ? image->getRowStepInBytes() : osg::Image::computeRowWidthInBytes(level.width, image->getPixelFormat(), image->getDataType(), image->getPacking());
+        level.destination = 0;
+
+        if (i>0) mipmapOffsets.push_back(totalSize);
+
+        int numBlockRows = (level.height+3)/4;
+        for(int row=0; row<numBlockRows; ++row)
+        {
+            blockRows.push_back(BlockRows::value_type(static_cast<unsigned int>(levels.size()), row));
+        }
+
+        totalSize += ((level.width+3)/4)*numBlockRows*blockSize;
+        levels.push_back(level);
+    }
+
+    unsigned char* data = new unsigned char[totalSize];
+    unsigned int offset = 0;
+    for(CompressionLevels::iterator itr = levels.begin();
+        itr != levels.end();
+        ++itr)
+    {
+        itr->destination = data+offset;
+        offset += ((itr->width+3)/4)*((itr->height+3)/4)*blockSize;
+    }
+
+    osg::ref_ptr<CompressBlockRowsTask> task = new CompressBlockRowsTask(image->getPixelFormat(), compressedPixelFormat, highQuality, levels, blockRows);
+    processRows(task.get(), numThreads);
+
+    image->setImage(image->s(), image->t(), 1,
+                    compressedPixelFormat, compressedPixelFormat, GL_UNSIGNED_BYTE,
+                    data, osg::Image::USE_NEW_DELETE, 1);
+    image->setMipmapLevels(mipmapOffsets);
+
+    return true;
+}
+
+
+namespace
+{
+
+bool isResampleSupported(GLenum pixelFormat, GLenum dataType)
+{
+    if (dataType!=GL_UNSIGNED_BYTE && dataType!=GL_UNSIGNED_SHORT && dataType!=GL_FLOAT) return false;
+    if (osg::Image::computeBlockSize(pixelFormat, 0)!=0) return false;
+    unsigned int numComponents = osg::Image::computeNumComponents(pixelFormat);
+    return numComponents>=1 && numComponents<=4;
+}
+
+// Index of the alpha channel of a pixel format, or -1 if it doesn't have one.
+int computeAlphaChannel(GLenum pixelFormat)
+{
+    switch(pixelFormat)
+    {
+        case(GL_RGBA):
+        case(GL_BGRA): return 3;
+        case(GL_LUMINANCE_ALPHA): return 1;
+        case(GL_ALPHA): return 0;
+        default: return -1;
+    }
+}
+
+float filterSupport(ResampleFilter filter)
+{
+    switch(filter)
+    {
+        case(BOX_FILTER): return 0.5f;
+        case(TRIANGLE_FILTER): return 1.0f;
+        case(LANCZOS_FILTER): return 3.0f;
+        case(KAISER_FILTER): return 3.0f;
+    }
+    return 0.5f;
+}
+
+inline double sinc(double x)
+{
+    if (x==0.0) return 1.0;
+    x *= osg::PI;
+    return sin(x)/x;
+}
+
+// Zeroth order modified Bessel function of the first kind, as used by the Kaiser window.
+double bessel0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for(int k=1; k<32; ++k)
+    {
+        double t = x/(2.0*k);
+        term *= t*t;
+        sum += term;
+        if (term<sum*1e-12) break;
+    }
+    return sum;
+}
+
+float filterWeight(ResampleFilter filter, double x)
+{
+    x = fabs(x);
+    switch(filter)
+    {
+        case(BOX_FILTER): return x<=0.5 ? 1.0f : 0.0f;
+        case(TRIANGLE_FILTER): return x<1.0 ? static_cast<float>(1.0-x) : 0.0f;
+        case(LANCZOS_FILTER): return x<3.0 ? static_cast<float>(sinc(x)*sinc(x/3.0)) : 0.0f;
+        case(KAISER_FILTER):
+        {
+            const double alpha = 4.0;
+            if (x>=3.0) return 0.0f;
+            double t = x/3.0;
+            return static_cast<float>(sinc(x)*bessel0(alpha*sqrt(1.0-t*t))/bessel0(alpha));
+        }
+    }
+    return 0.0f;
+}
+
+// Weights of the source pixels contributing to each destination pixel along one axis, clamped to the edge of the image.
+struct Contributions
+{
+    Contributions(ResampleFilter filter, int sourceSize, int destinationSize)
+    {
+        double scale = static_cast<double>(destinationSize)/static_cast<double>(sourceSize);
+        double filterScale = osg::minimum(scale, 1.0);
+        double support = filterSupport(filter)/filterScale;
+
+        starts.resize(destinationSize+1);
+        for(int i=0; i<destinationSize; ++i)
+        {
+            starts[i] = static_cast<unsigned int>(indices.size());
+
+            double center = (i+0.5)/scale;
+            int left = static_cast<int>(floor(center-support));
+            int right = static_cast<int>(ceil(center+support));
+
+            float total = 0.0f;
+            unsigned int first = static_cast<unsigned int>(weights.size());
+            for(int j=left; j<=right; ++j)
+            {
+                // half open interval so that box filters don't count a pixel on the boundary twice
+                double x = (j+0.5-center)*filterScale;
+                if (filter==BOX_FILTER && x<=-0.5) continue;
+
+                float weight = filterWeight(filter, x);
+                if (weight==0.0f) continue;
+
+                indices.push_back(osg::clampBetween(j, 0, sourceSize-1));
+                weights.push_back(weight);
+                total += weight;
+            }
+
+            if (total==0.0f)
+            {
+                indices.push_back(osg::clampBetween(static_cast<int>(center), 0, sourceSize-1));
+                weights.push_back(1.0f);
+            }
+            else
+            {
+                for(unsigned int w=first; w<weights.size(); ++w) weights[w] /= total;
+            }
+        }
+        starts[destinationSize] = static_cast<unsigned int>(indices.size());
+    }
+
+    std::vector<unsigned int>   starts;
+    std::vector<int>            indices;
+    std::vector<float>          weights;
+};
+
+struct ResampleLevel
+{
+    const unsigned char*    source;
+    int                     sourceWidth;
+    int                     sourceHeight;
+    unsigned int            sourceRowStep;
+    unsigned char*          destination;
+    int                     destinationWidth;
+    int                     destinationHeight;
+    unsigned int            destinationRowStep;
+};
+
+// Converts rows between the image's data type and linear floating point values.
+class PixelConverter
+{
+public:
+    PixelConverter(GLenum pixelFormat, GLenum dataType, bool sRGB):
+        _dataType(dataType),
+        _numComponents(osg::Image::computeNumComponents(pixelFormat))
+    {
+        int alphaChannel = computeAlphaChannel(pixelFormat);
+        for(unsigned int c=0; c<4; ++c) _convertColorSpace[c] = sRGB && static_cast<int>(c)!=alphaChannel;
+        _sRGB = sRGB;
+
+        if (_sRGB && _dataType==GL_UNSIGNED_BYTE)
+        {
+            for(unsigned int i=0; i<256; ++i) _byteToLinear[i] = toLinear(static_cast<float>(i)/255.0f);
+        }
+    }
+
+    static float toLinear(float value)
+    {
+        return value<=0.04045f ? value/12.92f : static_cast<float>(pow((value+0.055)/1.055, 2.4));
+    }
+
+    static float fromLinear(float value)
+    {
+        if (value<=0.0f) return 0.0f;
+        return value<=0.0031308f ? value*12.92f : static_cast<float>(1.055*pow(static_cast<double>(value), 1.0/2.4)-0.055);
+    }
+
+    void read(const unsigned char* source, int width, float* row) const
+    {
+        unsigned int numValues = width*_numComponents;
+        switch(_dataType)
+        {
+            case(GL_UNSIGNED_BYTE):
+            {
+                if (_sRGB)
+                {
+                    for(unsigned int i=0; i<numValues; ++i) row[i] = _convertColorSpace[i%_numComponents] ? _byteToLinear[source[i]] : source[i]*(1.0f/255.0f);
+                    return;
+                }
+                for(unsigned int i=0; i<numValues; ++i) row[i] = source[i]*(1.0f/255.0f);
+                break;
+            }
+            case(GL_UNSIGNED_SHORT):
+            {
+                const unsigned short* values = reinterpret_cast<const unsigned short*>(source);
+                for(unsigned int i=0; i<numValues; ++i) row[i] = values[i]*(1.0f/65535.0f);
+                break;
+            }
+            case(GL_FLOAT):
+            {
+                memcpy(row, source, numValues*sizeof(float));
+                break;
+            }
+        }
+
+        if (_sRGB)
+        {
+            for(unsigned int i=0; i<numValues; ++i)
+            {
+                if (_convertColorSpace[i%_numComponents]) row[i] = toLinear(row[i]);
+            }
+        }
+    }
+
+    void write(float* row, int width, unsigned char* destination) const
+    {
+        unsigned int numValues = width*_numComponents;
+        if (_sRGB)
+        {
+            for(unsigned int i=0; i<numValues; ++i)
+            {
+                if (_convertColorSpace[i%_numComponents]) row[i] = fromLinear(row[i]);
+            }
+        }
+
+        switch(_dataType)
+        {
+            case(GL_UNSIGNED_BYTE):
+            {
+                for(unsigned int i=0; i<numValues; ++i) destination[i] = static_cast<unsigned char>(osg::clampBetween(row[i], 0.0f, 1.0f)*255.0f+0.5f);
+                break;
+            }
+            case(GL_UNSIGNED_SHORT):
+            {
+                unsigned short* values = reinterpret_cast<unsigned short*>(destination);
+                for(unsigned int i=0; i<numValues; ++i) values[i] = static_cast<unsigned short>(osg::clampBetween(row[i], 0.0f, 1.0f)*65535.0f+0.5f);
+                break;
+            }
+            case(GL_FLOAT):
+            {
+                memcpy(destination, row, numValues*sizeof(float));
+                break;
+            }
+        }
+    }
+
+    unsigned int getNumComponents() const { return _numComponents; }
+
+protected:
+    GLenum          _dataType;
+    unsigned int    _numComponents;
+    bool            _sRGB;
+    bool            _convertColorSpace[4];
+    float           _byteToLinear[256];
+};
+
+// Task that filters each source row horizontally into the intermediate buffer.
+class ResampleRowsTask : public ProcessRowsTask
+{
+public:
+    ResampleRowsTask(const PixelConverter& converter, const ResampleLevel& level, const Contributions& contributions, std::vector<float>& intermediate):
+        ProcessRowsTask(static_cast<unsigned int>(level.sourceHeight)),
+        _converter(converter),
+        _level(level),
+        _contributions(contributions),
+        _intermediate(intermediate) {}
+
+    virtual void processRow(unsigned int row)
+    {
+        unsigned int numComponents = _converter.getNumComponents();
+        std::vector<float> sourceRow(_level.sourceWidth*numComponents);
+        _converter.read(_level.source + row*_level.sourceRowStep, _level.sourceWidth, &sourceRow[0]);
+
+        float* destination = &_intermediate[row*_level.destinationWidth*numComponents];
+        switch(numComponents)
+        {
+            case(1): filterRow<1>(&sourceRow[0], destination); break;
+            case(2): filterRow<2>(&sourceRow[0], destination); break;
+            case(3): filterRow<3>(&sourceRow[0], destination); break;
+            case(4): filterRow<4>(&sourceRow[0], destination); break;
+        }
+    }
+
+    // number of components fixed at compile time so the per pixel loops are fully unrolled
+    template<unsigned int NumComponents>
+    void filterRow(const float* sourceRow, float* destination) const
+    {
+        for(int x=0; x<_level.destinationWidth; ++x, destination += NumComponents)
+        {
+            float sum[NumComponents];
+            for(unsigned int c=0; c<NumComponents; ++c) sum[c] = 0.0f;
+
+            for(unsigned int w=_contributions.starts[x]; w<_contributions.starts[x+1]; ++w)
+            {
+                const float* pixel = sourceRow + _contributions.indices[w]*NumComponents;
+                float weight = _contributions.weights[w];
+                for(unsigned int c=0; c<NumComponents; ++c) sum[c] += pixel[c]*weight;
+            }
+
+            for(unsigned int c=0; c<NumComponents; ++c) destination[c] = sum[c];
+        }
+    }
+
+protected:
+    ResampleRowsTask& operator = (const ResampleRowsTask&) { return *this; }
+
+    const PixelConverter&   _converter;
+    const ResampleLevel&    _level;
+    const Contributions&    _contributions;
+    std::vector<float>&     _intermediate;
+};
+
+// Task that filters the intermediate buffer vertically into each destination row.
+class ResampleColumnsTask : public ProcessRowsTask
+{
+public:
+    ResampleColumnsTask(const PixelConverter& converter, const ResampleLevel& level, const Contributions& contributions, const std::vector<float>& intermediate):
+        ProcessRowsTask(static_cast<unsigned int>(level.destinationHeight)),
+        _converter(converter),
+        _level(level),
+        _contributions(contributions),
+        _intermediate(intermediate) {}
+
+    virtual void processRow(unsigned int row)
+    {
+        unsigned int rowSize = _level.destinationWidth*_converter.getNumComponents();
+        std::vector<float> destinationRow(rowSize, 0.0f);
+        for(unsigned int w=_contributions.starts[row]; w<_contributions.starts[row+1]; ++w)
+        {
+            // whole rows at a time so the inner loop is a straight multiply-add over contiguous floats
+            const float* sourceRow = &_intermediate[_contributions.indices[w]*rowSize];
+            float weight = _contributions.weights[w];
+            float* destination = &destinationRow[0];
+            for(unsigned int i=0; i<rowSize; ++i) destination[i] += sourceRow[i]*weight;
+        }
+
+        _converter.write(&destinationRow[0], _level.destinationWidth, _level.destination + row*_level.destinationRowStep);
+    }
+
+protected:
+    ResampleColumnsTask& operator = (const ResampleColumnsTask&) { return *this; }
+
+    const PixelConverter&       _converter;
+    const ResampleLevel&        _level;
+    const Contributions&        _contributions;
+    const std::vector<float>&   _intermediate;
+};
+
+void resampleLevel(const ResampleLevel& level, GLenum pixelFormat, GLenum dataType, ResampleFilter filter, bool sRGB, unsigned int numThreads)
+{
+    PixelConverter converter(pixelFormat, dataType, sRGB);
+    Contributions horizontal(filter, level.sourceWidth, level.destinationWidth);
+    Contributions vertical(filter, level.sourceHeight, level.destinationHeight);
+
+    std::vector<float> intermediate(level.sourceHeight*level.destinationWidth*converter.getNumComponents());
+
+    osg::ref_ptr<ResampleRowsTask> rowsTask = new ResampleRowsTask(converter, level, horizontal, intermediate);
+    processRows(rowsTask.get(), numThreads);
+
+    osg::ref_ptr<ResampleColumnsTask> columnsTask = new ResampleColumnsTask(converter, level, vertical, intermediate);
+    processRows(columnsTask.get(), numThreads);
+}
+
 }
 
+bool resampleImageData(const osg::Image* srcImage, int width, int height, unsigned char* data, int packing, ResampleFilter filter, bool sRGB, unsigned int numThreads)
+{
+    if (!srcImage || !srcImage->data() || !data || width<=0 || height<=0 || srcImage->r()!=1) return false;
+    if (!isResampleSupported(srcImage->getPixelFormat(), srcImage->getDataType())) return false;
+
+    ResampleLevel level;
+    level.source = srcImage->data();
+    level.sourceWidth = srcImage->s();
+    level.sourceHeight = srcImage->t();
+    level.sourceRowStep = srcImage->getRowStepInBytes();
+    level.destination = data;
+    level.destinationWidth = width;
+    level.destinationHeight = height;
+    level.destinationRowStep = osg::Image::computeRowWidthInBytes(width, srcImage->getPixelFormat(), srcImage->getDataType(), packing);
+
+    resampleLevel(level, srcImage->getPixelFormat(), srcImage->getDataType(), filter, sRGB, numThreads);
+    return true;
+}
+
+osg::Image* createResampledImage(const osg::Image* srcImage, int width, int height, ResampleFilter filter, bool sRGB, unsigned int numThreads)
+{
+    if (!srcImage) return 0;
+
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(width, height, 1, srcImage->getPixelFormat(), srcImage->getDataType(), srcImage->getPacking());
+    image->setInternalTextureFormat(srcImage->getInternalTextureFormat());
+
+    if (!resampleImageData(srcImage, width, height, image->data(), image->getPacking(), filter, sRGB, numThreads))
+    {
+        OSG_NOTICE<<"Warning: createResampledImage() does not support the pixel format or data type of "<<srcImage->getFileName()<<std::endl;
+        return 0;
+    }
+
+    return image.release();
+}
+
+bool generateMipmaps(osg::Image* image, ResampleFilter filter, bool sRGB, unsigned int numThreads)
+{
+    if (!image || !image->data() || image->r()!=1) return false;
+    if (!isResampleSupported(image->getPixelFormat(), image->getDataType()))
+    {
+        OSG_NOTICE<<"Warning: generateMipmaps() does not support the pixel format or data type of "<<image->getFileName()<<std::endl;
+        return false;
+    }
+
+    GLenum pixelFormat = image->getPixelFormat();
+    GLenum dataType = image->getDataType();
+    int packing = image->getPacking();
+    int numLevels = osg::Image::computeNumberOfMipmapLevels(image->s(), image->t(), 1);
+
+    osg::Image::MipmapDataType mipmapOffsets;
+    unsigned int totalSize = 0;
+    for(int i=0; i<numLevels; ++i)
+    {
+        if (i>0) mipmapOffsets.push_back(totalSize);
+        int width = osg::maximum(image->s()>>i, 1);
+        int height = osg::maximum(image->t()>>i, 1);
+        totalSize += osg::Image::computeRowWidthInBytes(width, pixelFormat, dataType, packing)*height;
+    }
+
+    unsigned char* data = new unsigned char[totalSize];
+
+    // copy the top level as is, then filter each level from the one above it.
+    unsigned int rowSize = image->getRowSizeInBytes();
+    unsigned int rowStep = osg::Image::computeRowWidthInBytes(image->s(), pixelFormat, dataType, packing);
+    for(int t=0; t<image->t(); ++t)
+    {
+        memcpy(data + t*rowStep, image->data(0, t), rowSize);
+    }
+
+    for(int i=1; i<numLevels; ++i)
+    {
+        ResampleLevel level;
+        level.sourceWidth = osg::maximum(image->s()>>(i-1), 1);
+        level.sourceHeight = osg::maximum(image->t()>>(i-1), 1);
+        level.source = data + (i>1 ? mipmapOffsets[i-2] : 0);
+        level.sourceRowStep = osg::Image::computeRowWidthInBytes(level.sourceWidth, pixelFormat, dataType, packing);
+        level.destinationWidth = osg::maximum(image->s()>>i, 1);
+        level.destinationHeight = osg::maximum(image->t()>>i, 1);
+        level.destination = data + mipmapOffsets[i-1];
+        level.destinationRowStep = osg::Image::computeRowWidthInBytes(level.destinationWidth, pixelFormat, dataType, packing);
+
+        resampleLevel(level, pixelFormat, dataType, filter, sRGB, numThreads);
+    }
+
+    image->setImage(image->s(), image->t(), 1,
+                    image->getInternalTextureFormat(), pixelFormat, dataType,
+                    data, osg::Image::USE_NEW_DELETE, packing);
+    image->setMipmapLevels(mipmapOffsets);
+
+    return true;
+}
+
+}
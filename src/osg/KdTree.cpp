@@ -16,9 +16,13 @@
 #include <osg/TriangleIndexFunctor>
 #include <osg/TemplatePrimitiveIndexFunctor>
 #include <osg/Timer>
+#include <osg/TaskScheduler>
 
 #include <osg/io_utils>
 
+#include <algorithm>
+#include <float.h>
+
 using namespace osg;
 
 //#define VERBOSE_OUTPUT
@@ -31,9 +35,11 @@ using namespace osg;
 struct BuildKdTree
 {
     BuildKdTree(KdTree& kdTree):
-        _kdTree(kdTree) {}
+        _kdTree(kdTree),
+        _collectBounds(false) {}
 
     typedef std::vector< osg::Vec3 >            CenterList;
+    typedef std::vector< osg::BoundingBox >     BoundsList;
     typedef std::vector< unsigned int >           Indices;
     typedef std::vector< unsigned int >         AxisStack;
 
@@ -43,6 +49,12 @@ struct BuildKdTree
 
     int divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
 
+    int divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, unsigned int start, unsigned int end, unsigned int level, unsigned int numParallelLevels);
+
+    bool findSAHSplit(const KdTree::BuildOptions& options, unsigned int start, unsigned int end, unsigned int& mid);
+
+    void computeLeafBound(KdTree::KdNode& node);
+
     KdTree&             _kdTree;
 
     osg::BoundingBox    _bb;
@@ -50,6 +62,9 @@ struct BuildKdTree
     Indices             _primitiveIndices;
     CenterList          _centers;
 
+    bool                _collectBounds;
+    BoundsList          _bounds;
+
 protected:
 
     BuildKdTree& operator = (const BuildKdTree&) { return *this; }
@@ -74,6 +89,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1)
@@ -98,6 +114,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2)
@@ -125,6 +142,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2, unsigned int p3)
@@ -154,6 +172,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_bounds.push_back(bb);
     }
 
     BuildKdTree* _buildKdTree;
@@ -192,9 +211,12 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     options._numVerticesProcessed += vertices->size();
 
+    _collectBounds = (options._splitMethod==KdTree::SAH_SPLIT);
+
     unsigned int estimatedNumTriangles = vertices->size()*2;
     _primitiveIndices.reserve(estimatedNumTriangles);
     _centers.reserve(estimatedNumTriangles);
+    if (_collectBounds) _bounds.reserve(estimatedNumTriangles);
 
     osg::TemplatePrimitiveIndexFunctor<PrimitiveIndicesCollector> collectIndices;
     collectIndices._buildKdTree = this;
@@ -202,13 +224,30 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 
     _primitiveIndices.reserve(vertices->size());
 
-    KdTree::KdNode node(-1, _primitiveIndices.size());
-    node.bb = _bb;
+    int nodeNum = 0;
+    if (options._splitMethod==KdTree::SAH_SPLIT)
+    {
+        // subtrees are handed to other threads for the first few levels, enough to give each thread several to work on.
+        unsigned int numThreads = options._numThreads>0 ? options._numThreads : static_cast<unsigned int>(OpenThreads::GetNumberOfProcessors());
+        unsigned int numParallelLevels = 0;
+        if (numThreads>1)
+        {
+            for(unsigned int n=1; n<numThreads; n*=2) ++numParallelLevels;
+            numParallelLevels += 2;
+        }
 
-    int nodeNum = _kdTree.addNode(node);
+        nodeNum = divideSAH(options, _kdTree.getNodes(), 0, static_cast<unsigned int>(_primitiveIndices.size()), 0, numParallelLevels);
+    }
+    else
+    {
+        KdTree::KdNode node(-1, _primitiveIndices.size());
+        node.bb = _bb;
 
-    osg::BoundingBox bb = _bb;
-    nodeNum = divide(options, bb, nodeNum, 0);
+        nodeNum = _kdTree.addNode(node);
+
+        osg::BoundingBox bb = _bb;
+        nodeNum = divide(options, bb, nodeNum, 0);
+    }
 
     osg::KdTree::Indices& primitiveIndices = _kdTree.getPrimitiveIndices();
 
@@ -271,6 +310,38 @@ void BuildKdTree::computeDivisions(KdTree::BuildOptions& options)
 #endif
 }
 
+void BuildKdTree::computeLeafBound(KdTree::KdNode& node)
+{
+    int istart = -node.first-1;
+    int iend = istart+node.second-1;
+
+    node.bb.init();
+    for(int i=istart; i<=iend; ++i)
+    {
+        unsigned int primitiveIndex = _kdTree.getPrimitiveIndices()[_primitiveIndices[i]];
+        primitiveIndex++; //skip original Primitive index
+        unsigned int numPoints = _kdTree.getVertexIndices()[primitiveIndex++];
+
+        for(; numPoints>0; --numPoints)
+        {
+            unsigned int vi = _kdTree.getVertexIndices()[primitiveIndex++];
+            const osg::Vec3& v = (*_kdTree.getVertices())[vi];
+            node.bb.expandBy(v);
+        }
+    }
+
+    if (node.bb.valid())
+    {
+        float epsilon = 1e-6f;
+        node.bb._min.x() -= epsilon;
+        node.bb._min.y() -= epsilon;
+        node.bb._min.z() -= epsilon;
+        node.bb._max.x() += epsilon;
+        node.bb._max.y() += epsilon;
+        node.bb._max.z() += epsilon;
+    }
+}
+
 int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level)
 {
     KdTree::KdNode& node = _kdTree.getNode(nodeIndex);
@@ -282,35 +353,8 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
     {
         if (node.first<0)
         {
-            int istart = -node.first-1;
-            int iend = istart+node.second-1;
-
             // leaf is done, now compute bound on it.
-            node.bb.init();
-            for(int i=istart; i<=iend; ++i)
-            {
-                unsigned int primitiveIndex = _kdTree.getPrimitiveIndices()[_primitiveIndices[i]];
-                primitiveIndex++; //skip original Primitive index
-                unsigned int numPoints = _kdTree.getVertexIndices()[primitiveIndex++];
-
-                for(; numPoints>0; --numPoints)
-                {
-                    unsigned int vi = _kdTree.getVertexIndices()[primitiveIndex++];
-                    const osg::Vec3& v = (*_kdTree.getVertices())[vi];
-                    node.bb.expandBy(v);
-                }
-            }
-
-            if (node.bb.valid())
-            {
-                float epsilon = 1e-6f;
-                node.bb._min.x() -= epsilon;
-                node.bb._min.y() -= epsilon;
-                node.bb._min.z() -= epsilon;
-                node.bb._max.x() += epsilon;
-                node.bb._max.y() += epsilon;
-                node.bb._max.z() += epsilon;
-            }
+            computeLeafBound(node);
 
 #ifdef VERBOSE_OUTPUT
             if (!node.bb.valid())
@@ -469,6 +513,231 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 
 }
 
+namespace
+{
+
+const unsigned int NUM_SAH_BINS = 16;
+
+// minimum number of primitives in a subtree for it to be worth building on another thread.
+const unsigned int MIN_NUM_PRIMITIVES_PER_TASK = 4096;
+
+inline float surfaceArea(const osg::BoundingBox& bb)
+{
+    if (!bb.valid()) return 0.0f;
+    float dx = bb.xMax()-bb.xMin();
+    float dy = bb.yMax()-bb.yMin();
+    float dz = bb.zMax()-bb.zMin();
+    return dx*dy + dy*dz + dz*dx;
+}
+
+inline unsigned int computeBin(float value, float minimum, float scale)
+{
+    unsigned int bin = static_cast<unsigned int>((value-minimum)*scale);
+    return bin<NUM_SAH_BINS ? bin : NUM_SAH_BINS-1;
+}
+
+struct InLeftBins
+{
+    InLeftBins(const BuildKdTree::CenterList& centers, int axis, float minimum, float scale, unsigned int lastLeftBin):
+        _centers(centers), _axis(axis), _minimum(minimum), _scale(scale), _lastLeftBin(lastLeftBin) {}
+
+    bool operator() (unsigned int index) const { return computeBin(_centers[index][_axis], _minimum, _scale)<=_lastLeftBin; }
+
+    const BuildKdTree::CenterList&  _centers;
+    int                             _axis;
+    float                           _minimum;
+    float                           _scale;
+    unsigned int                    _lastLeftBin;
+};
+
+// Append a subtree built into its own node list, offsetting its child indices to suit their new position.
+int appendNodes(KdTree::KdNodeList& nodes, const KdTree::KdNodeList& subtree)
+{
+    int offset = static_cast<int>(nodes.size());
+    for(KdTree::KdNodeList::const_iterator itr = subtree.begin();
+        itr != subtree.end();
+        ++itr)
+    {
+        KdTree::KdNode node = *itr;
+        if (node.first>0) node.first += offset;
+        if (node.first>=0 && node.second>0) node.second += offset;
+        nodes.push_back(node);
+    }
+    return offset;
+}
+
+class BuildKdSubtreeOperation : public osg::Operation
+{
+public:
+    BuildKdSubtreeOperation(BuildKdTree& buildKdTree, const KdTree::BuildOptions& options, unsigned int start, unsigned int end, unsigned int level, unsigned int numParallelLevels):
+        osg::Operation("BuildKdSubtree", false),
+        _buildKdTree(buildKdTree),
+        _options(options),
+        _start(start),
+        _end(end),
+        _level(level),
+        _numParallelLevels(numParallelLevels) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        _buildKdTree.divideSAH(_options, _nodes, _start, _end, _level, _numParallelLevels);
+    }
+
+    KdTree::KdNodeList              _nodes;
+
+protected:
+    BuildKdSubtreeOperation& operator = (const BuildKdSubtreeOperation&) { return *this; }
+
+    BuildKdTree&                    _buildKdTree;
+    const KdTree::BuildOptions&     _options;
+    unsigned int                    _start;
+    unsigned int                    _end;
+    unsigned int                    _level;
+    unsigned int                    _numParallelLevels;
+};
+
+}
+
+bool BuildKdTree::findSAHSplit(const KdTree::BuildOptions& options, unsigned int start, unsigned int end, unsigned int& mid)
+{
+    osg::BoundingBox centerBounds;
+    osg::BoundingBox bounds;
+    for(unsigned int i=start; i<end; ++i)
+    {
+        unsigned int index = _primitiveIndices[i];
+        centerBounds.expandBy(_centers[index]);
+        bounds.expandBy(_bounds[index]);
+    }
+
+    unsigned int num = end-start;
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+
+    // bin the primitives along all three axes in a single pass over them.
+    float scales[3];
+    unsigned int binCounts[3][NUM_SAH_BINS];
+    osg::BoundingBox binBounds[3][NUM_SAH_BINS];
+    for(int axis=0; axis<3; ++axis)
+    {
+        float extent = centerBounds._max[axis]-centerBounds._min[axis];
+        scales[axis] = extent>0.0f ? static_cast<float>(NUM_SAH_BINS)/extent : 0.0f;
+        for(unsigned int b=0; b<NUM_SAH_BINS; ++b) binCounts[axis][b] = 0;
+    }
+
+    for(unsigned int i=start; i<end; ++i)
+    {
+        unsigned int index = _primitiveIndices[i];
+        const osg::Vec3& center = _centers[index];
+        const osg::BoundingBox& bb = _bounds[index];
+        for(int axis=0; axis<3; ++axis)
+        {
+            unsigned int b = computeBin(center[axis], centerBounds._min[axis], scales[axis]);
+            ++binCounts[axis][b];
+            binBounds[axis][b].expandBy(bb);
+        }
+    }
+
+    for(int axis=0; axis<3; ++axis)
+    {
+        if (scales[axis]==0.0f) continue;
+
+        // sweep from the left recording the cost of everything up to each bin boundary,
+        // then from the right adding the cost of the remainder.
+        float leftCosts[NUM_SAH_BINS-1];
+        unsigned int leftCounts[NUM_SAH_BINS-1];
+        osg::BoundingBox accumulated;
+        unsigned int count = 0;
+        for(unsigned int b=0; b<NUM_SAH_BINS-1; ++b)
+        {
+            accumulated.expandBy(binBounds[axis][b]);
+            count += binCounts[axis][b];
+            leftCounts[b] = count;
+            leftCosts[b] = static_cast<float>(count)*surfaceArea(accumulated);
+        }
+
+        accumulated.init();
+        count = 0;
+        for(unsigned int b=NUM_SAH_BINS-1; b>0; --b)
+        {
+            accumulated.expandBy(binBounds[axis][b]);
+            count += binCounts[axis][b];
+            if (count==0 || leftCounts[b-1]==0) continue;
+
+            float cost = leftCosts[b-1] + static_cast<float>(count)*surfaceArea(accumulated);
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b-1;
+            }
+        }
+    }
+
+    if (bestAxis<0) return false;
+
+    // stop splitting once testing all the primitives is estimated to be cheaper than traversing
+    // another level, unless that would leave leaves well above the target size.
+    float area = surfaceArea(bounds);
+    if (num<=options._targetNumTrianglesPerLeaf*4 && bestCost+area>=static_cast<float>(num)*area) return false;
+
+    InLeftBins inLeftBins(_centers, bestAxis, centerBounds._min[bestAxis], scales[bestAxis], bestBin);
+    Indices::iterator split = std::partition(_primitiveIndices.begin()+start, _primitiveIndices.begin()+end, inLeftBins);
+
+    mid = static_cast<unsigned int>(split-_primitiveIndices.begin());
+    return mid>start && mid<end;
+}
+
+int BuildKdTree::divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, unsigned int start, unsigned int end, unsigned int level, unsigned int numParallelLevels)
+{
+    // nodes are added in depth first order, so each node's left child directly follows it in memory.
+    int nodeIndex = static_cast<int>(nodes.size());
+    nodes.push_back(KdTree::KdNode(-static_cast<int>(start)-1, static_cast<int>(end-start)));
+
+    unsigned int mid = start;
+    if (level>=options._maxNumLevels ||
+        end-start<=options._targetNumTrianglesPerLeaf ||
+        !findSAHSplit(options, start, end, mid))
+    {
+        computeLeafBound(nodes[nodeIndex]);
+        return nodeIndex;
+    }
+
+    int leftChildIndex = 0;
+    int rightChildIndex = 0;
+    if (level<numParallelLevels && end-start>=MIN_NUM_PRIMITIVES_PER_TASK)
+    {
+        // build the left subtree on another thread while this thread builds the right, each into
+        // its own node list, then append them in order so the layout is the same as a serial build.
+        osg::TaskScheduler* scheduler = osg::TaskScheduler::instance().get();
+        osg::ref_ptr<osg::TaskGroup> taskGroup = new osg::TaskGroup;
+        osg::ref_ptr<BuildKdSubtreeOperation> leftOperation = new BuildKdSubtreeOperation(*this, options, start, mid, level+1, numParallelLevels);
+        scheduler->add(leftOperation.get(), taskGroup.get());
+
+        KdTree::KdNodeList rightNodes;
+        divideSAH(options, rightNodes, mid, end, level+1, numParallelLevels);
+
+        scheduler->wait(taskGroup.get());
+
+        leftChildIndex = appendNodes(nodes, leftOperation->_nodes);
+        rightChildIndex = appendNodes(nodes, rightNodes);
+    }
+    else
+    {
+        leftChildIndex = divideSAH(options, nodes, start, mid, level+1, numParallelLevels);
+        rightChildIndex = divideSAH(options, nodes, mid, end, level+1, numParallelLevels);
+    }
+
+    KdTree::KdNode& node = nodes[nodeIndex];
+    node.first = leftChildIndex;
+    node.second = rightChildIndex;
+    node.bb.init();
+    node.bb.expandBy(nodes[leftChildIndex].bb);
+    node.bb.expandBy(nodes[rightChildIndex].bb);
+
+    return nodeIndex;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // KdTree::BuildOptions
@@ -476,7 +745,9 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 KdTree::BuildOptions::BuildOptions():
         _numVerticesProcessed(0),
         _targetNumTrianglesPerLeaf(4),
-        _maxNumLevels(32)
+        _maxNumLevels(32),
+        _splitMethod(KdTree::MIDPOINT_SPLIT),
+        _numThreads(1)
 {
 }
 
@@ -22,6 +22,20 @@
 #include <stdlib.h>
 #include <float.h>
 
+// Select the SIMD kernels for the 4x4 multiply at build time from what the compiler is targeting.
+#if defined(OSG_MATRIX_USE_SIMD)
+    #if defined(__AVX__)
+        #include <immintrin.h>
+        #define OSG_MATRIX_SIMD_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+        #include <emmintrin.h>
+        #define OSG_MATRIX_SIMD_SSE2
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+        #define OSG_MATRIX_SIMD_NEON
+    #endif
+#endif
+
 using namespace osg;
 
 #define SET_ROW(row, v1, v2, v3, v4 )    \
@@ -36,6 +50,155 @@ using namespace osg;
     +((a)._mat[r][2] * (b)._mat[2][c]) \
     +((a)._mat[r][3] * (b)._mat[3][c])
 
+#if defined(OSG_MATRIX_SIMD_AVX) || defined(OSG_MATRIX_SIMD_SSE2) || defined(OSG_MATRIX_SIMD_NEON)
+
+#define OSG_MATRIX_SIMD
+
+// The multMatrix4x4() kernels compute result = lhs * rhs one row at a time as
+//   row(lhs,r)[0]*row(rhs,0) + row(lhs,r)[1]*row(rhs,1) + row(lhs,r)[2]*row(rhs,2) + row(lhs,r)[3]*row(rhs,3)
+// which multiplies and adds in exactly the same order as INNER_PRODUCT, so results are bit for bit identical
+// to the scalar code. All of rhs is loaded before any stores, and each lhs row is read before its result row
+// is stored, so result may alias either lhs or rhs.
+
+#if defined(OSG_MATRIX_SIMD_AVX) || defined(OSG_MATRIX_SIMD_SSE2)
+
+static inline void multMatrix4x4(const float* lhs, const float* rhs, float* result)
+{
+    const __m128 r0 = _mm_loadu_ps(rhs);
+    const __m128 r1 = _mm_loadu_ps(rhs+4);
+    const __m128 r2 = _mm_loadu_ps(rhs+8);
+    const __m128 r3 = _mm_loadu_ps(rhs+12);
+
+    for(int row=0; row<4; ++row, lhs+=4, result+=4)
+    {
+        __m128 t = _mm_mul_ps(_mm_set1_ps(lhs[0]), r0);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(lhs[1]), r1));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(lhs[2]), r2));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(lhs[3]), r3));
+        _mm_storeu_ps(result, t);
+    }
+}
+
+#endif
+
+#if defined(OSG_MATRIX_SIMD_AVX)
+
+static inline void multMatrix4x4(const double* lhs, const double* rhs, double* result)
+{
+    const __m256d r0 = _mm256_loadu_pd(rhs);
+    const __m256d r1 = _mm256_loadu_pd(rhs+4);
+    const __m256d r2 = _mm256_loadu_pd(rhs+8);
+    const __m256d r3 = _mm256_loadu_pd(rhs+12);
+
+    for(int row=0; row<4; ++row, lhs+=4, result+=4)
+    {
+        __m256d t = _mm256_mul_pd(_mm256_set1_pd(lhs[0]), r0);
+        t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_set1_pd(lhs[1]), r1));
+        t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_set1_pd(lhs[2]), r2));
+        t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_set1_pd(lhs[3]), r3));
+        _mm256_storeu_pd(result, t);
+    }
+}
+
+#elif defined(OSG_MATRIX_SIMD_SSE2)
+
+static inline void multMatrix4x4(const double* lhs, const double* rhs, double* result)
+{
+    const __m128d r0l = _mm_loadu_pd(rhs),    r0h = _mm_loadu_pd(rhs+2);
+    const __m128d r1l = _mm_loadu_pd(rhs+4),  r1h = _mm_loadu_pd(rhs+6);
+    const __m128d r2l = _mm_loadu_pd(rhs+8),  r2h = _mm_loadu_pd(rhs+10);
+    const __m128d r3l = _mm_loadu_pd(rhs+12), r3h = _mm_loadu_pd(rhs+14);
+
+    for(int row=0; row<4; ++row, lhs+=4, result+=4)
+    {
+        const __m128d a0 = _mm_set1_pd(lhs[0]);
+        const __m128d a1 = _mm_set1_pd(lhs[1]);
+        const __m128d a2 = _mm_set1_pd(lhs[2]);
+        const __m128d a3 = _mm_set1_pd(lhs[3]);
+
+        __m128d tl = _mm_mul_pd(a0, r0l);
+        __m128d th = _mm_mul_pd(a0, r0h);
+        tl = _mm_add_pd(tl, _mm_mul_pd(a1, r1l));
+        th = _mm_add_pd(th, _mm_mul_pd(a1, r1h));
+        tl = _mm_add_pd(tl, _mm_mul_pd(a2, r2l));
+        th = _mm_add_pd(th, _mm_mul_pd(a2, r2h));
+        tl = _mm_add_pd(tl, _mm_mul_pd(a3, r3l));
+        th = _mm_add_pd(th, _mm_mul_pd(a3, r3h));
+        _mm_storeu_pd(result, tl);
+        _mm_storeu_pd(result+2, th);
+    }
+}
+
+#endif
+
+#if defined(OSG_MATRIX_SIMD_NEON)
+
+// use separate multiply and add rather than vmlaq/vfmaq so the rounding matches the scalar code.
+static inline void multMatrix4x4(const float* lhs, const float* rhs, float* result)
+{
+    const float32x4_t r0 = vld1q_f32(rhs);
+    const float32x4_t r1 = vld1q_f32(rhs+4);
+    const float32x4_t r2 = vld1q_f32(rhs+8);
+    const float32x4_t r3 = vld1q_f32(rhs+12);
+
+    for(int row=0; row<4; ++row, lhs+=4, result+=4)
+    {
+        float32x4_t t = vmulq_n_f32(r0, lhs[0]);
+        t = vaddq_f32(t, vmulq_n_f32(r1, lhs[1]));
+        t = vaddq_f32(t, vmulq_n_f32(r2, lhs[2]));
+        t = vaddq_f32(t, vmulq_n_f32(r3, lhs[3]));
+        vst1q_f32(result, t);
+    }
+}
+
+#if defined(__aarch64__)
+
+static inline void multMatrix4x4(const double* lhs, const double* rhs, double* result)
+{
+    const float64x2_t r0l = vld1q_f64(rhs),    r0h = vld1q_f64(rhs+2);
+    const float64x2_t r1l = vld1q_f64(rhs+4),  r1h = vld1q_f64(rhs+6);
+    const float64x2_t r2l = vld1q_f64(rhs+8),  r2h = vld1q_f64(rhs+10);
+    const float64x2_t r3l = vld1q_f64(rhs+12), r3h = vld1q_f64(rhs+14);
+
+    for(int row=0; row<4; ++row, lhs+=4, result+=4)
+    {
+        float64x2_t tl = vmulq_n_f64(r0l, lhs[0]);
+        float64x2_t th = vmulq_n_f64(r0h, lhs[0]);
+        tl = vaddq_f64(tl, vmulq_n_f64(r1l, lhs[1]));
+        th = vaddq_f64(th, vmulq_n_f64(r1h, lhs[1]));
+        tl = vaddq_f64(tl, vmulq_n_f64(r2l, lhs[2]));
+        th = vaddq_f64(th, vmulq_n_f64(r2h, lhs[2]));
+        tl = vaddq_f64(tl, vmulq_n_f64(r3l, lhs[3]));
+        th = vaddq_f64(th, vmulq_n_f64(r3h, lhs[3]));
+        vst1q_f64(result, tl);
+        vst1q_f64(result+2, th);
+    }
+}
+
+#else
+
+// 32 bit ARM has no double precision NEON, so fall back to the scalar ordering.
+static inline void multMatrix4x4(const double* lhs, const double* rhs, double* result)
+{
+    double r[16];
+    for(int i=0; i<16; ++i) r[i] = rhs[i];
+
+    for(int row=0; row<4; ++row, lhs+=4, result+=4)
+    {
+        const double a0 = lhs[0], a1 = lhs[1], a2 = lhs[2], a3 = lhs[3];
+        for(int col=0; col<4; ++col)
+        {
+            result[col] = (a0 * r[col]) + (a1 * r[4+col]) + (a2 * r[8+col]) + (a3 * r[12+col]);
+        }
+    }
+}
+
+#endif
+
+#endif
+
+#endif
+
 
 Matrix_implementation::Matrix_implementation( value_type a00, value_type a01, value_type a02, value_type a03,
                   value_type a10, value_type a11, value_type a12, value_type a13,
@@ -463,6 +626,9 @@ void Matrix_implementation::mult( const Matrix_implementation& lhs, const Matrix
         return;
     }
 
+#ifdef OSG_MATRIX_SIMD
+    multMatrix4x4(lhs.ptr(), rhs.ptr(), &_mat[0][0]);
+#else
 // PRECONDITION: We assume neither &lhs nor &rhs == this
 // if it did, use preMult or postMult instead
     _mat[0][0] = INNER_PRODUCT(lhs, rhs, 0, 0);
@@ -481,10 +647,14 @@ void Matrix_implementation::mult( const Matrix_implementation& lhs, const Matrix
     _mat[3][1] = INNER_PRODUCT(lhs, rhs, 3, 1);
     _mat[3][2] = INNER_PRODUCT(lhs, rhs, 3, 2);
     _mat[3][3] = INNER_PRODUCT(lhs, rhs, 3, 3);
+#endif
 }
 
 void Matrix_implementation::preMult( const Matrix_implementation& other )
 {
+#ifdef OSG_MATRIX_SIMD
+    multMatrix4x4(other.ptr(), &_mat[0][0], &_mat[0][0]);
+#else
     // brute force method requiring a copy
     //Matrix_implementation tmp(other* *this);
     // *this = tmp;
@@ -501,11 +671,14 @@ void Matrix_implementation::preMult( const Matrix_implementation& other )
         _mat[2][col] = t[2];
         _mat[3][col] = t[3];
     }
-
+#endif
 }
 
 void Matrix_implementation::postMult( const Matrix_implementation& other )
 {
+#ifdef OSG_MATRIX_SIMD
+    multMatrix4x4(&_mat[0][0], other.ptr(), &_mat[0][0]);
+#else
     // brute force method requiring a copy
     //Matrix_implementation tmp(*this * other);
     // *this = tmp;
@@ -520,6 +693,7 @@ void Matrix_implementation::postMult( const Matrix_implementation& other )
         t[3] = INNER_PRODUCT( *this, other, row, 3 );
         SET_ROW(row, t[0], t[1], t[2], t[3] )
     }
+#endif
 }
 
 #undef INNER_PRODUCT
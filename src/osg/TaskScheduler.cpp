@@ -0,0 +1,603 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/TaskScheduler>
+#include <osg/ApplicationUsage>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+#include <deque>
+#include <stdlib.h>
+
+using namespace osg;
+using namespace OpenThreads;
+
+static osg::ApplicationUsageProxy TaskScheduler_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_TASK_THREADS <value>","Set the number of worker threads used by the shared osg::TaskScheduler, defaults to one less than the number of processors.");
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//  TaskGroup
+//
+TaskGroup::TaskGroup():
+    osg::Referenced(true),
+    _numPending(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+}
+
+bool TaskGroup::done() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _numPending==0;
+}
+
+unsigned int TaskGroup::getNumPending() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _numPending;
+}
+
+void TaskGroup::addContinuation(Operation* operation, TaskScheduler* scheduler)
+{
+    if (!operation) return;
+    if (!scheduler) scheduler = TaskScheduler::instance().get();
+
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        if (_numPending>0)
+        {
+            _continuations.push_back(Continuation(operation, scheduler));
+            return;
+        }
+    }
+
+    scheduler->add(operation);
+}
+
+void TaskGroup::block()
+{
+    ScopedLock<Mutex> lock(_mutex);
+    while(_numPending>0)
+    {
+        _condition.wait(&_mutex);
+    }
+}
+
+void TaskGroup::started()
+{
+    ScopedLock<Mutex> lock(_mutex);
+    ++_numPending;
+}
+
+void TaskGroup::completed()
+{
+    Continuations continuations;
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        if (_numPending>0 && --_numPending==0)
+        {
+            continuations.swap(_continuations);
+            _condition.broadcast();
+        }
+    }
+
+    for(Continuations::iterator itr = continuations.begin();
+        itr != continuations.end();
+        ++itr)
+    {
+        itr->second->add(itr->first.get());
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//  TaskScheduler
+//
+class TaskScheduler::Worker : public osg::Referenced, public OpenThreads::Thread
+{
+    public:
+
+        Worker(TaskScheduler* scheduler, unsigned int index):
+            osg::Referenced(true),
+            _scheduler(scheduler),
+            _index(index) {}
+
+        virtual void run() { _scheduler->runWorker(_index); }
+
+        // take the newest or oldest of _tasks, or the newest or oldest of group's tasks if a group is given, with _mutex held.
+        bool takeTask(const TaskGroup* group, bool newest, Task& task)
+        {
+            if (_tasks.empty()) return false;
+
+            if (!group)
+            {
+                if (newest)
+                {
+                    task = _tasks.back();
+                    _tasks.pop_back();
+                }
+                else
+                {
+                    task = _tasks.front();
+                    _tasks.pop_front();
+                }
+                return true;
+            }
+
+            if (newest)
+            {
+                for(std::deque<Task>::reverse_iterator itr = _tasks.rbegin();
+                    itr != _tasks.rend();
+                    ++itr)
+                {
+                    if (itr->group.get()==group)
+                    {
+                        task = *itr;
+                        _tasks.erase((itr+1).base());
+                        return true;
+                    }
+                }
+            }
+            else
+            {
+                for(std::deque<Task>::iterator itr = _tasks.begin();
+                    itr != _tasks.end();
+                    ++itr)
+                {
+                    if (itr->group.get()==group)
+                    {
+                        task = *itr;
+                        _tasks.erase(itr);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        TaskScheduler*          _scheduler;
+        unsigned int            _index;
+
+        // _tasks may be stolen by other workers, _pinnedTasks are only run by this worker.
+        OpenThreads::Mutex      _mutex;
+        std::deque<Task>        _tasks;
+        std::deque<Task>        _pinnedTasks;
+        OpenThreads::Atomic     _numPinned;
+
+    protected:
+
+        virtual ~Worker() {}
+};
+
+static unsigned int getDefaultNumTaskThreads()
+{
+    const char* str = getenv("OSG_NUM_TASK_THREADS");
+    if (str)
+    {
+        int numThreads = atoi(str);
+        if (numThreads>0) return static_cast<unsigned int>(numThreads);
+    }
+
+    int numProcessors = OpenThreads::GetNumberOfProcessors();
+    return numProcessors>2 ? static_cast<unsigned int>(numProcessors-1) : 1u;
+}
+
+TaskScheduler::TaskScheduler(unsigned int numThreads):
+    osg::Referenced(true)
+{
+    if (numThreads==0)
+    {
+        int numProcessors = OpenThreads::GetNumberOfProcessors();
+        numThreads = numProcessors>2 ? static_cast<unsigned int>(numProcessors-1) : 1u;
+    }
+
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        _workers.push_back(new Worker(this, i));
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    cancel();
+}
+
+ref_ptr<TaskScheduler>& TaskScheduler::instance()
+{
+    static ref_ptr<TaskScheduler> s_taskScheduler = new TaskScheduler(getDefaultNumTaskThreads());
+    return s_taskScheduler;
+}
+
+// Use a proxy to force the initialization of the TaskScheduler singleton during static initialization,
+// the worker threads themselves aren't started until the first task is submitted.
+OSG_INIT_SINGLETON_PROXY(TaskSchedulerSingletonProxy, TaskScheduler::instance())
+
+void TaskScheduler::startThreads()
+{
+    ScopedLock<Mutex> lock(_threadsMutex);
+    if (_threadsStarted!=0 || _done!=0) return;
+
+    OSG_INFO<<"TaskScheduler::startThreads() starting "<<_workers.size()<<" threads"<<std::endl;
+
+    for(Workers::iterator itr = _workers.begin();
+        itr != _workers.end();
+        ++itr)
+    {
+        (*itr)->startThread();
+    }
+
+    _threadsStarted.exchange(1);
+}
+
+void TaskScheduler::add(Operation* operation, TaskGroup* group)
+{
+    if (!operation) return;
+
+    Task task;
+    task.operation = operation;
+    task.group = group;
+    if (group) group->started();
+
+    if (_done!=0)
+    {
+        runTask(task);
+        return;
+    }
+
+    if (_threadsStarted==0) startThreads();
+
+    // keep tasks submitted from a worker on its own queue for locality, otherwise spread them round robin.
+    int currentIndex = getCurrentThreadIndex();
+    unsigned int index = currentIndex>=0 ? static_cast<unsigned int>(currentIndex) : ((++_nextWorker) % _workers.size());
+
+    Worker* worker = _workers[index].get();
+    bool queued = false;
+    {
+        // cancel() drains the queues under the same lock once _done is set, so a task is either queued before
+        // the drain or sees _done here and is run straight away.
+        ScopedLock<Mutex> lock(worker->_mutex);
+        if (_done==0)
+        {
+            worker->_tasks.push_back(task);
+            ++_numQueued;
+            if (group) ++(group->_numQueued);
+            queued = true;
+        }
+    }
+
+    if (!queued)
+    {
+        runTask(task);
+        return;
+    }
+
+    {
+        ScopedLock<Mutex> lock(_sleepMutex);
+        _sleepCondition.signal();
+        if (group && group->_numWaiting!=0) _waitCondition.broadcast();
+    }
+}
+
+void TaskScheduler::addToThread(Operation* operation, unsigned int threadIndex, TaskGroup* group)
+{
+    if (!operation) return;
+
+    if (threadIndex>=_workers.size())
+    {
+        OSG_NOTICE<<"Warning: TaskScheduler::addToThread("<<operation->getName()<<", "<<threadIndex<<") thread index out of range, adding to any thread."<<std::endl;
+        add(operation, group);
+        return;
+    }
+
+    Task task;
+    task.operation = operation;
+    task.group = group;
+    if (group) group->started();
+
+    if (_done!=0)
+    {
+        runTask(task);
+        return;
+    }
+
+    if (_threadsStarted==0) startThreads();
+
+    Worker* worker = _workers[threadIndex].get();
+    bool queued = false;
+    {
+        ScopedLock<Mutex> lock(worker->_mutex);
+        if (_done==0)
+        {
+            worker->_pinnedTasks.push_back(task);
+            ++(worker->_numPinned);
+            queued = true;
+        }
+    }
+
+    if (!queued)
+    {
+        runTask(task);
+        return;
+    }
+
+    // the worker may be asleep in runWorker() or in wait().
+    {
+        ScopedLock<Mutex> lock(_sleepMutex);
+        _sleepCondition.broadcast();
+        _waitCondition.broadcast();
+    }
+}
+
+bool TaskScheduler::takeTask(int threadIndex, Task& task, const TaskGroup* group)
+{
+    unsigned int numWorkers = static_cast<unsigned int>(_workers.size());
+
+    if (threadIndex>=0)
+    {
+        // run this worker's own tasks first, newest first as it is most likely to still be in cache. Pinned tasks
+        // can't be run by anyone else, so they are run whichever group is being waited on.
+        Worker* worker = _workers[threadIndex].get();
+        ScopedLock<Mutex> lock(worker->_mutex);
+        if (!worker->_pinnedTasks.empty())
+        {
+            task = worker->_pinnedTasks.front();
+            worker->_pinnedTasks.pop_front();
+            --(worker->_numPinned);
+            return true;
+        }
+        if (worker->takeTask(group, true, task))
+        {
+            --_numQueued;
+            if (task.group.valid()) --(task.group->_numQueued);
+            return true;
+        }
+    }
+
+    if (group && group->_numQueued==0) return false;
+
+    // steal the oldest task from one of the other workers.
+    unsigned int start = threadIndex>=0 ? static_cast<unsigned int>(threadIndex) : (_nextWorker % numWorkers);
+    for(unsigned int i=1; i<=numWorkers; ++i)
+    {
+        Worker* worker = _workers[(start+i) % numWorkers].get();
+        if (worker->_index==static_cast<unsigned int>(threadIndex)) continue;
+
+        ScopedLock<Mutex> lock(worker->_mutex);
+        if (worker->takeTask(group, false, task))
+        {
+            --_numQueued;
+            if (task.group.valid()) --(task.group->_numQueued);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskScheduler::runTask(Task& task)
+{
+    (*task.operation)(0);
+
+    if (task.group.valid())
+    {
+        task.group->completed();
+
+        // wake any threads sleeping in wait() on this group.
+        if (task.group->_numWaiting!=0 && task.group->done())
+        {
+            ScopedLock<Mutex> lock(_sleepMutex);
+            _waitCondition.broadcast();
+        }
+    }
+
+    task.operation = 0;
+    task.group = 0;
+}
+
+void TaskScheduler::runWorker(unsigned int threadIndex)
+{
+    Worker* worker = _workers[threadIndex].get();
+
+    while(_done==0)
+    {
+        Task task;
+        if (takeTask(threadIndex, task))
+        {
+            runTask(task);
+            continue;
+        }
+
+        ScopedLock<Mutex> lock(_sleepMutex);
+        while(_done==0 && _numQueued==0 && worker->_numPinned==0)
+        {
+            _sleepCondition.wait(&_sleepMutex);
+        }
+    }
+}
+
+void TaskScheduler::wait(TaskGroup* group)
+{
+    if (!group) return;
+
+    int threadIndex = getCurrentThreadIndex();
+    Worker* worker = threadIndex>=0 ? _workers[threadIndex].get() : 0;
+
+    ++(group->_numWaiting);
+
+    while(!group->done())
+    {
+        if (_done!=0)
+        {
+            // cancel() runs the remaining tasks on the thread that called it.
+            group->block();
+            break;
+        }
+
+        Task task;
+        if (takeTask(threadIndex, task, group))
+        {
+            runTask(task);
+            continue;
+        }
+
+        // the group's remaining tasks are running elsewhere, sleep until it is done or more of its tasks are queued,
+        // as tasks it depends on may yet be added, or pinned to this thread if it is a worker.
+        ScopedLock<Mutex> lock(_sleepMutex);
+        while(_done==0 && !group->done() && group->_numQueued==0 && (!worker || worker->_numPinned==0))
+        {
+            _waitCondition.wait(&_sleepMutex);
+        }
+    }
+
+    --(group->_numWaiting);
+}
+
+namespace
+{
+
+// Hands out the ranges of a parallelFor() loop in turn to each of the threads running it.
+class ParallelForOperation : public Operation
+{
+public:
+    ParallelForOperation(TaskScheduler::ParallelForFunctor& functor, unsigned int numItems, unsigned int grainSize):
+        Operation("ParallelFor", false),
+        _functor(functor),
+        _numItems(numItems),
+        _grainSize(grainSize),
+        _numRanges((numItems-1)/grainSize+1) {}
+
+    unsigned int getNumRanges() const { return _numRanges; }
+
+    virtual void operator() (Object*)
+    {
+        for(unsigned int range = (++_nextRange) - 1;
+            range < _numRanges;
+            range = (++_nextRange) - 1)
+        {
+            unsigned int begin = range*_grainSize;
+            unsigned int end = (_numItems-begin)>_grainSize ? begin+_grainSize : _numItems;
+            _functor(begin, end);
+        }
+    }
+
+protected:
+    TaskScheduler::ParallelForFunctor&  _functor;
+    unsigned int                        _numItems;
+    unsigned int                        _grainSize;
+    unsigned int                        _numRanges;
+    OpenThreads::Atomic                 _nextRange;
+};
+
+}
+
+void TaskScheduler::parallelFor(unsigned int numItems, ParallelForFunctor& functor, unsigned int numThreads, unsigned int grainSize)
+{
+    if (numItems==0) return;
+    if (grainSize==0) grainSize = 1;
+
+    ref_ptr<ParallelForOperation> operation = new ParallelForOperation(functor, numItems, grainSize);
+
+    if (numThreads==0) numThreads = getNumThreads()+1;
+    if (numThreads>operation->getNumRanges()) numThreads = operation->getNumRanges();
+
+    if (numThreads<=1)
+    {
+        (*operation)(0);
+        return;
+    }
+
+    ref_ptr<TaskGroup> taskGroup = new TaskGroup;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        add(operation.get(), taskGroup.get());
+    }
+
+    // the calling thread takes ranges too, rather than sitting idle until the workers are done.
+    (*operation)(0);
+
+    wait(taskGroup.get());
+}
+
+unsigned int TaskScheduler::computeNumThreads(unsigned int amount, unsigned int minAmountPerThread, unsigned int numThreads) const
+{
+    unsigned int maxNumThreads = minAmountPerThread>0 ? amount/minAmountPerThread : amount;
+    if (maxNumThreads==0) maxNumThreads = 1;
+    if (numThreads==0) numThreads = getNumThreads()+1;
+    return numThreads<maxNumThreads ? numThreads : maxNumThreads;
+}
+
+int TaskScheduler::getCurrentThreadIndex() const
+{
+    Worker* worker = dynamic_cast<Worker*>(OpenThreads::Thread::CurrentThread());
+    return (worker && worker->_scheduler==this) ? static_cast<int>(worker->_index) : -1;
+}
+
+void TaskScheduler::cancel()
+{
+    {
+        ScopedLock<Mutex> lock(_threadsMutex);
+        if (_done!=0) return;
+        _done.exchange(1);
+    }
+
+    {
+        ScopedLock<Mutex> lock(_sleepMutex);
+        _sleepCondition.broadcast();
+        _waitCondition.broadcast();
+    }
+
+    if (_threadsStarted!=0)
+    {
+        for(Workers::iterator itr = _workers.begin();
+            itr != _workers.end();
+            ++itr)
+        {
+            (*itr)->join();
+        }
+    }
+
+    // run anything left so that callers waiting on TaskGroups aren't left blocked, taking the tasks under the
+    // worker's lock as add() may be pushing one that it checked _done for before it was set.
+    for(Workers::iterator itr = _workers.begin();
+        itr != _workers.end();
+        ++itr)
+    {
+        Worker* worker = itr->get();
+        for(;;)
+        {
+            Task task;
+            {
+                ScopedLock<Mutex> lock(worker->_mutex);
+                if (!worker->_pinnedTasks.empty())
+                {
+                    task = worker->_pinnedTasks.front();
+                    worker->_pinnedTasks.pop_front();
+                    --(worker->_numPinned);
+                }
+                else if (!worker->_tasks.empty())
+                {
+                    task = worker->_tasks.front();
+                    worker->_tasks.pop_front();
+                    --_numQueued;
+                    if (task.group.valid()) --(task.group->_numQueued);
+                }
+                else break;
+            }
+            runTask(task);
+        }
+    }
+}
@@ -523,7 +523,9 @@ VertexArrayState::VertexArrayState(osg::State* state):
     _state(state),
     _vertexArrayObject(0),
     _currentVBO(0),
+    _currentVBOID(0),
     _currentEBO(0),
+    _currentEBOID(0),
     _requiresSetArrays(true)
 {
     _stateObserverSet = _state->getOrCreateObserverSet();
@@ -723,6 +725,16 @@ void VertexArrayState::release()
     osg::get<VertexArrayStateManager>(_ext->contextID)->release(this);
 }
 
+// a ring buffer that is reallocated gets a new buffer object, so the arrays dispatched from the old one have to be dispatched again
+// even though they haven't been modified themselves.
+static bool vboIDChanged(const VertexArrayState::ArrayDispatch* vad, osg::State& state, const osg::Array* array)
+{
+    if (vad->vboID==0) return false;
+
+    const GLBufferObject* vbo = array->getGLBufferObject(state.getContextID());
+    return vbo && vbo->getGLObjectID()!=vad->vboID;
+}
+
 void VertexArrayState::setArray(ArrayDispatch* vad, osg::State& state, const osg::Array* new_array)
 {
     if (new_array)
@@ -746,8 +758,9 @@ void VertexArrayState::setArray(ArrayDispatch* vad, osg::State& state, const osg
                 unbindVertexBufferObject();
                 vad->enable_and_dispatch(state, new_array);
             }
+            vad->vboID = vbo ? vbo->getGLObjectID() : 0;
         }
-        else if (new_array!=vad->array || new_array->getModifiedCount()!=vad->modifiedCount)
+        else if (new_array!=vad->array || new_array->getModifiedCount()!=vad->modifiedCount || vboIDChanged(vad, state, new_array))
         {
             GLBufferObject* vbo = isVertexBufferObjectSupported() ? new_array->getOrCreateGLBufferObject(state.getContextID()) : 0;
             if (vbo)
@@ -760,6 +773,7 @@ void VertexArrayState::setArray(ArrayDispatch* vad, osg::State& state, const osg
                 unbindVertexBufferObject();
                 vad->dispatch(state, new_array);
             }
+            vad->vboID = vbo ? vbo->getGLObjectID() : 0;
         }
 
         vad->array = new_array;
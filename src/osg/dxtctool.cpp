@@ -8,6 +8,11 @@
 
 #include "dxtctool.h"
 
+#include <osg/Math>
+
+#include <float.h>
+#include <limits.h>
+
 
 namespace dxtc_tool {
 
@@ -659,4 +664,356 @@ void compressedBlockStripAlhpa(const GLenum format, const unsigned char *src_blo
     }
     }
 }
+
+//
+// Block encoders, a principal axis fit of the texels gives the end points of each block which are
+// then optionally refined with a least squares fit to the chosen indices.
+//
+
+namespace {
+
+inline unsigned short packColor565(float r, float g, float b)
+{
+    int r5 = static_cast<int>(osg::clampBetween(r, 0.0f, 255.0f)*31.0f/255.0f+0.5f);
+    int g6 = static_cast<int>(osg::clampBetween(g, 0.0f, 255.0f)*63.0f/255.0f+0.5f);
+    int b5 = static_cast<int>(osg::clampBetween(b, 0.0f, 255.0f)*31.0f/255.0f+0.5f);
+    return static_cast<unsigned short>((r5<<11) | (g6<<5) | b5);
+}
+
+inline void unpackColor565(unsigned short color, int rgb[3])
+{
+    int r5 = color>>11, g6 = (color>>5)&0x3f, b5 = color&0x1f;
+    rgb[0] = (r5<<3) | (r5>>2);
+    rgb[1] = (g6<<2) | (g6>>4);
+    rgb[2] = (b5<<3) | (b5>>2);
+}
+
+// Choose the palette entry closest to each texel, transparent texels take index 3 of the three colour mode.
+unsigned int fitColorIndices(const unsigned char texels[64], const bool transparent[16], unsigned short color_0, unsigned short color_1, unsigned int& indices)
+{
+    int palette[4][3];
+    unpackColor565(color_0, palette[0]);
+    unpackColor565(color_1, palette[1]);
+    bool fourColors = color_0>color_1;
+    for(int c=0; c<3; ++c)
+    {
+        if (fourColors)
+        {
+            palette[2][c] = (2*palette[0][c]+palette[1][c])/3;
+            palette[3][c] = (palette[0][c]+2*palette[1][c])/3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c]+palette[1][c])/2;
+            palette[3][c] = 0;
+        }
+    }
+
+    unsigned int numColors = fourColors ? 4 : 3;
+    unsigned int error = 0;
+    indices = 0;
+    for(int i=0; i<16; ++i)
+    {
+        unsigned int index = 3;
+        if (!transparent[i])
+        {
+            unsigned int bestDistance = UINT_MAX;
+            for(unsigned int p=0; p<numColors; ++p)
+            {
+                int dr = texels[i*4]-palette[p][0];
+                int dg = texels[i*4+1]-palette[p][1];
+                int db = texels[i*4+2]-palette[p][2];
+                unsigned int distance = dr*dr + dg*dg + db*db;
+                if (distance<bestDistance)
+                {
+                    bestDistance = distance;
+                    index = p;
+                }
+            }
+            error += bestDistance;
+        }
+        indices |= index<<(2*i);
+    }
+    return error;
+}
+
+// Order the end points for the required mode and fit the indices to them.
+unsigned int fitColorEndPoints(const unsigned char texels[64], const bool transparent[16], bool threeColorMode, unsigned short a, unsigned short b, unsigned short& color_0, unsigned short& color_1, unsigned int& indices)
+{
+    if (threeColorMode)
+    {
+        color_0 = osg::minimum(a, b);
+        color_1 = osg::maximum(a, b);
+    }
+    else
+    {
+        color_0 = osg::maximum(a, b);
+        color_1 = osg::minimum(a, b);
+    }
+    return fitColorIndices(texels, transparent, color_0, color_1, indices);
+}
+
+void writeColorBlock(unsigned short color_0, unsigned short color_1, unsigned int indices, unsigned char* block)
+{
+    block[0] = static_cast<unsigned char>(color_0 & 0xff);
+    block[1] = static_cast<unsigned char>(color_0 >> 8);
+    block[2] = static_cast<unsigned char>(color_1 & 0xff);
+    block[3] = static_cast<unsigned char>(color_1 >> 8);
+    for(int i=0; i<4; ++i)
+    {
+        block[4+i] = static_cast<unsigned char>((indices >> (8*i)) & 0xff);
+    }
+}
+
+// Encode the colour part of a block, when punchThroughAlpha is set texels with alpha below 128 use the transparent entry of the three colour mode.
+void compressColorBlock(const unsigned char texels[64], bool punchThroughAlpha, bool highQuality, unsigned char* block)
+{
+    bool transparent[16];
+    bool anyTransparent = false;
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    unsigned int numOpaque = 0;
+    for(int i=0; i<16; ++i)
+    {
+        transparent[i] = punchThroughAlpha && texels[i*4+3]<128;
+        if (transparent[i])
+        {
+            anyTransparent = true;
+            continue;
+        }
+        for(int c=0; c<3; ++c) mean[c] += texels[i*4+c];
+        ++numOpaque;
+    }
+
+    if (numOpaque==0)
+    {
+        writeColorBlock(0, 0, 0xffffffff, block);
+        return;
+    }
+
+    for(int c=0; c<3; ++c) mean[c] /= static_cast<float>(numOpaque);
+
+    // principal axis of the colours by power iteration on their covariance matrix
+    float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for(int i=0; i<16; ++i)
+    {
+        if (transparent[i]) continue;
+        float r = texels[i*4]-mean[0], g = texels[i*4+1]-mean[1], b = texels[i*4+2]-mean[2];
+        covariance[0] += r*r; covariance[1] += r*g; covariance[2] += r*b;
+        covariance[3] += g*g; covariance[4] += g*b; covariance[5] += b*b;
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for(int iteration=0; iteration<(highQuality ? 8 : 4); ++iteration)
+    {
+        float x = covariance[0]*axis[0] + covariance[1]*axis[1] + covariance[2]*axis[2];
+        float y = covariance[1]*axis[0] + covariance[3]*axis[1] + covariance[4]*axis[2];
+        float z = covariance[2]*axis[0] + covariance[4]*axis[1] + covariance[5]*axis[2];
+        float length = osg::maximum(osg::absolute(x), osg::maximum(osg::absolute(y), osg::absolute(z)));
+        if (length<=0.0f) break;
+        axis[0] = x/length; axis[1] = y/length; axis[2] = z/length;
+    }
+
+    int minTexel = -1, maxTexel = -1;
+    float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+    for(int i=0; i<16; ++i)
+    {
+        if (transparent[i]) continue;
+        float projection = texels[i*4]*axis[0] + texels[i*4+1]*axis[1] + texels[i*4+2]*axis[2];
+        if (projection<minProjection) { minProjection = projection; minTexel = i; }
+        if (projection>maxProjection) { maxProjection = projection; maxTexel = i; }
+    }
+
+    // inset the end points slightly as the extreme texels are rarely worth representing exactly
+    float minColor[3], maxColor[3];
+    for(int c=0; c<3; ++c)
+    {
+        float inset = (static_cast<float>(texels[maxTexel*4+c])-static_cast<float>(texels[minTexel*4+c]))/16.0f;
+        minColor[c] = texels[minTexel*4+c]+inset;
+        maxColor[c] = texels[maxTexel*4+c]-inset;
+    }
+
+    unsigned short color_0, color_1;
+    unsigned int indices;
+    unsigned int error = fitColorEndPoints(texels, transparent, anyTransparent,
+                                           packColor565(maxColor[0], maxColor[1], maxColor[2]),
+                                           packColor565(minColor[0], minColor[1], minColor[2]),
+                                           color_0, color_1, indices);
+
+    if (highQuality && error>0)
+    {
+        // least squares fit of the end points to the chosen indices, kept only if it reduces the error
+        static const float s_fourColorWeights[4] = { 1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f };
+        static const float s_threeColorWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+
+        bool fourColors = color_0>color_1;
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+        for(int i=0; i<16; ++i)
+        {
+            unsigned int index = (indices>>(2*i)) & 0x3;
+            if (transparent[i] || (!fourColors && index==3)) continue;
+
+            float alpha = fourColors ? s_fourColorWeights[index] : s_threeColorWeights[index];
+            float beta = 1.0f-alpha;
+            aa += alpha*alpha; ab += alpha*beta; bb += beta*beta;
+            for(int c=0; c<3; ++c)
+            {
+                ax[c] += alpha*texels[i*4+c];
+                bx[c] += beta*texels[i*4+c];
+            }
+        }
+
+        float determinant = aa*bb - ab*ab;
+        if (osg::absolute(determinant)>1e-6f)
+        {
+            float endPoint0[3], endPoint1[3];
+            for(int c=0; c<3; ++c)
+            {
+                endPoint0[c] = (ax[c]*bb - bx[c]*ab)/determinant;
+                endPoint1[c] = (bx[c]*aa - ax[c]*ab)/determinant;
+            }
+
+            unsigned short refined_0, refined_1;
+            unsigned int refinedIndices;
+            unsigned int refinedError = fitColorEndPoints(texels, transparent, anyTransparent,
+                                                          packColor565(endPoint0[0], endPoint0[1], endPoint0[2]),
+                                                          packColor565(endPoint1[0], endPoint1[1], endPoint1[2]),
+                                                          refined_0, refined_1, refinedIndices);
+            if (refinedError<error)
+            {
+                color_0 = refined_0;
+                color_1 = refined_1;
+                indices = refinedIndices;
+            }
+        }
+    }
+
+    writeColorBlock(color_0, color_1, indices, block);
+}
+
+unsigned int fitAlphaIndices(const unsigned char values[16], const int palette[8], dxtc_int64& indices)
+{
+    unsigned int error = 0;
+    indices = 0;
+    for(int i=0; i<16; ++i)
+    {
+        unsigned int index = 0;
+        int bestDistance = INT_MAX;
+        for(unsigned int p=0; p<8; ++p)
+        {
+            int distance = (values[i]-palette[p])*(values[i]-palette[p]);
+            if (distance<bestDistance)
+            {
+                bestDistance = distance;
+                index = p;
+            }
+        }
+        error += bestDistance;
+        indices |= static_cast<dxtc_int64>(index)<<(3*i);
+    }
+    return error;
+}
+
+// Encode a block of single channel values, as used for DXT5 alpha and RGTC.
+void compressAlphaBlock(const unsigned char values[16], bool highQuality, unsigned char* block)
+{
+    int minValue = 255, maxValue = 0;
+    int minInner = 255, maxInner = 0;
+    for(int i=0; i<16; ++i)
+    {
+        minValue = osg::minimum(minValue, static_cast<int>(values[i]));
+        maxValue = osg::maximum(maxValue, static_cast<int>(values[i]));
+        if (values[i]!=0 && values[i]!=255)
+        {
+            minInner = osg::minimum(minInner, static_cast<int>(values[i]));
+            maxInner = osg::maximum(maxInner, static_cast<int>(values[i]));
+        }
+    }
+
+    int alpha_0 = maxValue, alpha_1 = minValue;
+    dxtc_int64 indices = 0;
+    if (maxValue>minValue)
+    {
+        // eight value mode
+        int palette[8];
+        palette[0] = alpha_0;
+        palette[1] = alpha_1;
+        for(int p=2; p<8; ++p) palette[p] = (alpha_0*(8-p) + alpha_1*(p-1) + 3)/7;
+        unsigned int error = fitAlphaIndices(values, palette, indices);
+
+        // six value mode with explicit 0 and 255, better for blocks mixing the extremes with intermediate values
+        if (highQuality && error>0 && minInner<=maxInner)
+        {
+            int palette6[8];
+            palette6[0] = minInner;
+            palette6[1] = maxInner;
+            for(int p=2; p<6; ++p) palette6[p] = (minInner*(6-p) + maxInner*(p-1) + 2)/5;
+            palette6[6] = 0;
+            palette6[7] = 255;
+
+            dxtc_int64 indices6;
+            if (fitAlphaIndices(values, palette6, indices6)<error)
+            {
+                alpha_0 = minInner;
+                alpha_1 = maxInner;
+                indices = indices6;
+            }
+        }
+    }
+
+    block[0] = static_cast<unsigned char>(alpha_0);
+    block[1] = static_cast<unsigned char>(alpha_1);
+    for(int i=0; i<6; ++i)
+    {
+        block[2+i] = static_cast<unsigned char>((indices >> (8*i)) & 0xff);
+    }
+}
+
+inline void extractChannel(const unsigned char texels[64], unsigned int channel, unsigned char values[16])
+{
+    for(int i=0; i<16; ++i) values[i] = texels[i*4+channel];
+}
+
+}
+
+void compressBlockDXT1(const unsigned char texels[64], bool punchThroughAlpha, bool highQuality, unsigned char block[8])
+{
+    compressColorBlock(texels, punchThroughAlpha, highQuality, block);
+}
+
+void compressBlockDXT3(const unsigned char texels[64], bool highQuality, unsigned char block[16])
+{
+    for(int i=0; i<8; ++i)
+    {
+        unsigned int alpha_0 = (texels[(2*i)*4+3]*15+127)/255;
+        unsigned int alpha_1 = (texels[(2*i+1)*4+3]*15+127)/255;
+        block[i] = static_cast<unsigned char>(alpha_0 | (alpha_1<<4));
+    }
+    compressColorBlock(texels, false, highQuality, block+8);
+}
+
+void compressBlockDXT5(const unsigned char texels[64], bool highQuality, unsigned char block[16])
+{
+    unsigned char values[16];
+    extractChannel(texels, 3, values);
+    compressAlphaBlock(values, highQuality, block);
+    compressColorBlock(texels, false, highQuality, block+8);
+}
+
+void compressBlockRGTC1(const unsigned char texels[64], bool highQuality, unsigned char block[8])
+{
+    unsigned char values[16];
+    extractChannel(texels, 0, values);
+    compressAlphaBlock(values, highQuality, block);
+}
+
+void compressBlockRGTC2(const unsigned char texels[64], bool highQuality, unsigned char block[16])
+{
+    unsigned char values[16];
+    extractChannel(texels, 0, values);
+    compressAlphaBlock(values, highQuality, block);
+    extractChannel(texels, 1, values);
+    compressAlphaBlock(values, highQuality, block+8);
+}
+
 } // namespace dxtc_tool
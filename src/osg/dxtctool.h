@@ -91,6 +91,15 @@ bool CompressedImageGetColor(unsigned char color[4], unsigned int s, unsigned in
 void compressedBlockOrientationConversion(const GLenum format, const unsigned char *src_block, unsigned char *dst_block, const osg::Vec3i& srcOrigin, const osg::Vec3i& rowDelta, const osg::Vec3i& columnDelta);
 
 void compressedBlockStripAlhpa(const GLenum format, const unsigned char *src_block, unsigned char *dst_block);
+
+// Encode a 4x4 block of RGBA texels, stored row by row, into a single compressed block. With punchThroughAlpha,
+// DXT1 texels with alpha below 128 are made transparent, highQuality refines the end points chosen for each block.
+void compressBlockDXT1(const unsigned char texels[64], bool punchThroughAlpha, bool highQuality, unsigned char block[8]);
+void compressBlockDXT3(const unsigned char texels[64], bool highQuality, unsigned char block[16]);
+void compressBlockDXT5(const unsigned char texels[64], bool highQuality, unsigned char block[16]);
+// RGTC1 encodes the red channel, RGTC2 the red and green channels.
+void compressBlockRGTC1(const unsigned char texels[64], bool highQuality, unsigned char block[8]);
+void compressBlockRGTC2(const unsigned char texels[64], bool highQuality, unsigned char block[16]);
 // Class holding reference to DXTC image pixels
 class dxtc_pixels
 {
@@ -19,18 +19,24 @@
 #include <osgAnimation/BoneMapVisitor>
 #include <osgAnimation/RigGeometry>
 
+#include <osg/TaskScheduler>
+
 #include <algorithm>
 
 using namespace osgAnimation;
 
-RigTransformSoftware::RigTransformSoftware()
+RigTransformSoftware::RigTransformSoftware():
+    _needInit(true),
+    _skinningMethod(LINEAR_BLEND),
+    _numThreads(1)
 {
-    _needInit = true;
 }
 
 RigTransformSoftware::RigTransformSoftware(const RigTransformSoftware& rts,const osg::CopyOp& copyop):
     RigTransform(rts, copyop),
     _needInit(rts._needInit),
+    _skinningMethod(rts._skinningMethod),
+    _numThreads(rts._numThreads),
     _invalidInfluence(rts._invalidInfluence)
 {
 
@@ -155,7 +161,8 @@ bool RigTransformSoftware::init(RigGeometry&rig)
     VertexInfluenceMap & vertexInfluenceMap = *rig.getInfluenceMap();
 
     ///create local bonemap
-    std::vector<Bone*> localid2bone;
+    BoneList& localid2bone = _bones;
+    localid2bone.clear();
     localid2bone.reserve(vertexInfluenceMap.size());
     for (osgAnimation::VertexInfluenceMap::const_iterator perBoneinfit = vertexInfluenceMap.begin();
             perBoneinfit != vertexInfluenceMap.end();
@@ -190,7 +197,7 @@ bool RigTransformSoftware::init(RigGeometry&rig)
         VertexGroup& uniq = *itvg;
         for(BonePtrWeightList::iterator bwit = uniq.getBoneWeights().begin(); bwit != uniq.getBoneWeights().end(); )
         {
-            Bone * b = localid2bone[bwit->getBoneID()];
+            Bone * b = localid2bone[bwit->getBoneID()].get();
             if(!b)
                 bwit = uniq.getBoneWeights().erase(bwit);
             else
@@ -233,12 +240,189 @@ void RigTransformSoftware::operator()(RigGeometry& geom)
 {
     if (_needInit && !init(geom)) return;
 
+    skin(geom);
+}
+
+namespace
+{
+    // Hamilton product of two quaternions stored as x, y, z, w
+    inline void multiplyQuaternions(const float* a, const float* b, float* result)
+    {
+        result[0] = a[3]*b[0] + a[0]*b[3] + a[1]*b[2] - a[2]*b[1];
+        result[1] = a[3]*b[1] - a[0]*b[2] + a[1]*b[3] + a[2]*b[0];
+        result[2] = a[3]*b[2] + a[0]*b[1] - a[1]*b[0] + a[2]*b[3];
+        result[3] = a[3]*b[3] - a[0]*b[0] - a[1]*b[1] - a[2]*b[2];
+    }
+
+    // Smallest number of vertices worth handing to another thread, smaller rigs are skinned on the calling thread.
+    const unsigned int MIN_NUM_VERTICES_PER_THREAD = 8192;
+}
+
+void RigTransformSoftware::computeBoneTransforms(const osg::Matrix& transform, const osg::Matrix& invTransform)
+{
+    _boneMatrices.resize(_bones.size());
+    if (_skinningMethod==DUAL_QUATERNION) _boneDualQuaternions.resize(_bones.size());
+
+    for(unsigned int i=0; i<_bones.size(); ++i)
+    {
+        SkinningMatrix& result = _boneMatrices[i];
+        const Bone* bone = _bones[i].get();
+        if (!bone)
+        {
+            // bones that weren't found in the skeleton, or have since been removed, contribute nothing
+            std::fill(result.m, result.m+12, 0.0f);
+            if (_skinningMethod==DUAL_QUATERNION) std::fill(_boneDualQuaternions[i].q, _boneDualQuaternions[i].q+8, 0.0f);
+            continue;
+        }
+
+        // fold the geometry to skeleton transforms into each bone, as blending is linear this gives the same result as applying them to every blended matrix
+        osg::Matrix matrix = transform * bone->getInvBindMatrixInSkeletonSpace() * bone->getMatrixInSkeletonSpace() * invTransform;
+        for(unsigned int row=0; row<4; ++row)
+        {
+            result.m[row*3+0] = static_cast<float>(matrix(row,0));
+            result.m[row*3+1] = static_cast<float>(matrix(row,1));
+            result.m[row*3+2] = static_cast<float>(matrix(row,2));
+        }
+
+        if (_skinningMethod==DUAL_QUATERNION)
+        {
+            float* dq = _boneDualQuaternions[i].q;
+            osg::Quat rotation = matrix.getRotate();
+            dq[0] = static_cast<float>(rotation.x());
+            dq[1] = static_cast<float>(rotation.y());
+            dq[2] = static_cast<float>(rotation.z());
+            dq[3] = static_cast<float>(rotation.w());
+
+            float translation[4] = { result.m[9]*0.5f, result.m[10]*0.5f, result.m[11]*0.5f, 0.0f };
+            multiplyQuaternions(translation, dq, dq+4);
+        }
+    }
+}
+
+void RigTransformSoftware::computeVertexGroupMatrix(const VertexGroup& group, SkinningMatrix& result) const
+{
+    const BonePtrWeightList& boneWeights = group.getBoneWeights();
+    if (boneWeights.empty())
+    {
+        static const float identity[12] = { 1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f, 0.0f };
+        std::copy(identity, identity+12, result.m);
+        return;
+    }
+
+    if (_skinningMethod==LINEAR_BLEND)
+    {
+        std::fill(result.m, result.m+12, 0.0f);
+        for(BonePtrWeightList::const_iterator bwit=boneWeights.begin(); bwit!=boneWeights.end(); ++bwit)
+        {
+            const float* matrix = _boneMatrices[bwit->getBoneID()].m;
+            float weight = bwit->getWeight();
+            for(unsigned int i=0; i<12; ++i) result.m[i] += matrix[i] * weight;
+        }
+        return;
+    }
+
+    // blend the dual quaternions, flipping those in the opposite hemisphere to the first so the blend takes the short way round
+    float blend[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    const float* pivot = _boneDualQuaternions[boneWeights.front().getBoneID()].q;
+    for(BonePtrWeightList::const_iterator bwit=boneWeights.begin(); bwit!=boneWeights.end(); ++bwit)
+    {
+        const float* dq = _boneDualQuaternions[bwit->getBoneID()].q;
+        float weight = bwit->getWeight();
+        if (dq[0]*pivot[0] + dq[1]*pivot[1] + dq[2]*pivot[2] + dq[3]*pivot[3] < 0.0f) weight = -weight;
+        for(unsigned int i=0; i<8; ++i) blend[i] += dq[i] * weight;
+    }
+
+    float length = sqrtf(blend[0]*blend[0] + blend[1]*blend[1] + blend[2]*blend[2] + blend[3]*blend[3]);
+    if (length<1e-6f)
+    {
+        std::fill(result.m, result.m+12, 0.0f);
+        return;
+    }
+    for(unsigned int i=0; i<8; ++i) blend[i] /= length;
+
+    const float x = blend[0], y = blend[1], z = blend[2], w = blend[3];
+    result.m[0] = 1.0f - 2.0f*(y*y + z*z);
+    result.m[1] = 2.0f*(x*y + w*z);
+    result.m[2] = 2.0f*(x*z - w*y);
+    result.m[3] = 2.0f*(x*y - w*z);
+    result.m[4] = 1.0f - 2.0f*(x*x + z*z);
+    result.m[5] = 2.0f*(y*z + w*x);
+    result.m[6] = 2.0f*(x*z + w*y);
+    result.m[7] = 2.0f*(y*z - w*x);
+    result.m[8] = 1.0f - 2.0f*(x*x + y*y);
+
+    // translation = 2 * dual * conjugate(rotation)
+    float conjugate[4] = { -x, -y, -z, w };
+    float translation[4];
+    multiplyQuaternions(blend+4, conjugate, translation);
+    result.m[9] = translation[0]*2.0f;
+    result.m[10] = translation[1]*2.0f;
+    result.m[11] = translation[2]*2.0f;
+}
+
+void RigTransformSoftware::skinVertexGroup(const VertexGroup& group, const osg::Vec3* positionSrc, osg::Vec3* positionDst, const osg::Vec3* normalSrc, osg::Vec3* normalDst) const
+{
+    SkinningMatrix matrix;
+    computeVertexGroupMatrix(group, matrix);
+    const float* m = matrix.m;
+
+    const IndexList& vertices = group.getVertices();
+    for(IndexList::const_iterator vertIDit=vertices.begin(); vertIDit!=vertices.end(); ++vertIDit)
+    {
+        const unsigned int index = *vertIDit;
+
+        const osg::Vec3& p = positionSrc[index];
+        positionDst[index].set(p.x()*m[0] + p.y()*m[3] + p.z()*m[6] + m[9],
+                               p.x()*m[1] + p.y()*m[4] + p.z()*m[7] + m[10],
+                               p.x()*m[2] + p.y()*m[5] + p.z()*m[8] + m[11]);
+
+        if (normalSrc)
+        {
+            const osg::Vec3& n = normalSrc[index];
+            normalDst[index].set(n.x()*m[0] + n.y()*m[3] + n.z()*m[6],
+                                 n.x()*m[1] + n.y()*m[4] + n.z()*m[7],
+                                 n.x()*m[2] + n.y()*m[5] + n.z()*m[8]);
+        }
+    }
+}
+
+class RigTransformSoftware::SkinVertexGroupsFunctor : public osg::TaskScheduler::ParallelForFunctor
+{
+public:
+    SkinVertexGroupsFunctor(const RigTransformSoftware& rts, const osg::Vec3* positionSrc, osg::Vec3* positionDst, const osg::Vec3* normalSrc, osg::Vec3* normalDst):
+        _rts(rts),
+        _positionSrc(positionSrc),
+        _positionDst(positionDst),
+        _normalSrc(normalSrc),
+        _normalDst(normalDst) {}
+
+    virtual void operator() (unsigned int begin, unsigned int end)
+    {
+        const VertexGroupList& groups = _rts._uniqVertexGroupList;
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            _rts.skinVertexGroup(groups[i], _positionSrc, _positionDst, _normalSrc, _normalDst);
+        }
+    }
+
+protected:
+    const RigTransformSoftware&     _rts;
+    const osg::Vec3*                _positionSrc;
+    osg::Vec3*                      _positionDst;
+    const osg::Vec3*                _normalSrc;
+    osg::Vec3*                      _normalDst;
+};
+
+void RigTransformSoftware::skin(RigGeometry& geom)
+{
+    if (_needInit && !init(geom)) return;
+
     if (!geom.getSourceGeometry())
     {
         OSG_WARN << this << " RigTransformSoftware no source geometry found on RigGeometry" << std::endl;
         return;
     }
-    
+
     osg::Geometry& source = *geom.getSourceGeometry();
     osg::Geometry& destination = geom;
 
@@ -246,21 +430,20 @@ void RigTransformSoftware::operator()(RigGeometry& geom)
     osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(destination.getVertexArray());
     osg::Vec3Array* normalSrc = dynamic_cast<osg::Vec3Array*>(source.getNormalArray());
     osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(destination.getNormalArray());
+    if (!normalDst) normalSrc = 0;
 
+    // the bone matrices are computed once and shared by all the vertex groups, which then transform their vertices and normals in the same pass
+    computeBoneTransforms(geom.getMatrixFromSkeletonToGeometry(), geom.getInvMatrixFromSkeletonToGeometry());
 
-    compute<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                       geom.getInvMatrixFromSkeletonToGeometry(),
-                       &positionSrc->front(),
-                       &positionDst->front());    
-    positionDst->dirty();
+    SkinVertexGroupsFunctor functor(*this,
+        &positionSrc->front(), &positionDst->front(),
+        normalSrc ? &normalSrc->front() : 0, normalSrc ? &normalDst->front() : 0);
 
-    if (normalSrc )
-    {
-        computeNormal<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                                 geom.getInvMatrixFromSkeletonToGeometry(),
-                                 &normalSrc->front(),
-                                 &normalDst->front());
-        normalDst->dirty();
-    }
+    // the vertex groups vary in size, so the number of threads is limited by the number of vertices rather than groups
+    osg::TaskScheduler* scheduler = osg::TaskScheduler::instance().get();
+    unsigned int numThreads = scheduler->computeNumThreads(static_cast<unsigned int>(positionSrc->size()), MIN_NUM_VERTICES_PER_THREAD, _numThreads);
+    scheduler->parallelFor(static_cast<unsigned int>(_uniqVertexGroupList.size()), functor, numThreads);
 
+    positionDst->dirty();
+    if (normalSrc) normalDst->dirty();
 }
@@ -0,0 +1,111 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgAnimation/SoftwareSkinningBatch>
+#include <osgAnimation/RigTransformSoftware>
+#include <osgAnimation/RigGeometry>
+#include <osg/NodeVisitor>
+#include <osg/TaskScheduler>
+
+using namespace osgAnimation;
+
+namespace
+{
+    class SkinRigsFunctor : public osg::TaskScheduler::ParallelForFunctor
+    {
+    public:
+        typedef std::pair<RigTransformSoftware*, RigGeometry*> Rig;
+
+        SkinRigsFunctor(const std::vector<Rig>& rigs):
+            _rigs(rigs) {}
+
+        virtual void operator() (unsigned int begin, unsigned int end)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                _rigs[i].first->skin(*_rigs[i].second);
+            }
+        }
+
+    protected:
+        const std::vector<Rig>&     _rigs;
+    };
+}
+
+SoftwareSkinningBatch::SoftwareSkinningBatch(unsigned int numThreads):
+    _numThreads(numThreads)
+{
+}
+
+SoftwareSkinningBatch::SoftwareSkinningBatch(const SoftwareSkinningBatch& batch, const osg::CopyOp& copyop):
+    osg::Object(batch, copyop),
+    osg::Callback(batch, copyop),
+    osg::NodeCallback(batch, copyop),
+    _numThreads(batch._numThreads)
+{
+}
+
+SoftwareSkinningBatch* SoftwareSkinningBatch::find(osg::NodeVisitor* nv)
+{
+    if (!nv) return 0;
+
+    // batches may be nested, in which case the rigs go to the innermost one
+    const osg::NodePath& nodePath = nv->getNodePath();
+    for(osg::NodePath::const_reverse_iterator itr = nodePath.rbegin();
+        itr != nodePath.rend();
+        ++itr)
+    {
+        for(osg::Callback* callback = (*itr)->getUpdateCallback(); callback; callback = callback->getNestedCallback())
+        {
+            SoftwareSkinningBatch* batch = dynamic_cast<SoftwareSkinningBatch*>(callback);
+            if (batch) return batch;
+        }
+    }
+    return 0;
+}
+
+void SoftwareSkinningBatch::add(RigGeometry* rig)
+{
+    RigTransformSoftware* transform = dynamic_cast<RigTransformSoftware*>(rig->getRigTransformImplementation());
+    if (!transform)
+    {
+        rig->update();
+        return;
+    }
+
+    // a rig shared between several parents is updated once per parent path, skinning the copies concurrently would race
+    if (!_queuedRigs.insert(rig).second) return;
+
+    // the rig is initialized here, while the bones are updated, as only the skinning itself is safe to run concurrently
+    if (transform->_needInit && !transform->init(*rig)) return;
+
+    _rigs.push_back(Rig(transform, rig));
+}
+
+void SoftwareSkinningBatch::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    traverse(node, nv);
+
+    skinRigs();
+}
+
+void SoftwareSkinningBatch::skinRigs()
+{
+    if (_rigs.empty()) return;
+
+    SkinRigsFunctor functor(_rigs);
+    osg::TaskScheduler::instance()->parallelFor(static_cast<unsigned int>(_rigs.size()), functor, _numThreads);
+
+    _rigs.clear();
+    _queuedRigs.clear();
+}
@@ -0,0 +1,469 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/AsyncReader>
+#include <osgDB/Registry>
+
+#include <osg/ApplicationUsage>
+#include <osg/Notify>
+#include <osg/Timer>
+
+#include <OpenThreads/ScopedLock>
+
+#include <stdlib.h>
+
+using namespace osgDB;
+using namespace OpenThreads;
+
+static osg::ApplicationUsageProxy AsyncReader_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_ASYNC_READ_THREADS <int>","Set the number of threads the AsyncReader used by osgDB::readNodeFileAsync() uses to read files.");
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ReadFuture
+//
+ReadFuture::ReadFuture(ReadType readType, const std::string& fileName, const Options* options, float priority, Callback* callback):
+    osg::Referenced(true),
+    _readType(readType),
+    _fileName(fileName),
+    _options(options),
+    _callback(callback),
+    _priority(priority),
+    _sequenceNumber(0),
+    _status(PENDING),
+    _readTime(0.0)
+{
+}
+
+ReadFuture::~ReadFuture()
+{
+}
+
+void ReadFuture::setPriority(float priority)
+{
+    ScopedLock<Mutex> lock(_mutex);
+    _priority = priority;
+}
+
+float ReadFuture::getPriority() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _priority;
+}
+
+ReadFuture::Status ReadFuture::getStatus() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _status;
+}
+
+double ReadFuture::getReadTime() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _readTime;
+}
+
+bool ReadFuture::done() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _status==COMPLETED || _status==CANCELLED;
+}
+
+bool ReadFuture::cancel()
+{
+    ScopedLock<Mutex> lock(_mutex);
+    if (_status==COMPLETED) return false;
+
+    _status = CANCELLED;
+    _condition.broadcast();
+    return true;
+}
+
+void ReadFuture::wait()
+{
+    ScopedLock<Mutex> lock(_mutex);
+    while(_status==PENDING || _status==RUNNING)
+    {
+        _condition.wait(&_mutex);
+    }
+}
+
+ReaderWriter::ReadResult ReadFuture::getReadResult()
+{
+    wait();
+
+    ScopedLock<Mutex> lock(_mutex);
+    if (_status==CANCELLED) return ReaderWriter::ReadResult(ReaderWriter::ReadResult::FILE_NOT_HANDLED);
+    return _result;
+}
+
+osg::ref_ptr<osg::Object> ReadFuture::getObject()
+{
+    ReaderWriter::ReadResult rr = getReadResult();
+    if (rr.validObject()) return osg::ref_ptr<osg::Object>(rr.getObject());
+    if (!rr.success() && getStatus()!=CANCELLED) OSG_WARN << "Error reading file " << _fileName << ": " << rr.statusMessage() << std::endl;
+    return 0;
+}
+
+osg::ref_ptr<osg::Image> ReadFuture::getImage()
+{
+    ReaderWriter::ReadResult rr = getReadResult();
+    if (rr.validImage()) return osg::ref_ptr<osg::Image>(rr.getImage());
+    if (!rr.success() && getStatus()!=CANCELLED) OSG_WARN << "Error reading file " << _fileName << ": " << rr.statusMessage() << std::endl;
+    return 0;
+}
+
+osg::ref_ptr<osg::Node> ReadFuture::getNode()
+{
+    ReaderWriter::ReadResult rr = getReadResult();
+    if (rr.validNode()) return osg::ref_ptr<osg::Node>(rr.getNode());
+    if (!rr.success() && getStatus()!=CANCELLED) OSG_WARN << "Error reading file " << _fileName << ": " << rr.statusMessage() << std::endl;
+    return 0;
+}
+
+bool ReadFuture::start()
+{
+    ScopedLock<Mutex> lock(_mutex);
+    if (_status!=PENDING) return false;
+
+    _status = RUNNING;
+    return true;
+}
+
+bool ReadFuture::complete(const ReaderWriter::ReadResult& result, double readTime)
+{
+    ScopedLock<Mutex> lock(_mutex);
+    if (_status==CANCELLED) return false;
+
+    _result = result;
+    _readTime = readTime;
+    _status = COMPLETED;
+    _condition.broadcast();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// AsyncReader
+//
+class AsyncReader::ReaderThread : public osg::Referenced, public OpenThreads::Thread
+{
+    public:
+
+        ReaderThread(AsyncReader* reader, unsigned int generation):
+            osg::Referenced(true),
+            _reader(reader),
+            _generation(generation) {}
+
+        const AsyncReader* getReader() const { return _reader; }
+
+        virtual void run()
+        {
+            OSG_INFO<<"AsyncReader::ReaderThread::run() "<<this<<std::endl;
+
+            osg::ref_ptr<ReadFuture> future;
+            while((future = _reader->takeNext(_generation)).valid())
+            {
+                osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+                ReaderWriter::ReadResult result = _reader->readFile(*future);
+
+                if (future->complete(result, osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())))
+                {
+                    if (future->getCallback()) future->getCallback()->readCompleted(future.get());
+                }
+                else
+                {
+                    OSG_INFO<<"AsyncReader::ReaderThread::run(), discarding cancelled read of "<<future->getFileName()<<std::endl;
+                }
+
+                future = 0;
+            }
+
+            OSG_INFO<<"AsyncReader::ReaderThread::run() done "<<this<<std::endl;
+        }
+
+    protected:
+
+        virtual ~ReaderThread() {}
+
+        AsyncReader*    _reader;
+        unsigned int    _generation;
+};
+
+static unsigned int getDefaultNumAsyncReadThreads()
+{
+    const char* str = getenv("OSG_NUM_ASYNC_READ_THREADS");
+    if (str)
+    {
+        int numThreads = atoi(str);
+        if (numThreads>0) return static_cast<unsigned int>(numThreads);
+    }
+    return 2;
+}
+
+AsyncReader::AsyncReader(unsigned int numThreads):
+    osg::Referenced(true),
+    _numThreads(numThreads>0 ? numThreads : 1),
+    _sequenceNumber(0),
+    _generation(0)
+{
+}
+
+AsyncReader::~AsyncReader()
+{
+    if (isReaderThread())
+    {
+        OSG_WARN<<"Warning: AsyncReader deleted from one of its own reader threads, the threads can not be joined."<<std::endl;
+    }
+
+    cancel();
+}
+
+osg::ref_ptr<AsyncReader>& AsyncReader::instance()
+{
+    static osg::ref_ptr<AsyncReader> s_asyncReader = new AsyncReader(getDefaultNumAsyncReadThreads());
+    return s_asyncReader;
+}
+
+void AsyncReader::setNumThreads(unsigned int numThreads)
+{
+    bool hasPendingReads = false;
+    ReaderThreads threads;
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        _numThreads = numThreads>0 ? numThreads : 1;
+        hasPendingReads = !_pending.empty();
+        retireThreadsNoLock(threads);
+    }
+
+    joinThreads(threads);
+
+    if (hasPendingReads) startThreads();
+}
+
+unsigned int AsyncReader::getNumThreads() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _numThreads;
+}
+
+osg::ref_ptr<ReadFuture> AsyncReader::read(ReadFuture::ReadType readType, const std::string& fileName, const Options* options, float priority, ReadFuture::Callback* callback)
+{
+    osg::ref_ptr<ReadFuture> future = new ReadFuture(readType, fileName, options, priority, callback);
+    add(future.get());
+    return future;
+}
+
+void AsyncReader::add(ReadFuture* future)
+{
+    if (!future) return;
+
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        future->_sequenceNumber = _sequenceNumber++;
+        _pending.push_back(future);
+        _condition.signal();
+    }
+
+    startThreads();
+}
+
+unsigned int AsyncReader::getNumPendingReads() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+
+    unsigned int numPending = 0;
+    for(ReadFutures::const_iterator itr = _pending.begin();
+        itr != _pending.end();
+        ++itr)
+    {
+        if ((*itr)->getStatus()==ReadFuture::PENDING) ++numPending;
+    }
+    return numPending;
+}
+
+void AsyncReader::cancelPendingReads()
+{
+    ReadFutures pending;
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        pending.swap(_pending);
+    }
+
+    for(ReadFutures::iterator itr = pending.begin();
+        itr != pending.end();
+        ++itr)
+    {
+        (*itr)->cancel();
+    }
+}
+
+void AsyncReader::cancel()
+{
+    stopThreads();
+    cancelPendingReads();
+}
+
+void AsyncReader::startThreads()
+{
+    ScopedLock<Mutex> lock(_mutex);
+    if (!_threads.empty()) return;
+
+    OSG_INFO<<"AsyncReader::startThreads() starting "<<_numThreads<<" threads"<<std::endl;
+
+    // the new threads only take reads while the generation is unchanged, so threads of an earlier
+    // generation that are still finishing their last read exit rather than being revived.
+    for(unsigned int i=0; i<_numThreads; ++i)
+    {
+        osg::ref_ptr<ReaderThread> thread = new ReaderThread(this, _generation);
+        thread->startThread();
+        _threads.push_back(thread);
+    }
+}
+
+void AsyncReader::stopThreads()
+{
+    ReaderThreads threads;
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        retireThreadsNoLock(threads);
+    }
+
+    joinThreads(threads);
+}
+
+void AsyncReader::retireThreadsNoLock(ReaderThreads& threads)
+{
+    threads.swap(_threads);
+    ++_generation;
+    _condition.broadcast();
+}
+
+void AsyncReader::joinThreads(ReaderThreads& threads)
+{
+    // setNumThreads() or cancel() called from a ReadFuture::Callback runs on a reader thread, which can't join
+    // itself, nor the other reader threads as they may be waiting to join it, so leave them to be joined later.
+    if (isReaderThread())
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        _retiredThreads.insert(_retiredThreads.end(), threads.begin(), threads.end());
+        return;
+    }
+
+    {
+        ScopedLock<Mutex> lock(_mutex);
+        threads.insert(threads.end(), _retiredThreads.begin(), _retiredThreads.end());
+        _retiredThreads.clear();
+    }
+
+    // threads finish the read they are on before they exit, so this waits for any running reads.
+    for(ReaderThreads::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+    }
+}
+
+bool AsyncReader::isReaderThread() const
+{
+    ReaderThread* thread = dynamic_cast<ReaderThread*>(OpenThreads::Thread::CurrentThread());
+    return thread && thread->getReader()==this;
+}
+
+osg::ref_ptr<ReadFuture> AsyncReader::takeNext(unsigned int generation)
+{
+    ScopedLock<Mutex> lock(_mutex);
+
+    while(_generation==generation)
+    {
+        // priorities may be changed while reads are queued, so the highest priority read is searched for
+        // each time rather than keeping the queue sorted.
+        removeCancelled();
+
+        ReadFutures::iterator selected = _pending.end();
+        float selectedPriority = 0.0f;
+        for(ReadFutures::iterator itr = _pending.begin();
+            itr != _pending.end();
+            ++itr)
+        {
+            float priority = (*itr)->getPriority();
+            if (selected==_pending.end() ||
+                priority>selectedPriority ||
+                (priority==selectedPriority && (*itr)->_sequenceNumber<(*selected)->_sequenceNumber))
+            {
+                selected = itr;
+                selectedPriority = priority;
+            }
+        }
+
+        if (selected!=_pending.end())
+        {
+            osg::ref_ptr<ReadFuture> future = *selected;
+            _pending.erase(selected);
+
+            // a read cancelled since removeCancelled() is simply skipped.
+            if (future->start()) return future;
+        }
+        else
+        {
+            _condition.wait(&_mutex);
+        }
+    }
+
+    return 0;
+}
+
+void AsyncReader::removeCancelled()
+{
+    ReadFutures::iterator litr = _pending.begin();
+    for(ReadFutures::iterator itr = _pending.begin();
+        itr != _pending.end();
+        ++itr)
+    {
+        if ((*itr)->getStatus()==ReadFuture::PENDING) *(litr++) = *itr;
+    }
+    _pending.erase(litr, _pending.end());
+}
+
+ReaderWriter::ReadResult AsyncReader::readFile(const ReadFuture& future)
+{
+    Registry* registry = Registry::instance();
+    switch(future.getReadType())
+    {
+        case(ReadFuture::READ_OBJECT): return registry->readObject(future.getFileName(), future.getOptions());
+        case(ReadFuture::READ_IMAGE): return registry->readImage(future.getFileName(), future.getOptions());
+        case(ReadFuture::READ_HEIGHTFIELD): return registry->readHeightField(future.getFileName(), future.getOptions());
+        case(ReadFuture::READ_NODE): return registry->readNode(future.getFileName(), future.getOptions());
+    }
+    return ReaderWriter::ReadResult(ReaderWriter::ReadResult::FILE_NOT_HANDLED);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// convenience functions
+//
+osg::ref_ptr<ReadFuture> osgDB::readObjectFileAsync(const std::string& filename, const Options* options, float priority, ReadFuture::Callback* callback)
+{
+    return AsyncReader::instance()->read(ReadFuture::READ_OBJECT, filename, options, priority, callback);
+}
+
+osg::ref_ptr<ReadFuture> osgDB::readImageFileAsync(const std::string& filename, const Options* options, float priority, ReadFuture::Callback* callback)
+{
+    return AsyncReader::instance()->read(ReadFuture::READ_IMAGE, filename, options, priority, callback);
+}
+
+osg::ref_ptr<ReadFuture> osgDB::readNodeFileAsync(const std::string& filename, const Options* options, float priority, ReadFuture::Callback* callback)
+{
+    return AsyncReader::instance()->read(ReadFuture::READ_NODE, filename, options, priority, callback);
+}
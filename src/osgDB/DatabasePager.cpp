@@ -391,6 +391,7 @@ DatabasePager::RequestQueue::~RequestQueue()
         ++itr)
     {
         invalidate(itr->get());
+        (*itr)->_requestQueue = 0;
     }
 }
 
@@ -409,32 +410,119 @@ void DatabasePager::RequestQueue::invalidate(DatabaseRequest* dr)
 }
 
 
-bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
+bool DatabasePager::RequestQueue::lowerPriority(const osg::ref_ptr<DatabaseRequest>& lhs, const osg::ref_ptr<DatabaseRequest>& rhs)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    if (lhs->_timestampQueued<rhs->_timestampQueued) return true;
+    else if (lhs->_timestampQueued>rhs->_timestampQueued) return false;
+    else return (lhs->_priorityQueued<rhs->_priorityQueued);
+}
 
-    unsigned int frameNumber = _pager->_frameNumber;
-    if (_frameNumberLastPruned != frameNumber)
+void DatabasePager::RequestQueue::makeHeapNoLock()
+{
+    for(unsigned int i=0; i<_requestList.size(); ++i)
     {
-        for(RequestQueue::RequestList::iterator citr = _requestList.begin();
-            citr != _requestList.end();
-            )
+        _requestList[i]->_queueIndex = i;
+    }
+
+    for(unsigned int i=_requestList.size()/2; i>0; --i)
+    {
+        siftDownNoLock(i-1);
+    }
+}
+
+void DatabasePager::RequestQueue::siftUpNoLock(unsigned int index)
+{
+    osg::ref_ptr<DatabaseRequest> dr = _requestList[index];
+    while(index>0)
+    {
+        unsigned int parent = (index-1)/2;
+        if (!lowerPriority(_requestList[parent], dr)) break;
+
+        _requestList[index] = _requestList[parent];
+        _requestList[index]->_queueIndex = index;
+        index = parent;
+    }
+
+    _requestList[index] = dr;
+    dr->_queueIndex = index;
+}
+
+void DatabasePager::RequestQueue::siftDownNoLock(unsigned int index)
+{
+    osg::ref_ptr<DatabaseRequest> dr = _requestList[index];
+    unsigned int size = _requestList.size();
+    for(;;)
+    {
+        unsigned int child = index*2+1;
+        if (child>=size) break;
+        if (child+1<size && lowerPriority(_requestList[child], _requestList[child+1])) ++child;
+        if (!lowerPriority(dr, _requestList[child])) break;
+
+        _requestList[index] = _requestList[child];
+        _requestList[index]->_queueIndex = index;
+        index = child;
+    }
+
+    _requestList[index] = dr;
+    dr->_queueIndex = index;
+}
+
+void DatabasePager::RequestQueue::eraseNoLock(unsigned int index)
+{
+    unsigned int last = _requestList.size()-1;
+    if (index!=last)
+    {
+        // move the last request into the gap and then up or down to where it belongs
+        _requestList[index] = _requestList[last];
+        _requestList[index]->_queueIndex = index;
+        _requestList.pop_back();
+
+        if (index>0 && lowerPriority(_requestList[(index-1)/2], _requestList[index])) siftUpNoLock(index);
+        else siftDownNoLock(index);
+    }
+    else
+    {
+        _requestList.pop_back();
+    }
+}
+
+void DatabasePager::RequestQueue::pruneNoLock(unsigned int frameNumber)
+{
+    RequestList::iterator litr = _requestList.begin();
+    for(RequestList::iterator citr = _requestList.begin();
+        citr != _requestList.end();
+        ++citr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        if ((*citr)->isRequestCurrent(frameNumber))
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
-            {
-                ++citr;
-            }
-            else
-            {
-                invalidate(citr->get());
+            (*citr)->updateQueuedKey();
+            if (litr!=citr) *litr = *citr;
+            ++litr;
+        }
+        else
+        {
+            invalidate(citr->get());
+            (*citr)->_requestQueue = 0;
 
-                OSG_INFO<<"DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty(): Pruning "<<(*citr)<<std::endl;
-                citr = _requestList.erase(citr);
-            }
+            OSG_INFO<<"DatabasePager::RequestQueue::pruneNoLock(): Pruning "<<(*citr)<<std::endl;
         }
+    }
 
-        _frameNumberLastPruned = frameNumber;
+    _requestList.erase(litr, _requestList.end());
+    makeHeapNoLock();
+
+    _frameNumberLastPruned = frameNumber;
+}
+
+bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    unsigned int frameNumber = _pager->_frameNumber;
+    if (_frameNumberLastPruned != frameNumber)
+    {
+        pruneNoLock(frameNumber);
 
         updateBlock();
     }
@@ -464,6 +552,7 @@ void DatabasePager::RequestQueue::clear()
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
         invalidate(citr->get());
+        (*citr)->_requestQueue = 0;
     }
 
     _requestList.clear();
@@ -485,30 +574,68 @@ void DatabasePager::RequestQueue::remove(DatabasePager::DatabaseRequest* databas
 {
     // OSG_NOTICE<<"DatabasePager::RequestQueue::remove(DatabaseRequest* databaseRequest)"<<std::endl;
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
-    for(RequestList::iterator citr = _requestList.begin();
-        citr != _requestList.end();
-        ++citr)
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+    if (databaseRequest->_requestQueue==this)
     {
-        if (citr->get()==databaseRequest)
-        {
-            // OSG_NOTICE<<"  done remove(DatabaseRequest* databaseRequest)"<<std::endl;
-            _requestList.erase(citr);
-            return;
-        }
+        // OSG_NOTICE<<"  done remove(DatabaseRequest* databaseRequest)"<<std::endl;
+        databaseRequest->_requestQueue = 0;
+        eraseNoLock(databaseRequest->_queueIndex);
     }
 }
 
 
 void DatabasePager::RequestQueue::addNoLock(DatabasePager::DatabaseRequest* databaseRequest)
 {
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        databaseRequest->updateQueuedKey();
+        databaseRequest->_requestQueue = this;
+    }
+
     _requestList.push_back(databaseRequest);
+    siftUpNoLock(_requestList.size()-1);
     updateBlock();
 }
 
 void DatabasePager::RequestQueue::swap(RequestList& requestList)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+    for(RequestList::iterator citr = _requestList.begin();
+        citr != _requestList.end();
+        ++citr)
+    {
+        (*citr)->_requestQueue = 0;
+    }
+
     _requestList.swap(requestList);
+
+    for(RequestList::iterator citr = _requestList.begin();
+        citr != _requestList.end();
+        ++citr)
+    {
+        (*citr)->_requestQueue = this;
+    }
+
+    makeHeapNoLock();
+}
+
+void DatabasePager::RequestQueue::renew(DatabaseRequest* databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+
+    // the request may have been taken off or moved to another queue since it was renewed
+    if (databaseRequest->_requestQueue!=this) return;
+
+    // a request renewed with a lower key keeps its old one until it reaches the top of the heap, see takeFirst()
+    if (databaseRequest->_timestampLastRequest<databaseRequest->_timestampQueued) return;
+    if (databaseRequest->_timestampLastRequest==databaseRequest->_timestampQueued &&
+        databaseRequest->_priorityLastRequest<databaseRequest->_priorityQueued) return;
+
+    databaseRequest->updateQueuedKey();
+    siftUpNoLock(databaseRequest->_queueIndex);
 }
 
 void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest)
@@ -517,42 +644,56 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
 
     if (!_requestList.empty())
     {
-        DatabasePager::SortFileRequestFunctor highPriority;
+        unsigned int frameNumber = _pager->_frameNumber;
 
-        RequestQueue::RequestList::iterator selected_itr = _requestList.end();
+        // prune the requests that have dropped out of view once per frame.
+        if (_frameNumberLastPruned != frameNumber) pruneNoLock(frameNumber);
 
-        int frameNumber = _pager->_frameNumber;
-
-        for(RequestQueue::RequestList::iterator citr = _requestList.begin();
-            citr != _requestList.end();
-            )
+        while(!_requestList.empty())
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
+            osg::ref_ptr<DatabaseRequest> dr = _requestList.front();
+
+            bool current = true;
+            bool renewed = false;
             {
-                if (selected_itr==_requestList.end() || highPriority(*citr, *selected_itr))
+                OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+                current = dr->isRequestCurrent(frameNumber);
+                if (!current)
+                {
+                    invalidate(dr.get());
+                    dr->_requestQueue = 0;
+                }
+                else if (dr->isQueuedKeyStale())
+                {
+                    dr->updateQueuedKey();
+                    renewed = true;
+                }
+                else
                 {
-                    selected_itr = citr;
+                    dr->_requestQueue = 0;
                 }
+            }
 
-                ++citr;
+            if (!current)
+            {
+                OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<dr.get()<<std::endl;
+                eraseNoLock(0);
+            }
+            else if (renewed)
+            {
+                // renewed with a lower key since it was keyed, so move it down to its new place and look again.
+                siftDownNoLock(0);
             }
             else
             {
-                invalidate(citr->get());
-
-                OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<(*citr)<<std::endl;
-                citr = _requestList.erase(citr);
+                databaseRequest = dr;
+                eraseNoLock(0);
+                break;
             }
-
         }
 
-        _frameNumberLastPruned = frameNumber;
-
-        if (selected_itr != _requestList.end())
+        if (databaseRequest.valid())
         {
-            databaseRequest = *selected_itr;
-            _requestList.erase(selected_itr);
             OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
         }
         else
@@ -590,7 +731,11 @@ DatabasePager::DatabaseThread::DatabaseThread(DatabasePager* pager, Mode mode, c
     _active(false),
     _pager(pager),
     _mode(mode),
-    _name(name)
+    _name(name),
+    _numRequestsCompleted(0),
+    _numRequestsCancelled(0),
+    _numRequestsTimed(0),
+    _totalTimeLoading(0.0)
 {
 }
 
@@ -599,7 +744,11 @@ DatabasePager::DatabaseThread::DatabaseThread(const DatabaseThread& dt, Database
     _active(false),
     _pager(pager),
     _mode(dt._mode),
-    _name(dt._name)
+    _name(dt._name),
+    _numRequestsCompleted(0),
+    _numRequestsCancelled(0),
+    _numRequestsTimed(0),
+    _totalTimeLoading(0.0)
 {
 }
 
@@ -608,6 +757,28 @@ DatabasePager::DatabaseThread::~DatabaseThread()
     cancel();
 }
 
+double DatabasePager::DatabaseThread::getTotalTimeLoading() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statsMutex);
+    return _totalTimeLoading;
+}
+
+double DatabasePager::DatabaseThread::getAverageTimeLoading() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statsMutex);
+    return (_numRequestsTimed > 0) ? _totalTimeLoading/static_cast<double>(_numRequestsTimed) : 0.0;
+}
+
+void DatabasePager::DatabaseThread::resetStats()
+{
+    _numRequestsCompleted.exchange(0);
+    _numRequestsCancelled.exchange(0);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statsMutex);
+    _numRequestsTimed = 0;
+    _totalTimeLoading = 0.0;
+}
+
 int DatabasePager::DatabaseThread::cancel()
 {
     int result = 0;
@@ -840,6 +1011,7 @@ void DatabasePager::DatabaseThread::run()
             }
             else
             {
+                ++_numRequestsCancelled;
                 databaseRequest = 0;
             }
         }
@@ -851,14 +1023,15 @@ void DatabasePager::DatabaseThread::run()
             // load the data, note safe to write to the databaseRequest since once
             // it is created this thread is the only one to write to the _loadedModel pointer.
             //OSG_NOTICE<<"In DatabasePager thread readNodeFile("<<databaseRequest->_fileName<<")"<<std::endl;
-            //osg::Timer_t before = osg::Timer::instance()->tick();
-
+            osg::Timer_t before = osg::Timer::instance()->tick();
 
             // assume that readNode is thread safe...
             ReaderWriter::ReadResult rr = readFromFileCache ?
                         fileCache->readNode(fileName, dr_loadOptions.get(), false) :
                         Registry::instance()->readNode(fileName, dr_loadOptions.get(), false);
 
+            double timeLoading = osg::Timer::instance()->delta_s(before, osg::Timer::instance()->tick());
+
             osg::ref_ptr<osg::Node> loadedModel;
             if (rr.validNode()) loadedModel = rr.getNode();
             if (!rr.success()) OSG_WARN<<"Error in reading file "<<fileName<<" : "<<rr.statusMessage() << std::endl;
@@ -877,6 +1050,7 @@ void DatabasePager::DatabaseThread::run()
                 {
                     OSG_INFO<<_name<<": Warning DatabaseRquest no longer required."<<std::endl;
                     loadedModel = 0;
+                    ++_numRequestsCancelled;
                 }
             }
 
@@ -884,6 +1058,14 @@ void DatabasePager::DatabaseThread::run()
 
             if (loadedModel.valid())
             {
+                ++_numRequestsCompleted;
+
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> statsLock(_statsMutex);
+                    ++_numRequestsTimed;
+                    _totalTimeLoading += timeLoading;
+                }
+
                 loadedModel->getBound();
 
                 bool loadedObjectsNeedToBeCompiled = false;
@@ -1330,6 +1512,13 @@ void DatabasePager::resetStats()
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+
+    for(DatabaseThreadList::iterator dt_itr = _databaseThreads.begin();
+        dt_itr != _databaseThreads.end();
+        ++dt_itr)
+    {
+        (*dt_itr)->resetStats();
+    }
 }
 
 bool DatabasePager::getRequestsInProgress() const
@@ -1415,6 +1604,7 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
     {
         DatabaseRequest* databaseRequest = dynamic_cast<DatabaseRequest*>(databaseRequestRef.get());
         bool requeue = false;
+        RequestQueue* requestQueue = 0;
         if (databaseRequest)
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
@@ -1433,6 +1623,7 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                 databaseRequest->_timestampLastRequest = timestamp;
                 databaseRequest->_priorityLastRequest = priority;
                 ++(databaseRequest->_numOfRequests);
+                requestQueue = databaseRequest->_requestQueue;
 
                 foundEntry = true;
 
@@ -1454,6 +1645,8 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
         }
         if (requeue)
             _fileRequestQueue->add(databaseRequest);
+        else if (requestQueue)
+            requestQueue->renew(databaseRequest);
     }
 
     if (!foundEntry)
@@ -0,0 +1,159 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/ImageDestination>
+
+#include <OpenThreads/ScopedLock>
+
+using namespace osgDB;
+
+ImageDestination::ImageDestination(unsigned int maxNumPooledImages):
+    Referenced(true),
+    _maxNumPooledImages(maxNumPooledImages),
+    _numFramesBeforeReuse(1),
+    _frameNumber(UNRELEASED)
+{
+}
+
+ImageDestination::~ImageDestination()
+{
+}
+
+void ImageDestination::setMaxNumPooledImages(unsigned int maxNumPooledImages)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _maxNumPooledImages = maxNumPooledImages;
+}
+
+void ImageDestination::setNumFramesBeforeReuse(unsigned int numFrames)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _numFramesBeforeReuse = numFrames;
+}
+
+void ImageDestination::setFrameNumber(unsigned int frameNumber)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _frameNumber = frameNumber;
+
+    for(Images::iterator itr = _images.begin();
+        itr != _images.end();
+        ++itr)
+    {
+        if (itr->_image->referenceCount()>1) itr->_frameNumberReleased = UNRELEASED;
+        else if (itr->_frameNumberReleased==UNRELEASED) itr->_frameNumberReleased = frameNumber;
+    }
+}
+
+bool ImageDestination::isReusable(const PooledImage& pooledImage) const
+{
+    if (pooledImage._image->referenceCount()>1) return false;
+
+    // without frames to count there is nothing to wait for.
+    if (_frameNumber==UNRELEASED) return true;
+
+    return pooledImage._frameNumberReleased!=UNRELEASED &&
+           _frameNumber-pooledImage._frameNumberReleased>=_numFramesBeforeReuse;
+}
+
+void ImageDestination::addImage(osg::Image* image)
+{
+    if (!image) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _images.push_back(PooledImage(image));
+}
+
+unsigned int ImageDestination::getNumPooledImages() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return _images.size();
+}
+
+void ImageDestination::clear()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _images.clear();
+}
+
+osg::ref_ptr<osg::Image> ImageDestination::allocateImage(int s, int t, int r,
+                                                         GLint internalTextureFormat,
+                                                         GLenum pixelFormat, GLenum type,
+                                                         int packing)
+{
+    osg::ref_ptr<osg::Image> image;
+    bool recycled = false;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        // look for a pooled image that nothing else references, preferring one that already has the
+        // required amount of storage as osg::Image::allocateImage() will then keep its data.
+        unsigned int requiredSize = osg::Image::computeRowWidthInBytes(s, pixelFormat, type, packing)*t*r;
+        Images::iterator unused = _images.end();
+        for(Images::iterator itr = _images.begin();
+            itr != _images.end();
+            ++itr)
+        {
+            if (isReusable(*itr))
+            {
+                if (unused==_images.end()) unused = itr;
+                if (itr->_image->isDataContiguous() && itr->_image->getTotalSizeInBytes()==requiredSize)
+                {
+                    unused = itr;
+                    break;
+                }
+            }
+        }
+
+        // taking the reference while the mutex is held stops another read from claiming the same image.
+        if (unused!=_images.end())
+        {
+            image = unused->_image;
+            unused->_frameNumberReleased = UNRELEASED;
+            recycled = true;
+        }
+        else
+        {
+            image = new osg::Image;
+            if (_images.size()<_maxNumPooledImages) _images.push_back(PooledImage(image.get()));
+        }
+    }
+
+    if (recycled)
+    {
+        // a recycled image comes back as a new one would, without the details of the file it was last read from.
+        image->setFileName(std::string());
+        image->setName(std::string());
+        image->setUserDataContainer(0);
+        image->setOrigin(osg::Image::BOTTOM_LEFT);
+        image->setPixelAspectRatio(1.0f);
+        image->setPixelBufferObject(0);
+    }
+
+    image->allocateImage(s, t, r, pixelFormat, type, packing);
+    image->setInternalTextureFormat(internalTextureFormat);
+
+    if (!image->data()) return 0;
+
+    return image;
+}
+
+void ImageDestination::rowsDecoded(osg::Image*, int, int)
+{
+}
+
+void ImageDestination::imageDecoded(osg::Image* image)
+{
+    if (image) image->dirty();
+}
@@ -16,9 +16,15 @@
 
 #include <osg/Notify>
 #include <osg/ImageSequence>
+#include <osg/ApplicationUsage>
+
+#include <sstream>
+#include <stdlib.h>
 
 using namespace osgDB;
 
+static osg::ApplicationUsageProxy ImagePager_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_IMAGE_THREADS <int>","Set the number of threads the ImagePager uses to read images.");
+
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -90,10 +96,29 @@ void ImagePager::ReadQueue::add(ImagePager::ImageRequest* imageRequest)
     updateBlock();
 }
 
-void ImagePager::ReadQueue::takeFirst(osg::ref_ptr<ImageRequest>& databaseRequest)
+void ImagePager::ReadQueue::takeFirst(osg::ref_ptr<ImageRequest>& databaseRequest, int frameNumber)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
+    // discard the requests that are no longer being made, such as the images an ImageSequence has played past,
+    // so that the threads only spend their time on images that can still be displayed.
+    RequestList::iterator litr = _requestList.begin();
+    for(RequestList::iterator citr = _requestList.begin();
+        citr != _requestList.end();
+        ++citr)
+    {
+        if ((*citr)->isRequestCurrent(frameNumber))
+        {
+            *(litr++) = *citr;
+        }
+        else
+        {
+            OSG_INFO<<"ImagePager::ReadQueue::takeFirst(..), discarding request for "<<(*citr)->_fileName<<std::endl;
+            (*citr)->_requestQueue = 0;
+        }
+    }
+    _requestList.erase(litr, _requestList.end());
+
     if (!_requestList.empty())
     {
         sort();
@@ -173,6 +198,10 @@ void ImagePager::signalBeginFrame(const osg::FrameStamp* framestamp)
         //OSG_INFO << "signalBeginFrame "<<framestamp->getFrameNumber()<<">>>>>>>>>>>>>>>>"<<std::endl;
         _frameNumber.exchange(framestamp->getFrameNumber());
 
+        // images the ImageSequences have moved on from may still be being read by the draw of the previous
+        // frame, so the destination holds them back for a frame before decoding into them again.
+        if (_imageDestination.valid()) _imageDestination->setFrameNumber(framestamp->getFrameNumber());
+
     } //else OSG_INFO << "signalBeginFrame >>>>>>>>>>>>>>>>"<<std::endl;
 }
 
@@ -206,12 +235,29 @@ void ImagePager::ImageThread::run()
         read_queue->block();
 
         osg::ref_ptr<ImageRequest> imageRequest;
-        read_queue->takeFirst(imageRequest);
+        read_queue->takeFirst(imageRequest, _pager->_frameNumber);
 
         if (imageRequest.valid())
         {
             // OSG_NOTICE<<"doing readImageFile("<<imageRequest->_fileName<<") index to assign = "<<imageRequest->_attachmentIndex<<std::endl;
             osg::ref_ptr<osg::Image> image = osgDB::readRefImageFile(imageRequest->_fileName, imageRequest->_readOptions.get());
+
+            // playback may have moved past the image while it was being read, in which case assigning it would
+            // just hold onto memory, and keep a recycled image from being reused, until the sequence next reaches it.
+            bool requestCurrent = true;
+            if (image.valid())
+            {
+                // requestImageFile() keeps the request current under the read queue's mutex.
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_pager->_readQueue->_requestMutex);
+                requestCurrent = imageRequest->isRequestCurrent(_pager->_frameNumber);
+            }
+
+            if (!requestCurrent)
+            {
+                OSG_INFO<<"ImagePager::ImageThread::run(), discarding late image "<<imageRequest->_fileName<<std::endl;
+                image = 0;
+            }
+
             if (image.valid())
             {
                 // OSG_NOTICE<<"   successful readImageFile("<<imageRequest->_fileName<<") index to assign = "<<imageRequest->_attachmentIndex<<std::endl;
@@ -272,16 +318,20 @@ ImagePager::ImagePager():
 
     _readQueue = new ReadQueue(this,"Image Queue");
     _completedQueue = new RequestQueue;
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 1"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 2"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 3"));
-#if 0
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 4"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 5"));
-    _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, "Image Thread 6"));
-#endif
+
+    unsigned int numThreads = 3;
+    const char* str = getenv("OSG_NUM_IMAGE_THREADS");
+    if (str && atoi(str)>0)
+    {
+        numThreads = atoi(str);
+        OSG_INFO<<"OSG_NUM_IMAGE_THREADS set to "<<numThreads<<std::endl;
+    }
+
+    setUpThreads(numThreads);
+
     // 1 second
     _preLoadTime = 1.0;
+    _preLoadNumImages = 0;
 }
 
 ImagePager::~ImagePager()
@@ -317,28 +367,90 @@ int ImagePager::cancel()
     return result;
 }
 
+void ImagePager::setUpThreads(unsigned int totalNumThreads)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_run_mutex);
+
+    // stop any threads that are already running before replacing them.
+    for(ImageThreads::iterator itr = _imageThreads.begin();
+        itr != _imageThreads.end();
+        ++itr)
+    {
+        (*itr)->setDone(true);
+    }
+
+    _readQueue->release();
+
+    for(ImageThreads::iterator itr = _imageThreads.begin();
+        itr != _imageThreads.end();
+        ++itr)
+    {
+        (*itr)->cancel();
+    }
+
+    _imageThreads.clear();
+
+    if (totalNumThreads==0) totalNumThreads = 1;
+
+    for(unsigned int i=0; i<totalNumThreads; ++i)
+    {
+        std::stringstream name;
+        name<<"Image Thread "<<i+1;
+        _imageThreads.push_back(new ImageThread(this, ImageThread::HANDLE_ALL_REQUESTS, name.str()));
+    }
+
+    // restore the block so that the new threads wait for requests.
+    _readQueue->updateBlock();
+
+    if (_startThreadCalled)
+    {
+        for(ImageThreads::iterator itr = _imageThreads.begin();
+            itr != _imageThreads.end();
+            ++itr)
+        {
+            (*itr)->startThread();
+        }
+    }
+}
+
 osg::ref_ptr<osg::Image> ImagePager::readRefImageFile(const std::string& fileName, const osg::Referenced* options)
 {
     osgDB::Options* readOptions = dynamic_cast<osgDB::Options*>(const_cast<osg::Referenced*>(options));
     return osgDB::readRefImageFile(fileName, readOptions);
 }
 
-void ImagePager::requestImageFile(const std::string& fileName, osg::Object* attachmentPoint, int attachmentIndex, double timeToMergeBy, const osg::FrameStamp* /*framestamp*/, osg::ref_ptr<osg::Referenced>& imageRequest, const osg::Referenced* options)
+void ImagePager::requestImageFile(const std::string& fileName, osg::Object* attachmentPoint, int attachmentIndex, double timeToMergeBy, const osg::FrameStamp* framestamp, osg::ref_ptr<osg::Referenced>& imageRequest, const osg::Referenced* options)
 {
-    osgDB::Options* readOptions = dynamic_cast<osgDB::Options*>(const_cast<osg::Referenced*>(options));
+    osg::ref_ptr<osgDB::Options> readOptions = dynamic_cast<osgDB::Options*>(const_cast<osg::Referenced*>(options));
     if (!readOptions)
     {
        readOptions = Registry::instance()->getOptions();
     }
 
-    bool alreadyAssigned = dynamic_cast<ImageRequest*>(imageRequest.get()) && (imageRequest->referenceCount()>1);
+    unsigned int frameNumber = framestamp ? framestamp->getFrameNumber() : static_cast<unsigned int>(_frameNumber);
+
+    ImageRequest* existingRequest = dynamic_cast<ImageRequest*>(imageRequest.get());
+    bool alreadyAssigned = existingRequest && (imageRequest->referenceCount()>1);
     if (alreadyAssigned)
     {
         // OSG_NOTICE<<"ImagePager::requestImageFile("<<fileName<<") alreadyAssigned"<<std::endl;
+
+        // keep the request current, and update when it's needed as a looping sequence may need it again sooner.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_readQueue->_requestMutex);
+        existingRequest->_frameNumberLastRequest = frameNumber;
+        existingRequest->_timeToMergeBy = timeToMergeBy;
         return;
     }
 
+    // decode into the pager's ImageDestination when the read options don't provide their own.
+    if (_imageDestination.valid() && !(readOptions.valid() && readOptions->getImageDestination()))
+    {
+        readOptions = readOptions.valid() ? readOptions->cloneOptions() : new osgDB::Options;
+        readOptions->setImageDestination(_imageDestination.get());
+    }
+
     osg::ref_ptr<ImageRequest> request = new ImageRequest;
+    request->_frameNumberLastRequest = frameNumber;
     request->_timeToMergeBy = timeToMergeBy;
     request->_fileName = fileName;
     request->_attachmentPoint = attachmentPoint;
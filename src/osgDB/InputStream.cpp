@@ -20,6 +20,9 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ObjectWrapper>
 #include <osgDB/ConvertBase64>
+#include <osgDB/MemoryMappedStream>
+
+#include <string.h>
 
 using namespace osgDB;
 
@@ -709,6 +712,11 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
             unsigned int size = 0; *this >> size;
             if ( size )
             {
+                // when the stream is held in memory, check that all the data is there before allocating it
+                const char* mappedData = readCharArrayInPlace( size );
+                checkStream();
+                if ( getException() ) return NULL;
+
                 char* data = new char[size];
                 if ( !data )
                     throwException( "InputStream::readImage() Out of memory." );
@@ -719,7 +727,8 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
                     return NULL;
                 }
 
-                readCharArray( data, size );
+                if ( mappedData ) memcpy( data, mappedData, size );
+                else readCharArray( data, size );
                 image = new osg::Image;
                 image->setOrigin( (osg::Image::Origin)origin );
                 image->setImage( s, t, r, internalFormat, pixelFormat, dataType,
@@ -799,21 +808,30 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
             unsigned int size = readSize();
             if ( size>0 )
             {
-                char* data = new char[size];
-                if ( !data )
+                // when the stream is held in memory, the image file is read from in place rather than copied
+                const char* mappedData = readCharArrayInPlace( size );
+                checkStream();
+                if ( getException() ) return NULL;
+
+                char* data = 0;
+                if ( !mappedData )
                 {
-                    throwException( "InputStream::readImage(): Out of memory." );
-                    if ( getException() ) return NULL;
+                    data = new char[size];
+                    if ( !data )
+                    {
+                        throwException( "InputStream::readImage(): Out of memory." );
+                        if ( getException() ) return NULL;
+                    }
+                    readCharArray( data, size );
                 }
-                readCharArray( data, size );
 
                 std::string ext = osgDB::getFileExtension( name );
                 osgDB::ReaderWriter* reader =
                     osgDB::Registry::instance()->getReaderWriterForExtension( ext );
                 if ( reader )
                 {
-                    std::stringstream inputStream;
-                    inputStream.write( data, size );
+                    osgDB::MemoryStreamBuffer buffer( mappedData ? mappedData : data, size );
+                    std::istream inputStream( &buffer );
 
                     osgDB::ReaderWriter::ReadResult rr = reader->readImage( inputStream );
                     if ( rr.validImage() )
@@ -1116,14 +1134,30 @@ void InputStream::readArrayImplementation( T* a, unsigned int numComponentsPerEl
     *this >> size >> BEGIN_BRACKET;
     if ( size )
     {
-        a->resize( size );
         if ( isBinary() )
         {
-            readComponentArray( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
+            // when the stream is held in memory, check that the whole array is there before allocating it,
+            // then copy it in one go from the memory
+            unsigned int numBytes = size * numComponentsPerElements * componentSizeInBytes;
+            const char* data = readCharArrayInPlace( numBytes );
             checkStream();
+            if ( getException() ) return;
+
+            a->resize( size );
+            if ( data )
+            {
+                memcpy( &((*a)[0]), data, numBytes );
+                _in->swapComponentArray( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
+            }
+            else
+            {
+                readComponentArray( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
+                checkStream();
+            }
         }
         else
         {
+            a->resize( size );
             for ( int i=0; i<size; ++i )
                 *this >> (*a)[i];
         }
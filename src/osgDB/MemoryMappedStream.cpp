@@ -0,0 +1,154 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2008 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/MemoryMappedStream>
+#include <osgDB/ConvertUTF>
+#include <osg/Notify>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #define WIN32_LEAN_AND_MEAN
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace osgDB;
+
+MemoryStreamBuffer::MemoryStreamBuffer( const char* data, std::streamsize size )
+{
+    setData( data, size );
+}
+
+void MemoryStreamBuffer::setData( const char* data, std::streamsize size )
+{
+    // the get area is only ever read from, so the cast doesn't allow the data to be modified
+    char* begin = const_cast<char*>( data );
+    setg( begin, begin, begin + (begin ? size : 0) );
+}
+
+const char* MemoryStreamBuffer::take( std::streamsize numChars )
+{
+    if ( numChars<0 || egptr()-gptr()<numChars ) return 0;
+
+    const char* ptr = gptr();
+    setg( eback(), gptr() + numChars, egptr() );
+    return ptr;
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which )
+{
+    if ( !(which & std::ios_base::in) ) return pos_type(off_type(-1));
+
+    off_type base = 0;
+    if ( dir==std::ios_base::cur ) base = gptr() - eback();
+    else if ( dir==std::ios_base::end ) base = egptr() - eback();
+    return seekpos( pos_type(base + off), which );
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos( pos_type pos, std::ios_base::openmode which )
+{
+    off_type offset = off_type(pos);
+    if ( !(which & std::ios_base::in) || offset<0 || offset>(egptr() - eback()) ) return pos_type(off_type(-1));
+
+    setg( eback(), eback() + offset, egptr() );
+    return pos;
+}
+
+std::streamsize MemoryStreamBuffer::showmanyc()
+{
+    std::streamsize remaining = egptr() - gptr();
+    return remaining>0 ? remaining : -1;
+}
+
+MemoryMappedStreamBuffer::MemoryMappedStreamBuffer( const std::string& fileName, bool sequential )
+:   _data(0), _size(0), _mapping(0)
+{
+    map( fileName, sequential );
+}
+
+MemoryMappedStreamBuffer::~MemoryMappedStreamBuffer()
+{
+    unmap();
+}
+
+void MemoryMappedStreamBuffer::map( const std::string& fileName, bool sequential )
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    DWORD flags = sequential ? FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+    #ifdef OSG_USE_UTF8_FILENAME
+    HANDLE file = CreateFileW( osgDB::convertUTF8toUTF16(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, flags, NULL );
+    #else
+    HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, flags, NULL );
+    #endif
+    if ( file==INVALID_HANDLE_VALUE ) return;
+
+    LARGE_INTEGER fileSize;
+    if ( GetFileSizeEx(file, &fileSize) && fileSize.QuadPart>0 )
+    {
+        HANDLE mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+        if ( mapping )
+        {
+            _mapping = mapping;
+            _data = static_cast<char*>( MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) );
+            if ( _data ) _size = static_cast<std::streamsize>( fileSize.QuadPart );
+        }
+    }
+    CloseHandle( file );
+#else
+    int fd = ::open( fileName.c_str(), O_RDONLY );
+    if ( fd<0 ) return;
+
+    struct stat fileStat;
+    // files too large for the address space, such as big archives on 32 bit systems, are left unmapped
+    if ( ::fstat(fd, &fileStat)==0 && fileStat.st_size>0 &&
+         static_cast<unsigned long long>(fileStat.st_size)<=static_cast<unsigned long long>(static_cast<size_t>(-1)) )
+    {
+        void* ptr = ::mmap( 0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( ptr!=MAP_FAILED )
+        {
+            _data = static_cast<char*>(ptr);
+            _size = static_cast<std::streamsize>( fileStat.st_size );
+    #ifdef MADV_SEQUENTIAL
+            if ( sequential ) ::madvise( ptr, fileStat.st_size, MADV_SEQUENTIAL );
+    #endif
+        }
+    }
+    ::close( fd );
+#endif
+
+    if ( _data ) setData( _data, _size );
+    else OSG_INFO<<"MemoryMappedStreamBuffer: Unable to map "<<fileName<<", falling back to stream reading."<<std::endl;
+}
+
+void MemoryMappedStreamBuffer::unmap()
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    if ( _data ) UnmapViewOfFile( _data );
+    if ( _mapping ) CloseHandle( static_cast<HANDLE>(_mapping) );
+#else
+    if ( _data ) ::munmap( _data, _size );
+#endif
+    _mapping = 0;
+    _data = 0;
+    _size = 0;
+    setData( 0, 0 );
+}
@@ -11,38 +11,23 @@
  * OpenSceneGraph Public License for more details.
 */
 
+#include <osg/Geometry>
 #include <osg/Texture>
 #include <osgDB/ObjectCache>
 #include <osgDB/Options>
 
-using namespace osgDB;
-
-bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair& lhs, const ObjectCache::FileNameOptionsPair& rhs) const
-{
-    // check if filename are the same
-    if (lhs.first < rhs.first) return true;
-    if (rhs.first < lhs.first) return false;
-
-    // check if Options pointers are the same.
-    if (lhs.second == rhs.second) return false;
-
-    // need to compare Options pointers
-    if (lhs.second.valid() && rhs.second.valid())
-    {
-        // lhs & rhs have valid Options objects
-        return *lhs.second < *rhs.second;
-    }
+#include <algorithm>
+#include <set>
 
-    // finally use pointer comparison, expecting at least one will be NULL pointer
-    return lhs.second < rhs.second;
-}
+using namespace osgDB;
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // ObjectCache
 //
 ObjectCache::ObjectCache():
-    osg::Referenced(true)
+    osg::Referenced(true),
+    _maxNumBytes(0)
 {
 //    OSG_NOTICE<<"Constructed ObjectCache"<<std::endl;
 }
@@ -52,141 +37,368 @@ ObjectCache::~ObjectCache()
 //    OSG_NOTICE<<"Destructed ObjectCache"<<std::endl;
 }
 
-void ObjectCache::addObjectCache(ObjectCache* objectCache)
+ObjectCache::Shard& ObjectCache::getShard(const std::string& fileName)
 {
-    // don't allow a cache to be added to itself.
-    if (objectCache==this) return;
-
-    // lock both ObjectCache to prevent their contents from being modified by other threads while we merge.
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(_objectCacheMutex);
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(objectCache->_objectCacheMutex);
-
-    OSG_DEBUG<<"Inserting objects to main ObjectCache "<<objectCache->_objectCache.size()<<std::endl;
-
-    _objectCache.insert(objectCache->_objectCache.begin(), objectCache->_objectCache.end());
+    // FNV-1a hash of the file name, so that all the entries for a file live in the same shard.
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = fileName.begin();
+        itr != fileName.end();
+        ++itr)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return _shards[hash % NUM_SHARDS];
 }
 
-
-void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
+ObjectCache::CacheEntry* ObjectCache::find(CacheEntries& entries, const osgDB::Options* options)
 {
-    if (!object) return;
-
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[FileNameOptionsPair(filename, options ? osg::clone(options) : 0)] = ObjectTimeStampPair(object,timestamp);
-    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+    for(CacheEntries::iterator itr = entries.begin();
+        itr != entries.end();
+        ++itr)
+    {
+        if (itr->_options.valid())
+        {
+            if (options && *(itr->_options)==*options) return &(*itr);
+        }
+        else if (!options) return &(*itr);
+    }
+    return 0;
 }
 
-ObjectCache::ObjectCacheMap::iterator ObjectCache::find(const std::string& fileName, const osgDB::Options* options)
+void ObjectCache::addObjectCache(ObjectCache* objectCache)
 {
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    // don't allow a cache to be added to itself.
+    if (objectCache==this) return;
+
+    OSG_DEBUG<<"Inserting objects to main ObjectCache "<<objectCache->getNumObjects()<<std::endl;
+
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if (itr->first.first==fileName)
+        // lock both shards to prevent their contents from being modified by other threads while we merge,
+        // as both caches hash file names the same way matching entries are in the shards of the same index.
+        Shard& shard = _shards[i];
+        Shard& otherShard = objectCache->_shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(shard._mutex);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(otherShard._mutex);
+
+        for(CacheEntriesMap::iterator oitr = otherShard._entries.begin();
+            oitr != otherShard._entries.end();
+            ++oitr)
         {
-            if (itr->first.second.valid())
+            CacheEntries& entries = shard._entries[oitr->first];
+            for(CacheEntries::iterator eitr = oitr->second.begin();
+                eitr != oitr->second.end();
+                ++eitr)
             {
-                if (options && *(itr->first.second)==*options) return itr;
+                // existing entries are kept in preference to those being added.
+                if (!find(entries, eitr->_options.get()))
+                {
+                    entries.push_back(*eitr);
+                    entries.back()._lastUsed = ++_useCount;
+                    shard._numBytes += eitr->_numBytes;
+                    ++shard._numObjects;
+                }
             }
-            else if (!options) return itr;
         }
     }
-    return _objectCache.end();
+
+    if (_maxNumBytes>0) evictLeastRecentlyUsedObjects();
 }
 
 
-osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    if (!object) return;
+
+    // estimate the size before taking the lock as it may need to traverse a whole subgraph.
+    std::size_t numBytes = computeObjectSizeInBytes(object);
+
     {
-        osg::ref_ptr<const osgDB::Options> o = itr->first.second;
-        if (o.valid())
+        Shard& shard = getShard(filename);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        CacheEntries& entries = shard._entries[filename];
+        CacheEntry* entry = find(entries, options);
+        if (entry)
         {
-            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< o->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
+            shard._numBytes -= entry->_numBytes;
         }
         else
         {
-            OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
+            entries.push_back(CacheEntry());
+            entry = &entries.back();
+            entry->_options = options ? osg::clone(options) : 0;
+            ++shard._numObjects;
         }
-        return itr->second.first.get();
+
+        entry->_object = object;
+        entry->_timeStamp = timestamp;
+        entry->_lastUsed = ++_useCount;
+        entry->_numBytes = numBytes;
+        shard._numBytes += numBytes;
     }
-    else return 0;
+
+    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+
+    if (_maxNumBytes>0) evictLeastRecentlyUsedObjects();
+}
+
+osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+{
+    return getRefFromObjectCache(fileName, options).get();
 }
 
 osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+    CacheEntriesMap::iterator itr = shard._entries.find(fileName);
+    CacheEntry* entry = (itr!=shard._entries.end()) ? find(itr->second, options) : 0;
+    if (entry)
     {
-        osg::ref_ptr<const osgDB::Options> o = itr->first.second;
-        if (o.valid())
+        if (entry->_options.valid())
         {
-            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< o->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
+            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< entry->_options->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
         }
         else
         {
             OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
         }
-        return itr->second.first.get();
+        entry->_lastUsed = ++_useCount;
+        ++_numHits;
+        return entry->_object;
+    }
+    else
+    {
+        ++_numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(CacheEntriesMap::iterator itr = shard._entries.begin();
+            itr != shard._entries.end();
+            ++itr)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            for(CacheEntries::iterator eitr = itr->second.begin();
+                eitr != itr->second.end();
+                ++eitr)
+            {
+                // if ref count is greater the 1 the object has an external reference.
+                if (eitr->_object->referenceCount()>1)
+                {
+                    // so update it time stamp.
+                    eitr->_timeStamp = referenceTime;
+                }
+            }
         }
     }
 }
 
 void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // Remove expired entries from object cache
-    ObjectCacheMap::iterator oitr = _objectCache.begin();
-    while(oitr != _objectCache.end())
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if (oitr->second.second<=expiryTime)
-        {
-#if __cplusplus > 199711L
-            oitr = _objectCache.erase(oitr);
-#else
-            _objectCache.erase(oitr++);
-#endif
-        }
-        else
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // Remove expired entries from object cache
+        CacheEntriesMap::iterator itr = shard._entries.begin();
+        while(itr != shard._entries.end())
         {
-            ++oitr;
+            CacheEntries& entries = itr->second;
+            CacheEntries::iterator litr = entries.begin();
+            for(CacheEntries::iterator eitr = entries.begin();
+                eitr != entries.end();
+                ++eitr)
+            {
+                if (eitr->_timeStamp<=expiryTime)
+                {
+                    shard._numBytes -= eitr->_numBytes;
+                    --shard._numObjects;
+                }
+                else
+                {
+                    *(litr++) = *eitr;
+                }
+            }
+            entries.erase(litr, entries.end());
+
+            if (entries.empty()) shard._entries.erase(itr++);
+            else ++itr;
         }
     }
 }
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+    CacheEntriesMap::iterator itr = shard._entries.find(fileName);
+    if (itr==shard._entries.end()) return;
+
+    CacheEntry* entry = find(itr->second, options);
+    if (entry)
+    {
+        shard._numBytes -= entry->_numBytes;
+        --shard._numObjects;
+        itr->second.erase(itr->second.begin() + (entry - &(itr->second.front())));
+        if (itr->second.empty()) shard._entries.erase(itr);
+    }
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        shard._entries.clear();
+        shard._numBytes = 0;
+        shard._numObjects = 0;
+    }
+}
+
+void ObjectCache::setMaxNumBytes(std::size_t maxNumBytes)
+{
+    _maxNumBytes = maxNumBytes;
+
+    if (_maxNumBytes>0) evictLeastRecentlyUsedObjects();
+}
+
+unsigned int ObjectCache::getNumObjects() const
+{
+    unsigned int numObjects = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        numObjects += _shards[i]._numObjects;
+    }
+    return numObjects;
+}
+
+std::size_t ObjectCache::getNumBytes() const
+{
+    std::size_t numBytes = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        numBytes += _shards[i]._numBytes;
+    }
+    return numBytes;
+}
+
+void ObjectCache::resetStatistics()
+{
+    _numHits.exchange(0);
+    _numMisses.exchange(0);
+    _numEvictions.exchange(0);
+}
+
+void ObjectCache::recordStats(osg::Stats* stats, unsigned int frameNumber) const
+{
+    if (!stats) return;
+
+    stats->setAttribute(frameNumber, "ObjectCache objects", static_cast<double>(getNumObjects()));
+    stats->setAttribute(frameNumber, "ObjectCache bytes", static_cast<double>(getNumBytes()));
+    stats->setAttribute(frameNumber, "ObjectCache hits", static_cast<double>(_numHits));
+    stats->setAttribute(frameNumber, "ObjectCache misses", static_cast<double>(_numMisses));
+    stats->setAttribute(frameNumber, "ObjectCache evictions", static_cast<double>(_numEvictions));
+}
+
+namespace
+{
+    struct EvictionCandidate
+    {
+        EvictionCandidate(unsigned int lastUsed, unsigned int shardIndex, const std::string& fileName, const osg::Object* object):
+            _lastUsed(lastUsed), _shardIndex(shardIndex), _fileName(fileName), _object(object) {}
+
+        bool operator < (const EvictionCandidate& rhs) const { return _lastUsed < rhs._lastUsed; }
+
+        unsigned int        _lastUsed;
+        unsigned int        _shardIndex;
+        std::string         _fileName;
+        const osg::Object*  _object;
+    };
+}
+
+void ObjectCache::evictLeastRecentlyUsedObjects()
+{
+    // one thread evicts at a time, the others wait their turn and then check the budget again, so an
+    // addition made while another thread was evicting isn't left over budget.
+    OpenThreads::ScopedLock<OpenThreads::Mutex> evictionLock(_evictionMutex);
+
+    std::size_t numBytes = getNumBytes();
+    if (numBytes>_maxNumBytes)
+    {
+        // evict down to 90% of the budget so that each addition doesn't trigger another pass.
+        std::size_t targetNumBytes = _maxNumBytes - _maxNumBytes/10;
+
+        // gather the objects that nothing outside the cache references, as evicting anything else wouldn't free memory.
+        std::vector<EvictionCandidate> candidates;
+        for(unsigned int i=0; i<NUM_SHARDS; ++i)
+        {
+            Shard& shard = _shards[i];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+            for(CacheEntriesMap::iterator itr = shard._entries.begin();
+                itr != shard._entries.end();
+                ++itr)
+            {
+                for(CacheEntries::iterator eitr = itr->second.begin();
+                    eitr != itr->second.end();
+                    ++eitr)
+                {
+                    if (eitr->_object->referenceCount()==1)
+                    {
+                        candidates.push_back(EvictionCandidate(eitr->_lastUsed, i, itr->first, eitr->_object.get()));
+                    }
+                }
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+
+        for(std::vector<EvictionCandidate>::iterator citr = candidates.begin();
+            citr != candidates.end() && numBytes>targetNumBytes;
+            ++citr)
+        {
+            Shard& shard = _shards[citr->_shardIndex];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+            CacheEntriesMap::iterator itr = shard._entries.find(citr->_fileName);
+            if (itr==shard._entries.end()) continue;
+
+            // the entry may have been used or replaced since the candidates were gathered, in which case it's kept.
+            CacheEntries& entries = itr->second;
+            for(CacheEntries::iterator eitr = entries.begin();
+                eitr != entries.end();
+                ++eitr)
+            {
+                if (eitr->_object.get()==citr->_object && eitr->_lastUsed==citr->_lastUsed && eitr->_object->referenceCount()==1)
+                {
+                    OSG_DEBUG<<"Evicting "<<citr->_fileName<<" from ObjectCache "<<this<<std::endl;
+
+                    numBytes -= osg::minimum(numBytes, eitr->_numBytes);
+                    shard._numBytes -= eitr->_numBytes;
+                    --shard._numObjects;
+                    ++_numEvictions;
+
+                    entries.erase(eitr);
+                    if (entries.empty()) shard._entries.erase(itr);
+                    break;
+                }
+            }
+        }
+    }
 }
 
 namespace ObjectCacheUtils
@@ -252,32 +464,146 @@ struct ContainsUnreffedTextures : public osg::NodeVisitor
     }
 };
 
+struct ComputeSizeInBytes : public osg::NodeVisitor
+{
+    ComputeSizeInBytes() :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        numBytes(0)
+    {}
+
+    std::size_t numBytes;
+
+    // arrays, primitive sets and images may be shared between several parts of the subgraph so are only counted once.
+    std::set<const osg::BufferData*> bufferDataSet;
+
+    void add(const osg::BufferData* bufferData)
+    {
+        if (bufferData && bufferDataSet.insert(bufferData).second)
+        {
+            numBytes += bufferData->getTotalDataSize();
+        }
+    }
+
+    void add(const osg::Texture* texture)
+    {
+        if (!texture) return;
+
+        for(unsigned int i=0; i<texture->getNumImages(); ++i)
+        {
+            add(texture->getImage(i));
+        }
+    }
+
+    void add(const osg::StateSet* stateset)
+    {
+        if (!stateset) return;
+
+        for(unsigned int i=0; i<stateset->getNumTextureAttributeLists(); ++i)
+        {
+            const osg::StateAttribute* sa = stateset->getTextureAttribute(i, osg::StateAttribute::TEXTURE);
+            if (sa) add(sa->asTexture());
+        }
+    }
+
+    void add(const osg::Object* object)
+    {
+        const osg::BufferData* bufferData = dynamic_cast<const osg::BufferData*>(object);
+        if (bufferData) { add(bufferData); return; }
+
+        const osg::StateSet* stateset = dynamic_cast<const osg::StateSet*>(object);
+        if (stateset) { add(stateset); return; }
+
+        const osg::Texture* texture = dynamic_cast<const osg::Texture*>(object);
+        if (texture) { add(texture); return; }
+
+        const osg::Node* node = dynamic_cast<const osg::Node*>(object);
+        if (node) const_cast<osg::Node*>(node)->accept(*this);
+    }
+
+    void apply(osg::Node& node)
+    {
+        numBytes += sizeof(osg::Node);
+        add(node.getStateSet());
+
+        traverse(node);
+    }
+
+    void apply(osg::Drawable& drawable)
+    {
+        numBytes += sizeof(osg::Drawable);
+        add(drawable.getStateSet());
+    }
+
+    void apply(osg::Geometry& geometry)
+    {
+        numBytes += sizeof(osg::Geometry);
+        add(geometry.getStateSet());
+
+        osg::Geometry::ArrayList arrays;
+        geometry.getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+            itr != arrays.end();
+            ++itr)
+        {
+            add(itr->get());
+        }
+
+        for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+        {
+            add(geometry.getPrimitiveSet(i));
+        }
+    }
+};
+
 } // ObjectCacheUtils
 
-void ObjectCache::releaseGLObjects(osg::State* state)
+std::size_t ObjectCache::computeObjectSizeInBytes(const osg::Object* object) const
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
+    if (!object) return 0;
 
+    ObjectCacheUtils::ComputeSizeInBytes csib;
+    csib.add(object);
+    return csib.numBytes;
+}
+
+void ObjectCache::releaseGLObjects(osg::State* state)
+{
     ObjectCacheUtils::ContainsUnreffedTextures cut;
 
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        )
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        ObjectCacheMap::iterator curr_itr = itr;
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
 
-        // get object and advance iterator to next item
-        osg::Object* object = itr->second.first.get();
+        CacheEntriesMap::iterator itr = shard._entries.begin();
+        while(itr != shard._entries.end())
+        {
+            CacheEntries& entries = itr->second;
+            CacheEntries::iterator litr = entries.begin();
+            for(CacheEntries::iterator eitr = entries.begin();
+                eitr != entries.end();
+                ++eitr)
+            {
+                osg::Object* object = eitr->_object.get();
 
-        bool needToRemoveEntry = cut.check(itr->second.first.get());
+                bool needToRemoveEntry = cut.check(object);
 
-        object->releaseGLObjects(state);
+                object->releaseGLObjects(state);
 
-        ++itr;
+                if (needToRemoveEntry)
+                {
+                    shard._numBytes -= eitr->_numBytes;
+                    --shard._numObjects;
+                }
+                else
+                {
+                    *(litr++) = *eitr;
+                }
+            }
+            entries.erase(litr, entries.end());
 
-        if (needToRemoveEntry)
-        {
-            _objectCache.erase(curr_itr);
+            if (entries.empty()) shard._entries.erase(itr++);
+            else ++itr;
         }
     }
 }
@@ -51,6 +51,7 @@ Options::Options(const Options& options,const osg::CopyOp& copyop):
     _writeFileCallback(options._writeFileCallback),
     _fileLocationCallback(options._fileLocationCallback),
     _fileCache(options._fileCache),
+    _imageDestination(options._imageDestination),
     _terrain(options._terrain),
     _parentGroup(options._parentGroup)
 {
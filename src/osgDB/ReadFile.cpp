@@ -11,6 +11,7 @@
  * OpenSceneGraph Public License for more details.
 */
 #include <osg/Notify>
+#include <osg/Timer>
 #include <osg/Object>
 #include <osg/Image>
 #include <osg/Shader>
@@ -25,6 +26,7 @@
 
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
+#include <osgDB/AsyncReader>
 
 using namespace osg;
 using namespace osgDB;
@@ -141,24 +143,77 @@ osg::ref_ptr<osg::Script> osgDB::readRefScriptFile(const std::string& filename,c
     return NULL;
 }
 
-osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,const Options* options)
+typedef std::vector< osg::ref_ptr<osg::Node> > NodeList;
+
+// Read the files in fileList, appending the nodes read to nodeList in the same order. When readConcurrently is set,
+// there is more than one file and the AsyncReader has several threads the files are read concurrently, so that a
+// scene assembled from many parts isn't limited to loading one file at a time.
+static void readNodeFilesIntoList(const std::vector<std::string>& fileList, const Options* options, bool readConcurrently, NodeList& nodeList)
 {
-    typedef std::vector< osg::ref_ptr<osg::Node> > NodeList;
-    NodeList nodeList;
+    if (fileList.empty()) return;
 
-    for(std::vector<std::string>::iterator itr=fileList.begin();
-        itr!=fileList.end();
-        ++itr)
+    AsyncReader* asyncReader = readConcurrently ? AsyncReader::instance().get() : 0;
+    readConcurrently = asyncReader && fileList.size()>1 && asyncReader->getNumThreads()>1;
+
+    typedef std::vector< osg::ref_ptr<ReadFuture> > ReadFutures;
+    ReadFutures futures;
+    if (readConcurrently)
     {
-        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile( *itr , options );
+        OSG_INFO<<"Reading "<<fileList.size()<<" files using "<<asyncReader->getNumThreads()<<" threads"<<std::endl;
+
+        // the ReadFutures reference their options, so give them a copy rather than the caller's Options.
+        osg::ref_ptr<Options> localOptions = options ? options->cloneOptions() : 0;
 
-        if( node != (osg::Node *)0L )
+        for(std::vector<std::string>::const_iterator itr=fileList.begin();
+            itr!=fileList.end();
+            ++itr)
         {
-            if (node->getName().empty()) node->setName( *itr );
-            nodeList.push_back(node);
+            futures.push_back(asyncReader->read(ReadFuture::READ_NODE, *itr, localOptions.get()));
         }
+    }
 
+    // files read separately don't share their state, so share it across them when the application has set up a SharedStateManager.
+    SharedStateManager* sharedStateManager = fileList.size()>1 ? Registry::instance()->getSharedStateManager() : 0;
+
+    for(unsigned int i=0; i<fileList.size(); ++i)
+    {
+        const std::string& filename = fileList[i];
+
+        osg::ref_ptr<osg::Node> node;
+        double readTime = 0.0;
+        if (readConcurrently)
+        {
+            node = futures[i]->getNode();
+            readTime = futures[i]->getReadTime();
+        }
+        else
+        {
+            osg::Timer_t startTick = osg::Timer::instance()->tick();
+            node = osgDB::readRefNodeFile( filename , options );
+            readTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+        }
+
+        OSG_INFO<<"Time to read "<<filename<<" "<<readTime*1000.0<<" ms"<<std::endl;
+
+        if (node.valid())
+        {
+            if (node->getName().empty()) node->setName( filename );
+            if (sharedStateManager) sharedStateManager->share(node.get());
+            nodeList.push_back(node);
+        }
     }
+}
+
+osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,const Options* options)
+{
+    return readRefNodeFiles(fileList, options, false);
+}
+
+osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,const Options* options,bool readConcurrently)
+{
+    NodeList nodeList;
+
+    readNodeFilesIntoList(fileList, options, readConcurrently, nodeList);
 
     if (nodeList.empty())
     {
@@ -187,7 +242,6 @@ osg::ref_ptr<Node> osgDB::readRefNodeFiles(std::vector<std::string>& fileList,co
 osg::ref_ptr<Node> osgDB::readRefNodeFiles(osg::ArgumentParser& arguments,const Options* options)
 {
 
-    typedef std::vector< osg::ref_ptr<osg::Node> > NodeList;
     NodeList nodeList;
 
     std::string filename;
@@ -197,6 +251,14 @@ osg::ref_ptr<Node> osgDB::readRefNodeFiles(osg::ArgumentParser& arguments,const
         osgDB::Registry::instance()->setFileCache(new osgDB::FileCache(filename));
     }
 
+    bool readConcurrently = false;
+    unsigned int numThreads = 0;
+    while (arguments.read("--threads",numThreads))
+    {
+        AsyncReader::instance()->setNumThreads(numThreads);
+        readConcurrently = numThreads>1;
+    }
+
     while (arguments.read("--image",filename))
     {
         osg::ref_ptr<osg::Image> image = readRefImageFile(filename.c_str(), options);
@@ -258,22 +320,18 @@ osg::ref_ptr<Node> osgDB::readRefNodeFiles(osg::ArgumentParser& arguments,const
     }
 
     // note currently doesn't delete the loaded file entries from the command line yet...
+    std::vector<std::string> fileList;
     for(int pos=1;pos<arguments.argc();++pos)
     {
         if (!arguments.isOption(pos))
         {
             // not an option so assume string is a filename.
-            osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile( arguments[pos], options);
-
-            if(node)
-            {
-                if (node->getName().empty()) node->setName( arguments[pos] );
-                nodeList.push_back(node);
-            }
-
+            fileList.push_back(arguments[pos]);
         }
     }
 
+    readNodeFilesIntoList(fileList, options, readConcurrently, nodeList);
+
     if (nodeList.empty())
     {
         return NULL;
@@ -642,7 +642,10 @@ ImageProcessor* Registry::getImageProcessor()
             return _ipList.front().get();
         }
     }
-    return getImageProcessorForExtension("nvtt");
+    // fall back to the built-in software encoder when NVidia Texture Tools isn't available
+    ImageProcessor* imageProcessor = getImageProcessorForExtension("nvtt");
+    if (!imageProcessor) imageProcessor = getImageProcessorForExtension("bcn");
+    return imageProcessor;
 }
 
 ImageProcessor* Registry::getImageProcessorForExtension(const std::string& ext)
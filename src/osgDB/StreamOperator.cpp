@@ -32,17 +32,21 @@ void InputIterator::readComponentArray( char* s, unsigned int numElements, unsig
     if ( size>0 )
     {
         readCharArray( s, size);
+        swapComponentArray( s, numElements, numComponentsPerElements, componentSizeInBytes );
+    }
+}
 
-        if (_byteSwap && componentSizeInBytes>1)
+void InputIterator::swapComponentArray( char* s, unsigned int numElements, unsigned int numComponentsPerElements, unsigned int componentSizeInBytes)
+{
+    if (_byteSwap && componentSizeInBytes>1)
+    {
+        char* ptr = s;
+        for(unsigned int i=0; i<numElements; ++i)
         {
-            char* ptr = s;
-            for(unsigned int i=0; i<numElements; ++i)
+            for(unsigned int j=0; j<numComponentsPerElements; ++j)
             {
-                for(unsigned int j=0; j<numComponentsPerElements; ++j)
-                {
-                    osg::swapBytes( ptr, componentSizeInBytes );
-                    ptr += componentSizeInBytes;
-                }
+                osg::swapBytes( ptr, componentSizeInBytes );
+                ptr += componentSizeInBytes;
             }
         }
     }
@@ -0,0 +1,97 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/ImageUtils>
+#include <osg/Texture>
+#include <osg/Notify>
+#include <osgDB/Registry>
+
+// ImageProcessor that compresses images with osg::compressImage() so needs neither a graphics context nor any external library.
+class BCnImageProcessor : public osgDB::ImageProcessor
+{
+public:
+    virtual void compress(osg::Image& image, osg::Texture::InternalFormatMode compressedFormat, bool generateMipMap, bool resizeToPowerOfTwo, CompressionMethod method, CompressionQuality quality);
+    virtual void generateMipMap(osg::Image& image, bool resizeToPowerOfTwo, CompressionMethod method);
+
+protected:
+
+    bool prepare(osg::Image& image, bool generateMipMap, bool resizeToPowerOfTwo);
+};
+
+bool BCnImageProcessor::prepare(osg::Image& image, bool generateMipMap, bool resizeToPowerOfTwo)
+{
+    if (image.isCompressed() || image.getDataType()!=GL_UNSIGNED_BYTE || image.r()!=1)
+    {
+        OSG_WARN<<"BCnImageProcessor: only uncompressed 2D GL_UNSIGNED_BYTE images are supported, cannot process "<<image.getFileName()<<std::endl;
+        return false;
+    }
+
+    if (resizeToPowerOfTwo)
+    {
+        int s = osg::Image::computeNearestPowerOfTwo(image.s());
+        int t = osg::Image::computeNearestPowerOfTwo(image.t());
+        if (s!=image.s() || t!=image.t()) image.scaleImage(s, t, 1);
+    }
+
+    if (generateMipMap) osg::generateMipmaps(&image, osg::KAISER_FILTER);
+
+    return true;
+}
+
+void BCnImageProcessor::compress(osg::Image& image, osg::Texture::InternalFormatMode compressedFormat, bool generateMipMap, bool resizeToPowerOfTwo, CompressionMethod method, CompressionQuality quality)
+{
+    GLenum pixelFormat;
+    switch (compressedFormat)
+    {
+    case osg::Texture::USE_S3TC_DXT1_COMPRESSION:
+        pixelFormat = (image.getPixelFormat()==GL_RGBA || image.getPixelFormat()==GL_BGRA) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT1c_COMPRESSION:
+        pixelFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT1a_COMPRESSION:
+        pixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT3_COMPRESSION:
+        pixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        break;
+    case osg::Texture::USE_S3TC_DXT5_COMPRESSION:
+        pixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        break;
+    case osg::Texture::USE_RGTC1_COMPRESSION:
+        pixelFormat = GL_COMPRESSED_RED_RGTC1_EXT;
+        break;
+    case osg::Texture::USE_RGTC2_COMPRESSION:
+        pixelFormat = GL_COMPRESSED_RED_GREEN_RGTC2_EXT;
+        break;
+    default:
+        OSG_WARN<<"BCnImageProcessor: Invalid or not supported compress format"<<std::endl;
+        return;
+    }
+
+    if (method==USE_GPU)
+    {
+        OSG_INFO<<"BCnImageProcessor: GPU compression is not available, CPU will be used."<<std::endl;
+    }
+
+    if (!prepare(image, generateMipMap, resizeToPowerOfTwo)) return;
+
+    osg::compressImage(&image, pixelFormat, quality!=FASTEST);
+}
+
+void BCnImageProcessor::generateMipMap(osg::Image& image, bool resizeToPowerOfTwo, CompressionMethod /*method*/)
+{
+    prepare(image, true, resizeToPowerOfTwo);
+}
+
+REGISTER_OSGIMAGEPROCESSOR(bcn, BCnImageProcessor)
@@ -456,24 +456,17 @@ int headerlen)
 }
 
 
-static unsigned char*
-copyScanline(unsigned char *currPtr, unsigned char *from, int cnt)
-{
-    memcpy((void*)currPtr, (void*)from, cnt);
-    currPtr -= cnt;
-    return currPtr;
-}
-
-unsigned char* simage_jpeg_load(std::istream& fin,
-                                int *width_ret,
-                                int *height_ret,
-                                int *numComponents_ret,
-                                unsigned int* exif_orientation)
+osg::ref_ptr<osg::Image> simage_jpeg_load(std::istream& fin,
+                                          osgDB::ImageDestination* destination,
+                                          unsigned int* exif_orientation)
 {
     int width;
     int height;
-    unsigned char *currPtr;
-    int format;
+    GLenum format;
+    /* The image is decoded into, it is volatile as it is set after the setjmp() below
+     * and holds a reference to the image that the error handling has to release.
+     */
+    osg::Image* volatile image = NULL;
     /* This struct contains the JPEG decompression parameters and pointers to
      * working space (which is allocated as needed by the JPEG library).
      */
@@ -485,7 +478,7 @@ unsigned char* simage_jpeg_load(std::istream& fin,
     struct my_error_mgr jerr;
     /* More stuff */
     //FILE * infile;               /* source file */
-    JSAMPARRAY rowbuffer;        /* Output row buffer */
+    JSAMPROW rowpointers[16];    /* Output row pointers into the image */
     int row_stride;              /* physical row width in output buffer */
 
     jpegerror = ERR_NO_ERROR;
@@ -517,13 +510,10 @@ unsigned char* simage_jpeg_load(std::istream& fin,
         jpegerror = ERR_JPEGLIB;
         jpeg_destroy_decompress(&cinfo);
         //fclose(infile);
-        //if (buffer) delete [] buffer;
+        if (image) image->unref();
         return NULL;
     }
 
-    // used to be before setjump above, but have moved to after to avoid compile warnings.
-    unsigned char *buffer = NULL;
-
     /* Now we can initialize the JPEG decompression object. */
     jpeg_create_decompress(&cinfo);
 
@@ -561,12 +551,12 @@ unsigned char* simage_jpeg_load(std::istream& fin,
     /* Step 5: Start decompressor */
     if (cinfo.jpeg_color_space == JCS_GRAYSCALE)
     {
-        format = 1;
+        format = GL_LUMINANCE;
         cinfo.out_color_space = JCS_GRAYSCALE;
     }
     else                         /* use rgb */
     {
-        format = 3;
+        format = GL_RGB;
         cinfo.out_color_space = JCS_RGB;
     }
 
@@ -583,12 +573,20 @@ unsigned char* simage_jpeg_load(std::istream& fin,
      */
     /* JSAMPLEs per row in output buffer */
     row_stride = cinfo.output_width * cinfo.output_components;
-    /* Make a one-row-high sample array that will go away when done with image */
-    rowbuffer = (*cinfo.mem->alloc_sarray)
-        ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
     width = cinfo.output_width;
     height = cinfo.output_height;
-    buffer = currPtr = new unsigned char [width*height*cinfo.output_components];
+
+    /* The scanlines are decoded straight into the image provided by the destination,
+     * which may reuse the storage of an image it has been given.
+     */
+    {
+        osg::ref_ptr<osg::Image> allocated = destination->allocateImage(width, height, 1, format, format, GL_UNSIGNED_BYTE);
+        if (allocated.valid() && allocated->getRowSizeInBytes()==(unsigned int)row_stride)
+        {
+            image = allocated.get();
+            image->ref();
+        }
+    }
 
     /* Step 6: while (scan lines remain to be read) */
     /*           jpeg_read_scanlines(...); */
@@ -598,19 +596,23 @@ unsigned char* simage_jpeg_load(std::istream& fin,
      */
 
     /* flip image upside down */
-    if (buffer)
+    if (image)
     {
-        currPtr = buffer + row_stride * (cinfo.output_height-1);
-
         while (cinfo.output_scanline < cinfo.output_height)
         {
-            /* jpeg_read_scanlines expects an array of pointers to scanlines.
-             * Here the array is only one element long, but you could ask for
-             * more than one scanline at a time if that's more convenient.
+            /* jpeg_read_scanlines expects an array of pointers to scanlines,
+             * point them at the image rows so that several are decoded at once
+             * and passed on to the destination as they become available.
              */
-            (void) jpeg_read_scanlines(&cinfo, rowbuffer, 1);
-            /* Assume put_scanline_someplace wants a pointer and sample count. */
-            currPtr = copyScanline(currPtr, rowbuffer[0], row_stride);
+            int firstScanline = cinfo.output_scanline;
+            int numScanlines = osg::minimum(16, height - firstScanline);
+            for(int i=0; i<numScanlines; ++i)
+            {
+                rowpointers[i] = image->data(0, height - 1 - (firstScanline + i));
+            }
+
+            numScanlines = jpeg_read_scanlines(&cinfo, rowpointers, numScanlines);
+            destination->rowsDecoded(image, height - firstScanline - numScanlines, numScanlines);
         }
     }
     /* Step 7: Finish decompression */
@@ -637,17 +639,17 @@ unsigned char* simage_jpeg_load(std::istream& fin,
      */
 
     /* And we're done! */
-    if (buffer)
+    osg::ref_ptr<osg::Image> result = image;
+    if (image)
     {
-        *width_ret = width;
-        *height_ret = height;
-        *numComponents_ret = format;
+        image->unref();
+        destination->imageDecoded(result.get());
     }
     else
     {
         jpegerror = ERR_MEM;
     }
-    return buffer;
+    return result;
 }
 } // namespace osgDBJPEG
 
@@ -828,44 +830,16 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
 
         virtual const char* className() const { return "JPEG Image Reader/Writer"; }
 
-        ReadResult readJPGStream(std::istream& fin) const
+        ReadResult readJPGStream(std::istream& fin, const osgDB::ReaderWriter::Options* options) const
         {
-            unsigned char *imageData = NULL;
-            int width_ret;
-            int height_ret;
-            int numComponents_ret;
             unsigned int exif_orientation=0;
 
-            imageData = osgDBJPEG::simage_jpeg_load(fin, &width_ret, &height_ret, &numComponents_ret, &exif_orientation);
-
-            if (imageData==NULL) return ReadResult::ERROR_IN_READING_FILE;
-
-            int s = width_ret;
-            int t = height_ret;
-            int r = 1;
-
-            //int internalFormat = numComponents_ret;
-            int internalFormat =
-                numComponents_ret == 1 ? GL_LUMINANCE :
-                numComponents_ret == 2 ? GL_LUMINANCE_ALPHA :
-                numComponents_ret == 3 ? GL_RGB :
-                numComponents_ret == 4 ? GL_RGBA : (GLenum)-1;
-
-            unsigned int pixelFormat =
-                numComponents_ret == 1 ? GL_LUMINANCE :
-                numComponents_ret == 2 ? GL_LUMINANCE_ALPHA :
-                numComponents_ret == 3 ? GL_RGB :
-                numComponents_ret == 4 ? GL_RGBA : (GLenum)-1;
+            // decode straight into the image provided by the ImageDestination, when one is assigned, so that its storage is reused.
+            osg::ref_ptr<osgDB::ImageDestination> destination = (options && options->getImageDestination()) ? options->getImageDestination() : new osgDB::ImageDestination;
 
-            unsigned int dataType = GL_UNSIGNED_BYTE;
+            osg::ref_ptr<osg::Image> pOsgImage = osgDBJPEG::simage_jpeg_load(fin, destination.get(), &exif_orientation);
 
-            osg::ref_ptr<osg::Image> pOsgImage = new osg::Image;
-            pOsgImage->setImage(s,t,r,
-                internalFormat,
-                pixelFormat,
-                dataType,
-                imageData,
-                osg::Image::USE_NEW_DELETE);
+            if (!pOsgImage) return ReadResult::ERROR_IN_READING_FILE;
 
             if (exif_orientation>0)
             {
@@ -948,9 +922,9 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
             return readImage(file, options);
         }
 
-        virtual ReadResult readImage(std::istream& fin,const osgDB::ReaderWriter::Options* =NULL) const
+        virtual ReadResult readImage(std::istream& fin,const osgDB::ReaderWriter::Options* options =NULL) const
         {
-            return readJPGStream(fin);
+            return readJPGStream(fin, options);
         }
 
         virtual ReadResult readImage(const std::string& file, const osgDB::ReaderWriter::Options* options) const
@@ -963,7 +937,7 @@ class ReaderWriterJPEG : public osgDB::ReaderWriter
 
             osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
             if(!istream) return ReadResult::ERROR_IN_READING_FILE;
-            ReadResult rr = readJPGStream(istream);
+            ReadResult rr = readJPGStream(istream, options);
             if(rr.validImage()) rr.getImage()->setFileName(file);
             return rr;
         }
@@ -0,0 +1,392 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include "OctreeBuilder.h"
+
+#include <osg/Notify>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/PagedLOD>
+
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/WriteFile>
+
+#include <sstream>
+#include <stdio.h>
+#include <float.h>
+
+using namespace las;
+
+// the bucketing grid never goes finer than 2^MAX_GRID_DEPTH cells along each axis, which keeps the cell coordinates within the 21 bits of a CellKey
+static const unsigned int MAX_GRID_DEPTH = 16;
+
+// overfull grid cells are split in memory at most this many times, so that coincident points can't recurse forever
+static const unsigned int MAX_SPLIT_DEPTH = 16;
+
+OctreeBuilder::OctreeBuilder(const std::string& directory, const std::string& baseName, const osg::BoundingBoxd& bounds, double numPoints, unsigned int maxPointsPerTile):
+    _directory(directory),
+    _baseName(baseName),
+    _rootFileName(baseName+".osgb"),
+    _origin(bounds._min),
+    _size(0.0),
+    _maxPointsPerTile(osg::maximum(maxPointsPerTile, 4u)),
+    _memoryBudget(std::size_t(256)*1024*1024),
+    _lodScale(3.0f),
+    _depth(0),
+    _numCells(1),
+    _numBufferedPoints(0),
+    _ok(true)
+{
+    _size = osg::maximum(bounds.xMax()-bounds.xMin(), osg::maximum(bounds.yMax()-bounds.yMin(), bounds.zMax()-bounds.zMin()));
+    if (_size<=0.0) _size = 1.0;
+
+    // point clouds tend to be sampled from surfaces rather than volumes, so assume the number of occupied cells
+    // grows by four rather than eight with each level, cells that still end up overfull are split when built.
+    double numCellsOccupied = 1.0;
+    while (_depth<MAX_GRID_DEPTH && numPoints > numCellsOccupied*double(_maxPointsPerTile))
+    {
+        ++_depth;
+        numCellsOccupied *= 4.0;
+    }
+    _numCells = 1u << _depth;
+
+    OSG_INFO<<"las::OctreeBuilder grid depth "<<_depth<<" for "<<numPoints<<" points"<<std::endl;
+}
+
+OctreeBuilder::~OctreeBuilder()
+{
+    // clean up the temporary files of a build that failed or was never run
+    for(Buckets::iterator itr = _buckets.begin();
+        itr != _buckets.end();
+        ++itr)
+    {
+        if (itr->second.numWritten>0) remove(bucketFileName(itr->first).c_str());
+    }
+}
+
+OctreeBuilder::CellKey OctreeBuilder::makeKey(unsigned int x, unsigned int y, unsigned int z)
+{
+    return CellKey(x) | (CellKey(y)<<21) | (CellKey(z)<<42);
+}
+
+std::string OctreeBuilder::bucketFileName(CellKey key) const
+{
+    std::ostringstream str;
+    str<<_baseName<<"_bucket_"<<key<<".tmp";
+    return osgDB::concatPaths(_directory, str.str());
+}
+
+bool OctreeBuilder::addPoint(const osg::Vec3& position, const osg::Vec4ub& colour)
+{
+    double scale = double(_numCells)/_size;
+    unsigned int maxCell = _numCells-1;
+    unsigned int x = static_cast<unsigned int>(osg::clampBetween((double(position.x())-_origin.x())*scale, 0.0, double(maxCell)));
+    unsigned int y = static_cast<unsigned int>(osg::clampBetween((double(position.y())-_origin.y())*scale, 0.0, double(maxCell)));
+    unsigned int z = static_cast<unsigned int>(osg::clampBetween((double(position.z())-_origin.z())*scale, 0.0, double(maxCell)));
+
+    Point point;
+    point.position = position;
+    point.colour = colour;
+    _buckets[makeKey(x, y, z)].points.push_back(point);
+
+    if (++_numBufferedPoints >= _memoryBudget/sizeof(Point)) return flushBuckets();
+
+    return _ok;
+}
+
+bool OctreeBuilder::flushBuckets()
+{
+    for(Buckets::iterator itr = _buckets.begin();
+        itr != _buckets.end() && _ok;
+        ++itr)
+    {
+        Bucket& bucket = itr->second;
+        if (bucket.points.empty()) continue;
+
+        std::string fileName = bucketFileName(itr->first);
+        FILE* fp = osgDB::fopen(fileName.c_str(), "ab");
+        if (!fp)
+        {
+            OSG_WARN<<"las::OctreeBuilder unable to open temporary file "<<fileName<<std::endl;
+            _ok = false;
+            break;
+        }
+
+        size_t numWritten = fwrite(&bucket.points.front(), sizeof(Point), bucket.points.size(), fp);
+        fclose(fp);
+
+        bucket.numWritten += numWritten;
+        if (numWritten!=bucket.points.size())
+        {
+            OSG_WARN<<"las::OctreeBuilder unable to write temporary file "<<fileName<<std::endl;
+            _ok = false;
+            break;
+        }
+
+        // release the memory rather than just clearing, as most buckets won't be touched again for a while
+        Points().swap(bucket.points);
+    }
+
+    _numBufferedPoints = 0;
+
+    return _ok;
+}
+
+bool OctreeBuilder::loadBucket(CellKey key, Points& points)
+{
+    Bucket& bucket = _buckets[key];
+
+    points.reserve(bucket.numWritten + bucket.points.size());
+
+    if (bucket.numWritten>0)
+    {
+        std::string fileName = bucketFileName(key);
+        FILE* fp = osgDB::fopen(fileName.c_str(), "rb");
+        if (!fp)
+        {
+            OSG_WARN<<"las::OctreeBuilder unable to open temporary file "<<fileName<<std::endl;
+            return false;
+        }
+
+        points.resize(bucket.numWritten);
+        size_t numRead = fread(&points.front(), sizeof(Point), bucket.numWritten, fp);
+        fclose(fp);
+        remove(fileName.c_str());
+
+        bucket.numWritten = 0;
+        if (numRead!=points.size())
+        {
+            OSG_WARN<<"las::OctreeBuilder unable to read temporary file "<<fileName<<std::endl;
+            return false;
+        }
+    }
+
+    points.insert(points.end(), bucket.points.begin(), bucket.points.end());
+    Points().swap(bucket.points);
+
+    return true;
+}
+
+osg::ref_ptr<osg::Node> OctreeBuilder::build()
+{
+    if (!_ok || _buckets.empty()) return 0;
+
+    // mark the cells occupied at each level of the octree above the bucketing grid
+    _occupied.clear();
+    _occupied.resize(_depth+1);
+    CellKey mask = (CellKey(1)<<21)-1;
+    for(Buckets::iterator itr = _buckets.begin();
+        itr != _buckets.end();
+        ++itr)
+    {
+        unsigned int x = static_cast<unsigned int>(itr->first & mask);
+        unsigned int y = static_cast<unsigned int>((itr->first>>21) & mask);
+        unsigned int z = static_cast<unsigned int>((itr->first>>42) & mask);
+        for(unsigned int level=0; level<=_depth; ++level)
+        {
+            unsigned int shift = _depth-level;
+            _occupied[level].insert(makeKey(x>>shift, y>>shift, z>>shift));
+        }
+    }
+
+    Tile root;
+    if (!buildCell(0, 0, 0, 0, "", root)) return 0;
+
+    osg::ref_ptr<osg::Node> node = root.node;
+    if (!_transform.isIdentity())
+    {
+        osg::ref_ptr<osg::MatrixTransform> mt = new osg::MatrixTransform(_transform);
+        mt->setDataVariance(osg::Object::STATIC);
+        mt->addChild(root.node.get());
+        node = mt;
+    }
+
+    std::string fileName = osgDB::concatPaths(_directory, _rootFileName);
+    if (!osgDB::writeNodeFile(*node, fileName))
+    {
+        OSG_WARN<<"las::OctreeBuilder unable to write "<<fileName<<std::endl;
+        return 0;
+    }
+
+    // the copy on disk picks up its database path from where it's read from, the one returned needs to be told
+    osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(root.node.get());
+    if (plod) plod->setDatabasePath(_directory);
+
+    return node;
+}
+
+bool OctreeBuilder::buildCell(unsigned int level, unsigned int x, unsigned int y, unsigned int z, const std::string& path, Tile& tile)
+{
+    if (level==_depth)
+    {
+        Points points;
+        if (!loadBucket(makeKey(x, y, z), points)) return false;
+
+        return buildPoints(points, cellBounds(level, x, y, z), path, 0, tile);
+    }
+
+    std::vector<Tile> children;
+    children.reserve(8);
+    for(unsigned int i=0; i<8; ++i)
+    {
+        unsigned int cx = x*2 + (i&1);
+        unsigned int cy = y*2 + ((i>>1)&1);
+        unsigned int cz = z*2 + ((i>>2)&1);
+        if (_occupied[level+1].count(makeKey(cx, cy, cz))==0) continue;
+
+        children.push_back(Tile());
+        if (!buildCell(level+1, cx, cy, cz, path+char('0'+i), children.back())) return false;
+    }
+
+    return buildInner(children, cellBounds(level, x, y, z), path, tile);
+}
+
+bool OctreeBuilder::buildPoints(Points& points, const osg::BoundingBox& bounds, const std::string& path, unsigned int depth, Tile& tile)
+{
+    if (points.size()<=_maxPointsPerTile || depth>=MAX_SPLIT_DEPTH)
+    {
+        tile.node = createPoints(points);
+        subsample(points, _maxPointsPerTile/4, tile.sample);
+        return true;
+    }
+
+    // the grid cell holds too many points for one tile, so split it into octants
+    osg::Vec3 center = bounds.center();
+    std::vector<Points> octants(8);
+    for(Points::const_iterator itr = points.begin();
+        itr != points.end();
+        ++itr)
+    {
+        unsigned int i = (itr->position.x()>=center.x() ? 1 : 0) |
+                         (itr->position.y()>=center.y() ? 2 : 0) |
+                         (itr->position.z()>=center.z() ? 4 : 0);
+        octants[i].push_back(*itr);
+    }
+    Points().swap(points);
+
+    std::vector<Tile> children;
+    children.reserve(8);
+    for(unsigned int i=0; i<8; ++i)
+    {
+        if (octants[i].empty()) continue;
+
+        osg::BoundingBox childBounds((i&1) ? center.x() : bounds.xMin(),
+                                     (i&2) ? center.y() : bounds.yMin(),
+                                     (i&4) ? center.z() : bounds.zMin(),
+                                     (i&1) ? bounds.xMax() : center.x(),
+                                     (i&2) ? bounds.yMax() : center.y(),
+                                     (i&4) ? bounds.zMax() : center.z());
+
+        children.push_back(Tile());
+        if (!buildPoints(octants[i], childBounds, path+char('0'+i), depth+1, children.back())) return false;
+    }
+
+    return buildInner(children, bounds, path, tile);
+}
+
+bool OctreeBuilder::buildInner(std::vector<Tile>& children, const osg::BoundingBox& bounds, const std::string& path, Tile& tile)
+{
+    // each child passes up a quarter of a tile, so surfaces end up with a full tile and volumes with two before thinning
+    Points samples;
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    for(std::vector<Tile>::iterator itr = children.begin();
+        itr != children.end();
+        ++itr)
+    {
+        samples.insert(samples.end(), itr->sample.begin(), itr->sample.end());
+        Points().swap(itr->sample);
+
+        group->addChild(itr->node.get());
+        itr->node = 0;
+    }
+
+    std::string fileName = _baseName+"_t"+path+".osgb";
+    if (!osgDB::writeNodeFile(*group, osgDB::concatPaths(_directory, fileName)))
+    {
+        OSG_WARN<<"las::OctreeBuilder unable to write "<<osgDB::concatPaths(_directory, fileName)<<std::endl;
+        return false;
+    }
+
+    Points coarse;
+    subsample(samples, _maxPointsPerTile, coarse);
+    Points().swap(samples);
+
+    float cutOff = bounds.radius()*_lodScale;
+
+    osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+    plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+    plod->setCenter(bounds.center());
+    plod->setRadius(bounds.radius());
+    plod->addChild(createPoints(coarse), cutOff, FLT_MAX);
+    plod->setFileName(1, fileName);
+    plod->setRange(1, 0.0f, cutOff);
+
+    tile.node = plod;
+    subsample(coarse, _maxPointsPerTile/4, tile.sample);
+
+    return true;
+}
+
+osg::BoundingBox OctreeBuilder::cellBounds(unsigned int level, unsigned int x, unsigned int y, unsigned int z) const
+{
+    double cellSize = _size/double(1u<<level);
+    osg::Vec3d cellMin = _origin + osg::Vec3d(double(x)*cellSize, double(y)*cellSize, double(z)*cellSize);
+    osg::Vec3d cellMax = cellMin + osg::Vec3d(cellSize, cellSize, cellSize);
+    return osg::BoundingBox(cellMin, cellMax);
+}
+
+osg::Node* OctreeBuilder::createPoints(const Points& points) const
+{
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::Vec4ubArray* colours = new osg::Vec4ubArray;
+    vertices->reserve(points.size());
+    colours->reserve(points.size());
+    for(Points::const_iterator itr = points.begin();
+        itr != points.end();
+        ++itr)
+    {
+        vertices->push_back(itr->position);
+        colours->push_back(itr->colour);
+    }
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setUseDisplayList(true);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setVertexArray(vertices);
+    geometry->setColorArray(colours, osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 0, vertices->size()));
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(geometry);
+    return geode;
+}
+
+void OctreeBuilder::subsample(const Points& points, unsigned int maxNumPoints, Points& sample) const
+{
+    if (points.size()<=maxNumPoints)
+    {
+        sample = points;
+        return;
+    }
+
+    // points arrive in scan order, so an even stride through them spreads the sample evenly over the tile
+    double stride = double(points.size())/double(maxNumPoints);
+    sample.clear();
+    sample.reserve(maxNumPoints);
+    for(unsigned int i=0; i<maxNumPoints; ++i)
+    {
+        sample.push_back(points[static_cast<size_t>(double(i)*stride)]);
+    }
+}
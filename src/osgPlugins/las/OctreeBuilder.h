@@ -0,0 +1,135 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef LAS_OCTREEBUILDER_H
+#define LAS_OCTREEBUILDER_H
+
+#include <osg/Node>
+#include <osg/BoundingBox>
+#include <osg/Matrixd>
+#include <osg/Vec3>
+#include <osg/Vec4ub>
+#include <osg/Math>
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace las
+{
+
+/** OctreeBuilder turns a stream of points into a PagedLOD octree written out as .osgb tiles, so that point clouds far
+  * larger than memory can be paged in by the DatabasePager. Points are bucketed into the cells of a regular grid,
+  * buffered in memory up to a fixed budget and spilled to temporary files in the output directory, then the octree is
+  * built bottom up one grid cell at a time. Every tile holds at most maxPointsPerTile points, with inner tiles holding
+  * a uniform subsample of the points of their children.*/
+class OctreeBuilder
+{
+    public:
+
+        struct Point
+        {
+            osg::Vec3   position;
+            osg::Vec4ub colour;
+        };
+
+        /** Create a builder writing its tiles to directory, bounds is the extent of the points to be added and
+          * numPoints an estimate of their number used to choose the resolution of the bucketing grid.*/
+        OctreeBuilder(const std::string& directory, const std::string& baseName, const osg::BoundingBoxd& bounds, double numPoints, unsigned int maxPointsPerTile=65536);
+
+        ~OctreeBuilder();
+
+        /** Set the number of bytes of points held in memory before they are written out to the temporary files,
+          * budgets smaller than a single point are raised to one point.*/
+        void setMemoryBudget(std::size_t bytes) { _memoryBudget = osg::maximum(bytes, sizeof(Point)); }
+        std::size_t getMemoryBudget() const { return _memoryBudget; }
+
+        /** Set the ratio of the distance from the eye at which the children of a tile are paged in to the tile's radius.*/
+        void setLODScale(float scale) { _lodScale = scale; }
+        float getLODScale() const { return _lodScale; }
+
+        /** Set the transform from the coordinates of the points added to world coordinates. When not the identity the
+          * octree is placed below a MatrixTransform, so that the root written out can be reloaded on its own.*/
+        void setTransform(const osg::Matrixd& matrix) { _transform = matrix; }
+        const osg::Matrixd& getTransform() const { return _transform; }
+
+        /** Add a point, return false if the points buffered so far could not be written out.*/
+        bool addPoint(const osg::Vec3& position, const osg::Vec4ub& colour);
+
+        /** Build and write out the tiles, returning the root of the octree, including its transform, or NULL on failure.
+          * The root is also written to <baseName>.osgb so that the octree can be reloaded without rebuilding it.*/
+        osg::ref_ptr<osg::Node> build();
+
+        const std::string& getRootFileName() const { return _rootFileName; }
+
+    protected:
+
+        typedef unsigned long long CellKey;
+        typedef std::vector<Point> Points;
+
+        struct Bucket
+        {
+            Bucket() : numWritten(0) {}
+
+            Points          points;
+            unsigned int    numWritten;
+        };
+
+        struct Tile
+        {
+            osg::ref_ptr<osg::Node> node;
+            Points                  sample;
+        };
+
+        typedef std::map<CellKey, Bucket> Buckets;
+
+        static CellKey makeKey(unsigned int x, unsigned int y, unsigned int z);
+
+        std::string bucketFileName(CellKey key) const;
+
+        bool flushBuckets();
+        bool loadBucket(CellKey key, Points& points);
+
+        bool buildCell(unsigned int level, unsigned int x, unsigned int y, unsigned int z, const std::string& path, Tile& tile);
+        bool buildPoints(Points& points, const osg::BoundingBox& bounds, const std::string& path, unsigned int depth, Tile& tile);
+        bool buildInner(std::vector<Tile>& children, const osg::BoundingBox& bounds, const std::string& path, Tile& tile);
+
+        osg::BoundingBox cellBounds(unsigned int level, unsigned int x, unsigned int y, unsigned int z) const;
+
+        osg::Node* createPoints(const Points& points) const;
+
+        void subsample(const Points& points, unsigned int maxNumPoints, Points& sample) const;
+
+        std::string                     _directory;
+        std::string                     _baseName;
+        std::string                     _rootFileName;
+        osg::Vec3d                      _origin;
+        double                          _size;
+        unsigned int                    _maxPointsPerTile;
+        std::size_t                     _memoryBudget;
+        float                           _lodScale;
+        osg::Matrixd                    _transform;
+
+        unsigned int                    _depth;
+        unsigned int                    _numCells;
+        Buckets                         _buckets;
+        std::size_t                     _numBufferedPoints;
+        std::vector< std::set<CellKey> > _occupied;
+        bool                            _ok;
+};
+
+}
+
+#endif
@@ -11,7 +11,9 @@
 
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <liblas/liblas.hpp>
@@ -19,6 +21,8 @@
 #include <liblas/point.hpp>
 #include <liblas/detail/timer.hpp>
 
+#include "OctreeBuilder.h"
+
 class ReaderWriterLAS : public osgDB::ReaderWriter
 {
     public:
@@ -30,6 +34,9 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
             supportsOption("v", "Verbose output");
             supportsOption("noScale", "don't scale vertices according to las header - put scale in matrixTransform");
             supportsOption("noReCenter", "don't transform vertex coords to re-center the pointcloud");
+            supportsOption("octree=<directory>", "stream the points into a PagedLOD octree of .osgb tiles written to directory, rather than loading them all into memory");
+            supportsOption("octreeTilePoints=<n>", "maximum number of points in each octree tile, default 65536");
+            supportsOption("octreeMemory=<MB>", "memory used to buffer points while building the octree, default 256");
         }
 
         virtual const char* className() const { return "LAS point cloud reader"; }
@@ -53,7 +60,7 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
             {
                 return ReadResult::ERROR_IN_READING_FILE;
             }
-            return readNode(ifs, options);
+            return readLAS(ifs, osgDB::getStrippedName(fileName), options);
         }
 
         virtual ReadResult readObject(std::istream& fin, const osgDB::ReaderWriter::Options* options) const
@@ -61,17 +68,32 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
             return readNode(fin, options);
         }
 
-       virtual ReadResult readNode(std::istream& ifs, const Options* options) const {
+        virtual ReadResult readNode(std::istream& ifs, const Options* options) const
+        {
+            return readLAS(ifs, "pointcloud", options);
+        }
+
+    protected:
+
+        ReadResult readLAS(std::istream& ifs, const std::string& baseName, const Options* options) const
+        {
             // Reading options
             bool _verbose = false;
             bool _scale = true;
             bool _recenter = true;
+            std::string _octreeDirectory;
+            unsigned int _octreeTilePoints = 65536;
+            unsigned int _octreeMemory = 256;
             if (options)
             {
                 std::istringstream iss(options->getOptionString());
                 std::string opt;
                 while (iss >> opt)
                 {
+                    std::string::size_type pos = opt.find('=');
+                    std::string key = opt.substr(0, pos);
+                    std::string value = (pos != std::string::npos) ? opt.substr(pos+1) : std::string();
+
                     if (opt == "v")
                     {
                         _verbose = true;
@@ -84,6 +106,20 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
                     {
                         _recenter = false;
                     }
+                    if (key == "octree")
+                    {
+                        _octreeDirectory = value;
+                    }
+                    if (key == "octreeTilePoints")
+                    {
+                        _octreeTilePoints = atoi(value.c_str());
+                    }
+                    if (key == "octreeMemory")
+                    {
+                        int memoryMB = atoi(value.c_str());
+                        if (memoryMB>0) _octreeMemory = memoryMB;
+                        else OSG_WARN << "LAS reader ignoring octreeMemory=" << value << ", the budget must be at least 1MB" << std::endl;
+                    }
                 }
             }
             liblas::ReaderFactory f;
@@ -106,6 +142,10 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
                 std::cout << std::endl;
             }
 
+            if (!_octreeDirectory.empty())
+            {
+                return readOctree(reader, baseName, _octreeDirectory, _octreeTilePoints, _octreeMemory, _verbose, _scale, _recenter);
+            }
 
             // POINTS ////
 
@@ -257,6 +297,90 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
                     << std::endl << std::endl;
             }
 
+            osg::MatrixTransform *mt = createTransform(h, _scale, _recenter, mid_x, mid_y, mid_z);
+            mt->addChild (geode);
+
+            return mt;
+        }
+
+        ReadResult readOctree(liblas::Reader& reader, const std::string& baseName, const std::string& directory,
+                              unsigned int tilePoints, unsigned int memoryMB, bool _verbose, bool _scale, bool _recenter) const
+        {
+            liblas::Header const& h = reader.GetHeader();
+
+            if (!osgDB::makeDirectory(directory))
+            {
+                OSG_WARN << "LAS reader unable to create octree directory " << directory << std::endl;
+                return ReadResult::ERROR_IN_READING_FILE;
+            }
+
+            // the points are only read once, so the extents have to come from the header rather than the points
+            osg::Vec3d scaleVec(h.GetScaleX(), h.GetScaleY(), h.GetScaleZ());
+            osg::Vec3d minVec(h.GetMinX() - h.GetOffsetX(), h.GetMinY() - h.GetOffsetY(), h.GetMinZ() - h.GetOffsetZ());
+            osg::Vec3d maxVec(h.GetMaxX() - h.GetOffsetX(), h.GetMaxY() - h.GetOffsetY(), h.GetMaxZ() - h.GetOffsetZ());
+            if (!_scale)
+            {
+                minVec = osg::componentDivide(minVec, scaleVec);
+                maxVec = osg::componentDivide(maxVec, scaleVec);
+            }
+
+            osg::Vec3d midVec;
+            if (_recenter) midVec = (minVec + maxVec) * 0.5;
+
+            las::OctreeBuilder builder(directory, baseName, osg::BoundingBoxd(minVec - midVec, maxVec - midVec), h.GetPointRecordsCount(), tilePoints);
+            // compute the budget in bytes as a size_t, clamped so that it can't overflow on 32 bit platforms
+            std::size_t maxMemoryMB = std::numeric_limits<std::size_t>::max()/(1024*1024);
+            builder.setMemoryBudget(osg::minimum(static_cast<std::size_t>(memoryMB), maxMemoryMB)*1024*1024);
+
+            // the builder places the octree below the transform itself, so that the root written out is complete
+            osg::ref_ptr<osg::MatrixTransform> mt = createTransform(h, _scale, _recenter, midVec.x(), midVec.y(), midVec.z());
+            builder.setTransform(mt->getMatrix());
+
+            liblas::detail::Timer t;
+            t.start();
+
+            uint32_t i = 0;
+            while (reader.ReadNextPoint())
+            {
+                liblas::Point const& p = reader.GetPoint();
+
+                liblas::Color c = p.GetColor();
+                osg::Vec4ub colour(c.GetRed() >> 8, c.GetGreen() >> 8, c.GetBlue() >> 8, 255);
+
+                double X = p.GetRawX();
+                double Y = p.GetRawY();
+                double Z = p.GetRawZ();
+                if (_scale)
+                {
+                    X *= h.GetScaleX();
+                    Y *= h.GetScaleY();
+                    Z *= h.GetScaleZ();
+                }
+
+                if (!builder.addPoint(osg::Vec3(X - midVec.x(), Y - midVec.y(), Z - midVec.z()), colour))
+                {
+                    return ReadResult::ERROR_IN_READING_FILE;
+                }
+                i++;
+            }
+
+            osg::ref_ptr<osg::Node> root = builder.build();
+            if (!root) return ReadResult::ERROR_IN_READING_FILE;
+
+            double const d2 = t.stop();
+
+            if (_verbose)
+            {
+                std::cout << "Read points: " << i << " Elapsed Time: " << d2 << std::endl;
+                std::cout << "Octree written to: " << osgDB::concatPaths(directory, builder.getRootFileName())
+                    << std::endl << std::endl;
+            }
+
+            return root.release();
+        }
+
+        osg::MatrixTransform* createTransform(liblas::Header const& h, bool _scale, bool _recenter, double mid_x, double mid_y, double mid_z) const
+        {
             // MatrixTransform with the mid-point translation
 
             osg::MatrixTransform *mt = new osg::MatrixTransform;
@@ -287,8 +411,6 @@ class ReaderWriterLAS : public osgDB::ReaderWriter
                 }
             }
 
-            mt->addChild (geode);
-
             return mt;
         }
 };
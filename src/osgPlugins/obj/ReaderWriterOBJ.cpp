@@ -63,6 +63,7 @@ public:
         supportsOption("noTriStripPolygons","Do not do the default tri stripping of polygons");
         supportsOption("generateFacetNormals","generate facet normals for vertices without normals");
         supportsOption("noReverseFaces","avoid to reverse faces when normals and triangles orientation are reversed");
+        supportsOption("numThreads=<n>","Set the number of threads used to parse the file, 0 for all the threads of the shared TaskScheduler, the default");
 
         supportsOption("DIFFUSE=<unit>", "Set texture unit for diffuse texture");
         supportsOption("AMBIENT=<unit>", "Set texture unit for ambient texture");
@@ -170,6 +171,7 @@ protected:
         int precision;
         bool outputTextureFiles;
         int specularExponent;
+        unsigned int numThreads;
 
         ObjOptionsStruct()
         {
@@ -182,6 +184,7 @@ protected:
             precision = std::numeric_limits<double>::digits10 + 2;
             outputTextureFiles = false;
             specularExponent = -1;
+            numThreads = 0;
         }
     };
 
@@ -908,6 +911,10 @@ ReaderWriterOBJ::ObjOptionsStruct ReaderWriterOBJ::parseOptions(const osgDB::Rea
                     localOptions.precision = val;
                 }
             }
+            else if (pre_equals == "numThreads")
+            {
+                localOptions.numThreads = atoi(post_equals.c_str());
+            }
             else if (pre_equals == "NsIfNotPresent")
             {
                 int value = atoi(post_equals.c_str());
@@ -955,11 +962,11 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(const std::string& fil
         osg::ref_ptr<Options> local_opt = options ? static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
         local_opt->getDatabasePathList().push_front(osgDB::getFilePath(fileName));
 
+        ObjOptionsStruct localOptions = parseOptions(options);
+
         obj::Model model;
         model.setDatabasePath(osgDB::getFilePath(fileName.c_str()));
-        model.readOBJ(fin, local_opt.get());
-
-        ObjOptionsStruct localOptions = parseOptions(options);
+        model.readOBJ(fin, local_opt.get(), localOptions.numThreads);
 
         osg::Node* node = convertModelToSceneGraph(model, localOptions, local_opt.get());
         return node;
@@ -972,11 +979,11 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(std::istream& fin, con
 {
     if (fin)
     {
-        obj::Model model;
-        model.readOBJ(fin, options);
-
         ObjOptionsStruct localOptions = parseOptions(options);
 
+        obj::Model model;
+        model.readOBJ(fin, options, localOptions.numThreads);
+
         osg::Node* node = convertModelToSceneGraph(model, localOptions, options);
         return node;
     }
@@ -16,11 +16,16 @@
 #include <fstream>
 #include <string>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include <functional>
+#include <deque>
 
 #include "obj.h"
 
 #include <osg/Notify>
+#include <osg/TaskScheduler>
+#include <osg/Timer>
 
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
@@ -560,287 +565,591 @@ std::string trim(const std::string& s)
   return std::string(s, b, e - b + 1);
 }
 
-inline bool isZBrushColorField(char* line)
+// Read the next line from [ptr,end) with the same handling of line endings, continuation lines and white space as Model::readline().
+static const char* readChunkLine(const char* ptr, const char* end, std::string& line)
 {
-    return strncmp(line, "#MRGB", 5) == 0;
+    line.clear();
+
+    bool eatWhiteSpaceAtStart = true;
+    while (ptr<end)
+    {
+        char c = *ptr++;
+        if (c=='\r' || c=='\n')
+        {
+            // treat \r\n as a single windows line ending
+            if (c=='\r' && ptr<end && *ptr=='\n') ++ptr;
+
+            // a backslash at the end of a line continues it on the next
+            if (!line.empty() && line[line.size()-1]=='\\')
+            {
+                line[line.size()-1] = ' ';
+                continue;
+            }
+            break;
+        }
+
+        if (!eatWhiteSpaceAtStart || (c!=' ' && c!='\t'))
+        {
+            eatWhiteSpaceAtStart = false;
+            line.push_back(c=='\t' ? ' ' : c);
+        }
+    }
+
+    // strip trailing spaces
+    std::string::size_type length = line.size();
+    while (length>0 && line[length-1]==' ') --length;
+    line.resize(length);
+
+    return ptr;
 }
 
-bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options)
+// Parse a decimal floating point number, skipping leading spaces. Much faster than sscanf and independent of the locale,
+// it falls back to strtod for anything it doesn't recognise, such as nan and inf.
+static bool parseFloat(const char*& ptr, float& value)
 {
-    OSG_INFO<<"Reading OBJ file"<<std::endl;
+    const char* p = ptr;
+    while (*p==' ') ++p;
 
-    fin.imbue(std::locale::classic());
+    const char* start = p;
+    bool negative = (*p=='-');
+    if (*p=='-' || *p=='+') ++p;
 
-    const int LINE_SIZE = 4096;
-    char line[LINE_SIZE];
-    float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
-    float r,g,b,a;
+    double mantissa = 0.0;
+    int exponent = 0;
+    int numSignificantDigits = 0;
+    bool hasDigits = false;
 
-    while (fin)
+    for(; *p>='0' && *p<='9'; ++p)
     {
-        readline(fin,line,LINE_SIZE);
-        if ((line[0]=='#' && !isZBrushColorField(line)) || line[0]=='$')
+        hasDigits = true;
+        if (numSignificantDigits<18)
         {
-            // comment line
-            // OSG_NOTICE <<"Comment: "<<line<<std::endl;
+            mantissa = mantissa*10.0 + (*p-'0');
+            if (mantissa!=0.0) ++numSignificantDigits;
         }
-        else if(isZBrushColorField(line))
+        else ++exponent;
+    }
+
+    if (*p=='.')
+    {
+        for(++p; *p>='0' && *p<='9'; ++p)
         {
-            // Get the zBrush vertex colors given in comments under the form :
-            // * #MRGB MMRRGGBB MMRRGGBB ... (up to 64 hexadecimal color fields)
-            std::string colorFields(line + 6);
-            while (colorFields.size() >= 8)
+            hasDigits = true;
+            if (numSignificantDigits<18)
             {
-                std::string currentValue;
+                mantissa = mantissa*10.0 + (*p-'0');
+                if (mantissa!=0.0) ++numSignificantDigits;
+                --exponent;
+            }
+        }
+    }
 
-                // Skipping the MM component
-                colorFields = colorFields.substr(2);
+    if (!hasDigits)
+    {
+        char* endptr = 0;
+        double result = strtod(start, &endptr);
+        if (endptr==start) return false;
+        value = static_cast<float>(result);
+        ptr = endptr;
+        return true;
+    }
 
-                currentValue = colorFields.substr(0,2);
-                r = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
+    if ((*p=='e' || *p=='E') && ((p[1]>='0' && p[1]<='9') || ((p[1]=='-' || p[1]=='+') && p[2]>='0' && p[2]<='9')))
+    {
+        ++p;
+        bool negativeExponent = (*p=='-');
+        if (*p=='-' || *p=='+') ++p;
 
-                currentValue = colorFields.substr(0,2);
-                g = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
+        int e = 0;
+        for(; *p>='0' && *p<='9'; ++p)
+        {
+            if (e<10000) e = e*10 + (*p-'0');
+        }
+        exponent += negativeExponent ? -e : e;
+    }
 
-                currentValue = colorFields.substr(0,2);
-                b = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
-                colorFields = colorFields.substr(2);
+    static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    if (exponent>=0 && exponent<=22) mantissa *= powersOfTen[exponent];
+    else if (exponent<0 && exponent>=-22) mantissa /= powersOfTen[-exponent];
+    else mantissa *= pow(10.0, exponent);
 
-                colors.push_back(osg::Vec4(r, g, b, 1.0));
-            }
-        }
-        else if (strlen(line)>0)
-        {
-            if (strncmp(line,"v ",2)==0)
-            {
-                unsigned int fieldsRead = sscanf(line+2,"%f %f %f %f %f %f %f", &x, &y, &z, &w, &g, &b, &a);
-
-                if (fieldsRead==1)
-                    vertices.push_back(osg::Vec3(x,0.0f,0.0f));
-                else if (fieldsRead==2)
-                    vertices.push_back(osg::Vec3(x,y,0.0f));
-                else if (fieldsRead==3)
-                    vertices.push_back(osg::Vec3(x,y,z));
-                else if (fieldsRead == 4)
-                    vertices.push_back(osg::Vec3(x/w,y/w,z/w));
-                else if (fieldsRead == 6)
-                {
-                    vertices.push_back(osg::Vec3(x,y,z));
-                    colors.push_back(osg::Vec4(w, g, b, 1.0));
-                }
-                else if ( fieldsRead == 7 )
-                {
-                    vertices.push_back(osg::Vec3(x,y,z));
-                    colors.push_back(osg::Vec4(w, g, b, a));
-                }
-            }
-            else if (strncmp(line,"vn ",3)==0)
-            {
-                unsigned int fieldsRead = sscanf(line+3,"%f %f %f", &x, &y, &z);
+    value = static_cast<float>(negative ? -mantissa : mantissa);
+    ptr = p;
+    return true;
+}
 
-                if (fieldsRead==1) normals.push_back(osg::Vec3(x,0.0f,0.0f));
-                else if (fieldsRead==2) normals.push_back(osg::Vec3(x,y,0.0f));
-                else if (fieldsRead==3) normals.push_back(osg::Vec3(x,y,z));
-            }
-            else if (strncmp(line,"vt ",3)==0)
-            {
-                unsigned int fieldsRead = sscanf(line+3,"%f %f %f", &x, &y, &z);
+static bool parseInt(const char*& ptr, int& value)
+{
+    const char* p = ptr;
+    bool negative = (*p=='-');
+    if (*p=='-' || *p=='+') ++p;
+    if (*p<'0' || *p>'9') return false;
 
-                if (fieldsRead==1) texcoords.push_back(osg::Vec2(x,0.0f));
-                else if (fieldsRead==2) texcoords.push_back(osg::Vec2(x,y));
-                else if (fieldsRead==3) texcoords.push_back(osg::Vec2(x,y));
-            }
-            else if (strncmp(line,"l ",2)==0 ||
-                     strncmp(line,"p ",2)==0 ||
-                     strncmp(line,"f ",2)==0)
-            {
-                char* ptr = line+2;
+    int result = 0;
+    for(; *p>='0' && *p<='9'; ++p) result = result*10 + (*p-'0');
 
-                Element* element = new Element( (line[0]=='p') ? Element::POINTS :
-                                                (line[0]=='l') ? Element::POLYLINE :
-                                                Element::POLYGON );
+    value = negative ? -result : result;
+    ptr = p;
+    return true;
+}
 
-                // OSG_NOTICE<<"face"<<ptr<<std::endl;
+inline bool isZBrushColorField(const char* line)
+{
+    return strncmp(line, "#MRGB", 5) == 0;
+}
 
-                int vi=0, ti=0, ni=0;
-                while(*ptr!=0)
-                {
-                    // skip white space
-                    while(*ptr==' ') ++ptr;
+void Chunk::parse()
+{
+    std::string line;
+    const char* ptr = text.c_str();
+    const char* end = ptr + text.size();
+    while (ptr<end)
+    {
+        ptr = readChunkLine(ptr, end, line);
+        parseLine(line);
+    }
 
-                    if (sscanf(ptr, "%d/%d/%d", &vi, &ti, &ni) == 3)
-                    {
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        if (normals.size() > 0 && remapNormalIndex(ni) < static_cast<int>(normals.size())) element->normalIndices.push_back(remapNormalIndex(ni));
-                        if (texcoords.size() > 0 && remapTexCoordIndex(ti) < static_cast<int>(texcoords.size())) element->texCoordIndices.push_back(remapTexCoordIndex(ti));
-                    }
-                    else if (sscanf(ptr, "%d//%d", &vi, &ni) == 2)
-                    {
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        if (normals.size() > 0 && remapNormalIndex(ni) < static_cast<int>(normals.size())) element->normalIndices.push_back(remapNormalIndex(ni));
-                    }
-                    else if (sscanf(ptr, "%d/%d", &vi, &ti) == 2)
-                    {
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                        if (texcoords.size() > 0 && remapTexCoordIndex(ti) < static_cast<int>(texcoords.size())) element->texCoordIndices.push_back(remapTexCoordIndex(ti));
-                    }
-                    else if (sscanf(ptr, "%d", &vi) == 1)
-                    {
-                        element->vertexIndices.push_back(remapVertexIndex(vi));
-                    }
+    // release the text now it's been parsed
+    std::string().swap(text);
+}
 
-                    // skip to white space or end of line
-                    while(*ptr!=' ' && *ptr!=0) ++ptr;
+void Chunk::parseLine(const std::string& lineString)
+{
+    const char* line = lineString.c_str();
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
+    float r,g,b,a;
 
-                }
+    if ((line[0]=='#' && !isZBrushColorField(line)) || line[0]=='$' || line[0]==0)
+    {
+        // comment or empty line
+    }
+    else if(isZBrushColorField(line))
+    {
+        // Get the zBrush vertex colors given in comments under the form :
+        // * #MRGB MMRRGGBB MMRRGGBB ... (up to 64 hexadecimal color fields)
+        std::string colorFields(line + 6);
+        while (colorFields.size() >= 8)
+        {
+            std::string currentValue;
 
-                if (!element->normalIndices.empty() && element->normalIndices.size() != element->vertexIndices.size())
-                {
-                    element->normalIndices.clear();
-                }
+            // Skipping the MM component
+            colorFields = colorFields.substr(2);
 
-                if (!element->texCoordIndices.empty() && element->texCoordIndices.size() != element->vertexIndices.size())
-                {
-                    element->texCoordIndices.clear();
-                }
+            currentValue = colorFields.substr(0,2);
+            r = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+            colorFields = colorFields.substr(2);
 
-                if (!element->vertexIndices.empty())
-                {
-                    Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
-                    if (coordateCombination!=currentElementState.coordinateCombination)
-                    {
-                        currentElementState.coordinateCombination = coordateCombination;
-                        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                    }
-                    addElement(element);
-                }
-                else
-                {
-                    // empty element, don't both adding, just unref to delete it.
-                    element->unref();
-                }
+            currentValue = colorFields.substr(0,2);
+            g = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+            colorFields = colorFields.substr(2);
 
-            }
-            else if (strncmp(line,"usemtl ",7)==0)
-            {
-                std::string materialName( line+7 );
-                if (currentElementState.materialName != materialName)
-                {
-                    currentElementState.materialName = materialName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
-            }
-            else if (strncmp(line,"mtllib ",7)==0)
+            currentValue = colorFields.substr(0,2);
+            b = static_cast<float>(strtol(currentValue.c_str(), NULL, 16)) / 255.;
+            colorFields = colorFields.substr(2);
+
+            colors.push_back(osg::Vec4(r, g, b, 1.0));
+        }
+    }
+    else if (strncmp(line,"v ",2)==0)
+    {
+        float fields[7] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        unsigned int fieldsRead = 0;
+        const char* ptr = line+2;
+        while (fieldsRead<7 && parseFloat(ptr, fields[fieldsRead])) ++fieldsRead;
+
+        x = fields[0]; y = fields[1]; z = fields[2]; w = fields[3];
+        g = fields[4]; b = fields[5]; a = fields[6];
+
+        if (fieldsRead==1)
+            vertices.push_back(osg::Vec3(x,0.0f,0.0f));
+        else if (fieldsRead==2)
+            vertices.push_back(osg::Vec3(x,y,0.0f));
+        else if (fieldsRead==3)
+            vertices.push_back(osg::Vec3(x,y,z));
+        else if (fieldsRead == 4)
+            vertices.push_back(osg::Vec3(x/w,y/w,z/w));
+        else if (fieldsRead == 6)
+        {
+            vertices.push_back(osg::Vec3(x,y,z));
+            colors.push_back(osg::Vec4(w, g, b, 1.0));
+        }
+        else if ( fieldsRead == 7 )
+        {
+            vertices.push_back(osg::Vec3(x,y,z));
+            colors.push_back(osg::Vec4(w, g, b, a));
+        }
+    }
+    else if (strncmp(line,"vn ",3)==0)
+    {
+        const char* ptr = line+3;
+        unsigned int fieldsRead = 0;
+        if (parseFloat(ptr, x)) ++fieldsRead;
+        if (fieldsRead==1 && parseFloat(ptr, y)) ++fieldsRead;
+        if (fieldsRead==2 && parseFloat(ptr, z)) ++fieldsRead;
+
+        if (fieldsRead==1) normals.push_back(osg::Vec3(x,0.0f,0.0f));
+        else if (fieldsRead==2) normals.push_back(osg::Vec3(x,y,0.0f));
+        else if (fieldsRead==3) normals.push_back(osg::Vec3(x,y,z));
+    }
+    else if (strncmp(line,"vt ",3)==0)
+    {
+        const char* ptr = line+3;
+        unsigned int fieldsRead = 0;
+        if (parseFloat(ptr, x)) ++fieldsRead;
+        if (fieldsRead==1 && parseFloat(ptr, y)) ++fieldsRead;
+
+        if (fieldsRead==1) texcoords.push_back(osg::Vec2(x,0.0f));
+        else if (fieldsRead==2) texcoords.push_back(osg::Vec2(x,y));
+    }
+    else if (strncmp(line,"l ",2)==0 ||
+             strncmp(line,"p ",2)==0 ||
+             strncmp(line,"f ",2)==0)
+    {
+        const char* ptr = line+2;
+
+        Element* element = new Element( (line[0]=='p') ? Element::POINTS :
+                                        (line[0]=='l') ? Element::POLYLINE :
+                                        Element::POLYGON );
+
+        int vi=0, ti=0, ni=0;
+        while(*ptr!=0)
+        {
+            // skip white space
+            while(*ptr==' ') ++ptr;
+
+            // vertex indices take the forms v, v/t, v//n and v/t/n
+            if (parseInt(ptr, vi))
             {
-                std::string materialFileName = trim( line+7 );
-                std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
-                if (!fullPathFileName.empty())
+                element->vertexIndices.push_back(vi);
+                if (*ptr=='/')
                 {
-                    osgDB::ifstream mfin( fullPathFileName.c_str() );
-                    if (mfin)
+                    ++ptr;
+                    if (*ptr=='/')
                     {
-                        OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
-                        readMTL(mfin);
+                        ++ptr;
+                        if (parseInt(ptr, ni)) element->normalIndices.push_back(ni);
                     }
-                    else
+                    else if (parseInt(ptr, ti))
                     {
-                        OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
+                        element->texCoordIndices.push_back(ti);
+                        if (*ptr=='/')
+                        {
+                            ++ptr;
+                            if (parseInt(ptr, ni)) element->normalIndices.push_back(ni);
+                        }
                     }
                 }
-                else
-                {
-                    OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
-                }
             }
-            else if (strncmp(line,"o ",2)==0)
+
+            // skip to white space or end of line
+            while(*ptr!=' ' && *ptr!=0) ++ptr;
+        }
+
+        Record record;
+        record.element = element;
+        record.numVertices = vertices.size();
+        record.numNormals = normals.size();
+        record.numTexCoords = texcoords.size();
+        records.push_back(record);
+    }
+    else
+    {
+        Record record;
+        record.line = lineString;
+        records.push_back(record);
+    }
+}
+
+namespace
+{
+    class ParseChunkOperation : public osg::Operation
+    {
+    public:
+        ParseChunkOperation(Chunk* chunk):
+            osg::Operation("ParseOBJChunk", false),
+            _chunk(chunk) {}
+
+        virtual void operator() (osg::Object*) { _chunk->parse(); }
+
+    protected:
+        osg::ref_ptr<Chunk> _chunk;
+    };
+
+    struct PendingChunk
+    {
+        osg::ref_ptr<Chunk>             chunk;
+        osg::ref_ptr<osg::TaskGroup>    taskGroup;
+    };
+
+    // Size of the blocks of the file handed to the parsing threads.
+    const std::streamsize CHUNK_SIZE = 4*1024*1024;
+
+    // Read the next block of whole lines into text, carrying any partial line at the end over to the next block.
+    bool readChunk(std::istream& fin, std::string& carry, std::string& text)
+    {
+        text.swap(carry);
+        carry.clear();
+
+        std::string::size_type split = std::string::npos;
+        while (split==std::string::npos)
+        {
+            std::string::size_type size = text.size();
+            if (fin)
             {
-                std::string objectName(line+2);
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                text.resize(size+CHUNK_SIZE);
+                fin.read(&text[size], CHUNK_SIZE);
+                text.resize(size+fin.gcount());
             }
-            else if (strcmp(line,"o")==0)
+
+            if (!fin)
             {
-                std::string objectName(""); // empty name
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                // the rest of the file forms the last block
+                return !text.empty();
             }
-            else if (strncmp(line,"g ",2)==0)
+
+            // find the last line ending that isn't escaped by a backslash, a \r at the very end may be the first half of a \r\n
+            for(std::string::size_type i=text.size(); i>size; --i)
             {
-                std::string groupName(line+2);
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                char c = text[i-1];
+                if (c!='\n' && c!='\r') continue;
+                if (c=='\r' && i==text.size()) continue;
+
+                std::string::size_type lineEnd = i-1;
+                if (c=='\n' && lineEnd>0 && text[lineEnd-1]=='\r') --lineEnd;
+                if (lineEnd>0 && text[lineEnd-1]=='\\') continue;
+
+                split = i;
+                break;
             }
-            else if (strcmp(line,"g")==0)
+        }
+
+        carry.assign(text, split, std::string::npos);
+        text.resize(split);
+        return true;
+    }
+}
+
+bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options, unsigned int numThreads)
+{
+    OSG_INFO<<"Reading OBJ file"<<std::endl;
+
+    fin.imbue(std::locale::classic());
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    double numBytes = 0.0;
+
+    osg::TaskScheduler* scheduler = osg::TaskScheduler::instance().get();
+    if (numThreads==0) numThreads = scheduler->getNumThreads()+1;
+
+    // keep a couple of blocks per thread in flight so the threads don't wait on the reading of the file
+    const unsigned int maxNumPendingChunks = numThreads>1 ? numThreads*2 : 1;
+
+    std::deque<PendingChunk> pendingChunks;
+    std::string carry;
+    bool moreToRead = true;
+    for(;;)
+    {
+        while (moreToRead && pendingChunks.size()<maxNumPendingChunks)
+        {
+            PendingChunk pending;
+            pending.chunk = new Chunk;
+            if (!readChunk(fin, carry, pending.chunk->text))
             {
-                std::string groupName(""); // empty name
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                moreToRead = false;
+                break;
             }
-            else if (strncmp(line,"s ",2)==0)
-            {
-                int smoothingGroup=0;
-                if (strncmp(line+2,"off",3)==0) smoothingGroup = 0;
-                else
-                {
-                    int result = sscanf(line+2,"%d",&smoothingGroup);
-                    if (result!=1)
-                    {
-                        OSG_NOTICE <<"*** error reading smoothing group ***"<<std::endl;
-                    }
-                }
+            numBytes += pending.chunk->text.size();
 
-                if (currentElementState.smoothingGroup != smoothingGroup)
-                {
-                    currentElementState.smoothingGroup = smoothingGroup;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+            if (numThreads>1)
+            {
+                pending.taskGroup = new osg::TaskGroup;
+                scheduler->add(new ParseChunkOperation(pending.chunk.get()), pending.taskGroup.get());
             }
             else
             {
-                OSG_NOTICE <<"*** line not handled *** :"<<line<<std::endl;
+                pending.chunk->parse();
             }
+            pendingChunks.push_back(pending);
+        }
 
+        if (pendingChunks.empty()) break;
+
+        // merge the blocks in file order so that element indices and state changes apply as they would reading line by line
+        PendingChunk& front = pendingChunks.front();
+        // the wait only runs this block's parse, so the loader isn't held up by other work on the shared scheduler
+        if (front.taskGroup.valid()) scheduler->wait(front.taskGroup.get());
+        mergeChunk(*front.chunk, options);
+        pendingChunks.pop_front();
+    }
+
+    double duration = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+    OSG_INFO<<"Read OBJ file of "<<numBytes/(1024.0*1024.0)<<"MB in "<<duration*1000.0<<"ms, "
+            <<((duration>0.0) ? numBytes/(1024.0*1024.0*duration) : 0.0)<<"MB/s"<<std::endl;
+
+    return true;
+}
+
+void Model::mergeChunk(Chunk& chunk, const osgDB::ReaderWriter::Options* options)
+{
+    const int vertexBase = vertices.size();
+    const int normalBase = normals.size();
+    const int texCoordBase = texcoords.size();
+
+    vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+    colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+    normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+
+    Vec3Array().swap(chunk.vertices);
+    Vec4Array().swap(chunk.colors);
+    Vec3Array().swap(chunk.normals);
+    Vec2Array().swap(chunk.texcoords);
+
+    for(Chunk::RecordList::iterator itr = chunk.records.begin();
+        itr != chunk.records.end();
+        ++itr)
+    {
+        Element* element = itr->element.get();
+        if (!element)
+        {
+            readStatement(itr->line.c_str(), options);
+            continue;
+        }
+
+        // indices are 1 based, or relative to the data read so far when negative
+        const int numVertices = vertexBase + itr->numVertices;
+        const int numNormals = normalBase + itr->numNormals;
+        const int numTexCoords = texCoordBase + itr->numTexCoords;
+
+        for(Element::IndexList::iterator iitr = element->vertexIndices.begin(); iitr != element->vertexIndices.end(); ++iitr)
+        {
+            *iitr = (*iitr<0) ? numVertices + *iitr : *iitr - 1;
+        }
+
+        bool validNormals = element->normalIndices.size()==element->vertexIndices.size();
+        for(Element::IndexList::iterator iitr = element->normalIndices.begin(); validNormals && iitr != element->normalIndices.end(); ++iitr)
+        {
+            *iitr = (*iitr<0) ? numNormals + *iitr : *iitr - 1;
+            if (*iitr<0 || *iitr>=numNormals) validNormals = false;
+        }
+        if (!validNormals) element->normalIndices.clear();
+
+        bool validTexCoords = element->texCoordIndices.size()==element->vertexIndices.size();
+        for(Element::IndexList::iterator iitr = element->texCoordIndices.begin(); validTexCoords && iitr != element->texCoordIndices.end(); ++iitr)
+        {
+            *iitr = (*iitr<0) ? numTexCoords + *iitr : *iitr - 1;
+            if (*iitr<0 || *iitr>=numTexCoords) validTexCoords = false;
         }
+        if (!validTexCoords) element->texCoordIndices.clear();
 
+        if (!element->vertexIndices.empty())
+        {
+            Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
+            if (coordateCombination!=currentElementState.coordinateCombination)
+            {
+                currentElementState.coordinateCombination = coordateCombination;
+                currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+            }
+            addElement(element);
+        }
     }
-#if 0
-    OSG_NOTICE <<"vertices :"<<vertices.size()<<std::endl;
-    OSG_NOTICE <<"normals :"<<normals.size()<<std::endl;
-    OSG_NOTICE <<"texcoords :"<<texcoords.size()<<std::endl;
-    OSG_NOTICE <<"materials :"<<materialMap.size()<<std::endl;
-    OSG_NOTICE <<"elementStates :"<<elementStateMap.size()<<std::endl;
 
-    unsigned int pos=0;
-    for(ElementStateMap::iterator itr=elementStateMap.begin();
-        itr!=elementStateMap.end();
-        ++itr,++pos)
+    Chunk::RecordList().swap(chunk.records);
+}
+
+void Model::readStatement(const char* line, const osgDB::ReaderWriter::Options* options)
+{
+    if (strncmp(line,"usemtl ",7)==0)
+    {
+        std::string materialName( line+7 );
+        if (currentElementState.materialName != materialName)
+        {
+            currentElementState.materialName = materialName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"mtllib ",7)==0)
     {
-        const ElementState& es = itr->first;
-        ElementList& el = itr->second;
-        OSG_NOTICE<<"ElementState "<<pos<<std::endl;
-        OSG_NOTICE<<"    es.objectName="<<es.objectName<<std::endl;
-        OSG_NOTICE<<"    es.groupName="<<es.groupName<<std::endl;
-        OSG_NOTICE<<"    es.materialName="<<es.materialName<<std::endl;
-        OSG_NOTICE<<"    es.smoothGroup="<<es.smoothingGroup<<std::endl;
-        OSG_NOTICE<<"    ElementList ="<<el.size()<<std::endl;
+        std::string materialFileName = trim( line+7 );
+        std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
+        if (!fullPathFileName.empty())
+        {
+            osgDB::ifstream mfin( fullPathFileName.c_str() );
+            if (mfin)
+            {
+                OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
+                readMTL(mfin);
+            }
+            else
+            {
+                OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
+            }
+        }
+        else
+        {
+            OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
+        }
+    }
+    else if (strncmp(line,"o ",2)==0)
+    {
+        std::string objectName(line+2);
+        if (currentElementState.objectName != objectName)
+        {
+            currentElementState.objectName = objectName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strcmp(line,"o")==0)
+    {
+        std::string objectName(""); // empty name
+        if (currentElementState.objectName != objectName)
+        {
+            currentElementState.objectName = objectName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"g ",2)==0)
+    {
+        std::string groupName(line+2);
+        if (currentElementState.groupName != groupName)
+        {
+            currentElementState.groupName = groupName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strcmp(line,"g")==0)
+    {
+        std::string groupName(""); // empty name
+        if (currentElementState.groupName != groupName)
+        {
+            currentElementState.groupName = groupName;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else if (strncmp(line,"s ",2)==0)
+    {
+        int smoothingGroup=0;
+        if (strncmp(line+2,"off",3)==0) smoothingGroup = 0;
+        else
+        {
+            int result = sscanf(line+2,"%d",&smoothingGroup);
+            if (result!=1)
+            {
+                OSG_NOTICE <<"*** error reading smoothing group ***"<<std::endl;
+            }
+        }
 
+        if (currentElementState.smoothingGroup != smoothingGroup)
+        {
+            currentElementState.smoothingGroup = smoothingGroup;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+    }
+    else
+    {
+        OSG_NOTICE <<"*** line not handled *** :"<<line<<std::endl;
     }
-#endif
-    return true;
 }
 
 
@@ -185,6 +185,44 @@ public:
     int                             smoothingGroup;
 };
 
+/** The vertex data and elements parsed from a block of whole lines of an OBJ file. Blocks are parsed
+  * independently of each other, so can be parsed in parallel, then merged into the Model in file order.
+  * Element indices are left as they are in the file until the block is merged.*/
+class Chunk : public osg::Referenced
+{
+public:
+
+    /** An element, or a line that has to be handled in order on the reading thread, along with the
+      * number of vertices, normals and texcoords that precede it in the chunk.*/
+    struct Record
+    {
+        Record(): numVertices(0), numNormals(0), numTexCoords(0) {}
+
+        osg::ref_ptr<Element>   element;
+        std::string             line;
+        unsigned int            numVertices;
+        unsigned int            numNormals;
+        unsigned int            numTexCoords;
+    };
+
+    typedef std::vector<Record> RecordList;
+
+    /** Parse the lines held in text.*/
+    void parse();
+
+    std::string                 text;
+
+    std::vector<osg::Vec3>      vertices;
+    std::vector<osg::Vec4>      colors;
+    std::vector<osg::Vec3>      normals;
+    std::vector<osg::Vec2>      texcoords;
+    RecordList                  records;
+
+protected:
+
+    void parseLine(const std::string& line);
+};
+
 class Model
 {
 public:
@@ -196,9 +234,17 @@ public:
 
     std::string lastComponent(const char* linep);
     bool readMTL(std::istream& fin);
-    bool readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options);
+
+    /** Read an OBJ file, parsing blocks of the file on numThreads threads of the shared osg::TaskScheduler, 0 for all of them.*/
+    bool readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options, unsigned int numThreads=1);
 
     bool readline(std::istream& fin, char* line, const int LINE_SIZE);
+
+    /** Handle a line that changes the state of the elements that follow it, such as usemtl, mtllib, o, g and s.*/
+    void readStatement(const char* line, const osgDB::ReaderWriter::Options* options);
+
+    /** Append the data parsed into chunk, resolving its element indices against the data already read.*/
+    void mergeChunk(Chunk& chunk, const osgDB::ReaderWriter::Options* options);
     void addElement(Element* element);
 
     osg::Vec3 averageNormal(const Element& element) const;
@@ -2,6 +2,7 @@
 #define OSG2_BINARYSTREAMOPERATOR
 
 #include <osgDB/StreamOperator>
+#include <osgDB/MemoryMappedStream>
 #include <osg/Types>
 #include <vector>
 
@@ -298,6 +299,16 @@ public:
     virtual void readCharArray( char* s, unsigned int size )
     { if ( size>0 ) _in->read( s, size ); }
 
+    virtual const char* readCharArrayInPlace( unsigned int size )
+    {
+        osgDB::MemoryStreamBuffer* buffer = dynamic_cast<osgDB::MemoryStreamBuffer*>( _in->rdbuf() );
+        if ( !buffer ) return 0;
+
+        const char* data = buffer->take( size );
+        if ( !data ) _in->setstate( std::ios::failbit );
+        return data;
+    }
+
     virtual void readWrappedString( std::string& str )
     { readString( str ); }
 
@@ -16,6 +16,7 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <osgDB/MemoryMappedStream>
 #include <stdlib.h>
 #include "AsciiStreamOperator.h"
 #include "BinaryStreamOperator.h"
@@ -128,6 +129,7 @@ public:
         supportsOption( "Ascii", "Import/Export option: Force reading/writing ascii file" );
         supportsOption( "XML", "Import/Export option: Force reading/writing XML file" );
         supportsOption( "ForceReadingImage", "Import option: Load an empty image instead if required file missed" );
+        supportsOption( "MemoryMapped", "Import option: Read through a memory mapping of the whole file instead of a file stream, the data is still copied into the loaded objects" );
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
         supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
@@ -174,6 +176,11 @@ public:
         return local_opt.release();
     }
 
+    bool useMemoryMapping( const Options* options ) const
+    {
+        return options && options->getPluginStringData("MemoryMapped")=="true";
+    }
+
     virtual ReadResult readObject( const std::string& file, const Options* options ) const
     {
         ReadResult result = ReadResult::FILE_LOADED;
@@ -182,6 +189,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt) )
+        {
+            MemoryMappedStreamBuffer buffer( fileName );
+            if ( buffer.valid() )
+            {
+                std::istream istream( &buffer );
+                return readObject( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readObject( istream, local_opt );
     }
@@ -213,6 +230,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt) )
+        {
+            MemoryMappedStreamBuffer buffer( fileName );
+            if ( buffer.valid() )
+            {
+                std::istream istream( &buffer );
+                return readImage( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readImage( istream, local_opt );
     }
@@ -244,6 +271,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt) )
+        {
+            MemoryMappedStreamBuffer buffer( fileName );
+            if ( buffer.valid() )
+            {
+                std::istream istream( &buffer );
+                return readNode( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readNode( istream, local_opt );
     }
@@ -320,7 +320,8 @@ void OSGA_Archive::IndexBlock::setPositionNextIndexBlock(pos_type position)
 
 OSGA_Archive::OSGA_Archive():
     _version(0.0f),
-    _status(READ)
+    _status(READ),
+    _mappedArchive(0)
 {
 }
 
@@ -333,7 +334,16 @@ OSGA_Archive::~OSGA_Archive()
 bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSize)
 {
     SERIALIZER();
+    OpenThreads::ScopedWriteLock mappedLock(_mappedArchiveMutex);
 
+    // reopening replaces the mapping and index of the previous archive rather than adding to them
+    closeArchive();
+
+    return openArchive(filename, status, indexBlockSize);
+}
+
+bool OSGA_Archive::openArchive(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSize)
+{
     _archiveFileName = filename;
 
     if (status==READ)
@@ -341,11 +351,19 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
         _status = status;
         _input.open(filename.c_str(), std::ios_base::binary | std::ios_base::in);
 
-        return _open(_input);
+        if (!_open(_input)) return false;
+
+        // the index doesn't change from here on, so once the archive is mapped reads no longer need
+        // to share _input, the stream is left open though as opening for WRITE seeks on it.
+        MemoryMappedStreamBuffer* mappedArchive = new MemoryMappedStreamBuffer(filename, false);
+        if (mappedArchive->valid()) _mappedArchive = mappedArchive;
+        else delete mappedArchive;
+
+        return true;
     }
     else
     {
-        if (status==WRITE && open(filename,READ))
+        if (status==WRITE && openArchive(filename,READ,indexBlockSize))
         {
             pos_type file_size( 0 );
             _input.seekg( 0, std::ios_base::end );
@@ -375,6 +393,8 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
                 }
             }
             _input.close();
+            delete _mappedArchive;
+            _mappedArchive = 0;
             _status = WRITE;
 
             osgDB::open(_output, filename.c_str(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
@@ -418,6 +438,9 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
 bool OSGA_Archive::open(std::istream& fin)
 {
     SERIALIZER();
+    OpenThreads::ScopedWriteLock mappedLock(_mappedArchiveMutex);
+
+    closeArchive();
 
     _archiveFileName = "";
 
@@ -492,14 +515,30 @@ bool OSGA_Archive::_open(std::istream& input)
 void OSGA_Archive::close()
 {
     SERIALIZER();
+    OpenThreads::ScopedWriteLock mappedLock(_mappedArchiveMutex);
 
-    _input.close();
+    closeArchive();
+}
 
-    if (_status==WRITE)
+void OSGA_Archive::closeArchive()
+{
+    if (_input.is_open()) _input.close();
+
+    // detach any stream passed to open(std::istream&) and clear the state left by the last read, so the archive can be reopened
+    static_cast<std::istream&>(_input).rdbuf(_input.rdbuf());
+
+    delete _mappedArchive;
+    _mappedArchive = 0;
+
+    if (_status==WRITE && _output.is_open())
     {
         writeIndexBlocks();
         _output.close();
     }
+
+    _indexBlockList.clear();
+    _indexMap.clear();
+    _masterFileName.clear();
 }
 
 std::string OSGA_Archive::getMasterFileName() const
@@ -724,32 +763,70 @@ struct OSGA_Archive::ReadShaderFunctor : public OSGA_Archive::ReadFunctor
     virtual ReaderWriter::ReadResult doRead(ReaderWriter& rw, std::istream& input) const { return rw.readShader(input, _options); }
 };
 
-ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
+ReaderWriter* OSGA_Archive::getReaderWriter(const ReadFunctor& readFunctor, FileNamePositionMap::const_iterator& itr, ReadResult& result) const
 {
-    SERIALIZER();
-
     if (_status!=READ)
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, archive opened as write only."<<std::endl;
-        return ReadResult(ReadResult::FILE_NOT_HANDLED);
+        result = ReadResult(ReadResult::FILE_NOT_HANDLED);
+        return 0;
     }
 
-    FileNamePositionMap::const_iterator itr = _indexMap.find(readFunctor._filename);
+    itr = _indexMap.find(readFunctor._filename);
     if (itr==_indexMap.end())
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file not found in archive"<<std::endl;
-        return ReadResult(ReadResult::FILE_NOT_FOUND);
+        result = ReadResult(ReadResult::FILE_NOT_FOUND);
+        return 0;
     }
 
     ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(getLowerCaseFileExtension(readFunctor._filename));
     if (!rw)
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed to find appropriate plugin to read file."<<std::endl;
-        return ReadResult(ReadResult::FILE_NOT_HANDLED);
+        result = ReadResult(ReadResult::FILE_NOT_HANDLED);
+        return 0;
     }
 
     OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<")"<<std::endl;
 
+    return rw;
+}
+
+ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
+{
+    ReadResult result(ReadResult::FILE_NOT_HANDLED);
+    FileNamePositionMap::const_iterator itr;
+
+    {
+        // the index and the mapping are only replaced by open() and close(), which wait for the read lock to be
+        // released, so reads from a mapped archive don't need serializing, each gets its own stream onto the mapping.
+        OpenThreads::ScopedReadLock mappedLock(_mappedArchiveMutex);
+        if (_mappedArchive)
+        {
+            ReaderWriter* rw = getReaderWriter(readFunctor, itr, result);
+            if (!rw) return result;
+
+            pos_type position = itr->second.first;
+            size_type size = itr->second.second;
+            if (position<0 || size<0 || position+size>pos_type(_mappedArchive->size()))
+            {
+                OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file extends beyond the end of the archive"<<std::endl;
+                return ReadResult(ReadResult::ERROR_IN_READING_FILE);
+            }
+
+            osgDB::MemoryStreamBuffer mystreambuf(_mappedArchive->data()+position, size);
+            std::istream ins(&mystreambuf);
+
+            return readFunctor.doRead(*rw, ins);
+        }
+    }
+
+    SERIALIZER();
+
+    ReaderWriter* rw = getReaderWriter(readFunctor, itr, result);
+    if (!rw) return result;
+
     _input.seekg( STREAM_POS( itr->second.first ) );
 
     // set up proxy stream buffer to provide the faked ending.
@@ -757,7 +834,7 @@ ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
     proxy_streambuf mystreambuf(ins.rdbuf(),itr->second.second);
     ins.rdbuf(&mystreambuf);
 
-    ReaderWriter::ReadResult result = readFunctor.doRead(*rw, _input);
+    result = readFunctor.doRead(*rw, _input);
 
     ins.rdbuf(mystreambuf._streambuf);
 
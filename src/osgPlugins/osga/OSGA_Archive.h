@@ -14,9 +14,11 @@
 #include <osg/Notify>
 #include <osgDB/Archive>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MemoryMappedStream>
 
 #include <OpenThreads/ScopedLock>
 #include <OpenThreads/ReentrantMutex>
+#include <OpenThreads/ReadWriteMutex>
 
 #define SERIALIZER() OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_serializerMutex)
 
@@ -35,7 +37,9 @@ class OSGA_Archive : public osgDB::Archive
             return osgDB::equalCaseInsensitive(extension,"osga");
         }
 
-        /** open the archive.*/
+        /** open the archive, closing any archive already open. An archive opened for reading is memory mapped
+          * where possible, in which case reads are served straight from the mapping and may run concurrently
+          * without serializing on the archive's input stream.*/
         virtual bool open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSizeHint=4096);
 
         /** open the archive for reading.*/
@@ -105,6 +109,10 @@ class OSGA_Archive : public osgDB::Archive
 
         mutable OpenThreads::ReentrantMutex _serializerMutex;
 
+        // held for reading by reads from the mapped archive and for writing while the archive is opened or
+        // closed, so that the mapping and the index aren't replaced under a read.
+        mutable OpenThreads::ReadWriteMutex _mappedArchiveMutex;
+
         class IndexBlock;
         friend class IndexBlock;
 
@@ -203,12 +211,17 @@ class OSGA_Archive : public osgDB::Archive
 
 
         osgDB::ReaderWriter::ReadResult read(const ReadFunctor& readFunctor);
+        osgDB::ReaderWriter* getReaderWriter(const ReadFunctor& readFunctor, FileNamePositionMap::const_iterator& itr, ReadResult& result) const;
         osgDB::ReaderWriter::WriteResult write(const WriteFunctor& writeFunctor);
 
         typedef std::list< osg::ref_ptr<IndexBlock> >   IndexBlockList;
 
         bool _open(std::istream& fin);
 
+        bool openArchive(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSizeHint);
+
+        void closeArchive();
+
         void writeIndexBlocks();
 
         bool addFileReference(pos_type position, size_type size, const std::string& fileName);
@@ -223,6 +236,7 @@ class OSGA_Archive : public osgDB::Archive
         std::string         _masterFileName;
         IndexBlockList      _indexBlockList;
         FileNamePositionMap _indexMap;
+        osgDB::MemoryMappedStreamBuffer* _mappedArchive;
 
 
         template <typename T>
@@ -162,6 +162,10 @@ extern void ply_put_other_elements (PlyFile *);
 extern void ply_free_other_elements (PlyOtherElems *);
 
 extern int equal_strings(const char *, const char *);
+extern PlyElement *find_element(PlyFile *, const char *);
+
+/* size in bytes of each of the scalar data types in binary files */
+extern int ply_type_size[];
 
 #endif /* !__PLY_H__ */
 
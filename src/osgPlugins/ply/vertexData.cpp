@@ -23,10 +23,145 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
 #include <osg/Texture2D>
+#include <osg/Endian>
+#include <osg/TaskScheduler>
+#include <osg/Timer>
 
 using namespace std;
 using namespace ply;
 
+namespace
+{
+    // Number of vertices read from the file at a time by the binary fast path.
+    const unsigned int NUM_VERTICES_PER_BLOCK = 1024*1024;
+
+    // Smallest number of vertices worth handing to another thread to decode.
+    const unsigned int MIN_NUM_VERTICES_PER_THREAD = 65536;
+
+    // Where a property sits within a fixed size binary vertex record.
+    struct BinaryProperty
+    {
+        BinaryProperty() : offset(-1), type(0) {}
+
+        bool valid() const { return offset>=0; }
+
+        int offset;
+        int type;
+    };
+
+    inline bool isBinaryFloat( int type )
+    {
+        return type==PLY_FLOAT || type==PLY_FLOAT32 || type==PLY_DOUBLE;
+    }
+
+    inline bool isBinaryUChar( int type )
+    {
+        return type==PLY_UCHAR || type==PLY_UINT8;
+    }
+
+    inline float decodeFloat( const unsigned char* record, const BinaryProperty& property, bool swap )
+    {
+        char bytes[8];
+        if (property.type==PLY_DOUBLE)
+        {
+            memcpy( bytes, record+property.offset, 8 );
+            if (swap) osg::swapBytes8( bytes );
+            double value;
+            memcpy( &value, bytes, 8 );
+            return static_cast<float>( value );
+        }
+
+        memcpy( bytes, record+property.offset, 4 );
+        if (swap) osg::swapBytes4( bytes );
+        float value;
+        memcpy( &value, bytes, 4 );
+        return value;
+    }
+
+    inline float decodeColor( const unsigned char* record, const BinaryProperty& property )
+    {
+        return (unsigned int) record[property.offset] / 255.0;
+    }
+
+    // Layout of the fixed size binary vertex records.
+    struct VertexLayout
+    {
+        VertexLayout() : recordSize( 0 ), swap( false ) {}
+
+        BinaryProperty  x, y, z;
+        BinaryProperty  nx, ny, nz;
+        BinaryProperty  red, green, blue, alpha;
+        BinaryProperty  u, v;
+        unsigned int    recordSize;
+        bool            swap;
+    };
+
+    // Decodes a range of a block of vertex records into the osg arrays.
+    class DecodeVerticesFunctor : public osg::TaskScheduler::ParallelForFunctor
+    {
+    public:
+        DecodeVerticesFunctor( const VertexLayout& layout, const unsigned char* records ) :
+            _layout( layout ),
+            _records( records ),
+            _vertices( 0 ),
+            _normals( 0 ),
+            _colors( 0 ),
+            _texcoords( 0 ) {}
+
+        void setArrays( osg::Vec3* vertices, osg::Vec3* normals, osg::Vec4* colors, osg::Vec2* texcoords )
+        {
+            _vertices = vertices;
+            _normals = normals;
+            _colors = colors;
+            _texcoords = texcoords;
+        }
+
+        virtual void operator() ( unsigned int begin, unsigned int end )
+        {
+            const VertexLayout& l = _layout;
+            const unsigned char* record = _records + static_cast<size_t>( begin )*l.recordSize;
+            for( unsigned int i = begin; i < end; ++i, record += l.recordSize )
+            {
+                _vertices[i].set( decodeFloat( record, l.x, l.swap ),
+                                  decodeFloat( record, l.y, l.swap ),
+                                  decodeFloat( record, l.z, l.swap ) );
+
+                if (_normals)
+                    _normals[i].set( decodeFloat( record, l.nx, l.swap ),
+                                     decodeFloat( record, l.ny, l.swap ),
+                                     decodeFloat( record, l.nz, l.swap ) );
+
+                if (_colors)
+                    _colors[i].set( decodeColor( record, l.red ),
+                                    decodeColor( record, l.green ),
+                                    decodeColor( record, l.blue ),
+                                    l.alpha.valid() ? decodeColor( record, l.alpha ) : 1.0f );
+
+                if (_texcoords)
+                    _texcoords[i].set( decodeFloat( record, l.u, l.swap ),
+                                       decodeFloat( record, l.v, l.swap ) );
+            }
+        }
+
+        const VertexLayout&     _layout;
+        const unsigned char*    _records;
+
+        osg::Vec3*              _vertices;
+        osg::Vec3*              _normals;
+        osg::Vec4*              _colors;
+        osg::Vec2*              _texcoords;
+    };
+
+    void readBlock( FILE* fp, void* data, size_t size )
+    {
+        if (size>0 && fread( data, size, 1, fp ) < 1)
+        {
+            throw ply::MeshException( "Error in reading PLY file."
+                                      "fread not succeeded." );
+        }
+    }
+}
+
 
 /*  Constructor.  */
 VertexData::VertexData()
@@ -174,6 +309,9 @@ void VertexData::readVertices( PlyFile* file, const int nVertices,
             _texcoord = new osg::Vec2Array;
     }
 
+    if (readVerticesBinary( file, nVertices, fields ))
+        return;
+
     // read in the vertices
     for( int i = 0; i < nVertices; ++i )
     {
@@ -211,6 +349,105 @@ void VertexData::readVertices( PlyFile* file, const int nVertices,
 }
 
 
+/*  Read the vertices of a binary file with bulk reads, decoding the records
+    on the threads of the shared TaskScheduler.  */
+bool VertexData::readVerticesBinary( PlyFile* file, const int nVertices,
+                                     const int fields )
+{
+    if( file->file_type == PLY_ASCII || nVertices <= 0 )
+        return false;
+
+    // the ambient, diffuse and specular colors are left to the generic path
+    if( fields & (AMBIENT | DIFFUSE | SPECULAR) )
+        return false;
+
+    PlyElement* elem = find_element( file, "vertex" );
+    if( !elem )
+        return false;
+
+    // work out the layout of the records, which have to be of a fixed size
+    VertexLayout layout;
+    layout.swap = (file->file_type == PLY_BINARY_BE) != (osg::getCpuByteOrder() == osg::BigEndian);
+    for( int j = 0; j < elem->nprops; ++j )
+    {
+        PlyProperty* prop = elem->props[j];
+        if( prop->is_list || prop->external_type <= PLY_START_TYPE || prop->external_type >= PLY_END_TYPE )
+            return false;
+
+        BinaryProperty property;
+        property.offset = layout.recordSize;
+        property.type = prop->external_type;
+        layout.recordSize += ply_type_size[prop->external_type];
+
+        if( equal_strings( prop->name, "x" ) ) layout.x = property;
+        else if( equal_strings( prop->name, "y" ) ) layout.y = property;
+        else if( equal_strings( prop->name, "z" ) ) layout.z = property;
+        else if( equal_strings( prop->name, "nx" ) ) layout.nx = property;
+        else if( equal_strings( prop->name, "ny" ) ) layout.ny = property;
+        else if( equal_strings( prop->name, "nz" ) ) layout.nz = property;
+        else if( equal_strings( prop->name, "red" ) ) layout.red = property;
+        else if( equal_strings( prop->name, "green" ) ) layout.green = property;
+        else if( equal_strings( prop->name, "blue" ) ) layout.blue = property;
+        else if( equal_strings( prop->name, "alpha" ) ) layout.alpha = property;
+        else if( equal_strings( prop->name, "texture_u" ) ) layout.u = property;
+        else if( equal_strings( prop->name, "texture_v" ) ) layout.v = property;
+    }
+
+    // only the common types are decoded here, anything else goes through the generic conversions
+    if( !isBinaryFloat( layout.x.type ) || !isBinaryFloat( layout.y.type ) || !isBinaryFloat( layout.z.type ) )
+        return false;
+
+    if( (fields & NORMALS) &&
+        (!isBinaryFloat( layout.nx.type ) || !isBinaryFloat( layout.ny.type ) || !isBinaryFloat( layout.nz.type )) )
+        return false;
+
+    if( (fields & (RGB | RGBA)) &&
+        (!isBinaryUChar( layout.red.type ) || !isBinaryUChar( layout.green.type ) || !isBinaryUChar( layout.blue.type )) )
+        return false;
+
+    if( (fields & RGBA) && !isBinaryUChar( layout.alpha.type ) )
+        return false;
+
+    if( (fields & TEXCOORD) && (!isBinaryFloat( layout.u.type ) || !isBinaryFloat( layout.v.type )) )
+        return false;
+
+    if( !(fields & RGBA) )
+        layout.alpha = BinaryProperty();
+
+    // size the arrays up front so the records can be decoded straight into them
+    unsigned int base = _vertices->size();
+    _vertices->resize( base + nVertices );
+    if( fields & NORMALS ) _normals->resize( base + nVertices );
+    if( fields & (RGB | RGBA) ) _colors->resize( base + nVertices );
+    if( fields & TEXCOORD ) _texcoord->resize( base + nVertices );
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    std::vector<unsigned char> records;
+    for( unsigned int first = 0; first < static_cast<unsigned int>( nVertices ); first += NUM_VERTICES_PER_BLOCK )
+    {
+        unsigned int numInBlock = osg::minimum( NUM_VERTICES_PER_BLOCK, static_cast<unsigned int>( nVertices ) - first );
+        records.resize( static_cast<size_t>( numInBlock ) * layout.recordSize );
+        readBlock( file->fp, &records.front(), records.size() );
+
+        DecodeVerticesFunctor functor( layout, &records.front() );
+        functor.setArrays( &(*_vertices)[base + first],
+                           (fields & NORMALS) ? &(*_normals)[base + first] : 0,
+                           (fields & (RGB | RGBA)) ? &(*_colors)[base + first] : 0,
+                           (fields & TEXCOORD) ? &(*_texcoord)[base + first] : 0 );
+
+        osg::TaskScheduler::instance()->parallelFor( numInBlock, functor, 0, MIN_NUM_VERTICES_PER_THREAD );
+    }
+
+    double duration = osg::Timer::instance()->delta_s( startTick, osg::Timer::instance()->tick() );
+    double megaBytes = static_cast<double>( nVertices ) * layout.recordSize / (1024.0*1024.0);
+    MESHINFO << "Read " << nVertices << " binary vertices, " << megaBytes << "MB in "
+             << duration*1000.0 << "ms, " << (duration > 0.0 ? megaBytes/duration : 0.0) << "MB/s" << endl;
+
+    return true;
+}
+
+
 /*  Read the index data from the open file.  */
 void VertexData::readTriangles( PlyFile* file, const int nFaces )
 {
@@ -236,6 +473,9 @@ void VertexData::readTriangles( PlyFile* file, const int nFaces )
         _quads = new osg::DrawElementsUInt(osg::PrimitiveSet::QUADS);
 
 
+    if (readTrianglesBinary( file, nFaces ))
+        return;
+
     const char NUM_VERTICES_TRIANGLE(3);
     const char NUM_VERTICES_QUAD(4);
 
@@ -268,6 +508,62 @@ void VertexData::readTriangles( PlyFile* file, const int nFaces )
 }
 
 
+/*  Read the faces of a binary file without going through the per item
+    conversions and allocations of ply_get_element.  */
+bool VertexData::readTrianglesBinary( PlyFile* file, const int nFaces )
+{
+    if( file->file_type == PLY_ASCII )
+        return false;
+
+    PlyElement* elem = find_element( file, "face" );
+    if( !elem || elem->nprops != 1 )
+        return false;
+
+    PlyProperty* prop = elem->props[0];
+    if( !prop->is_list ||
+        !(equal_strings( prop->name, "vertex_indices" ) || equal_strings( prop->name, "vertex_index" )) ||
+        !isBinaryUChar( prop->count_external ) ||
+        !(prop->external_type == PLY_INT || prop->external_type == PLY_INT32 || prop->external_type == PLY_UINT) )
+        return false;
+
+    bool swap = (file->file_type == PLY_BINARY_BE) != (osg::getCpuByteOrder() == osg::BigEndian);
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    double numBytes = 0.0;
+
+    unsigned int indices[256];
+    for( int i = 0 ; i < nFaces; i++ )
+    {
+        unsigned char nVertices;
+        readBlock( file->fp, &nVertices, 1 );
+        readBlock( file->fp, indices, nVertices*4 );
+        numBytes += 1 + nVertices*4;
+
+        if (nVertices != 3 && nVertices != 4)
+            continue;
+
+        if (swap)
+        {
+            for( unsigned int j = 0; j < nVertices; ++j )
+                osg::swapBytes4( reinterpret_cast<char*>( &indices[j] ) );
+        }
+
+        osg::DrawElementsUInt* primitives = (nVertices == 4) ? _quads.get() : _triangles.get();
+        for( unsigned int j = 0; j < nVertices; ++j )
+        {
+            primitives->push_back( indices[_invertFaces ? nVertices - 1 - j : j] );
+        }
+    }
+
+    double duration = osg::Timer::instance()->delta_s( startTick, osg::Timer::instance()->tick() );
+    double megaBytes = numBytes / (1024.0*1024.0);
+    MESHINFO << "Read " << nFaces << " binary faces, " << megaBytes << "MB in "
+             << duration*1000.0 << "ms, " << (duration > 0.0 ? megaBytes/duration : 0.0) << "MB/s" << endl;
+
+    return true;
+}
+
+
 /*  Open a PLY file and read vertex, color and index data. and returns the node  */
 osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColors )
 {
@@ -64,9 +64,19 @@ namespace ply
         void readVertices( PlyFile* file, const int nVertices,
                            const int vertexFields );
 
+        // Reads the vertices of binary files whose vertex properties are all
+        // scalars of the common types with bulk reads straight into the
+        // arrays, returns false without reading anything otherwise
+        bool readVerticesBinary( PlyFile* file, const int nVertices,
+                                 const int vertexFields );
+
         // Reads the triangle indices from the ply file
         void readTriangles( PlyFile* file, const int nFaces );
 
+        // Reads the faces of binary files that hold nothing but the list of
+        // vertex indices, returns false without reading anything otherwise
+        bool readTrianglesBinary( PlyFile* file, const int nFaces );
+
         bool        _invertFaces;
 
         // Vertex array in osg format
@@ -9,6 +9,7 @@
 #include <osgDB/FileNameUtils>
 
 #include <sstream>
+#include <vector>
 
 using namespace osg;
 
@@ -160,7 +161,7 @@ class ReaderWriterPNG : public osgDB::ReaderWriter
             return WriteResult::FILE_SAVED;
         }
 
-        ReadResult readPNGStream(std::istream& fin) const
+        ReadResult readPNGStream(std::istream& fin, const osgDB::ReaderWriter::Options* options) const
         {
             int trans = PNG_ALPHA;
             pngInfo pInfo;
@@ -170,8 +171,6 @@ class ReaderWriterPNG : public osgDB::ReaderWriter
             png_structp png;
             png_infop   info;
             png_infop   endinfo;
-            png_bytep   data;    //, data2;
-            png_bytep  *row_p;
             double  fileGamma;
 
             png_uint_32 width, height;
@@ -266,23 +265,9 @@ class ReaderWriterPNG : public osgDB::ReaderWriter
                 else
                     png_set_gamma(png, screenGamma, 1.0/2.2);
 
-                png_read_update_info(png, info);
-
-                data = (png_bytep) new unsigned char [png_get_rowbytes(png, info)*height];
-                row_p = new png_bytep [height];
-
-                bool StandardOrientation = true;
-                for (i = 0; i < height; i++)
-                {
-                    if (StandardOrientation)
-                        row_p[height - 1 - i] = &data[png_get_rowbytes(png, info)*i];
-                    else
-                        row_p[i] = &data[png_get_rowbytes(png, info)*i];
-                }
+                int numPasses = png_set_interlace_handling(png);
 
-                png_read_image(png, row_p);
-                delete [] row_p;
-                png_read_end(png, endinfo);
+                png_read_update_info(png, info);
 
                 GLenum pixelFormat = 0;
                 GLenum dataType = depth<=8?GL_UNSIGNED_BYTE:GL_UNSIGNED_SHORT;
@@ -298,13 +283,13 @@ class ReaderWriterPNG : public osgDB::ReaderWriter
                   default: break;
                 }
 
-                // Some paletted images contain alpha information.  To be
-                // able to give that back to the calling program, we need to
-                // check the number of channels in the image.  However, the
-                // call might not return correct information unless
-                // png_read_end is called first.  See libpng man page.
+                // Some paletted and greyscale images contain alpha information in
+                // a tRNS chunk, png_read_update_info() has already set up its expansion
+                // so the number of channels tells us whether the alpha is present.
                 if (pixelFormat == GL_RGB && png_get_channels(png, info) == 4)
                     pixelFormat = GL_RGBA;
+                if (pixelFormat == GL_LUMINANCE && png_get_channels(png, info) == 2)
+                    pixelFormat = GL_LUMINANCE_ALPHA;
 
                 int internalFormat = pixelFormat;
                 if (depth > 8)
@@ -320,23 +305,51 @@ class ReaderWriterPNG : public osgDB::ReaderWriter
                     }
                 }
 
-                png_destroy_read_struct(&png, &info, &endinfo);
-
-                //    delete [] data;
-
                 if (pixelFormat==0)
+                {
+                    png_destroy_read_struct(&png, &info, &endinfo);
                     return ReadResult::FILE_NOT_HANDLED;
+                }
 
-                osg::Image* pOsgImage = new osg::Image();
-
-                pOsgImage->setImage(width, height, 1,
+                // decode straight into the image provided by the ImageDestination, when one is assigned, so that its storage is reused.
+                osg::ref_ptr<osgDB::ImageDestination> destination = (options && options->getImageDestination()) ? options->getImageDestination() : new osgDB::ImageDestination;
+                osg::ref_ptr<osg::Image> pOsgImage = destination->allocateImage(width, height, 1,
                     internalFormat,
                     pixelFormat,
-                    dataType,
-                    data,
-                    osg::Image::USE_NEW_DELETE);
+                    dataType);
+
+                if (!pOsgImage || pOsgImage->getRowSizeInBytes()!=png_get_rowbytes(png, info))
+                {
+                    png_destroy_read_struct(&png, &info, &endinfo);
+                    return ReadResult::ERROR_IN_READING_FILE;
+                }
+
+                std::vector<png_bytep> row_p(height);
+                for (i = 0; i < height; i++)
+                {
+                    row_p[i] = pOsgImage->data(0, height - 1 - i);
+                }
+
+                // read the rows in batches so that the destination can process them as they arrive,
+                // interlaced images are only complete once the last pass is read.
+                const png_uint_32 numRowsPerBatch = 16;
+                for (int pass = 0; pass < numPasses; ++pass)
+                {
+                    for (i = 0; i < height; i += numRowsPerBatch)
+                    {
+                        png_uint_32 numRows = osg::minimum(numRowsPerBatch, height - i);
+                        png_read_rows(png, &row_p[i], NULL, numRows);
+                        if (pass == numPasses - 1)
+                            destination->rowsDecoded(pOsgImage.get(), height - i - numRows, numRows);
+                    }
+                }
+
+                png_read_end(png, endinfo);
+                png_destroy_read_struct(&png, &info, &endinfo);
+
+                destination->imageDecoded(pOsgImage.get());
 
-                return pOsgImage;
+                return pOsgImage.release();
 
             }
             #ifdef OSG_CPP_EXCEPTIONS_AVAILABLE
@@ -376,9 +389,9 @@ class ReaderWriterPNG : public osgDB::ReaderWriter
             return readImage(file, options);
         }
 
-        virtual ReadResult readImage(std::istream& fin,const Options* =NULL) const
+        virtual ReadResult readImage(std::istream& fin,const Options* options =NULL) const
         {
-            return readPNGStream(fin);
+            return readPNGStream(fin, options);
         }
 
         virtual ReadResult readImage(const std::string& file, const osgDB::ReaderWriter::Options* options) const
@@ -391,7 +404,7 @@ class ReaderWriterPNG : public osgDB::ReaderWriter
 
             osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
             if(!istream) return ReadResult::FILE_NOT_HANDLED;
-            ReadResult rr = readPNGStream(istream);
+            ReadResult rr = readPNGStream(istream, options);
             if(rr.validImage()) rr.getImage()->setFileName(file);
             return rr;
         }
@@ -498,12 +498,49 @@ int headerlen)
 #define CVT(x)      (((x) * 255L) / ((1L<<16)-1))
 #define pack(a,b)   ((a)<<8 | (b))
 
-unsigned char *
+static GLint
+tiff_internal_format(GLenum pixelFormat, GLenum dataType)
+{
+    switch (pixelFormat) {
+        case GL_LUMINANCE: {
+            switch (dataType) {
+                case GL_UNSIGNED_BYTE: return GL_LUMINANCE8;
+                case GL_UNSIGNED_SHORT: return GL_LUMINANCE16;
+                case GL_FLOAT : return GL_LUMINANCE32F_ARB;
+            }
+            break;
+        }
+        case GL_LUMINANCE_ALPHA: {
+            switch (dataType) {
+                case GL_UNSIGNED_BYTE: return GL_LUMINANCE_ALPHA8UI_EXT;
+                case GL_UNSIGNED_SHORT: return GL_LUMINANCE_ALPHA16UI_EXT;
+                case GL_FLOAT: return GL_LUMINANCE_ALPHA32F_ARB;
+            }
+            break;
+        }
+        case GL_RGB: {
+            switch (dataType) {
+                case GL_UNSIGNED_BYTE: return GL_RGB8;
+                case GL_UNSIGNED_SHORT: return GL_RGB16;
+                case GL_FLOAT: return GL_RGB32F_ARB;
+            }
+            break;
+        }
+        case GL_RGBA : {
+            switch (dataType) {
+                case GL_UNSIGNED_BYTE: return GL_RGBA8;
+                case GL_UNSIGNED_SHORT: return GL_RGBA16;
+                case GL_FLOAT: return GL_RGBA32F_ARB;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+osg::ref_ptr<osg::Image>
 simage_tiff_load(std::istream& fin,
-                 int& width_ret,
-                 int& height_ret,
-                 int& numComponents_ret,
-                 uint16& bitspersample)
+                 osgDB::ImageDestination* destination)
 {
     TIFF *in;
     uint16 dataType;
@@ -511,6 +548,7 @@ simage_tiff_load(std::istream& fin,
     uint16 photometric;
     uint32 w, h;
     uint16 config;
+    uint16 bitspersample;
     uint16* red;
     uint16* green;
     uint16* blue;
@@ -518,9 +556,7 @@ simage_tiff_load(std::istream& fin,
     tsize_t rowsize;
     uint32 row;
     int format;
-    unsigned char *buffer;
-    int width;
-    int height;
+    osg::ref_ptr<osg::Image> image;
     unsigned char *currPtr;
 
     TIFFSetErrorHandler(tiff_error);
@@ -632,22 +668,31 @@ simage_tiff_load(std::istream& fin,
     OSG_INFO<<"bytespersample="<<bytespersample<<std::endl;
     OSG_INFO<<"bytesperpixel="<<bytesperpixel<<std::endl;
 
-    buffer = new unsigned char [w*h*format];
+    // a palette is remapped to 8 bit rgb, otherwise the samples are copied as they are.
+    int numComponents = (photometric == PHOTOMETRIC_PALETTE) ? 3 : samplesperpixel;
+
+    GLenum pixelFormat =
+        numComponents == 1 ? GL_LUMINANCE :
+        numComponents == 2 ? GL_LUMINANCE_ALPHA :
+        numComponents == 3 ? GL_RGB :
+        numComponents == 4 ? GL_RGBA : (GLenum)-1;
+
+    GLenum pixelDataType =
+        (photometric == PHOTOMETRIC_PALETTE || bitspersample == 8) ? GL_UNSIGNED_BYTE :
+        bitspersample == 16 ? GL_UNSIGNED_SHORT :
+        bitspersample == 32 ? GL_FLOAT : (GLenum)-1;
+
+    // decode straight into the image provided by the destination, which may reuse the storage of an image it has been given.
+    image = destination->allocateImage(w, h, 1, tiff_internal_format(pixelFormat, pixelDataType), pixelFormat, pixelDataType);
 
-    if (!buffer)
+    if (!image || image->getRowSizeInBytes()!=(unsigned int)(w*format))
     {
         tifferror = ERR_MEM;
         TIFFClose(in);
         return NULL;
     }
 
-    // initialize memory
-    for(unsigned char* ptr=buffer;ptr<buffer+w*h*format;++ptr) *ptr = 0;
-
-    width = w;
-    height = h;
-
-    currPtr = buffer + (h-1)*w*format;
+    currPtr = image->data(0, h-1);
 
     tifferror = ERR_NO_ERROR;
 
@@ -667,6 +712,7 @@ simage_tiff_load(std::istream& fin,
                 }
                 invert_row(currPtr, inbuf, samplesperpixel*w, photometric == PHOTOMETRIC_MINISWHITE, bitspersample);
                 currPtr -= format*w;
+                destination->rowsDecoded(image.get(), h-1-row, 1);
             }
             break;
 
@@ -704,6 +750,7 @@ simage_tiff_load(std::istream& fin,
                 }
                 remap_row(currPtr, inbuf, w, red, green, blue);
                 currPtr -= format*w;
+                destination->rowsDecoded(image.get(), h-1-row, 1);
             }
             break;
 
@@ -718,6 +765,7 @@ simage_tiff_load(std::istream& fin,
                 }
                 memcpy(currPtr, inbuf, format*w);
                 currPtr -= format*w;
+                destination->rowsDecoded(image.get(), h-1-row, 1);
             }
             break;
 
@@ -739,6 +787,7 @@ simage_tiff_load(std::istream& fin,
                     if (format==3) interleave_row(currPtr, inbuf, inbuf+rowsize, inbuf+2*rowsize, w, format, bitspersample);
                     else if (format==4) interleave_row(currPtr, inbuf, inbuf+rowsize, inbuf+2*rowsize, inbuf+3*rowsize, w, format, bitspersample);
                     currPtr -= format*w;
+                    destination->rowsDecoded(image.get(), h-1-row, 1);
                 }
             }
             break;
@@ -752,17 +801,12 @@ simage_tiff_load(std::istream& fin,
 
     if (tifferror)
     {
-        if (buffer) delete [] buffer;
         return NULL;
     }
-    width_ret = width;
-    height_ret = height;
-    if (photometric == PHOTOMETRIC_PALETTE)
-        numComponents_ret = format;
-    else
-        numComponents_ret = samplesperpixel;
 
-    return buffer;
+    destination->imageDecoded(image.get());
+
+    return image;
 }
 
 
@@ -787,17 +831,14 @@ class ReaderWriterTIFF : public osgDB::ReaderWriter
             return false;
         }
 
-        ReadResult readTIFStream(std::istream& fin) const
+        ReadResult readTIFStream(std::istream& fin, const osgDB::ReaderWriter::Options* options) const
         {
-            unsigned char *imageData = NULL;
-            int width_ret = -1;
-            int height_ret = -1;
-            int numComponents_ret = -1;
-            uint16 bitspersample_ret = 0;
+            // decode straight into the image provided by the ImageDestination, when one is assigned, so that its storage is reused.
+            osg::ref_ptr<osgDB::ImageDestination> destination = (options && options->getImageDestination()) ? options->getImageDestination() : new osgDB::ImageDestination;
 
-            imageData = simage_tiff_load(fin, width_ret, height_ret, numComponents_ret, bitspersample_ret);
+            osg::ref_ptr<osg::Image> pOsgImage = simage_tiff_load(fin, destination.get());
 
-            if (imageData==NULL)
+            if (!pOsgImage)
             {
                 char err_msg[256];
                 simage_tiff_error( err_msg, sizeof(err_msg));
@@ -805,66 +846,7 @@ class ReaderWriterTIFF : public osgDB::ReaderWriter
                 return ReadResult::FILE_NOT_HANDLED;
             }
 
-            int s = width_ret;
-            int t = height_ret;
-            int r = 1;
-
-            unsigned int pixelFormat =
-                numComponents_ret == 1 ? GL_LUMINANCE :
-                numComponents_ret == 2 ? GL_LUMINANCE_ALPHA :
-                numComponents_ret == 3 ? GL_RGB :
-                numComponents_ret == 4 ? GL_RGBA : (GLenum)-1;
-
-            unsigned int dataType =
-                bitspersample_ret == 8 ? GL_UNSIGNED_BYTE :
-                bitspersample_ret == 16 ? GL_UNSIGNED_SHORT :
-                bitspersample_ret == 32 ? GL_FLOAT : (GLenum)-1;
-
-            int internalFormat = 0;
-            switch (pixelFormat) {
-                case GL_LUMINANCE: {
-                    switch (dataType) {
-                        case GL_UNSIGNED_BYTE: internalFormat = GL_LUMINANCE8; break;
-                        case GL_UNSIGNED_SHORT: internalFormat = GL_LUMINANCE16; break;
-                        case GL_FLOAT : internalFormat = GL_LUMINANCE32F_ARB; break;
-                    }
-                    break;
-                }
-                case GL_LUMINANCE_ALPHA: {
-                    switch (dataType) {
-                        case GL_UNSIGNED_BYTE: internalFormat = GL_LUMINANCE_ALPHA8UI_EXT; break;
-                        case GL_UNSIGNED_SHORT: internalFormat = GL_LUMINANCE_ALPHA16UI_EXT; break;
-                        case GL_FLOAT: internalFormat = GL_LUMINANCE_ALPHA32F_ARB; break;
-                    }
-                    break;
-                }
-                case GL_RGB: {
-                    switch (dataType) {
-                        case GL_UNSIGNED_BYTE: internalFormat = GL_RGB8; break;
-                        case GL_UNSIGNED_SHORT: internalFormat = GL_RGB16; break;
-                        case GL_FLOAT: internalFormat = GL_RGB32F_ARB; break;
-                    }
-                    break;
-                }
-                case GL_RGBA : {
-                    switch (dataType) {
-                        case GL_UNSIGNED_BYTE: internalFormat = GL_RGBA8; break;
-                        case GL_UNSIGNED_SHORT: internalFormat = GL_RGBA16; break;
-                        case GL_FLOAT: internalFormat = GL_RGBA32F_ARB; break;
-                    }
-                    break;
-                }
-            }
-
-            osg::Image* pOsgImage = new osg::Image;
-            pOsgImage->setImage(s,t,r,
-                internalFormat,
-                pixelFormat,
-                dataType,
-                imageData,
-                osg::Image::USE_NEW_DELETE);
-
-            return pOsgImage;
+            return pOsgImage.release();
         }
 
         WriteResult::WriteStatus writeTIFStream(std::ostream& fout, const osg::Image& img, const osgDB::ReaderWriter::Options* options) const
@@ -1000,9 +982,9 @@ class ReaderWriterTIFF : public osgDB::ReaderWriter
             return readImage(file, options);
         }
 
-        virtual ReadResult readImage(std::istream& fin,const osgDB::ReaderWriter::Options* =NULL) const
+        virtual ReadResult readImage(std::istream& fin,const osgDB::ReaderWriter::Options* options =NULL) const
         {
-            return readTIFStream(fin);
+            return readTIFStream(fin, options);
         }
 
         virtual ReadResult readImage(const std::string& file, const osgDB::ReaderWriter::Options* options) const
@@ -1015,7 +997,7 @@ class ReaderWriterTIFF : public osgDB::ReaderWriter
 
             osgDB::ifstream istream(fileName.c_str(), std::ios::in | std::ios::binary);
             if(!istream) return ReadResult::FILE_NOT_HANDLED;
-            ReadResult rr = readTIFStream(istream);
+            ReadResult rr = readTIFStream(istream, options);
             if(rr.validImage()) rr.getImage()->setFileName(file);
             return rr;
         }
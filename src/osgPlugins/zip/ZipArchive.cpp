@@ -55,14 +55,25 @@ void ZipArchive::close()
         OpenThreads::ScopedLock<OpenThreads::Mutex> exclusive(_zipMutex);
         if ( _zipLoaded )
         {
-            // close the file (on one thread since it's a shared file)
-            const PerThreadData& data = getDataNoLock();
-            CloseZip( data._zipHandle );
-
-            // clear out the file handles
-            _perThreadData.clear();
+            // close the handles opened by each of the threads
+            {
+                OpenThreads::ScopedWriteLock exclusiveData(_perThreadDataMutex);
+                for(PerThreadDataMap::iterator itr = _perThreadData.begin();
+                    itr != _perThreadData.end();
+                    ++itr)
+                {
+                    if ( itr->second._zipHandle != NULL ) CloseZip( itr->second._zipHandle );
+                }
+                _perThreadData.clear();
+            }
 
             // clear out the index.
+            for(ZipEntryMap::iterator itr = _zipIndex.begin();
+                itr != _zipIndex.end();
+                ++itr)
+            {
+                delete itr->second;
+            }
             _zipIndex.clear();
 
             _zipLoaded = false;
@@ -131,7 +142,7 @@ bool ZipArchive::open(const std::string& file, ArchiveStatus /*status*/, const o
             _password = ReadPassword(options);
 
             // open the zip file in this thread:
-            const PerThreadData& data = getDataNoLock();
+            const PerThreadData& data = getData();
 
             // establish a shared (read-only) index:
             if ( data._zipHandle != NULL )
@@ -167,7 +178,7 @@ bool ZipArchive::open(std::istream& fin, const osgDB::ReaderWriter::Options* opt
             _password = ReadPassword(options);
 
             // open on this thread:
-            const PerThreadData& data = getDataNoLock();
+            const PerThreadData& data = getData();
 
             if ( data._zipHandle != NULL )
             {
@@ -664,42 +675,45 @@ bool ZipArchive::CheckZipErrorCode(ZRESULT result) const
 const ZipArchive::PerThreadData&
 ZipArchive::getData() const
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> exclusive( const_cast<ZipArchive*>(this)->_zipMutex );
-    return getDataNoLock();
-}
-
-
-const ZipArchive::PerThreadData&
-ZipArchive::getDataNoLock() const
-{
-    // get/create data for the currently running thread:
     size_t current = OpenThreads::Thread::CurrentThreadId();
 
-    PerThreadDataMap::const_iterator i = _perThreadData.find( current );
-
-    if ( i == _perThreadData.end() || i->second._zipHandle == NULL )
     {
-        // cache pattern: cast to const for caching purposes
-        ZipArchive* ncThis = const_cast<ZipArchive*>(this);
+        OpenThreads::ScopedReadLock sharedLock( _perThreadDataMutex );
 
-        // data does not already exist, so open the ZIP with a handle exclusively for this thread:
-        PerThreadData& data = ncThis->_perThreadData[current];
-        if ( !_filename.empty() )
+        PerThreadDataMap::const_iterator i = _perThreadData.find( current );
+        if ( i != _perThreadData.end() && i->second._zipHandle != NULL )
         {
-            data._zipHandle = OpenZip( _filename.c_str(), _password.c_str() );
+            return i->second;
         }
-        else if ( !_membuffer.empty() )
-        {
-            data._zipHandle = OpenZip( (void*)_membuffer.c_str(), _membuffer.length(), _password.c_str() );
-        }
-        else
-        {
-            data._zipHandle = NULL;
-        }
-        return data;
+    }
+
+    // data does not already exist, so open the ZIP with a handle exclusively for this thread,
+    // doing so outside of the lock so other threads carry on reading while it's opened.
+    HZIP zipHandle = openZipHandle();
+
+    OpenThreads::ScopedWriteLock exclusiveLock( _perThreadDataMutex );
+
+    // cache pattern: cast to const for caching purposes
+    ZipArchive* ncThis = const_cast<ZipArchive*>(this);
+
+    // std::map nodes are never moved, so the reference stays valid once the lock is released
+    PerThreadData& data = ncThis->_perThreadData[current];
+    data._zipHandle = zipHandle;
+    return data;
+}
+
+HZIP ZipArchive::openZipHandle() const
+{
+    if ( !_filename.empty() )
+    {
+        return OpenZip( _filename.c_str(), _password.c_str() );
+    }
+    else if ( !_membuffer.empty() )
+    {
+        return OpenZip( (void*)_membuffer.c_str(), _membuffer.length(), _password.c_str() );
     }
     else
     {
-        return i->second;
+        return NULL;
     }
 }
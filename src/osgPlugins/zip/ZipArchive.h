@@ -6,6 +6,7 @@
 
 #include <osgDB/Archive>
 #include <OpenThreads/Mutex>
+#include <OpenThreads/ReadWriteMutex>
 
 #include "unzip.h"
 
@@ -93,10 +94,15 @@ class ZipArchive : public osgDB::Archive
         };
 
         typedef std::map<size_t, PerThreadData> PerThreadDataMap;
+        mutable OpenThreads::ReadWriteMutex _perThreadDataMutex;
         PerThreadDataMap _perThreadData;
 
+        /** get the zip handle of the calling thread, opening one if needed. Threads that already have a
+          * handle only take a read lock, and new handles are opened outside of the lock, so that pager
+          * threads can inflate members concurrently.*/
         const PerThreadData& getData() const;
-        const PerThreadData& getDataNoLock() const;
+
+        HZIP openZipHandle() const;
 };
 
 
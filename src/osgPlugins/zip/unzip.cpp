@@ -3964,7 +3964,7 @@ int unzCloseCurrentFile (unzFile file);
 
 class TUnzip
 { public:
-  TUnzip(const char *pwd) : uf(0), currentfile(-1), czei(-1), password(0), unzbuf(0)
+  TUnzip(const char *pwd) : uf(0), currentfile(-1), czei(-1), password(0), unzbuf(0), dirpos(0), ndirpos(0)
   {
     if (pwd!=0)
     {
@@ -3972,12 +3972,17 @@ class TUnzip
         strncpy(password,pwd,strlen(pwd)+1);
     }
   }
-  ~TUnzip() {if (password!=0) delete[] password; password=0; if (unzbuf!=0) delete[] unzbuf; unzbuf=0;}
+  ~TUnzip() {if (password!=0) delete[] password; password=0; if (unzbuf!=0) delete[] unzbuf; unzbuf=0; if (dirpos!=0) delete[] dirpos; dirpos=0;}
 
   unzFile uf; int currentfile; ZIPENTRY cze; int czei;
   char *password;
   char *unzbuf;            // lazily created and destroyed, used by Unzip
   TCHAR rootdir[MAX_PATH]; // includes a trailing slash
+  uLong *dirpos;           // central directory positions of the items walked past so far, so that
+  int ndirpos;             // going back to an earlier item doesn't mean walking the directory again
+
+  void GoToItem(int index);
+  void RecordItemPos();
 
   ZRESULT Open(void *z,unsigned int len,DWORD flags);
   ZRESULT Get(int index,ZIPENTRY *ze);
@@ -4014,9 +4019,35 @@ ZRESULT TUnzip::Open(void *z,unsigned int len,DWORD flags)
   if (f==NULL) return e;
   uf = unzOpenInternal(f);
   if (uf==0) return ZR_NOFILE;
+  if (uf->gi.number_entry>0)
+  { dirpos = new uLong[uf->gi.number_entry];
+    RecordItemPos();
+  }
   return ZR_OK;
 }
 
+void TUnzip::RecordItemPos()
+{ if (dirpos!=0 && uf->current_file_ok && (int)uf->num_file==ndirpos) dirpos[ndirpos++]=uf->pos_in_central_dir;
+}
+
+void TUnzip::GoToItem(int index)
+{ if (index==(int)uf->num_file) return;
+  if (index<ndirpos)
+  { // jump straight to an item we've been past before
+    uf->pos_in_central_dir=dirpos[index]; uf->num_file=index;
+    int err=unzlocal_GetCurrentFileInfoInternal(uf,&uf->cur_file_info,&uf->cur_file_info_internal,NULL,0,NULL,0,NULL,0);
+    uf->current_file_ok = (err==UNZ_OK);
+    return;
+  }
+  // otherwise walk on from the furthest item we know of
+  if (ndirpos>0 && (int)uf->num_file<ndirpos-1) GoToItem(ndirpos-1);
+  else if (index<(int)uf->num_file) {unzGoToFirstFile(uf); RecordItemPos();}
+  while ((int)uf->num_file<index)
+  { if (unzGoToNextFile(uf)!=UNZ_OK) break;
+    RecordItemPos();
+  }
+}
+
 ZRESULT TUnzip::SetUnzipBaseDir(const TCHAR *dir)
 {
 #ifdef ZIP_STD
@@ -4050,8 +4081,7 @@ ZRESULT TUnzip::Get(int index,ZIPENTRY *ze)
     ze->unc_size=0;
     return ZR_OK;
   }
-  if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-  while ((int)uf->num_file<index) unzGoToNextFile(uf);
+  GoToItem(index);
   unz_file_info ufi; char fn[MAX_PATH];
   unzGetCurrentFileInfo(uf,&ufi,fn,MAX_PATH,NULL,0,NULL,0);
   // now get the extra header. We do this ourselves, instead of
@@ -4280,8 +4310,7 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
   { if (index!=currentfile)
     { if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
       if (index>=(int)uf->gi.number_entry) return ZR_ARGS;
-      if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-      while ((int)uf->num_file<index) unzGoToNextFile(uf);
+      GoToItem(index);
       unzOpenCurrentFile(uf,password); currentfile=index;
     }
     bool reached_eof;
@@ -4310,8 +4339,7 @@ ZRESULT TUnzip::Unzip(int index,void *dst,unsigned int len,DWORD flags)
   // otherwise we're writing to a handle or a file
   if (currentfile!=-1) unzCloseCurrentFile(uf); currentfile=-1;
   if (index>=(int)uf->gi.number_entry) return ZR_ARGS;
-  if (index<(int)uf->num_file) unzGoToFirstFile(uf);
-  while ((int)uf->num_file<index) unzGoToNextFile(uf);
+  GoToItem(index);
   ZIPENTRY ze; Get(index,&ze);
   // zipentry=directory is handled specially
 #ifdef ZIP_STD
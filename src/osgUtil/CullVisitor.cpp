@@ -14,6 +14,8 @@
 #include <osg/Projection>
 #include <osg/Geode>
 #include <osg/LOD>
+#include <osg/PagedLOD>
+#include <osg/ProxyNode>
 #include <osg/Billboard>
 #include <osg/LightSource>
 #include <osg/ClipNode>
@@ -27,11 +29,14 @@
 #include <osg/TemplatePrimitiveFunctor>
 #include <osg/Geometry>
 #include <osg/io_utils>
+#include <osg/ApplicationUsage>
 
 #include <osgUtil/CullVisitor>
 
 #include <float.h>
+#include <stdlib.h>
 #include <algorithm>
+#include <typeinfo>
 
 #include <osg/Timer>
 
@@ -43,6 +48,21 @@ inline float MAX_F(float a, float b)
 inline int EQUAL_F(float a, float b)
     { return a == b || fabsf(a-b) <= MAX_F(fabsf(a),fabsf(b))*1e-3f; }
 
+static osg::ApplicationUsageProxy CullVisitor_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_CULL_THREADS <value>","Set the number of threads used to cull the children of wide Groups in parallel, 1 disables parallel culling, 0 uses all of the shared task scheduler's threads.");
+
+static unsigned int getDefaultNumCullThreads()
+{
+    static unsigned int s_numCullThreads = 1;
+    static bool s_initialized = false;
+    if (!s_initialized)
+    {
+        s_initialized = true;
+        const char* str = getenv("OSG_NUM_CULL_THREADS");
+        if (str) s_numCullThreads = atoi(str);
+    }
+    return s_numCullThreads;
+}
+
 
 CullVisitor::CullVisitor():
     osg::NodeVisitor(CULL_VISITOR,TRAVERSE_ACTIVE_CHILDREN),
@@ -52,7 +72,12 @@ CullVisitor::CullVisitor():
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
-    _numberOfEncloseOverrideRenderBinDetails(0)
+    _numberOfEncloseOverrideRenderBinDetails(0),
+    _numCullThreads(getDefaultNumCullThreads()),
+    _minimumNumChildrenToCullInParallel(16),
+    _parallelCullMutex(0),
+    _parallelCullNodePathDepth(0),
+    _clearNodeApplied(false)
 {
     _identifier = new Identifier;
 }
@@ -68,7 +93,12 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
     _numberOfEncloseOverrideRenderBinDetails(0),
-    _identifier(rhs._identifier)
+    _identifier(rhs._identifier),
+    _numCullThreads(rhs._numCullThreads),
+    _minimumNumChildrenToCullInParallel(rhs._minimumNumChildrenToCullInParallel),
+    _parallelCullMutex(0),
+    _parallelCullNodePathDepth(0),
+    _clearNodeApplied(false)
 {
 }
 
@@ -133,6 +163,13 @@ void CullVisitor::reset()
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
+
+    for(CullWorkerList::iterator itr = _cullWorkers.begin();
+        itr != _cullWorkers.end();
+        ++itr)
+    {
+        (*itr)->reset();
+    }
 }
 
 float CullVisitor::getDistanceToEyePoint(const Vec3& pos, bool withLODScale) const
@@ -1145,7 +1182,7 @@ void CullVisitor::apply(Group& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    if (!cullChildrenInParallel(node)) handle_cull_callbacks_and_traverse(node);
 
     // pop the node's state off the render graph stack.
     if (node_state) popStateSet();
@@ -1154,6 +1191,319 @@ void CullVisitor::apply(Group& node)
     popCurrentMask();
 }
 
+namespace
+{
+
+/** Operation that culls a contiguous range of a Group's children with a worker CullVisitor.*/
+class CullChildrenOperation : public osg::Operation
+{
+public:
+    CullChildrenOperation(CullVisitor* cullVisitor, osg::Group* group, unsigned int begin, unsigned int end):
+        osg::Operation("CullChildren", false),
+        _cullVisitor(cullVisitor),
+        _group(group),
+        _begin(begin),
+        _end(end) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        for(unsigned int i=_begin; i<_end; ++i)
+        {
+            _group->getChild(i)->accept(*_cullVisitor);
+        }
+    }
+
+protected:
+    CullVisitor*        _cullVisitor;
+    osg::Group*         _group;
+    unsigned int        _begin;
+    unsigned int        _end;
+};
+
+typedef std::map<StateGraph*, StateGraph*> StateGraphMap;
+
+/** Return the StateGraph in the destination tree with the same StateSet path as sg, creating it if required.*/
+StateGraph* findOrInsertMergedStateGraph(StateGraph* sg, StateGraphMap& stateGraphMap)
+{
+    StateGraphMap::iterator itr = stateGraphMap.find(sg);
+    if (itr!=stateGraphMap.end()) return itr->second;
+
+    StateGraph* parent = findOrInsertMergedStateGraph(sg->_parent, stateGraphMap);
+    StateGraph* merged = parent->find_or_insert(sg->getStateSet());
+    stateGraphMap[sg] = merged;
+    return merged;
+}
+
+/** Move the leaves of a worker RenderBin, and recursively its child bins, into the matching destination RenderBin.*/
+void mergeRenderBin(RenderBin* bin, RenderBin* workerBin, StateGraphMap& stateGraphMap, unsigned int traversalOrderOffset)
+{
+    RenderBin::StateGraphList& stateGraphList = workerBin->getStateGraphList();
+    for(RenderBin::StateGraphList::iterator itr = stateGraphList.begin();
+        itr != stateGraphList.end();
+        ++itr)
+    {
+        StateGraph* workerStateGraph = *itr;
+        StateGraph* stateGraph = findOrInsertMergedStateGraph(workerStateGraph, stateGraphMap);
+
+        // as in CullVisitor::addDrawable(), a StateGraph is added to the bin along with its first leaf.
+        if (stateGraph->leaves_empty() && !workerStateGraph->leaves_empty()) bin->addStateGraph(stateGraph);
+
+        for(StateGraph::LeafList::iterator litr = workerStateGraph->_leaves.begin();
+            litr != workerStateGraph->_leaves.end();
+            ++litr)
+        {
+            (*litr)->_traversalOrderNumber += traversalOrderOffset;
+            stateGraph->addLeaf(litr->get());
+        }
+        workerStateGraph->_leaves.clear();
+    }
+
+    RenderBin::RenderBinList& workerBins = workerBin->getRenderBinList();
+    for(RenderBin::RenderBinList::iterator itr = workerBins.begin();
+        itr != workerBins.end();
+        ++itr)
+    {
+        RenderBin* workerChild = itr->second.get();
+        // clone the worker's bin so that custom RenderBin subclasses, which needn't be registered as prototypes under
+        // their class name, are replicated along with their sort mode, StateSet and callbacks.
+        RenderBin* child = bin->find_or_insert(itr->first, workerChild);
+
+        mergeRenderBin(child, workerChild, stateGraphMap, traversalOrderOffset);
+    }
+}
+
+}
+
+bool CullVisitor::cullChildrenInParallel(osg::Group& group)
+{
+    // the workers are already busy if this Group is below one that is being culled in parallel.
+    if (_numCullThreads==1 || _parallelCullMutex) return false;
+
+    unsigned int numChildren = group.getNumChildren();
+    if (numChildren<_minimumNumChildrenToCullInParallel || numChildren<2) return false;
+
+    // subclasses of Group such as Switch and Sequence have their own rules for which children to
+    // traverse, and cull callbacks control the traversal themselves, so only fork at plain Groups.
+    if (typeid(group)!=typeid(osg::Group) || group.getCullCallback()) return false;
+
+    // the worker's RenderStage stands in for the current RenderBin, so this has to be the stage itself
+    // for non nested bins to be merged back into the correct place.
+    if (!_currentRenderBin || _currentRenderBin!=_currentRenderBin->getStage() || !_currentStateGraph) return false;
+
+    // the calling thread culls its own share of the children, so the default is one more than the shared scheduler's workers.
+    osg::TaskScheduler* scheduler = osg::TaskScheduler::instance().get();
+    unsigned int numThreads = _numCullThreads==0 ? scheduler->getNumThreads()+1 : _numCullThreads;
+    if (numThreads>numChildren) numThreads = numChildren;
+    if (numThreads<2) return false;
+
+    unsigned int numWorkers = numThreads-1;
+
+    while(_cullWorkers.size()<numWorkers)
+    {
+        osg::ref_ptr<CullVisitor> worker = clone();
+        worker->_numCullThreads = 1;
+        worker->_rootStateGraph = new StateGraph;
+        worker->_rootRenderStage = _rootRenderStage.valid() ? osg::cloneType(_rootRenderStage.get()) : new RenderStage;
+        _cullWorkers.push_back(worker);
+    }
+
+    // make sure all the bounding volumes in the subgraph are computed before the workers start reading them.
+    group.getBound();
+
+    osg::ref_ptr<osg::TaskGroup> taskGroup = new osg::TaskGroup;
+
+    _parallelCullMutex = &_sharedNodeMutex;
+    _parallelCullNodePathDepth = _nodePath.size();
+
+    for(unsigned int i=0; i<numWorkers; ++i)
+    {
+        CullVisitor* worker = _cullWorkers[i].get();
+        prepareCullWorker(*worker);
+
+        unsigned int begin = ((i+1)*numChildren)/numThreads;
+        unsigned int end = ((i+2)*numChildren)/numThreads;
+        scheduler->add(new CullChildrenOperation(worker, &group, begin, end), taskGroup.get());
+    }
+
+    // cull the first range of children on this thread while the workers handle the rest.
+    unsigned int end = numChildren/numThreads;
+    for(unsigned int i=0; i<end; ++i)
+    {
+        group.getChild(i)->accept(*this);
+    }
+
+    // only the workers' cull tasks are run here while waiting, so the cull isn't held up by other work on the shared scheduler.
+    scheduler->wait(taskGroup.get());
+
+    _parallelCullMutex = 0;
+
+    // merge in child order so the result is the same as a serial traversal.
+    for(unsigned int i=0; i<numWorkers; ++i)
+    {
+        mergeCullWorker(*_cullWorkers[i]);
+    }
+
+    return true;
+}
+
+bool CullVisitor::isNodeSharedBelowParallelCull() const
+{
+    // a node can only be reached by more than one of the threads if it, or one of its ancestors below
+    // the Group being culled in parallel, has more than one parent.
+    for(unsigned int i=_parallelCullNodePathDepth; i<_nodePath.size(); ++i)
+    {
+        if (_nodePath[i]->getNumParents()>1) return true;
+    }
+    return false;
+}
+
+void CullVisitor::prepareCullWorker(CullVisitor& worker)
+{
+    // NodeVisitor state
+    worker.setTraversalMask(getTraversalMask());
+    worker.setNodeMaskOverride(getNodeMaskOverride());
+    worker.setTraversalNumber(getTraversalNumber());
+    worker._frameStamp = _frameStamp;
+    worker._databaseRequestHandler = _databaseRequestHandler;
+    worker._imageRequestHandler = _imageRequestHandler;
+    worker._nodePath = _nodePath;
+    worker._parallelCullMutex = _parallelCullMutex;
+    worker._parallelCullNodePathDepth = _parallelCullNodePathDepth;
+
+    // CullStack state
+    worker.setCullSettings(*this);
+    worker._occluderList = _occluderList;
+    worker._projectionStack = _projectionStack;
+    worker._modelviewStack = _modelviewStack;
+    worker._MVPW_Stack = _MVPW_Stack;
+    worker._viewportStack = _viewportStack;
+    worker._referenceViewPoints = _referenceViewPoints;
+    worker._eyePointStack = _eyePointStack;
+    worker._viewPointStack = _viewPointStack;
+    worker._clipspaceCullingStack = _clipspaceCullingStack;
+    worker._projectionCullingStack = _projectionCullingStack;
+    worker._modelviewCullingStack = _modelviewCullingStack;
+    worker._index_modelviewCullingStack = _index_modelviewCullingStack;
+    worker._back_modelviewCullingStack = _index_modelviewCullingStack>0 ? &worker._modelviewCullingStack[_index_modelviewCullingStack-1] : 0;
+    worker._frustumVolume = _frustumVolume;
+    worker._bbCornerNear = _bbCornerNear;
+    worker._bbCornerFar = _bbCornerFar;
+
+    // CullVisitor state
+    worker._renderInfo = _renderInfo;
+    worker._identifier = _identifier;
+    worker._computed_znear = FLT_MAX;
+    worker._computed_zfar = -FLT_MAX;
+    worker._nearPlaneCandidateMap.clear();
+    worker._farPlaneCandidateMap.clear();
+    worker._traversalOrderNumber = 0;
+    worker._numberOfEncloseOverrideRenderBinDetails = _numberOfEncloseOverrideRenderBinDetails;
+    worker._renderBinStack.clear();
+
+    // set up the worker's RenderStage so that RTT Cameras below the group inherit the same settings.
+    RenderStage* stage = getCurrentRenderStage();
+    RenderStage* workerStage = worker._rootRenderStage.get();
+    workerStage->setCamera(stage->getCamera());
+    workerStage->setViewport(stage->getViewport());
+    workerStage->setDrawBuffer(stage->getDrawBuffer(), stage->getDrawBufferApplyMask());
+    workerStage->setReadBuffer(stage->getReadBuffer(), stage->getReadBufferApplyMask());
+    workerStage->setClearMask(stage->getClearMask());
+    workerStage->setClearColor(stage->getClearColor());
+    workerStage->setColorMask(stage->getColorMask());
+    worker._currentRenderBin = workerStage;
+    worker._clearNodeApplied = false;
+
+    // replicate the StateGraph parental chain so the worker pushes state relative to the same StateSets.
+    std::vector<StateGraph*> stateGraphParentalChain;
+    for(StateGraph* sg = _currentStateGraph; sg; sg = sg->_parent)
+    {
+        stateGraphParentalChain.push_back(sg);
+    }
+
+    std::vector<StateGraph*>::reverse_iterator ritr = stateGraphParentalChain.rbegin();
+    worker._rootStateGraph->setStateSet((*ritr++)->getStateSet());
+    worker._currentStateGraph = worker._rootStateGraph.get();
+    while(ritr != stateGraphParentalChain.rend())
+    {
+        worker._currentStateGraph = worker._currentStateGraph->find_or_insert((*ritr++)->getStateSet());
+    }
+}
+
+void CullVisitor::mergeCullWorker(CullVisitor& worker)
+{
+    RenderStage* stage = getCurrentRenderStage();
+    RenderStage* workerStage = worker._rootRenderStage.get();
+
+    PositionalStateContainer* psc = stage->getPositionalStateContainer();
+    PositionalStateContainer* workerPSC = workerStage->getPositionalStateContainer();
+
+    // move across the RenderStages of any RTT Cameras below the group, pointing them at this stage's
+    // positional state rather than the worker's.
+    RenderStage::RenderStageList& preRenderList = workerStage->getPreRenderList();
+    for(RenderStage::RenderStageList::iterator itr = preRenderList.begin();
+        itr != preRenderList.end();
+        ++itr)
+    {
+        if (itr->second->getInheritedPositionalStateContainer()==workerPSC) itr->second->setInheritedPositionalStateContainer(psc);
+        stage->addPreRenderStage(itr->second.get(), itr->first);
+    }
+    preRenderList.clear();
+
+    RenderStage::RenderStageList& postRenderList = workerStage->getPostRenderList();
+    for(RenderStage::RenderStageList::iterator itr = postRenderList.begin();
+        itr != postRenderList.end();
+        ++itr)
+    {
+        if (itr->second->getInheritedPositionalStateContainer()==workerPSC) itr->second->setInheritedPositionalStateContainer(psc);
+        stage->addPostRenderStage(itr->second.get(), itr->first);
+    }
+    postRenderList.clear();
+
+    // the clear settings of any ClearNode below the group, the workers are merged in child order so the last one wins as in a serial traversal.
+    if (worker._clearNodeApplied)
+    {
+        stage->setClearColor(workerStage->getClearColor());
+        stage->setClearMask(workerStage->getClearMask());
+    }
+
+    // positional state such as lights
+    PositionalStateContainer::AttrMatrixList& attrList = workerPSC->getAttrMatrixList();
+    psc->getAttrMatrixList().insert(psc->getAttrMatrixList().end(), attrList.begin(), attrList.end());
+
+    PositionalStateContainer::TexUnitAttrMatrixListMap& texAttrListMap = workerPSC->getTexUnitAttrMatrixListMap();
+    for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator itr = texAttrListMap.begin();
+        itr != texAttrListMap.end();
+        ++itr)
+    {
+        PositionalStateContainer::AttrMatrixList& texAttrList = psc->getTexUnitAttrMatrixListMap()[itr->first];
+        texAttrList.insert(texAttrList.end(), itr->second.begin(), itr->second.end());
+    }
+
+    // StateGraphs, RenderLeaves and RenderBins
+    StateGraph* rootStateGraph = _currentStateGraph;
+    while(rootStateGraph->_parent) rootStateGraph = rootStateGraph->_parent;
+
+    StateGraphMap stateGraphMap;
+    stateGraphMap[worker._rootStateGraph.get()] = rootStateGraph;
+    mergeRenderBin(_currentRenderBin, workerStage, stateGraphMap, _traversalOrderNumber);
+    _traversalOrderNumber += worker._traversalOrderNumber;
+
+    // near and far planes
+    if (worker._computed_znear<_computed_znear) _computed_znear = worker._computed_znear;
+    if (worker._computed_zfar>_computed_zfar) _computed_zfar = worker._computed_zfar;
+
+    _nearPlaneCandidateMap.insert(worker._nearPlaneCandidateMap.begin(), worker._nearPlaneCandidateMap.end());
+    _farPlaneCandidateMap.insert(worker._farPlaneCandidateMap.begin(), worker._farPlaneCandidateMap.end());
+    worker._nearPlaneCandidateMap.clear();
+    worker._farPlaneCandidateMap.clear();
+
+    // empty the worker's backend ready for its next range of children, the leaves themselves stay
+    // in the worker's reuse list until CullVisitor::reset().
+    workerStage->reset();
+    worker._rootStateGraph->clean();
+    worker._rootStateGraph->prune();
+}
+
 void CullVisitor::apply(Transform& node)
 {
     if (isCulled(node)) return;
@@ -1262,6 +1612,34 @@ void CullVisitor::apply(LOD& node)
     popCurrentMask();
 }
 
+void CullVisitor::apply(osg::PagedLOD& node)
+{
+    // PagedLOD records the frame and time it was last traversed, and requests its children, so
+    // during a parallel cull a PagedLOD that more than one thread can reach is culled by one thread at a time.
+    if (_parallelCullMutex && isNodeSharedBelowParallelCull())
+    {
+        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(*_parallelCullMutex);
+        apply(static_cast<osg::LOD&>(node));
+    }
+    else
+    {
+        apply(static_cast<osg::LOD&>(node));
+    }
+}
+
+void CullVisitor::apply(osg::ProxyNode& node)
+{
+    if (_parallelCullMutex && isNodeSharedBelowParallelCull())
+    {
+        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(*_parallelCullMutex);
+        apply(static_cast<osg::Group&>(node));
+    }
+    else
+    {
+        apply(static_cast<osg::Group&>(node));
+    }
+}
+
 void CullVisitor::apply(osg::ClearNode& node)
 {
     // simply override the current earth sky.
@@ -1276,6 +1654,7 @@ void CullVisitor::apply(osg::ClearNode& node)
       // so we don't need to clear.
       getCurrentRenderBin()->getStage()->setClearMask(0);
     }
+    if (getCurrentRenderBin()->getStage()==_rootRenderStage.get()) _clearNodeApplied = true;
 
     // push the node's state.
     StateSet* node_state = node.getStateSet();
@@ -1497,11 +1876,16 @@ void CullVisitor::apply(osg::Camera& camera)
 
         // use render to texture stage.
         // create the render to texture stage.
-        osg::ref_ptr<osgUtil::RenderStageCache> rsCache = dynamic_cast<osgUtil::RenderStageCache*>(camera.getRenderingCache());
-        if (!rsCache)
+        osg::ref_ptr<osgUtil::RenderStageCache> rsCache;
         {
-            rsCache = new osgUtil::RenderStageCache;
-            camera.setRenderingCache(rsCache.get());
+            // the Camera may be culled by several CullVisitors at once, so only one of them should create the cache.
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(*(camera.getDataChangeMutex()));
+            rsCache = dynamic_cast<osgUtil::RenderStageCache*>(camera.getRenderingCache());
+            if (!rsCache)
+            {
+                rsCache = new osgUtil::RenderStageCache;
+                camera.setRenderingCache(rsCache.get());
+            }
         }
 
         osg::ref_ptr<osgUtil::RenderStage> rtts = rsCache->getRenderStage(this);
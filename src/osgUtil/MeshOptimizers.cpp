@@ -16,6 +16,7 @@
 #include <limits>
 
 #include <algorithm>
+#include <set>
 #include <vector>
 
 #include <iostream>
@@ -25,6 +26,7 @@
 #include <osg/PrimitiveSet>
 #include <osg/TriangleIndexFunctor>
 #include <osg/TriangleLinePointIndexFunctor>
+#include <osg/TaskScheduler>
 
 #include <osgUtil/MeshOptimizers>
 
@@ -43,6 +45,133 @@ void GeometryCollector::apply(Geometry& geom)
     _geometryList.insert(&geom);
 }
 
+namespace
+{
+// Operation applied to each collected Geometry, implementations must only modify the Geometry passed in.
+struct GeometryOperation
+{
+    virtual ~GeometryOperation() {}
+    virtual void operator() (Geometry& geom) = 0;
+};
+
+template<class V>
+struct GeometryMemberOperation : public GeometryOperation
+{
+    typedef void (V::*Function)(Geometry&);
+
+    GeometryMemberOperation(V& visitor, Function function):
+        _visitor(visitor),
+        _function(function) {}
+
+    virtual void operator() (Geometry& geom) { (_visitor.*_function)(geom); }
+
+    V&          _visitor;
+    Function    _function;
+};
+
+typedef std::vector<Geometry*> GeometryVector;
+
+// Return true if any of the geometry's arrays or primitive sets are referenced from elsewhere, or are held in a
+// vertex or element buffer object along with another geometry's data. Such geometries can't safely be modified
+// concurrently with other geometries, as dirtying an array or primitive set also updates its buffer object.
+bool sharesData(const Geometry& geom)
+{
+    if (geom.containsSharedArrays()) return true;
+
+    typedef std::set<const BufferData*> BufferDataSet;
+    BufferDataSet ownData;
+
+    const Geometry::PrimitiveSetList& primitives = geom.getPrimitiveSetList();
+    for(Geometry::PrimitiveSetList::const_iterator itr = primitives.begin();
+        itr != primitives.end();
+        ++itr)
+    {
+        if (!itr->valid()) continue;
+        if ((*itr)->referenceCount()>1) return true;
+        ownData.insert(itr->get());
+    }
+
+    Geometry::ArrayList arrays;
+    geom.getArrayList(arrays);
+    for(Geometry::ArrayList::const_iterator itr = arrays.begin();
+        itr != arrays.end();
+        ++itr)
+    {
+        ownData.insert(itr->get());
+    }
+
+    for(BufferDataSet::const_iterator itr = ownData.begin();
+        itr != ownData.end();
+        ++itr)
+    {
+        const BufferObject* bufferObject = (*itr)->getBufferObject();
+        if (!bufferObject) continue;
+
+        for(unsigned int i=0; i<bufferObject->getNumBufferData(); ++i)
+        {
+            const BufferData* bufferData = bufferObject->getBufferData(i);
+            if (bufferData && ownData.count(bufferData)==0) return true;
+        }
+    }
+    return false;
+}
+
+// Applies the operation to each geometry of a range of the list.
+class GeometryOperationFunctor : public osg::TaskScheduler::ParallelForFunctor
+{
+public:
+    GeometryOperationFunctor(GeometryOperation& operation, GeometryVector& geometries):
+        _operation(operation),
+        _geometries(geometries) {}
+
+    virtual void operator() (unsigned int begin, unsigned int end)
+    {
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            _operation(*_geometries[i]);
+        }
+    }
+
+protected:
+    GeometryOperation&      _operation;
+    GeometryVector&         _geometries;
+};
+
+// Apply the operation to all the geometries in the list, spreading the geometries that don't share
+// data across numThreads threads of the shared TaskScheduler and then doing the rest serially. Each
+// geometry is processed by exactly one thread so the result doesn't depend upon the number of threads used.
+void applyToGeometries(GeometryCollector::GeometryList& geometryList, GeometryOperation& operation, unsigned int numThreads)
+{
+    GeometryVector independent, shared;
+    for(GeometryCollector::GeometryList::iterator itr = geometryList.begin();
+        itr != geometryList.end();
+        ++itr)
+    {
+        if (numThreads>1 && !sharesData(*(*itr))) independent.push_back(*itr);
+        else shared.push_back(*itr);
+    }
+
+    if (!independent.empty())
+    {
+        GeometryOperationFunctor functor(operation, independent);
+        osg::TaskScheduler::instance()->parallelFor(static_cast<unsigned int>(independent.size()), functor, numThreads);
+    }
+
+    for(GeometryVector::iterator itr = shared.begin();
+        itr != shared.end();
+        ++itr)
+    {
+        operation(*(*itr));
+    }
+}
+
+unsigned int getNumThreads(Optimizer* optimizer)
+{
+    return optimizer ? optimizer->getNumThreads() : 1;
+}
+
+}
+
 namespace
 {
 typedef std::vector<unsigned int> IndexList;
@@ -401,12 +530,8 @@ void IndexMeshVisitor::makeMesh(Geometry& geom)
 
 void IndexMeshVisitor::makeMesh()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        makeMesh(*(*itr));
-    }
+    GeometryMemberOperation<IndexMeshVisitor> operation(*this, &IndexMeshVisitor::makeMesh);
+    applyToGeometries(_geometryList, operation, getNumThreads(_optimizer));
 }
 
 namespace
@@ -878,12 +1003,8 @@ void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
 
 void VertexCacheVisitor::optimizeVertices()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        optimizeVertices(*(*itr));
-    }
+    GeometryMemberOperation<VertexCacheVisitor> operation(*this, &VertexCacheVisitor::optimizeVertices);
+    applyToGeometries(_geometryList, operation, getNumThreads(_optimizer));
 }
 
 VertexCacheMissVisitor::VertexCacheMissVisitor(unsigned cacheSize)
@@ -1107,12 +1228,8 @@ struct VertexReorder : public TriangleLinePointIndexFunctor<osgUtil::VertexReord
 
 void VertexAccessOrderVisitor::optimizeOrder()
 {
-    for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
-         itr != end;
-         ++itr)
-    {
-        optimizeOrder(*(*itr));
-    }
+    GeometryMemberOperation<VertexAccessOrderVisitor> operation(*this, &VertexAccessOrderVisitor::optimizeOrder);
+    applyToGeometries(_geometryList, operation, getNumThreads(_optimizer));
 }
 
 template<typename DE>
@@ -40,6 +40,8 @@
 #include <osgUtil/Statistics>
 #include <osgUtil/MeshOptimizers>
 
+#include <OpenThreads/Thread>
+
 #include <typeinfo>
 #include <algorithm>
 #include <numeric>
@@ -49,11 +51,33 @@
 
 using namespace osgUtil;
 
+namespace
+{
+// Reports how long an optimization pass took when the notify level is INFO or above.
+class PassTimer
+{
+public:
+    PassTimer(const char* pass):
+        _pass(pass),
+        _startTick(osg::Timer::instance()->tick()) {}
+
+    ~PassTimer()
+    {
+        OSG_INFO<<"Optimizer::optimize() "<<_pass<<" took "<<osg::Timer::instance()->delta_m(_startTick, osg::Timer::instance()->tick())<<"ms"<<std::endl;
+    }
+
+protected:
+    const char*     _pass;
+    osg::Timer_t    _startTick;
+};
+}
+
 void Optimizer::reset()
 {
 }
 
 static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS");
+static osg::ApplicationUsageProxy Optimizer_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER_NUM_THREADS <num>","Number of threads used by the INDEX_MESH, VERTEX_POSTTRANSFORM and VERTEX_PRETRANSFORM passes, 0 uses one thread per processor.");
 
 void Optimizer::optimize(osg::Node* node)
 {
@@ -138,10 +162,22 @@ void Optimizer::optimize(osg::Node* node)
         options = DEFAULT_OPTIMIZATIONS;
     }
 
+    const char* numThreadsEnv = getenv("OSG_OPTIMIZER_NUM_THREADS");
+    if (numThreadsEnv)
+    {
+        setNumThreads(atoi(numThreadsEnv));
+    }
+
     optimize(node,options);
 
 }
 
+void Optimizer::setNumThreads(unsigned int numThreads)
+{
+    _numThreads = (numThreads>0) ? numThreads : OpenThreads::GetNumberOfProcessors();
+    if (_numThreads<1) _numThreads = 1;
+}
+
 void Optimizer::optimize(osg::Node* node, unsigned int options)
 {
     StatsVisitor stats;
@@ -156,6 +192,9 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & STATIC_OBJECT_DETECTION)
     {
+        OSG_INFO<<"Optimizer::optimize() doing STATIC_OBJECT_DETECTION"<<std::endl;
+        PassTimer timer("STATIC_OBJECT_DETECTION");
+
         StaticObjectDetectionVisitor sodv;
         node->accept(sodv);
     }
@@ -163,6 +202,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & TESSELLATE_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing TESSELLATE_GEOMETRY"<<std::endl;
+        PassTimer timer("TESSELLATE_GEOMETRY");
 
         TessellateVisitor tsv;
         node->accept(tsv);
@@ -171,6 +211,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & REMOVE_LOADED_PROXY_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_LOADED_PROXY_NODES"<<std::endl;
+        PassTimer timer("REMOVE_LOADED_PROXY_NODES");
 
         RemoveLoadedProxyNodesVisitor rlpnv(this);
         node->accept(rlpnv);
@@ -181,6 +222,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & COMBINE_ADJACENT_LODS)
     {
         OSG_INFO<<"Optimizer::optimize() doing COMBINE_ADJACENT_LODS"<<std::endl;
+        PassTimer timer("COMBINE_ADJACENT_LODS");
 
         CombineLODsVisitor clv(this);
         node->accept(clv);
@@ -190,6 +232,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & OPTIMIZE_TEXTURE_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing OPTIMIZE_TEXTURE_SETTINGS"<<std::endl;
+        PassTimer timer("OPTIMIZE_TEXTURE_SETTINGS");
 
         TextureVisitor tv(true,true, // unref image
                           false,false, // client storage
@@ -201,6 +244,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & SHARE_DUPLICATE_STATE)
     {
         OSG_INFO<<"Optimizer::optimize() doing SHARE_DUPLICATE_STATE"<<std::endl;
+        PassTimer timer("SHARE_DUPLICATE_STATE");
 
         bool combineDynamicState = false;
         bool combineStaticState = true;
@@ -214,6 +258,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & TEXTURE_ATLAS_BUILDER)
     {
         OSG_INFO<<"Optimizer::optimize() doing TEXTURE_ATLAS_BUILDER"<<std::endl;
+        PassTimer timer("TEXTURE_ATLAS_BUILDER");
 
         // traverse the scene collecting textures into texture atlas.
         TextureAtlasVisitor tav(this);
@@ -233,6 +278,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & COPY_SHARED_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing COPY_SHARED_NODES"<<std::endl;
+        PassTimer timer("COPY_SHARED_NODES");
 
         CopySharedSubgraphsVisitor cssv(this);
         node->accept(cssv);
@@ -242,6 +288,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & FLATTEN_STATIC_TRANSFORMS)
     {
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS"<<std::endl;
+        PassTimer timer("FLATTEN_STATIC_TRANSFORMS");
 
         int i=0;
         bool result = false;
@@ -263,6 +310,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS)
     {
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS"<<std::endl;
+        PassTimer timer("FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS");
 
         // now combine any adjacent static transforms.
         FlattenStaticTransformsDuplicatingSharedSubgraphsVisitor fstdssv(this);
@@ -273,6 +321,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & REMOVE_REDUNDANT_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_REDUNDANT_NODES"<<std::endl;
+        PassTimer timer("REMOVE_REDUNDANT_NODES");
 
         RemoveEmptyNodesVisitor renv(this);
         node->accept(renv);
@@ -287,20 +336,16 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & MERGE_GEODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEODES"<<std::endl;
-
-        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        PassTimer timer("MERGE_GEODES");
 
         MergeGeodesVisitor visitor;
         node->accept(visitor);
-
-        osg::Timer_t endTick = osg::Timer::instance()->tick();
-
-        OSG_INFO<<"MERGE_GEODES took "<<osg::Timer::instance()->delta_s(startTick,endTick)<<std::endl;
     }
 
     if (options & MAKE_FAST_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing MAKE_FAST_GEOMETRY"<<std::endl;
+        PassTimer timer("MAKE_FAST_GEOMETRY");
 
         MakeFastGeometryVisitor mgv(this);
         node->accept(mgv);
@@ -309,21 +354,19 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & MERGE_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEOMETRY"<<std::endl;
-
-        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        PassTimer timer("MERGE_GEOMETRY");
 
         MergeGeometryVisitor mgv(this);
         mgv.setTargetMaximumNumberOfVertices(10000);
         node->accept(mgv);
-
-        osg::Timer_t endTick = osg::Timer::instance()->tick();
-
-        OSG_INFO<<"MERGE_GEOMETRY took "<<osg::Timer::instance()->delta_s(startTick,endTick)<<std::endl;
     }
 
 
     if (options & FLATTEN_BILLBOARDS)
     {
+        OSG_INFO<<"Optimizer::optimize() doing FLATTEN_BILLBOARDS"<<std::endl;
+        PassTimer timer("FLATTEN_BILLBOARDS");
+
         FlattenBillboardVisitor fbv(this);
         node->accept(fbv);
         fbv.process();
@@ -332,6 +375,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & SPATIALIZE_GROUPS)
     {
         OSG_INFO<<"Optimizer::optimize() doing SPATIALIZE_GROUPS"<<std::endl;
+        PassTimer timer("SPATIALIZE_GROUPS");
 
         SpatializeGroupsVisitor sv(this);
         node->accept(sv);
@@ -341,6 +385,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & INDEX_MESH)
     {
         OSG_INFO<<"Optimizer::optimize() doing INDEX_MESH"<<std::endl;
+        PassTimer timer("INDEX_MESH");
         IndexMeshVisitor imv(this);
         node->accept(imv);
         imv.makeMesh();
@@ -349,7 +394,10 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & VERTEX_POSTTRANSFORM)
     {
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_POSTTRANSFORM"<<std::endl;
-        VertexCacheVisitor vcv;
+        PassTimer timer("VERTEX_POSTTRANSFORM");
+        // the optimizer is only passed on for getNumThreads(), GeometryCollector doesn't check the
+        // permissible options, so the same geometries are processed as when it was left out.
+        VertexCacheVisitor vcv(this);
         node->accept(vcv);
         vcv.optimizeVertices();
     }
@@ -357,7 +405,9 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & VERTEX_PRETRANSFORM)
     {
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_PRETRANSFORM"<<std::endl;
-        VertexAccessOrderVisitor vaov;
+        PassTimer timer("VERTEX_PRETRANSFORM");
+        // as above, the optimizer is only passed on for getNumThreads().
+        VertexAccessOrderVisitor vaov(this);
         node->accept(vaov);
         vaov.optimizeOrder();
     }
@@ -365,6 +415,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & BUFFER_OBJECT_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing BUFFER_OBJECT_SETTINGS"<<std::endl;
+        PassTimer timer("BUFFER_OBJECT_SETTINGS");
         BufferObjectVisitor bov(true, true, true, true, true, false);
         node->accept(bov);
     }
@@ -12,6 +12,7 @@
 */
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 
 #include <osgUtil/RenderBin>
 #include <osgUtil/RenderStage>
@@ -20,6 +21,7 @@
 #include <osg/Notify>
 #include <osg/ApplicationUsage>
 #include <osg/AlphaFunc>
+#include <osg/Types>
 
 #include <algorithm>
 
@@ -38,6 +40,10 @@ class RenderBinPrototypeList : osg::depends_on<OpenThreads::Mutex*, osg::Referen
             add("SORT_BACK_TO_FRONT",new RenderBin(RenderBin::SORT_BACK_TO_FRONT));
             add("SORT_FRONT_TO_BACK",new RenderBin(RenderBin::SORT_FRONT_TO_BACK));
             add("TraversalOrderBin",new RenderBin(RenderBin::TRAVERSAL_ORDER));
+            add("CoherentDepthSortedBin",new RenderBin(RenderBin::SORT_BACK_TO_FRONT_COHERENT));
+            add("SORT_BACK_TO_FRONT_COHERENT",new RenderBin(RenderBin::SORT_BACK_TO_FRONT_COHERENT));
+            add("SORT_FRONT_TO_BACK_COHERENT",new RenderBin(RenderBin::SORT_FRONT_TO_BACK_COHERENT));
+            add("DrawKeySortedBin",new RenderBin(RenderBin::SORT_BY_DRAW_KEY));
         }
 
         void add(const std::string& name, RenderBin* bin)
@@ -113,7 +119,7 @@ void RenderBin::removeRenderBinPrototype(RenderBin* proto)
 
 static bool s_defaultBinSortModeInitialized = false;
 static RenderBin::SortMode s_defaultBinSortMode = RenderBin::SORT_BY_STATE;
-static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT");
+static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT | SORT_FRONT_TO_BACK_COHERENT | SORT_BACK_TO_FRONT_COHERENT | SORT_BY_DRAW_KEY");
 
 void RenderBin::setDefaultRenderBinSortMode(RenderBin::SortMode mode)
 {
@@ -136,6 +142,9 @@ RenderBin::SortMode RenderBin::getDefaultRenderBinSortMode()
             else if (strcmp(str,"SORT_FRONT_TO_BACK")==0) s_defaultBinSortMode = RenderBin::SORT_FRONT_TO_BACK;
             else if (strcmp(str,"SORT_BACK_TO_FRONT")==0) s_defaultBinSortMode = RenderBin::SORT_BACK_TO_FRONT;
             else if (strcmp(str,"TRAVERSAL_ORDER")==0) s_defaultBinSortMode = RenderBin::TRAVERSAL_ORDER;
+            else if (strcmp(str,"SORT_FRONT_TO_BACK_COHERENT")==0) s_defaultBinSortMode = RenderBin::SORT_FRONT_TO_BACK_COHERENT;
+            else if (strcmp(str,"SORT_BACK_TO_FRONT_COHERENT")==0) s_defaultBinSortMode = RenderBin::SORT_BACK_TO_FRONT_COHERENT;
+            else if (strcmp(str,"SORT_BY_DRAW_KEY")==0) s_defaultBinSortMode = RenderBin::SORT_BY_DRAW_KEY;
         }
     }
 
@@ -149,6 +158,7 @@ RenderBin::RenderBin()
     _stage = NULL;
     _sorted = false;
     _sortMode = getDefaultRenderBinSortMode();
+    _numCoherentlySortedLeaves = 0;
 }
 
 RenderBin::RenderBin(SortMode mode)
@@ -158,9 +168,10 @@ RenderBin::RenderBin(SortMode mode)
     _stage = NULL;
     _sorted = false;
     _sortMode = mode;
+    _numCoherentlySortedLeaves = 0;
 
 #if 1
-    if (_sortMode==SORT_BACK_TO_FRONT)
+    if (_sortMode==SORT_BACK_TO_FRONT || _sortMode==SORT_BACK_TO_FRONT_COHERENT)
     {
         _stateset  = new osg::StateSet;
         _stateset->setThreadSafeRefUnref(true);
@@ -185,6 +196,7 @@ RenderBin::RenderBin(const RenderBin& rhs,const CopyOp& copyop):
         _bins(rhs._bins),
         _stateGraphList(rhs._stateGraphList),
         _renderLeafList(rhs._renderLeafList),
+        _numCoherentlySortedLeaves(0),
         _sorted(rhs._sorted),
         _sortMode(rhs._sortMode),
         _sortCallback(rhs._sortCallback),
@@ -202,8 +214,27 @@ void RenderBin::reset()
 {
     _stateGraphList.clear();
     _renderLeafList.clear();
+
+    // bins retained last frame that find_or_insert() didn't hand back have gone out of use, so release them.
+    _retainedBins.clear();
+
+    // keep hold of child bins that sort coherently, or by draw key, so that find_or_insert() can hand them
+    // back next frame along with the order they sorted their leaves into and their sort storage.
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr != _bins.end();
+        ++itr)
+    {
+        SortMode mode = itr->second->getSortMode();
+        if (mode==SORT_FRONT_TO_BACK_COHERENT || mode==SORT_BACK_TO_FRONT_COHERENT || mode==SORT_BY_DRAW_KEY)
+        {
+            itr->second->reset();
+            _retainedBins[itr->first] = itr->second;
+        }
+    }
+
     _bins.clear();
     _sorted = false;
+    _numCoherentlySortedLeaves = 0;
 }
 
 void RenderBin::sort()
@@ -250,6 +281,15 @@ void RenderBin::sortImplementation()
         case(TRAVERSAL_ORDER):
             sortTraversalOrder();
             break;
+        case(SORT_FRONT_TO_BACK_COHERENT):
+            sortFrontToBackCoherent();
+            break;
+        case(SORT_BACK_TO_FRONT_COHERENT):
+            sortBackToFrontCoherent();
+            break;
+        case(SORT_BY_DRAW_KEY):
+            sortByDrawKey();
+            break;
     }
 }
 
@@ -346,6 +386,284 @@ void RenderBin::sortTraversalOrder()
     std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
 }
 
+void RenderBin::sortFrontToBackCoherent()
+{
+    sortCoherent(false);
+}
+
+void RenderBin::sortBackToFrontCoherent()
+{
+    sortCoherent(true);
+}
+
+namespace
+{
+
+typedef std::pair<unsigned int, unsigned int> DepthKeyIndex;
+typedef std::vector<DepthKeyIndex> DepthKeyIndexList;
+
+/** Map a depth onto an unsigned int key with the same ordering, flipping the sign bit of positive values
+  * and all the bits of negative ones.*/
+inline unsigned int depthKey(float depth, bool backToFront)
+{
+    unsigned int bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    unsigned int key = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    return backToFront ? ~key : key;
+}
+
+/** Stable insertion sort of entries on their keys, giving up once more than maxMoves elements have been shifted.*/
+bool insertionSort(DepthKeyIndexList& entries, unsigned int maxMoves)
+{
+    unsigned int numMoves = 0;
+    for(unsigned int i=1; i<entries.size(); ++i)
+    {
+        DepthKeyIndex entry = entries[i];
+        unsigned int j = i;
+        while(j>0 && entry.first<entries[j-1].first)
+        {
+            entries[j] = entries[j-1];
+            --j;
+            if (++numMoves>maxMoves)
+            {
+                entries[j] = entry;
+                return false;
+            }
+        }
+        entries[j] = entry;
+    }
+    return true;
+}
+
+/** Stable LSD radix sort of entries on their keys, 8 bits per pass, skipping passes where all keys share the same byte.
+  * buffer is resized to hold the entries between passes.*/
+template<typename EntryList>
+void radixSort(EntryList& entries, EntryList& buffer)
+{
+    typedef typename EntryList::value_type Entry;
+    typedef typename EntryList::const_iterator EntryIterator;
+
+    if (entries.empty()) return;
+
+    buffer.resize(entries.size());
+    for(unsigned int shift=0; shift<sizeof(typename Entry::first_type)*8; shift+=8)
+    {
+        unsigned int counts[256];
+        memset(counts, 0, sizeof(counts));
+        for(EntryIterator itr = entries.begin(); itr != entries.end(); ++itr)
+        {
+            ++counts[(itr->first>>shift) & 0xff];
+        }
+
+        if (counts[(entries.front().first>>shift) & 0xff]==entries.size()) continue;
+
+        unsigned int offset = 0;
+        for(unsigned int i=0; i<256; ++i)
+        {
+            unsigned int count = counts[i];
+            counts[i] = offset;
+            offset += count;
+        }
+
+        for(EntryIterator itr = entries.begin(); itr != entries.end(); ++itr)
+        {
+            buffer[counts[(itr->first>>shift) & 0xff]++] = *itr;
+        }
+        entries.swap(buffer);
+    }
+}
+
+}
+
+void RenderBin::sortCoherent(bool backToFront)
+{
+    copyLeavesFromStateGraphListToRenderLeafList();
+
+    _numCoherentlySortedLeaves = 0;
+
+    unsigned int numLeaves = _renderLeafList.size();
+    if (numLeaves<2)
+    {
+        _coherentSortOrder.clear();
+        return;
+    }
+
+    DepthKeyIndexList entries(numLeaves);
+
+    // The leaves arrive in cull traversal order, which is stable from frame to frame, so when the number of
+    // leaves hasn't changed last frame's sorted order of traversal indices is a good starting point that
+    // only needs repairing where depths have crossed over.
+    bool sorted = false;
+    if (_coherentSortOrder.size()==numLeaves)
+    {
+        for(unsigned int i=0; i<numLeaves; ++i)
+        {
+            unsigned int index = _coherentSortOrder[i];
+            entries[i] = DepthKeyIndex(depthKey(_renderLeafList[index]->_depth, backToFront), index);
+        }
+
+        sorted = insertionSort(entries, numLeaves*4);
+        if (sorted) _numCoherentlySortedLeaves = numLeaves;
+    }
+    else
+    {
+        for(unsigned int i=0; i<numLeaves; ++i)
+        {
+            entries[i] = DepthKeyIndex(depthKey(_renderLeafList[i]->_depth, backToFront), i);
+        }
+    }
+
+    // too many changes since last frame to repair cheaply, so fall back to a full sort.
+    if (!sorted)
+    {
+        DepthKeyIndexList buffer;
+        radixSort(entries, buffer);
+    }
+
+    RenderLeafList sortedLeaves(numLeaves);
+    _coherentSortOrder.resize(numLeaves);
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        _coherentSortOrder[i] = entries[i].second;
+        sortedLeaves[i] = _renderLeafList[entries[i].second];
+    }
+    _renderLeafList.swap(sortedLeaves);
+}
+
+namespace
+{
+
+typedef std::pair<const osg::StateAttribute*, unsigned int> AttributeIndex;
+typedef std::vector<AttributeIndex> AttributeIndexList;
+
+/** Or into the key of each StateGraph listed in attributes the dense rank of its attribute in order of first appearance,
+  * with 0 left for no attribute and the last rank shared by everything once the 16 bits available are used up.
+  * attributes pairs each attribute with the index of the StateGraph it's in effect for, and is sorted in place.*/
+void rankAttributes(AttributeIndexList& attributes, std::vector<unsigned int>& firstIndices,
+                    std::vector<uint64_t>& stateKeys, unsigned int shift)
+{
+    // grouping the StateGraphs by attribute puts the index of each attribute's first appearance at the start of its group.
+    std::sort(attributes.begin(), attributes.end());
+
+    firstIndices.clear();
+    for(unsigned int i=0; i<attributes.size(); ++i)
+    {
+        if (i==0 || attributes[i].first!=attributes[i-1].first) firstIndices.push_back(attributes[i].second);
+    }
+    std::sort(firstIndices.begin(), firstIndices.end());
+
+    uint64_t rank = 0;
+    for(unsigned int i=0; i<attributes.size(); ++i)
+    {
+        if (i==0 || attributes[i].first!=attributes[i-1].first)
+        {
+            unsigned int numBefore = std::lower_bound(firstIndices.begin(), firstIndices.end(), attributes[i].second) - firstIndices.begin();
+            rank = osg::minimum(numBefore+1, 0xffffu);
+        }
+        stateKeys[attributes[i].second] |= rank << shift;
+    }
+}
+
+/** Map depth onto 0 to 65535 across the finite range minDepth to maxDepth, clamping depths outside the
+  * range, including infinite ones, to its ends.*/
+inline uint64_t quantizeDepth(float depth, float minDepth, float maxDepth, float depthScale)
+{
+    if (depth<=minDepth) return 0;
+    if (depth>=maxDepth) return 0xffff;
+    return static_cast<uint64_t>(osg::clampBetween((depth-minDepth)*depthScale, 0.0f, 65535.0f));
+}
+
+}
+
+void RenderBin::sortByDrawKey()
+{
+    // The key packs, from most to least significant 16 bits, the ranks of the program and first texture
+    // in effect for each StateGraph, the StateGraph's own position in the bin and the leaf's quantized
+    // front to back depth, so a single radix sort groups leaves by their most expensive state changes.
+    unsigned int numStateGraphs = _stateGraphList.size();
+    _drawKeyStateKeys.resize(numStateGraphs);
+    _drawKeyPrograms.clear();
+    _drawKeyTextures.clear();
+
+    for(unsigned int i=0; i<numStateGraphs; ++i)
+    {
+        const osg::StateAttribute* program = 0;
+        const osg::StateAttribute* texture = 0;
+        for(StateGraph* sg = _stateGraphList[i]; sg && !(program && texture); sg = sg->_parent)
+        {
+            const osg::StateSet* stateset = sg->getStateSet();
+            if (!stateset) continue;
+            if (!program) program = stateset->getAttribute(osg::StateAttribute::PROGRAM);
+            if (!texture) texture = stateset->getTextureAttribute(0, osg::StateAttribute::TEXTURE);
+        }
+
+        if (program) _drawKeyPrograms.push_back(DrawKeyAttribute(program, i));
+        if (texture) _drawKeyTextures.push_back(DrawKeyAttribute(texture, i));
+        _drawKeyStateKeys[i] = static_cast<uint64_t>(osg::minimum(i, 0xffffu)) << 16;
+    }
+
+    rankAttributes(_drawKeyPrograms, _drawKeyFirstIndices, _drawKeyStateKeys, 48);
+    rankAttributes(_drawKeyTextures, _drawKeyFirstIndices, _drawKeyStateKeys, 32);
+
+    float minDepth = FLT_MAX;
+    float maxDepth = -FLT_MAX;
+    bool detectedNaN = false;
+
+    _drawKeyLeaves.clear();
+    for(unsigned int i=0; i<numStateGraphs; ++i)
+    {
+        StateGraph::LeafList& leaves = _stateGraphList[i]->_leaves;
+        for(StateGraph::LeafList::iterator litr = leaves.begin();
+            litr != leaves.end();
+            ++litr)
+        {
+            RenderLeaf* leaf = litr->get();
+            if (osg::isNaN(leaf->_depth))
+            {
+                detectedNaN = true;
+                continue;
+            }
+
+            // infinite depths are sorted to the ends of the range rather than stretching it.
+            if (leaf->_depth>=-FLT_MAX && leaf->_depth<=FLT_MAX)
+            {
+                if (leaf->_depth<minDepth) minDepth = leaf->_depth;
+                if (leaf->_depth>maxDepth) maxDepth = leaf->_depth;
+            }
+            _drawKeyLeaves.push_back(DrawKeyLeaf(_drawKeyStateKeys[i], leaf));
+        }
+    }
+
+    if (detectedNaN) OSG_NOTICE<<"Warning: RenderBin::sortByDrawKey() detected NaN depth values, database may be corrupted."<<std::endl;
+
+    // quantize the depth into the bottom 16 bits, when all the depths are equal they all quantize to 0.
+    float depthScale = maxDepth>minDepth ? 65535.0f/(maxDepth-minDepth) : 0.0f;
+    for(std::vector<DrawKeyLeaf>::iterator itr = _drawKeyLeaves.begin();
+        itr != _drawKeyLeaves.end();
+        ++itr)
+    {
+        itr->first |= quantizeDepth(itr->second->_depth, minDepth, maxDepth, depthScale);
+    }
+
+    radixSort(_drawKeyLeaves, _drawKeyBuffer);
+
+    _renderLeafList.clear();
+    _renderLeafList.reserve(_drawKeyLeaves.size());
+    for(std::vector<DrawKeyLeaf>::iterator itr = _drawKeyLeaves.begin();
+        itr != _drawKeyLeaves.end();
+        ++itr)
+    {
+        _renderLeafList.push_back(itr->second);
+    }
+
+    // keep the storage but not the pointers to this frame's leaves.
+    _drawKeyLeaves.clear();
+    _drawKeyBuffer.clear();
+
+    // empty the render graph list to prevent it being drawn along side the render leaf list (see drawImplementation.)
+    _stateGraphList.clear();
+}
+
 void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
 {
     _renderLeafList.clear();
@@ -389,12 +707,35 @@ void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
     _stateGraphList.clear();
 }
 
+// a bin retained from a previous frame can only stand in for a new one made from the same kind of prototype.
+static bool isSameKindOfBin(const RenderBin* bin, const RenderBin* prototype)
+{
+    return prototype &&
+           strcmp(bin->className(), prototype->className())==0 &&
+           strcmp(bin->libraryName(), prototype->libraryName())==0 &&
+           bin->getSortMode()==prototype->getSortMode();
+}
+
 RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
 {
     // search for appropriate bin.
     RenderBinList::iterator itr = _bins.find(binNum);
     if (itr!=_bins.end()) return itr->second.get();
 
+    // reuse a bin retained from a previous frame, unless the bin number now asks for a different kind of bin.
+    RenderBinList::iterator ritr = _retainedBins.find(binNum);
+    if (ritr!=_retainedBins.end())
+    {
+        RenderBin* rb = ritr->second.get();
+        if (isSameKindOfBin(rb, getRenderBinPrototype(binName)))
+        {
+            _bins[binNum] = rb;
+            _retainedBins.erase(ritr);
+            return rb;
+        }
+        _retainedBins.erase(ritr);
+    }
+
     // create a rendering bin and insert into bin list.
     RenderBin* rb = RenderBin::createRenderBin(binName);
     if (rb)
@@ -419,6 +760,43 @@ RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
     return rb;
 }
 
+RenderBin* RenderBin::find_or_insert(int binNum,const RenderBin* prototype)
+{
+    if (!prototype) return find_or_insert(binNum, std::string("RenderBin"));
+
+    RenderBinList::iterator itr = _bins.find(binNum);
+    if (itr!=_bins.end()) return itr->second.get();
+
+    RenderBinList::iterator ritr = _retainedBins.find(binNum);
+    if (ritr!=_retainedBins.end())
+    {
+        RenderBin* rb = ritr->second.get();
+        if (isSameKindOfBin(rb, prototype))
+        {
+            _bins[binNum] = rb;
+            _retainedBins.erase(ritr);
+            return rb;
+        }
+        _retainedBins.erase(ritr);
+    }
+
+    RenderBin* rb = dynamic_cast<RenderBin*>(prototype->clone(osg::CopyOp::SHALLOW_COPY));
+    if (rb)
+    {
+        // keep the prototype's settings and callbacks but none of its contents.
+        rb->_bins.clear();
+        rb->_stateGraphList.clear();
+        rb->_renderLeafList.clear();
+        rb->_sorted = false;
+
+        rb->_binNum = binNum;
+        rb->_parent = this;
+        rb->_stage = _stage;
+        _bins[binNum] = rb;
+    }
+    return rb;
+}
+
 void RenderBin::draw(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     renderInfo.pushRenderBin(this);
@@ -535,6 +913,7 @@ bool RenderBin::getStats(Statistics& stats) const
     // different by return type - collects the stats in this renderrBin
     bool statsCollected = false;
     stats.addOrderedLeaves(_renderLeafList.size());
+    stats.addCoherentlySortedLeaves(_numCoherentlySortedLeaves);
     // draw fine grained ordering.
     for(RenderLeafList::const_iterator dw_itr = _renderLeafList.begin();
         dw_itr != _renderLeafList.end();
@@ -46,6 +46,7 @@ void Statistics::reset()
     nimpostor=0;
     numStateGraphs=0;
     numOrderedLeaves=0;
+    numCoherentlySortedLeaves=0;
 
     _binNo = 0;
 
@@ -119,6 +120,7 @@ void Statistics::add(const Statistics& stats)
     nimpostor += stats.nimpostor;
     numStateGraphs += stats.numStateGraphs;
     numOrderedLeaves += stats.numOrderedLeaves;
+    numCoherentlySortedLeaves += stats.numCoherentlySortedLeaves;
 
     _vertexCount += stats._vertexCount;
     for(PrimitiveValueMap::const_iterator pitr = stats._primitiveCount.begin();
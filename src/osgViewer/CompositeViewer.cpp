@@ -1487,6 +1487,12 @@ void CompositeViewer::updateTraversal()
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
     }
 
+    if (getViewerStats() && getViewerStats()->collectStats("object_cache"))
+    {
+        osgDB::ObjectCache* objectCache = osgDB::Registry::instance()->getObjectCache();
+        if (objectCache) objectCache->recordStats(getViewerStats(), _frameStamp->getFrameNumber());
+    }
+
 }
 
 double CompositeViewer::elapsedTime()
@@ -631,6 +631,7 @@ static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView*
     stats->setAttribute(frameNumber, "Number of StateGraphs", static_cast<double>(sceneStats.numStateGraphs));
     stats->setAttribute(frameNumber, "Visible number of impostors", static_cast<double>(sceneStats.nimpostor));
     stats->setAttribute(frameNumber, "Number of ordered leaves", static_cast<double>(sceneStats.numOrderedLeaves));
+    stats->setAttribute(frameNumber, "Number of coherently sorted leaves", static_cast<double>(sceneStats.numCoherentlySortedLeaves));
 
     unsigned int totalNumPrimitiveSets = 0;
     const osgUtil::Statistics::PrimitiveValueMap& pvm = sceneStats.getPrimitiveValueMap();
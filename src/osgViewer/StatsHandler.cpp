@@ -193,6 +193,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                             viewer->getViewerStats()->collectStats("frame_rate",false);
                             viewer->getViewerStats()->collectStats("event",false);
                             viewer->getViewerStats()->collectStats("update",false);
+                            viewer->getViewerStats()->collectStats("object_cache",false);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
@@ -239,6 +240,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
 
                             viewer->getViewerStats()->collectStats("event",true);
                             viewer->getViewerStats()->collectStats("update",true);
+                            viewer->getViewerStats()->collectStats("object_cache",true);
 
                             for(osgViewer::ViewerBase::Cameras::iterator itr = cameras.begin();
                                 itr != cameras.end();
@@ -539,6 +541,52 @@ struct RawValueTextDrawCallback : public virtual osg::Drawable::DrawCallback
     mutable osg::Timer_t        _tickLastUpdated;
 };
 
+// Drawcallback to draw the osgDB::ObjectCache attributes recorded in the viewer stats
+struct ObjectCacheStatsTextDrawCallback : public virtual osg::Drawable::DrawCallback
+{
+    ObjectCacheStatsTextDrawCallback(osg::Stats* stats):
+        _stats(stats),
+        _tickLastUpdated(0)
+    {
+    }
+
+    /** do customized draw code.*/
+    virtual void drawImplementation(osg::RenderInfo& renderInfo,const osg::Drawable* drawable) const
+    {
+        osgText::Text* text = (osgText::Text*)drawable;
+
+        osg::Timer_t tick = osg::Timer::instance()->tick();
+        double delta = osg::Timer::instance()->delta_m(_tickLastUpdated, tick);
+
+        if (delta>50) // update every 50ms
+        {
+            _tickLastUpdated = tick;
+
+            unsigned int frameNumber = renderInfo.getState()->getFrameStamp()->getFrameNumber();
+            double numObjects, numBytes, numHits, numMisses, numEvictions;
+            if (_stats->getAttribute(frameNumber, "ObjectCache objects", numObjects) &&
+                _stats->getAttribute(frameNumber, "ObjectCache bytes", numBytes) &&
+                _stats->getAttribute(frameNumber, "ObjectCache hits", numHits) &&
+                _stats->getAttribute(frameNumber, "ObjectCache misses", numMisses) &&
+                _stats->getAttribute(frameNumber, "ObjectCache evictions", numEvictions))
+            {
+                char tmpText[256];
+                sprintf(tmpText,"ObjectCache objects: %.0f  size: %.1fMB  hits: %.0f  misses: %.0f  evictions: %.0f",
+                        numObjects, numBytes/(1024.0*1024.0), numHits, numMisses, numEvictions);
+                text->setText(tmpText);
+            }
+            else
+            {
+                text->setText("");
+            }
+        }
+        text->drawImplementation(renderInfo);
+    }
+
+    osg::ref_ptr<osg::Stats>    _stats;
+    mutable osg::Timer_t        _tickLastUpdated;
+};
+
 struct CameraSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCallback
 {
     CameraSceneStatsTextDrawCallback(osg::Camera* camera, int cameraNumber):
@@ -604,6 +652,7 @@ struct CameraSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCall
                 STATS_ATTRIBUTE("Visible number of impostors")
                 STATS_ATTRIBUTE("Visible number of drawables")
                 STATS_ATTRIBUTE("Number of ordered leaves")
+                STATS_ATTRIBUTE("Number of coherently sorted leaves")
                 STATS_ATTRIBUTE("Visible number of fast drawables")
                 STATS_ATTRIBUTE("Visible vertex count")
 
@@ -1583,6 +1632,28 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
 
             pos.x() = _leftPos;
         }
+
+        // ObjectCache stats, recorded by the viewer when the "object_cache" stats are collected
+        {
+            pos.y() -= (_characterSize + backgroundSpacing);
+
+            _statsGeode->addDrawable(createBackgroundRectangle(    pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
+                                                                   _statsWidth - 2 * backgroundMargin,
+                                                                   _characterSize + 2 * backgroundMargin,
+                                                                   backgroundColor));
+
+            osg::ref_ptr<osgText::Text> objectCacheText = new osgText::Text;
+            _statsGeode->addDrawable( objectCacheText.get() );
+
+            objectCacheText->setColor(colorDP);
+            objectCacheText->setFont(_font);
+            objectCacheText->setCharacterSize(_characterSize);
+            objectCacheText->setPosition(pos);
+            objectCacheText->setDataVariance(osg::Object::DYNAMIC);
+            objectCacheText->setDrawCallback(new ObjectCacheStatsTextDrawCallback(viewer->getViewerStats()));
+
+            pos.x() = _leftPos;
+        }
     }
 
     // Camera scene stats
@@ -1598,7 +1669,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         group->addChild(geode);
         geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
                                                         10 * _characterSize + 2 * backgroundMargin,
-                                                        22 * _characterSize + 2 * backgroundMargin,
+                                                        23 * _characterSize + 2 * backgroundMargin,
                                                         backgroundColor));
 
         // Camera scene & primitive stats static text
@@ -1622,6 +1693,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         viewStr << "Imposters" << std::endl;
         viewStr << "Drawables" << std::endl;
         viewStr << "Sorted Drawables" << std::endl;
+        viewStr << "Coherent Sorted" << std::endl;
         viewStr << "Fast Drawables" << std::endl;
         viewStr << "Vertices" << std::endl;
         viewStr << "PrimitiveSets" << std::endl;
@@ -1647,7 +1719,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         {
             geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
                                                             5 * _characterSize + 2 * backgroundMargin,
-                                                            22 * _characterSize + 2 * backgroundMargin,
+                                                            23 * _characterSize + 2 * backgroundMargin,
                                                             backgroundColor));
 
             // Camera scene stats
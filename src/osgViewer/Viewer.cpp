@@ -1224,6 +1224,12 @@ void Viewer::updateTraversal()
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal end time", endUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
     }
+
+    if (getViewerStats() && getViewerStats()->collectStats("object_cache"))
+    {
+        osgDB::ObjectCache* objectCache = osgDB::Registry::instance()->getObjectCache();
+        if (objectCache) objectCache->recordStats(getViewerStats(), _frameStamp->getFrameNumber());
+    }
 }
 
 void Viewer::getScenes(Scenes& scenes, bool /*onlyValid*/)
@@ -15,4 +15,8 @@ REGISTER_OBJECT_WRAPPER( BufferObject,
         UPDATE_TO_VERSION_SCOPED( 201 )
         ADD_HEXINT_SERIALIZER( MappingBitfield, 0x0 );  // _mappingBitField
     }
+    {
+        UPDATE_TO_VERSION_SCOPED( 203 )
+        ADD_UINT_SERIALIZER( NumRingBufferFrames, 0u );  // _numRingBufferFrames
+    }
 }